@@ -22,6 +22,13 @@ enum np_return {
   np_invalid_operation,
   np_startup,
 };
+enum np_event_backend {
+  np_event_backend_auto = 0,
+  np_event_backend_epoll,
+  np_event_backend_iouring,
+  np_event_backend_poll,
+  np_event_backend_select,
+};
 const char *np_error_str(enum np_return e);
 struct version_t {
   uint8_t major;
@@ -79,6 +86,7 @@ struct np_settings {
   np_log_write_callback log_write_fn;
   uint16_t              jobqueue_size;
   uint16_t              max_msgs_per_sec;
+  enum np_event_backend event_backend;
 };
 struct np_settings *np_default_settings(struct np_settings *settings);
 np_context         *np_new_context(struct np_settings *settings);
@@ -213,7 +221,7 @@ enum np_data_return   np_set_data(np_datablock_t     *block,
                                   struct np_data_conf data_conf,
                                   np_data_value       data);
 enum np_data_return   np_get_data(np_datablock_t      *block,
-                                  char                 key[255],
+                                  const char          *key,
                                   struct np_data_conf *out_data_config,
                                   np_data_value       *out_data);
 enum np_data_return   np_get_data_size(np_datablock_t *block,
@@ -304,6 +312,11 @@ enum np_search_shingle_mode {
   SEARCH_4_KMER
 };
 enum np_search_node_type { SEARCH_NODE_SERVER = 1, SEARCH_NODE_CLIENT };
+enum np_search_index_layout {
+  SEARCH_INDEX_BKTREE = 0,
+  SEARCH_INDEX_FLAT,
+  SEARCH_INDEX_FLAT_LSH
+};
 struct np_search_settings {
   np_subject                   search_space;
   bool                         enable_remote_peers;
@@ -311,6 +324,8 @@ struct np_search_settings {
   enum np_search_node_type     node_type;
   uint8_t                      local_peer_count;
   uint16_t                     local_table_count;
+  enum np_search_index_layout  index_layout;
+  char                         snapshot_file[255];
   enum np_search_analytic_mode analytic_mode;
   enum np_search_minhash_mode  minhash_mode;
   enum np_search_shingle_mode  shingle_mode;
@@ -650,8 +650,10 @@ bool __file_open(np_state_t *context,
         // }
         // char rotator[] = { '/', '-', '\\', '|' };
         // uint16_t i = 1;
-        size_t left_file_size = _info->file_size;
-        char  *text_start     = _info->mmap_region;
+        size_t            left_file_size = _info->file_size;
+        char             *text_start     = _info->mmap_region;
+        np_searchentry_t *batch[NP_SEARCH_BATCH_ENTRIES];
+        uint32_t          batch_count = 0;
         while (text_start != NULL && left_file_size > 0) {
           // fprintf(stdout, "--- adding search indices: %5u %c \r", i,
           // rotator[i%4]); fflush(stdout);
@@ -665,7 +667,7 @@ bool __file_open(np_state_t *context,
               np_create_searchentry(context, se, search_text, &attr)) {
             // fprintf(stdout, "--- adding search indices: %5u %c \r", i,
             // rotator[i%4]); fflush(stdout);
-            np_search_add_entry(context, se);
+            batch[batch_count++] = se;
             // fprintf(stdout, "--- adding search indices: %5u %c \r", i,
             // rotator[i%4]); fflush(stdout);
           }
@@ -678,10 +680,15 @@ bool __file_open(np_state_t *context,
           if (text_start != NULL) text_start++;
           // i++;
           // fprintf(stdout, "--- adding search indices: %5u %c \r", i,
-          // rotator[i%4]); fflush(stdout); throttle to prevent overload of
-          // other systems
-          np_time_sleep(NP_PI / 157);
+          // rotator[i%4]); fflush(stdout);
+          if (batch_count == NP_SEARCH_BATCH_ENTRIES) {
+            np_search_add_entries(context, batch, batch_count);
+            batch_count = 0;
+            // throttle to prevent overload of other systems
+            np_time_sleep(NP_PI / 157);
+          }
         }
+        np_search_add_entries(context, batch, batch_count);
         // fprintf(stdout, "\n");
       }
     }
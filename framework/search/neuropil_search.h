@@ -28,6 +28,15 @@ enum np_search_shingle_mode {
 };
 enum np_search_node_type { SEARCH_NODE_SERVER = 1, SEARCH_NODE_CLIENT };
 
+// the data structure of the local search tables: a bktree, a flat array of
+// signatures scanned block by block, or the flat array narrowed down with
+// locality sensitive banding (approximate, but much faster for large tables)
+enum np_search_index_layout {
+  SEARCH_INDEX_BKTREE = 0,
+  SEARCH_INDEX_FLAT,
+  SEARCH_INDEX_FLAT_LSH
+};
+
 // a set of settings that affect how your local node is build up and how it
 // interacts with the other peers in the system
 struct np_search_settings {
@@ -40,9 +49,14 @@ struct np_search_settings {
   char bootstrap_node[255]; // join the following network
 
   // settings that affect your local machine
-  enum np_search_node_type node_type;
-  uint8_t                  local_peer_count;
-  uint16_t                 local_table_count; // set BKTREE_ARRAY_SIZE
+  enum np_search_node_type    node_type;
+  uint8_t                     local_peer_count;
+  uint16_t                    local_table_count; // set BKTREE_ARRAY_SIZE
+  enum np_search_index_layout index_layout;
+  uint16_t                    query_radius; // see NP_SEARCH_QUERY_RADIUS
+  // persist the local search tables to this file on shutdown and restore
+  // them on startup, empty to disable
+  char snapshot_file[255];
 
   // settings that affect how text is pre-processed
   enum np_search_analytic_mode analytic_mode;
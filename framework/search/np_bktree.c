@@ -11,6 +11,22 @@
 #define BKTREE_SPREAD     8
 #define BKTREE_BUCKETSIZE 32
 
+// the full 256 bit hamming distance, _np_dhkey_hamming_distance wraps at 255
+static uint16_t __np_bktree_distance(const np_dhkey_t *x, const np_dhkey_t *y) {
+  uint16_t ret = 0;
+  for (uint8_t k = 0; k < 8; k++) {
+    ret += __builtin_popcount(x->t[k] ^ y->t[k]);
+  }
+  return ret;
+}
+
+// all keys below a child bin share between 8*bin and 8*bin+7 bits with the
+// parent key, the last bin also takes the fully populated key
+static uint8_t __np_bktree_bin_index(uint8_t dist_common) {
+  uint8_t bin_index = dist_common / BKTREE_SPREAD;
+  return (bin_index < BKTREE_BUCKETSIZE) ? bin_index : BKTREE_BUCKETSIZE - 1;
+}
+
 int8_t _compare_npindex_entry_add(const void *old, const void *new) {
   np_searchentry_t *_1 = (np_searchentry_t *)old;
   np_searchentry_t *_2 = (np_searchentry_t *)new;
@@ -75,10 +91,11 @@ int8_t _compare_npindex_entry_query(struct np_map_reduce_s *mr_struct,
   else return 1;
 }
 
-void np_bktree_init(np_bktree_t *tree, np_dhkey_t key, uint8_t distance) {
+void np_bktree_init(np_bktree_t *tree, np_dhkey_t key, uint16_t distance) {
   memset(&tree->_root, 0, sizeof(np_bktree_node_t));
   tree->_root._values      = NULL;
   tree->_root._child_nodes = NULL;
+  tree->_max_distance      = distance;
 
   _np_dhkey_assign(&tree->_root._key, &key);
 }
@@ -138,6 +155,11 @@ bool __np_bktree_insert(np_bktree_node_t *tree_node,
 
   float _jc = (float)_dist_common / _dist_diff; // jaccard index
 
+  // the key will end up in this subtree, widen its covering radius
+  uint16_t _distance = __np_bktree_distance(&key, &tree_node->_key);
+  if (tree_node->_max_distance < _distance)
+    tree_node->_max_distance = _distance;
+
   /*  _np_dhkey_and(&_containment, &tree_node->_key, &key);
       // _np_dhkey_hamming_distance_each(&_hd_zero, &_containment, &_null);
       for (uint8_t i = 0; i < 8; i++)
@@ -166,7 +188,7 @@ bool __np_bktree_insert(np_bktree_node_t *tree_node,
   // uint16_t diff = 0; // _np_dhkey_cmp(&tree_node->_key, &key);
   // _np_dhkey_hamming_distance(&diff, &tree_node->_key, &key);
   // _np_neuropil_bloom_containment(it_2->bloom, it_1->bloom, &_similarity);
-  uint8_t bin_index = round(_dist_common / BKTREE_SPREAD);
+  uint8_t bin_index = __np_bktree_bin_index(_dist_common);
   // for (uint16_t i = 0; i < BKTREE_SPREAD; i++)
   // {
   // fprintf(stdout, "ibi: %u\n", bin_index);
@@ -228,8 +250,14 @@ bool np_bktree_insert(np_bktree_t *tree, np_dhkey_t key, void *value) {
 
 void __np_bktree_query(np_bktree_node_t *tree_node,
                        np_dhkey_t        key,
+                       uint16_t          radius,
                        void             *value,
                        np_map_reduce_t  *mr_struct) {
+  // triangle inequality: every key x below this node satisfies
+  // d(key, x) >= d(key, node) - d(node, x) >= d(key, node) - _max_distance
+  uint16_t _distance = __np_bktree_distance(&key, &tree_node->_key);
+  if (_distance > radius + tree_node->_max_distance) return;
+
   // bool _do_map = false;
   // np_lph_t * v = (np_lph_t*) value;
 
@@ -313,7 +341,7 @@ void __np_bktree_query(np_bktree_node_t *tree_node,
   //     // }
   // }
 
-  uint8_t bin_index = round(_dist_common / BKTREE_SPREAD);
+  uint8_t bin_index = __np_bktree_bin_index(_dist_common);
   // fprintf(stdout, "qbi: %u ", bin_index);
 
   // fprintf(stdout, "%u:%u :: ", min_diff, bin_index);
@@ -322,7 +350,7 @@ void __np_bktree_query(np_bktree_node_t *tree_node,
   // {
   uint8_t min_idx = (bin_index == 0) ? 0 : bin_index - 1;
   uint8_t max_idx =
-      (bin_index == BKTREE_BUCKETSIZE) ? BKTREE_BUCKETSIZE : bin_index + 1;
+      (bin_index == BKTREE_BUCKETSIZE - 1) ? bin_index : bin_index + 1;
   // uint8_t j = _index;
   for (uint8_t i = min_idx; i <= max_idx; i++) {
     // fprintf(stdout, "%u", i);
@@ -338,7 +366,11 @@ void __np_bktree_query(np_bktree_node_t *tree_node,
       // if (diff )
       // fprintf(stdout, "%u %p --> step --> ", i,
       // tree_node->_child_nodes[i]->_values);
-      __np_bktree_query(tree_node->_child_nodes[i], key, value, mr_struct);
+      __np_bktree_query(tree_node->_child_nodes[i],
+                        key,
+                        radius,
+                        value,
+                        mr_struct);
       // }
     }
   }
@@ -356,7 +388,7 @@ void np_bktree_query(np_bktree_t     *tree,
   // fprintf(stdout, "search: ");
   mr_struct->cmp = _compare_npindex_entry_query;
 
-  __np_bktree_query(&tree->_root, key, value, mr_struct);
+  __np_bktree_query(&tree->_root, key, tree->_max_distance, value, mr_struct);
   // fprintf(stdout, "\n");
 
   /*    for (uint8_t i = 0; i < 8; i++)
@@ -376,9 +408,37 @@ void np_bktree_query(np_bktree_t     *tree,
   // fprintf(stdout, "\n");
 }
 
+void __np_bktree_foreach(np_bktree_node_t *tree_node,
+                         np_map_reduce_t  *mr_struct) {
+  if (tree_node->_values != NULL) {
+    np_skiplist_map(tree_node->_values, mr_struct);
+  }
+
+  for (uint8_t i = 0; i < BKTREE_BUCKETSIZE; i++) {
+    if (tree_node->_child_nodes != NULL && tree_node->_child_nodes[i] != NULL)
+      __np_bktree_foreach(tree_node->_child_nodes[i], mr_struct);
+  }
+}
+
+// start the skiplist map at the first value of each node
+static int8_t __np_bktree_cmp_first(NP_UNUSED struct np_map_reduce_s *mr_struct,
+                                    NP_UNUSED const void            *element) {
+  return 0;
+}
+
+void np_bktree_foreach(np_bktree_t *tree, np_map_reduce_t *mr_struct) {
+  mr_struct->cmp = __np_bktree_cmp_first;
+
+  __np_bktree_foreach(&tree->_root, mr_struct);
+}
+
 void __np_bktree_remove(np_bktree_node_t *tree_node,
                         np_dhkey_t        key,
                         void             *value) {
+  // the key can only be stored within the covering radius of this node
+  if (__np_bktree_distance(&key, &tree_node->_key) > tree_node->_max_distance)
+    return;
+
   np_dhkey_t _common = {0}, _diff = {0};
 
   _np_dhkey_and(&_common, &key, &tree_node->_key);
@@ -405,7 +465,7 @@ void __np_bktree_remove(np_bktree_node_t *tree_node,
     np_skiplist_remove(tree_node->_values, value);
   }
 
-  uint8_t bin_index = round(_dist_common / BKTREE_SPREAD);
+  uint8_t bin_index = __np_bktree_bin_index(_dist_common);
   // fprintf(stdout, "qbi: %u ", bin_index);
 
   // fprintf(stdout, "%u:%u :: ", min_diff, bin_index);
@@ -414,7 +474,7 @@ void __np_bktree_remove(np_bktree_node_t *tree_node,
   // {
   uint8_t min_idx = (bin_index == 0) ? 0 : bin_index - 1;
   uint8_t max_idx =
-      (bin_index == BKTREE_BUCKETSIZE) ? BKTREE_BUCKETSIZE : bin_index + 1;
+      (bin_index == BKTREE_BUCKETSIZE - 1) ? bin_index : bin_index + 1;
   // uint8_t j = _index;
   for (uint8_t i = min_idx; i <= max_idx; i++) {
     // fprintf(stdout, "%u", i);
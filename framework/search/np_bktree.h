@@ -20,7 +20,9 @@ extern "C" {
 typedef bool (*compare_bktree_value)(const void *left, const void *right);
 
 struct np_bktree_node_s {
-  uint8_t _max_distance;
+  // largest hamming distance between _key and any key stored below this node,
+  // used to prune whole subtrees with the triangle inequality
+  uint16_t _max_distance;
 
   np_dhkey_t     _key;
   np_skiplist_t *_values;
@@ -30,7 +32,9 @@ struct np_bktree_node_s {
 typedef struct np_bktree_node_s np_bktree_node_t;
 
 struct np_bktree_s {
-  uint8_t _max_distance;
+  // query radius: entries further away than this hamming distance from the
+  // query key are not visited
+  uint16_t _max_distance;
 
   np_bktree_node_t _root;
 
@@ -38,7 +42,7 @@ struct np_bktree_s {
 };
 typedef struct np_bktree_s np_bktree_t;
 
-void np_bktree_init(np_bktree_t *tree, np_dhkey_t key, uint8_t _distance);
+void np_bktree_init(np_bktree_t *tree, np_dhkey_t key, uint16_t distance);
 void np_bktree_destroy(np_bktree_t *tree);
 
 bool np_bktree_insert(np_bktree_t *tree, np_dhkey_t key, void *value);
@@ -50,6 +54,9 @@ void np_bktree_query(np_bktree_t     *tree,
 
 void np_bktree_remove(np_bktree_t *tree, np_dhkey_t key, void *value);
 
+// visit all values of the tree regardless of their distance
+void np_bktree_foreach(np_bktree_t *tree, np_map_reduce_t *mr_struct);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,356 @@
+//
+// SPDX-FileCopyrightText: 2016-2024 by pi-lar GmbH
+// SPDX-License-Identifier: OSL-3.0
+//
+
+#include "search/np_flatindex.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define NP_FLATINDEX_USE_AVX2
+#include <immintrin.h>
+#endif
+
+#include "search/np_search.h"
+
+static void __np_flatindex_distance_scalar(const np_dhkey_t *keys,
+                                           uint16_t          count,
+                                           const np_dhkey_t *key,
+                                           uint16_t         *distances) {
+  for (uint16_t i = 0; i < count; i++) {
+    uint16_t distance = 0;
+    for (uint8_t k = 0; k < 8; k++) {
+      distance += __builtin_popcount(keys[i].t[k] ^ key->t[k]);
+    }
+    distances[i] = distance;
+  }
+}
+
+#ifdef NP_FLATINDEX_USE_AVX2
+// number of set bits of each nibble, repeated for both 128 bit lanes
+static const uint8_t __np_flatindex_nibble_bits[32] = {
+    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
+
+// popcount of each byte with a nibble lookup table (W. Mula), summed up into
+// four 64 bit lanes
+__attribute__((target("avx2"))) static inline __m256i
+__np_flatindex_popcount_avx2(__m256i value) {
+  const __m256i lookup =
+      _mm256_loadu_si256((const __m256i *)__np_flatindex_nibble_bits);
+  const __m256i low_mask = _mm256_set1_epi8(0x0f);
+
+  __m256i low  = _mm256_and_si256(value, low_mask);
+  __m256i high = _mm256_and_si256(_mm256_srli_epi16(value, 4), low_mask);
+  __m256i bits = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, low),
+                                 _mm256_shuffle_epi8(lookup, high));
+  return _mm256_sad_epu8(bits, _mm256_setzero_si256());
+}
+
+__attribute__((target("avx2"))) static void
+__np_flatindex_distance_avx2(const np_dhkey_t *keys,
+                             uint16_t          count,
+                             const np_dhkey_t *key,
+                             uint16_t         *distances) {
+  const __m256i query = _mm256_loadu_si256((const __m256i *)key);
+
+  uint16_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m256i sum[4];
+    for (uint8_t j = 0; j < 4; j++) {
+      __m256i signature = _mm256_loadu_si256((const __m256i *)&keys[i + j]);
+      sum[j] = __np_flatindex_popcount_avx2(_mm256_xor_si256(signature, query));
+    }
+    // pack the four distances into 16 bit slots of each lane, then add up the
+    // lanes. a single distance never exceeds 256
+    __m256i packed = _mm256_add_epi64(
+        _mm256_add_epi64(sum[0], _mm256_slli_epi64(sum[1], 16)),
+        _mm256_add_epi64(_mm256_slli_epi64(sum[2], 32),
+                         _mm256_slli_epi64(sum[3], 48)));
+    __m128i half = _mm_add_epi64(_mm256_castsi256_si128(packed),
+                                 _mm256_extracti128_si256(packed, 1));
+    uint64_t total = (uint64_t)_mm_cvtsi128_si64(half) +
+                     (uint64_t)_mm_extract_epi64(half, 1);
+
+    distances[i]     = (uint16_t)(total & 0xffff);
+    distances[i + 1] = (uint16_t)((total >> 16) & 0xffff);
+    distances[i + 2] = (uint16_t)((total >> 32) & 0xffff);
+    distances[i + 3] = (uint16_t)((total >> 48) & 0xffff);
+  }
+  __np_flatindex_distance_scalar(&keys[i], count - i, key, &distances[i]);
+}
+#endif
+
+void np_flatindex_distance(const np_dhkey_t *keys,
+                           uint16_t          count,
+                           const np_dhkey_t *key,
+                           uint16_t         *distances) {
+#ifdef NP_FLATINDEX_USE_AVX2
+  if (__builtin_cpu_supports("avx2")) {
+    __np_flatindex_distance_avx2(keys, count, key, distances);
+  } else {
+    __np_flatindex_distance_scalar(keys, count, key, distances);
+  }
+#else
+  __np_flatindex_distance_scalar(keys, count, key, distances);
+#endif
+}
+
+static int8_t __np_flatindex_cmp(NP_UNUSED struct np_map_reduce_s *mr_struct,
+                                 NP_UNUSED const void             *element) {
+  // entries are not ordered, keep on mapping
+  return 0;
+}
+
+static struct np_flatindex_bucket_s *
+__np_flatindex_bucket(np_flatindex_t   *index,
+                      const np_dhkey_t *key,
+                      uint8_t           band) {
+  uint16_t value  = (uint16_t)(key->t[band / 2] >> ((band % 2) * 16));
+  uint32_t bucket = (((uint32_t)value * 40503u) >> 8) &
+                    (NP_FLATINDEX_BAND_BUCKETS - 1);
+  return &index->_buckets[band * NP_FLATINDEX_BAND_BUCKETS + bucket];
+}
+
+static void __np_flatindex_bucket_add(struct np_flatindex_bucket_s *bucket,
+                                      uint32_t                      position) {
+  if (bucket->_count == bucket->_size) {
+    bucket->_size      = (bucket->_size == 0) ? 8 : 2 * bucket->_size;
+    bucket->_positions = realloc(bucket->_positions,
+                                 bucket->_size * sizeof(uint32_t));
+  }
+  bucket->_positions[bucket->_count] = position;
+  bucket->_count++;
+}
+
+// replaces the position in a bucket, or removes it if replacement is UINT32_MAX
+static void __np_flatindex_bucket_update(struct np_flatindex_bucket_s *bucket,
+                                         uint32_t                      position,
+                                         uint32_t replacement) {
+  for (uint32_t i = 0; i < bucket->_count; i++) {
+    if (bucket->_positions[i] == position) {
+      if (replacement == UINT32_MAX) {
+        bucket->_count--;
+        bucket->_positions[i] = bucket->_positions[bucket->_count];
+      } else {
+        bucket->_positions[i] = replacement;
+      }
+      break;
+    }
+  }
+}
+
+static np_dhkey_t *__np_flatindex_key_at(np_flatindex_t *index,
+                                         uint32_t        position) {
+  return &index->_blocks[position / NP_FLATINDEX_BLOCK_SIZE]
+              ->_keys[position % NP_FLATINDEX_BLOCK_SIZE];
+}
+
+static void **__np_flatindex_value_at(np_flatindex_t *index,
+                                      uint32_t        position) {
+  return &index->_blocks[position / NP_FLATINDEX_BLOCK_SIZE]
+              ->_values[position % NP_FLATINDEX_BLOCK_SIZE];
+}
+
+void np_flatindex_init(np_flatindex_t *index,
+                       np_dhkey_t      key,
+                       uint16_t        distance,
+                       bool            use_bands) {
+  memset(index, 0, sizeof(np_flatindex_t));
+  index->_max_distance = distance;
+  index->_use_bands    = use_bands;
+
+  _np_dhkey_assign(&index->_key, &key);
+}
+
+void np_flatindex_destroy(np_flatindex_t *index) {
+  for (uint32_t i = 0; i < index->_block_count; i++) {
+    free(index->_blocks[i]);
+  }
+  free(index->_blocks);
+
+  if (index->_buckets != NULL) {
+    for (uint32_t i = 0; i < NP_FLATINDEX_BANDS * NP_FLATINDEX_BAND_BUCKETS;
+         i++) {
+      free(index->_buckets[i]._positions);
+    }
+    free(index->_buckets);
+  }
+  memset(index, 0, sizeof(np_flatindex_t));
+}
+
+bool np_flatindex_insert(np_flatindex_t *index, np_dhkey_t key, void *value) {
+  uint32_t position = index->_count;
+
+  if (position == index->_block_count * NP_FLATINDEX_BLOCK_SIZE) {
+    index->_blocks = realloc(index->_blocks,
+                             (index->_block_count + 1) *
+                                 sizeof(struct np_flatindex_block_s *));
+    index->_blocks[index->_block_count] =
+        calloc(1, sizeof(struct np_flatindex_block_s));
+    index->_block_count++;
+  }
+
+  _np_dhkey_assign(__np_flatindex_key_at(index, position), &key);
+  *__np_flatindex_value_at(index, position) = value;
+  index->_count++;
+
+  if (index->_use_bands) {
+    if (index->_buckets == NULL) {
+      index->_buckets = calloc(NP_FLATINDEX_BANDS * NP_FLATINDEX_BAND_BUCKETS,
+                               sizeof(struct np_flatindex_bucket_s));
+    }
+    for (uint8_t band = 0; band < NP_FLATINDEX_BANDS; band++) {
+      __np_flatindex_bucket_add(__np_flatindex_bucket(index, &key, band),
+                                position);
+    }
+  }
+  return true;
+}
+
+// collects the positions of all entries sharing a band with the key, returns
+// false if banding would not narrow down the scan
+static bool __np_flatindex_candidates(np_flatindex_t   *index,
+                                      const np_dhkey_t *key,
+                                      uint32_t        **candidates,
+                                      uint32_t         *candidate_count) {
+  if (!index->_use_bands || index->_buckets == NULL ||
+      index->_count < NP_FLATINDEX_BAND_MIN_ENTRIES)
+    return false;
+
+  struct np_flatindex_bucket_s *buckets[NP_FLATINDEX_BANDS];
+  uint32_t                      total = 0;
+  for (uint8_t band = 0; band < NP_FLATINDEX_BANDS; band++) {
+    buckets[band] = __np_flatindex_bucket(index, key, band);
+    total += buckets[band]->_count;
+  }
+  if (total >= index->_count / 2) return false;
+
+  uint8_t *seen    = calloc((index->_count + 7) / 8, sizeof(uint8_t));
+  *candidates      = malloc((total + 1) * sizeof(uint32_t));
+  *candidate_count = 0;
+
+  for (uint8_t band = 0; band < NP_FLATINDEX_BANDS; band++) {
+    for (uint32_t i = 0; i < buckets[band]->_count; i++) {
+      uint32_t position = buckets[band]->_positions[i];
+      if (0 == (seen[position / 8] & (1 << (position % 8)))) {
+        seen[position / 8] |= (1 << (position % 8));
+        (*candidates)[*candidate_count] = position;
+        (*candidate_count)++;
+      }
+    }
+  }
+  free(seen);
+  return true;
+}
+
+void np_flatindex_query(np_flatindex_t  *index,
+                        np_dhkey_t       key,
+                        NP_UNUSED void  *value,
+                        np_map_reduce_t *mr_struct) {
+  mr_struct->cmp = __np_flatindex_cmp;
+
+  uint16_t distances[NP_FLATINDEX_BLOCK_SIZE];
+  bool     _continue = true;
+
+  uint32_t *candidates      = NULL;
+  uint32_t  candidate_count = 0;
+  if (__np_flatindex_candidates(index, &key, &candidates, &candidate_count)) {
+    // gather the scattered candidates into one block and scan it
+    np_dhkey_t keys[NP_FLATINDEX_BLOCK_SIZE];
+    for (uint32_t i = 0; i < candidate_count && _continue;
+         i += NP_FLATINDEX_BLOCK_SIZE) {
+      uint16_t count = (candidate_count - i < NP_FLATINDEX_BLOCK_SIZE)
+                           ? candidate_count - i
+                           : NP_FLATINDEX_BLOCK_SIZE;
+      for (uint16_t j = 0; j < count; j++) {
+        _np_dhkey_assign(&keys[j],
+                         __np_flatindex_key_at(index, candidates[i + j]));
+      }
+      np_flatindex_distance(keys, count, &key, distances);
+
+      for (uint16_t j = 0; j < count && _continue; j++) {
+        if (distances[j] <= index->_max_distance) {
+          _continue = mr_struct->map(
+              mr_struct,
+              *__np_flatindex_value_at(index, candidates[i + j]));
+        }
+      }
+    }
+    free(candidates);
+  } else {
+    for (uint32_t b = 0; b < index->_block_count && _continue; b++) {
+      uint32_t remaining = index->_count - b * NP_FLATINDEX_BLOCK_SIZE;
+      uint16_t count     = (remaining < NP_FLATINDEX_BLOCK_SIZE)
+                               ? remaining
+                               : NP_FLATINDEX_BLOCK_SIZE;
+      np_flatindex_distance(index->_blocks[b]->_keys, count, &key, distances);
+
+      for (uint16_t j = 0; j < count && _continue; j++) {
+        if (distances[j] <= index->_max_distance) {
+          _continue = mr_struct->map(mr_struct, index->_blocks[b]->_values[j]);
+        }
+      }
+    }
+  }
+}
+
+void np_flatindex_foreach(np_flatindex_t *index, np_map_reduce_t *mr_struct) {
+  bool _continue = true;
+  for (uint32_t i = 0; i < index->_count && _continue; i++) {
+    _continue = mr_struct->map(mr_struct, *__np_flatindex_value_at(index, i));
+  }
+}
+
+void np_flatindex_remove(np_flatindex_t *index, np_dhkey_t key, void *value) {
+  uint32_t position = UINT32_MAX;
+
+  if (index->_buckets != NULL) {
+    // an entry is part of all buckets of its own key
+    struct np_flatindex_bucket_s *bucket =
+        __np_flatindex_bucket(index, &key, 0);
+    for (uint32_t i = 0; i < bucket->_count && position == UINT32_MAX; i++) {
+      if (*__np_flatindex_value_at(index, bucket->_positions[i]) == value)
+        position = bucket->_positions[i];
+    }
+  } else {
+    for (uint32_t i = 0; i < index->_count && position == UINT32_MAX; i++) {
+      if (*__np_flatindex_value_at(index, i) == value) position = i;
+    }
+  }
+
+  if (position == UINT32_MAX) return;
+
+  // move the last entry into the free slot to keep the blocks dense
+  uint32_t    last        = index->_count - 1;
+  np_dhkey_t *removed_key = __np_flatindex_key_at(index, position);
+  np_dhkey_t *moved_key   = __np_flatindex_key_at(index, last);
+  if (index->_buckets != NULL) {
+    for (uint8_t band = 0; band < NP_FLATINDEX_BANDS; band++) {
+      __np_flatindex_bucket_update(
+          __np_flatindex_bucket(index, removed_key, band),
+          position,
+          UINT32_MAX);
+    }
+    for (uint8_t band = 0; band < NP_FLATINDEX_BANDS && last != position;
+         band++) {
+      __np_flatindex_bucket_update(
+          __np_flatindex_bucket(index, moved_key, band),
+          last,
+          position);
+    }
+  }
+
+  _np_dhkey_assign(removed_key, moved_key);
+  *__np_flatindex_value_at(index, position) =
+      *__np_flatindex_value_at(index, last);
+  index->_count--;
+
+  if (index->_count == (index->_block_count - 1) * NP_FLATINDEX_BLOCK_SIZE) {
+    index->_block_count--;
+    free(index->_blocks[index->_block_count]);
+    index->_blocks[index->_block_count] = NULL;
+  }
+}
@@ -0,0 +1,87 @@
+//
+// SPDX-FileCopyrightText: 2016-2024 by pi-lar GmbH
+// SPDX-License-Identifier: OSL-3.0
+//
+#ifndef NP_FWK_SEARCH_FLATINDEX_H_
+#define NP_FWK_SEARCH_FLATINDEX_H_
+
+#include "util/np_mapreduce.h"
+
+#include "np_dhkey.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// a flat alternative to the bktree: the 256 bit signatures of all entries are
+// stored back to back in blocks, a query scans a whole block at once and
+// compares the hamming distance of each signature with the query radius.
+// 64 signatures of 32 bytes fill a block of 2KiB, which stays in the L1 cache
+#define NP_FLATINDEX_BLOCK_SIZE 64
+
+// locality sensitive banding: the signature is split into 16 bands of 16 bits,
+// only entries sharing at least one band with the query are compared
+#define NP_FLATINDEX_BANDS        16
+#define NP_FLATINDEX_BAND_BUCKETS 256
+// below this number of entries a full scan is cheaper than banding
+#define NP_FLATINDEX_BAND_MIN_ENTRIES (4 * NP_FLATINDEX_BLOCK_SIZE)
+
+struct np_flatindex_block_s {
+  np_dhkey_t _keys[NP_FLATINDEX_BLOCK_SIZE];
+  void      *_values[NP_FLATINDEX_BLOCK_SIZE];
+};
+
+struct np_flatindex_bucket_s {
+  uint32_t *_positions;
+  uint32_t  _count;
+  uint32_t  _size;
+};
+
+struct np_flatindex_s {
+  // query radius: entries further away than this hamming distance from the
+  // query key are not visited
+  uint16_t _max_distance;
+
+  np_dhkey_t _key;
+
+  uint32_t                      _count;
+  uint32_t                      _block_count;
+  struct np_flatindex_block_s **_blocks;
+
+  // NP_FLATINDEX_BANDS * NP_FLATINDEX_BAND_BUCKETS entry positions, stays NULL
+  // until the first insert or if banding is disabled
+  bool                          _use_bands;
+  struct np_flatindex_bucket_s *_buckets;
+};
+typedef struct np_flatindex_s np_flatindex_t;
+
+void np_flatindex_init(np_flatindex_t *index,
+                       np_dhkey_t      key,
+                       uint16_t        distance,
+                       bool            use_bands);
+void np_flatindex_destroy(np_flatindex_t *index);
+
+bool np_flatindex_insert(np_flatindex_t *index, np_dhkey_t key, void *value);
+
+void np_flatindex_query(np_flatindex_t  *index,
+                        np_dhkey_t       key,
+                        void            *value,
+                        np_map_reduce_t *mr_struct);
+
+void np_flatindex_remove(np_flatindex_t *index, np_dhkey_t key, void *value);
+
+// visit all values of the index regardless of their distance
+void np_flatindex_foreach(np_flatindex_t *index, np_map_reduce_t *mr_struct);
+
+// hamming distances of count signatures to the query key, uses AVX2 when the
+// cpu supports it
+void np_flatindex_distance(const np_dhkey_t *keys,
+                           uint16_t          count,
+                           const np_dhkey_t *key,
+                           uint16_t         *distances);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NP_FWK_SEARCH_FLATINDEX_H_
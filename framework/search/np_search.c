@@ -4,6 +4,7 @@
 //
 #include "search/np_search.h"
 
+#include <assert.h>
 #include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -17,8 +18,11 @@
 #include "core/np_comp_msgproperty.h"
 #include "http/np_http.h"
 #include "search/np_bktree.h"
+#include "search/np_flatindex.h"
 #include "search/np_index.h"
+#include "search/np_searchsnapshot.h"
 #include "util/np_bloom.h"
+#include "util/np_heap.h"
 #include "util/np_list.h"
 #include "util/np_mapreduce.h"
 #include "util/np_minhash.h"
@@ -29,6 +33,7 @@
 #include "np_constants.h"
 #include "np_data.h"
 #include "np_dhkey.h"
+#include "np_jobqueue.h"
 #include "np_key.h"
 #include "np_legacy.h"
 #include "np_log.h"
@@ -49,8 +54,9 @@
 struct np_searchnode_s {
   np_dhkey_t node_id;
 
-  uint16_t     local_table_count;
-  np_bktree_t *tree[BKTREE_ARRAY_SIZE];
+  uint16_t        local_table_count;
+  np_bktree_t    *tree[BKTREE_ARRAY_SIZE];
+  np_flatindex_t *flat[BKTREE_ARRAY_SIZE];
 
   uint16_t   remote_peer_count;
   np_dhkey_t peers[8][32]; // could be extended with additional third [128] in
@@ -80,6 +86,14 @@ np_module_struct(search) {
   np_spinlock_t table_lock[BKTREE_ARRAY_SIZE];
   np_spinlock_t peer_lock[8 + 1];
   np_spinlock_t pipeline_lock;
+
+  // bktree table operations that can be picked up by helper jobs
+  np_sll_t(void_ptr, table_batches);
+  np_spinlock_t batch_lock;
+  np_sll_t(np_evt_callback_t, table_batch_cb);
+
+  // entries restored on startup keep their bloom filters in this mapping
+  np_searchsnapshot_t snapshot;
 };
 
 bool _np_new_searchentry_cb(np_context                          *ac,
@@ -112,6 +126,12 @@ struct search_pipeline_result {
     np_searchquery_t *query;
     np_searchentry_t *entry;
   } obj;
+
+  // a batch of entries is tracked by a single pipeline, each entry has its own
+  // remote distribution count
+  uint32_t           batch_count;
+  np_searchentry_t **batch_entries;
+  uint8_t           *batch_distribution;
 };
 
 static char       *__text_delimiter       = " ,!'.\"-_[]{}/";
@@ -137,6 +157,8 @@ bool __np_search_cleanup_pipeline(np_state_t               *context,
     struct search_pipeline_result *pipeline = tmp->val.value.v;
     if ((pipeline->stop_time + NP_SEARCH_CLEANUP_INTERVAL) < np_time_now()) {
       np_tree_del_uuid(pipeline_results, tmp->key.value.uuid);
+      free(pipeline->batch_entries);
+      free(pipeline->batch_distribution);
       free(pipeline);
       break;
     }
@@ -146,6 +168,100 @@ bool __np_search_cleanup_pipeline(np_state_t               *context,
   return true;
 }
 
+// the local tables are either bktrees or flat indices, depending on the
+// configured index layout
+static void __np_search_table_init(np_state_t *context,
+                                   uint16_t    index,
+                                   np_dhkey_t  seed) {
+  enum np_search_index_layout layout =
+      np_module(search)->searchcfg.index_layout;
+
+  if (layout == SEARCH_INDEX_BKTREE) {
+    np_module(search)->searchnode.tree[index] = malloc(sizeof(np_bktree_t));
+    np_bktree_init(np_module(search)->searchnode.tree[index],
+                   seed,
+                   np_module(search)->searchcfg.query_radius);
+  } else {
+    np_module(search)->searchnode.flat[index] = malloc(sizeof(np_flatindex_t));
+    np_flatindex_init(np_module(search)->searchnode.flat[index],
+                      seed,
+                      np_module(search)->searchcfg.query_radius,
+                      layout == SEARCH_INDEX_FLAT_LSH);
+  }
+}
+
+static void __np_search_table_destroy(np_state_t *context, uint16_t index) {
+  if (np_module(search)->searchnode.tree[index] != NULL) {
+    np_bktree_destroy(np_module(search)->searchnode.tree[index]);
+    free(np_module(search)->searchnode.tree[index]);
+  }
+  if (np_module(search)->searchnode.flat[index] != NULL) {
+    np_flatindex_destroy(np_module(search)->searchnode.flat[index]);
+    free(np_module(search)->searchnode.flat[index]);
+  }
+}
+
+static np_dhkey_t *__np_search_table_key(np_state_t *context, uint16_t index) {
+  if (np_module(search)->searchcfg.index_layout == SEARCH_INDEX_BKTREE) {
+    return &np_module(search)->searchnode.tree[index]->_root._key;
+  } else {
+    return &np_module(search)->searchnode.flat[index]->_key;
+  }
+}
+
+static void __np_search_table_insert(np_state_t       *context,
+                                     uint16_t          index,
+                                     np_searchentry_t *entry) {
+  if (np_module(search)->searchcfg.index_layout == SEARCH_INDEX_BKTREE) {
+    np_bktree_insert(np_module(search)->searchnode.tree[index],
+                     entry->search_index.lower_dhkey,
+                     entry);
+  } else {
+    np_flatindex_insert(np_module(search)->searchnode.flat[index],
+                        entry->search_index.lower_dhkey,
+                        entry);
+  }
+}
+
+static void __np_search_table_query(np_state_t      *context,
+                                    uint16_t         index,
+                                    np_dhkey_t       key,
+                                    void            *value,
+                                    np_map_reduce_t *mr) {
+  if (np_module(search)->searchcfg.index_layout == SEARCH_INDEX_BKTREE) {
+    np_bktree_query(np_module(search)->searchnode.tree[index], key, value, mr);
+  } else {
+    np_flatindex_query(np_module(search)->searchnode.flat[index],
+                       key,
+                       value,
+                       mr);
+  }
+}
+
+static void __np_search_table_remove(np_state_t       *context,
+                                     uint16_t          index,
+                                     np_searchentry_t *entry) {
+  if (np_module(search)->searchcfg.index_layout == SEARCH_INDEX_BKTREE) {
+    np_bktree_remove(np_module(search)->searchnode.tree[index],
+                     entry->search_index.lower_dhkey,
+                     entry);
+  } else {
+    np_flatindex_remove(np_module(search)->searchnode.flat[index],
+                        entry->search_index.lower_dhkey,
+                        entry);
+  }
+}
+
+static void __np_search_table_foreach(np_state_t      *context,
+                                      uint16_t         index,
+                                      np_map_reduce_t *mr) {
+  if (np_module(search)->searchcfg.index_layout == SEARCH_INDEX_BKTREE) {
+    np_bktree_foreach(np_module(search)->searchnode.tree[index], mr);
+  } else {
+    np_flatindex_foreach(np_module(search)->searchnode.flat[index], mr);
+  }
+}
+
 // map reduce algorithms or parts of those
 bool _deprecate_map_func(np_map_reduce_t *mr_struct, const void *element) {
   np_searchentry_t *it_1              = (np_searchentry_t *)element;
@@ -189,9 +305,6 @@ bool _deprecate_reduce_func(np_map_reduce_t *mr_struct, const void *element) {
 
   // log_msg(LOG_DEBUG, NULL, "deleting entry (%p) \n", element);
   np_searchentry_t *search_elem = (np_searchentry_t *)element;
-  np_bktree_t      *tree        = (np_bktree_t *)mr_struct->reduce_args.io;
-
-  np_bktree_remove(tree, search_elem->search_index.lower_dhkey, search_elem);
 
   np_tree_insert_str(mr_struct->reduce_result,
                      search_elem->intent.uuid,
@@ -220,16 +333,13 @@ bool __np_search_deprecate_entries(np_state_t               *context,
   for (uint16_t i = 0; i < np_module(search)->searchnode.local_table_count;
        i++) {
     np_spinlock_lock(&np_module(search)->table_lock[i]);
-    np_bktree_query(np_module(search)->searchnode.tree[i],
-                    _random_dhkey,
-                    NULL,
-                    &mr);
+    __np_search_table_query(context, i, _random_dhkey, NULL, &mr);
     np_spinlock_unlock(&np_module(search)->table_lock[i]);
 
     sll_iterator(void_ptr) iterator = sll_first(mr.map_result);
     while (iterator != NULL) {
       np_spinlock_lock(&np_module(search)->table_lock[i]);
-      mr.reduce_args.io = np_module(search)->searchnode.tree[i];
+      __np_search_table_remove(context, i, iterator->val);
       mr.reduce(&mr, iterator->val);
       np_spinlock_unlock(&np_module(search)->table_lock[i]);
 
@@ -242,6 +352,7 @@ bool __np_search_deprecate_entries(np_state_t               *context,
   RB_FOREACH (tmp, np_tree_s, mr.reduce_result) {
     np_searchentry_t *elem = (np_searchentry_t *)tmp->val.value.v;
 
+    np_searchsnapshot_release(&np_module(search)->snapshot, elem);
     np_index_destroy(&elem->search_index);
     free(elem);
   }
@@ -267,6 +378,32 @@ static int __search_table_bucket_cmp(const void *a, const void *b) {
              : da->hamming_distance > db->hamming_distance;
 }
 
+// sort the local tables by the distance of their key to the entry, returns the
+// number of tables the entry is stored in
+static uint8_t
+__np_search_nearest_tables(np_state_t                   *context,
+                           np_searchentry_t             *entry,
+                           struct __search_table_bucket *buckets) {
+  uint8_t dh_diff = 0;
+  for (uint16_t i = 0; i < np_module(search)->searchnode.local_table_count;
+       i++) {
+    _np_dhkey_hamming_distance(&dh_diff,
+                               &entry->search_index.lower_dhkey,
+                               __np_search_table_key(context, i));
+    buckets[i].hamming_distance = dh_diff;
+    buckets[i].index            = i;
+  }
+
+  qsort(buckets,
+        np_module(search)->searchnode.local_table_count,
+        sizeof(struct __search_table_bucket),
+        __search_table_bucket_cmp);
+
+  return (np_module(search)->searchnode.local_table_count < 8)
+             ? np_module(search)->searchnode.local_table_count
+             : 8;
+}
+
 static JSON_Value *__np_generate_error_json(const char *error,
                                             const char *details) {
   JSON_Value *ret = json_value_init_object();
@@ -392,6 +529,235 @@ int __compare_uint16_t(const void *first, const void *second) {
   return 0;
 }
 
+// keeps the best results of a query, the result with the lowest similarity
+// level is always on top of the heap
+typedef np_searchresult_t *np_searchresult_ptr;
+
+bool np_searchresult_ptr_compare(np_searchresult_ptr i, np_searchresult_ptr j) {
+  return (i->level < j->level);
+}
+
+size_t np_searchresult_ptr_binheap_get_priority(np_searchresult_ptr result) {
+  return (size_t)result->hit_counter;
+}
+
+NP_BINHEAP_GENERATE_PROTOTYPES(np_searchresult_ptr);
+
+NP_BINHEAP_GENERATE_IMPLEMENTATION(np_searchresult_ptr);
+
+// a set of bktree tables that have to be searched or extended for a single
+// search entry. the calling thread and helper jobs on the jobqueue claim the
+// tables one after the other, counters are guarded by the module batch_lock.
+// the calling thread waits on done_lock for tables still worked on by helpers
+struct __search_table_batch {
+  np_searchentry_t *entry;
+  np_searchquery_t *query; // NULL when the entry is inserted
+
+  struct __search_table_bucket *buckets;
+  uint16_t                      count;
+  uint16_t                      next;
+  uint16_t                      done;
+  uint16_t                      hits;
+
+  np_tree_t    *kv_pairs;
+  np_tree_t    *candidates;
+  np_spinlock_t candidates_lock;
+
+  np_mutex_t done_lock;
+};
+
+static bool __np_search_table_batch_claim(struct __search_table_batch *batch,
+                                          uint16_t *index) {
+  // tables are sorted by distance, once a closer table has produced results
+  // the remaining ones are not queried any more
+  if (batch->next >= batch->count) return false;
+  if (batch->query != NULL && batch->hits > 0) return false;
+
+  *index = batch->buckets[batch->next].index;
+  batch->next++;
+  return true;
+}
+
+static void __np_search_table_batch_exec(np_state_t                  *context,
+                                         struct __search_table_batch *batch,
+                                         uint16_t                     index) {
+  bool hit = false;
+
+  if (batch->query == NULL) {
+    np_spinlock_lock(&np_module(search)->table_lock[index]);
+    __np_search_table_insert(context, index, batch->entry);
+    np_spinlock_unlock(&np_module(search)->table_lock[index]);
+  } else {
+    np_map_reduce_t mr = {.map           = _map_np_searchentry,
+                          .reduce        = _reduce_np_searchentry,
+                          .reduce_result = batch->candidates};
+    mr.map_args.io       = batch->entry;
+    mr.map_args.kv_pairs = batch->kv_pairs;
+    sll_init(void_ptr, mr.map_result);
+
+    np_spinlock_lock(&np_module(search)->table_lock[index]);
+    __np_search_table_query(context,
+                            index,
+                            batch->entry->search_index.lower_dhkey,
+                            batch->entry,
+                            &mr);
+    np_spinlock_unlock(&np_module(search)->table_lock[index]);
+
+    hit = (sll_size(mr.map_result) > 0);
+
+    np_spinlock_lock(&batch->candidates_lock);
+    sll_iterator(void_ptr) iterator = sll_first(mr.map_result);
+    while (iterator != NULL) {
+      mr.reduce(&mr, iterator->val);
+      sll_next(iterator);
+    }
+    np_spinlock_unlock(&batch->candidates_lock);
+
+    sll_free(void_ptr, mr.map_result);
+  }
+
+  _LOCK_ACCESS (&batch->done_lock) {
+    np_spinlock_lock(&np_module(search)->batch_lock);
+    batch->done++;
+    if (hit) batch->hits++;
+    np_spinlock_unlock(&np_module(search)->batch_lock);
+    _np_threads_mutex_condition_signal(context, &batch->done_lock);
+  }
+}
+
+bool __np_search_table_batch_cb(np_state_t                *context,
+                                NP_UNUSED np_util_event_t  event) {
+  if (np_module_not_initiated(search)) return true;
+
+  bool claimed = true;
+  while (claimed) {
+    struct __search_table_batch *batch = NULL;
+    uint16_t                     index = 0;
+
+    claimed = false;
+    np_spinlock_lock(&np_module(search)->batch_lock);
+    sll_iterator(void_ptr) iter = sll_first(np_module(search)->table_batches);
+    while (iter != NULL && !claimed) {
+      batch   = iter->val;
+      claimed = __np_search_table_batch_claim(batch, &index);
+      sll_next(iter);
+    }
+    np_spinlock_unlock(&np_module(search)->batch_lock);
+
+    if (claimed) __np_search_table_batch_exec(context, batch, index);
+  }
+  return true;
+}
+
+// fans the table operations out to the jobqueue. the calling thread works on
+// the batch as well, so it never waits for a helper job that has not started
+static void __np_search_table_batch_run(np_state_t                  *context,
+                                        struct __search_table_batch *batch) {
+  _np_threads_mutex_init(context, &batch->done_lock, "search batch done_lock");
+
+  np_spinlock_lock(&np_module(search)->batch_lock);
+  sll_append(void_ptr, np_module(search)->table_batches, batch);
+  np_spinlock_unlock(&np_module(search)->batch_lock);
+
+  uint32_t helper_count = (batch->count > 0) ? batch->count - 1 : 0;
+  if (helper_count > context->settings->n_threads)
+    helper_count = context->settings->n_threads;
+
+  np_util_event_t batch_event = {.type = evt_internal};
+  for (uint32_t i = 0; i < helper_count; i++) {
+    np_jobqueue_submit_event_callbacks(context,
+                                       0.0,
+                                       dhkey_zero,
+                                       batch_event,
+                                       np_module(search)->table_batch_cb,
+                                       "__np_search_table_batch_cb");
+  }
+
+  bool pending = true;
+  while (pending) {
+    uint16_t index = 0;
+
+    np_spinlock_lock(&np_module(search)->batch_lock);
+    bool claimed = __np_search_table_batch_claim(batch, &index);
+    np_spinlock_unlock(&np_module(search)->batch_lock);
+
+    if (claimed) {
+      __np_search_table_batch_exec(context, batch, index);
+      continue;
+    }
+
+    // nothing left to claim, wait for the tables still worked on by helpers.
+    // helpers count their tables while holding done_lock, so the signal
+    // cannot get lost between the check and the wait
+    _LOCK_ACCESS (&batch->done_lock) {
+      np_spinlock_lock(&np_module(search)->batch_lock);
+      pending = (batch->done < batch->next);
+      np_spinlock_unlock(&np_module(search)->batch_lock);
+
+      if (pending) _np_threads_mutex_condition_wait(context, &batch->done_lock);
+    }
+  }
+
+  // claims fail for good once all tables are handed out or a query has hits
+  np_spinlock_lock(&np_module(search)->batch_lock);
+  sll_remove(void_ptr,
+             np_module(search)->table_batches,
+             batch,
+             void_ptr_sll_compare_type);
+  np_spinlock_unlock(&np_module(search)->batch_lock);
+
+  _np_threads_mutex_destroy(context, &batch->done_lock);
+}
+
+// moves the best NP_SEARCH_QUERY_TOP_K candidates into the result set of the
+// query and frees all other candidates
+static void __np_search_select_results(np_state_t       *context,
+                                       np_searchquery_t *query,
+                                       np_tree_t        *candidates,
+                                       np_tree_t        *results) {
+  np_pheap_t(np_searchresult_ptr, best);
+  pheap_init(np_searchresult_ptr, best, NP_SEARCH_QUERY_TOP_K);
+
+  np_tree_elem_t *tmp = NULL;
+  RB_FOREACH (tmp, np_tree_s, candidates) {
+    np_searchresult_t *candidate = tmp->val.value.v;
+    np_searchresult_t *dropped   = candidate;
+
+    if (best->count < best->size) {
+      pheap_insert(np_searchresult_ptr, best, candidate);
+      dropped = NULL;
+    } else if (pheap_first(np_searchresult_ptr, best)->level <
+               candidate->level) {
+      dropped = pheap_head(np_searchresult_ptr, best);
+      pheap_insert(np_searchresult_ptr, best, candidate);
+    }
+
+    if (dropped != NULL) {
+      free(dropped->label);
+      free(dropped);
+    }
+  }
+
+  np_spinlock_lock(&np_module(search)->results_lock[query->query_id]);
+  while (!pheap_is_empty(np_searchresult_ptr, best)) {
+    np_searchresult_t *result = pheap_head(np_searchresult_ptr, best);
+
+    np_tree_elem_t *result_elem = np_tree_find_str(results, result->label);
+    if (result_elem != NULL) {
+      np_searchresult_t *known = (np_searchresult_t *)result_elem->val.value.v;
+      known->hit_counter += result->hit_counter;
+      if (known->level < result->level) known->level = result->level;
+      free(result->label);
+      free(result);
+    } else {
+      np_tree_insert_str(results, result->label, np_treeval_new_v(result));
+    }
+  }
+  np_spinlock_unlock(&np_module(search)->results_lock[query->query_id]);
+
+  pheap_free(np_searchresult_ptr, best);
+}
+
 // authz callbacks
 bool __np_search_authorize_result_cb(np_context      *ac,
                                      struct np_token *intent_token) {
@@ -992,63 +1358,44 @@ bool __np_search_query(np_context                          *ac,
         (np_module(search)->searchnode.local_table_count < 16)
             ? np_module(search)->searchnode.local_table_count
             : 16;
-    for (uint8_t j = 0; j < max_query_count; j++) {
-      // #pragma omp parallel for shared(query)
-      for (uint16_t i = 0; i < np_module(search)->searchnode.local_table_count;
-           i++) {
-        _np_dhkey_hamming_distance(
-            &dh_diff,
-            &query->query_entry.search_index.lower_dhkey,
-            &np_module(search)->searchnode.tree[i]->_root._key);
-        buckets[i].hamming_distance = dh_diff;
-        buckets[i].index            = i;
-      }
+    for (uint16_t i = 0; i < np_module(search)->searchnode.local_table_count;
+         i++) {
+      _np_dhkey_hamming_distance(
+          &dh_diff,
+          &query->query_entry.search_index.lower_dhkey,
+          __np_search_table_key(context, i));
+      buckets[i].hamming_distance = dh_diff;
+      buckets[i].index            = i;
     }
     qsort(buckets,
           np_module(search)->searchnode.local_table_count,
           sizeof(struct __search_table_bucket),
           __search_table_bucket_cmp);
-    // log_msg(LOG_DEBUG, NULL,  "         into table: ");
-    // for (uint16_t i = 0; i < 16; i++)
-    // {
-    //             log_msg(LOG_DEBUG,  "%u (%u) : ", buckets[i].index ,
-    //             buckets[i].hamming_distance);
-    // }
-    // log_msg(LOG_DEBUG, NULL,  "");
-    // log_msg(LOG_DEBUG, NULL,  "searching in   table: ");
-    // #pragma omp parallel for shared(query)
-    for (uint16_t j = 0; (j < max_query_count) && (mr.reduce_result->size == 0);
-         j++) {
-      log_msg(LOG_DEBUG,
-              msg->uuid,
-              "distribution factor was %2d, querying locally in %3d | "
-              "distance %3d",
-              pipeline->remote_distribution_count,
-              buckets[j].index,
-              buckets[j].hamming_distance);
-      // log_msg(LOG_DEBUG, NULL,  " %2u (distance %3u [at %2u] )",
-      // buckets[j].index , buckets[j].hamming_distance, j);
-      // np_skipbi_query(&lsh->_skipbi[j], &mr);
-
-      np_spinlock_lock(&np_module(search)->table_lock[j]);
-      np_bktree_query(np_module(search)->searchnode.tree[buckets[j].index],
-                      query->query_entry.search_index.lower_dhkey,
-                      &query->query_entry,
-                      &mr);
-      np_spinlock_unlock(&np_module(search)->table_lock[j]);
-
-      np_spinlock_lock(&np_module(search)->results_lock[query->query_id]);
-      sll_iterator(void_ptr) iterator = sll_first(mr.map_result);
-      while (iterator != NULL) {
-        mr.reduce(&mr, iterator->val);
-        sll_next(iterator);
-      }
-      np_spinlock_unlock(&np_module(search)->results_lock[query->query_id]);
 
-      // np_bktree_query(np_module(search)->searchnode.tree[ min_index[j] ],
-      // entry->query_entry.search_index.upper_dhkey, &entry->query_entry, &mr);
-      sll_clear(void_ptr, mr.map_result);
-    }
+    log_msg(LOG_DEBUG,
+            msg->uuid,
+            "distribution factor was %2d, querying locally in %3d tables | "
+            "distance %3d",
+            pipeline->remote_distribution_count,
+            max_query_count,
+            buckets[0].hamming_distance);
+
+    struct __search_table_batch batch = {.entry      = &query->query_entry,
+                                         .query      = query,
+                                         .buckets    = buckets,
+                                         .count      = max_query_count,
+                                         .kv_pairs   = mr.map_args.kv_pairs,
+                                         .candidates = np_tree_create()};
+    np_spinlock_init(&batch.candidates_lock, PTHREAD_PROCESS_PRIVATE);
+
+    __np_search_table_batch_run(context, &batch);
+    __np_search_select_results(context,
+                               query,
+                               batch.candidates,
+                               mr.reduce_result);
+
+    np_spinlock_destroy(&batch.candidates_lock);
+    np_tree_free(batch.candidates);
   } else {
     log_msg(LOG_DEBUG,
             msg->uuid,
@@ -1147,6 +1494,41 @@ bool __np_search_query(np_context                          *ac,
   return true;
 }
 
+// store an entry in its nearest local tables, unless it has already been
+// distributed to enough remote peers
+static void __np_search_store_entry(np_state_t       *context,
+                                    unsigned char    *uuid,
+                                    np_searchentry_t *entry,
+                                    uint8_t           distribution_count) {
+  if (distribution_count <= 6) {
+    struct __search_table_bucket
+            buckets[np_module(search)->searchnode.local_table_count];
+    uint8_t max_create_count =
+        __np_search_nearest_tables(context, entry, buckets);
+
+    log_msg(LOG_DEBUG,
+            uuid,
+            "distribution factor was %2d, storing locally in %3d tables | "
+            "distance %3d",
+            distribution_count,
+            max_create_count,
+            buckets[0].hamming_distance);
+
+    struct __search_table_batch batch = {.entry   = entry,
+                                         .query   = NULL,
+                                         .buckets = buckets,
+                                         .count   = max_create_count};
+    __np_search_table_batch_run(context, &batch);
+  } else {
+    log_msg(LOG_DEBUG,
+            uuid,
+            "distribution factor was %2d, not querying locally",
+            distribution_count);
+    np_index_destroy(&entry->search_index);
+    free(entry);
+  }
+}
+
 bool __np_search_add_entry(np_context                          *ac,
                            const struct np_e2e_message_s *const msg,
                            np_tree_t                           *body,
@@ -1184,83 +1566,18 @@ bool __np_search_add_entry(np_context                          *ac,
       }
   */
 
-  if (pipeline->remote_distribution_count <= 6) {
-    uint8_t dh_diff = {0};
-    struct __search_table_bucket
-            buckets[np_module(search)->searchnode.local_table_count];
-    uint8_t max_create_count =
-        (np_module(search)->searchnode.local_table_count < 8)
-            ? np_module(search)->searchnode.local_table_count
-            : 8;
-    for (uint8_t j = 0; j < max_create_count; j++) {
-      // #pragma omp parallel for shared(entry)
-      for (uint16_t i = 0; i < np_module(search)->searchnode.local_table_count;
-           i++) {
-        _np_dhkey_hamming_distance(
-            &dh_diff,
-            &pipeline->obj.entry->search_index.lower_dhkey,
-            &np_module(search)->searchnode.tree[i]->_root._key);
-        buckets[i].hamming_distance = dh_diff;
-        buckets[i].index            = i;
-      }
-    }
-
-    qsort(buckets,
-          np_module(search)->searchnode.local_table_count,
-          sizeof(struct __search_table_bucket),
-          __search_table_bucket_cmp);
-
-    // log_msg(LOG_DEBUG, NULL,  "         into table: ");
-    // for (uint16_t i = 0; i < 16; i++)
-    // {
-    //             log_msg(LOG_DEBUG, NULL,  "%u (%u) : ", buckets[i].index ,
-    //             buckets[i].hamming_distance);
-    // }
-    // log_msg(LOG_DEBUG, NULL,  "");
-
-    // uint8_t i = 0;
-    // log_msg(LOG_DEBUG, NULL,  "inserting into table: ");
-    // #pragma omp parallel for shared(entry)
-    for (uint16_t j = 0; j < max_create_count; j++) {
-      log_msg(LOG_DEBUG,
-              msg->uuid,
-              "distribution factor was %2d, storing locally in %3d | "
-              "distance %3d",
-
-              pipeline->remote_distribution_count,
-              buckets[j].index,
-              buckets[j].hamming_distance);
-
-      np_spinlock_lock(&np_module(search)->table_lock[j]);
-
-      // log_msg(LOG_DEBUG, NULL,  " %2u (distance %3u [at %2u] )",
-      // buckets[j].index , buckets[j].hamming_distance, j); log_msg(LOG_DEBUG,
-      // NULL,  "< NODE INDEX:>
-      // "); for (uint32_t k = 0; k < 8; k++)
-      // {
-      //     log_msg(LOG_DEBUG, NULL,  "%08x", lsh->_bktree[j]._root._key.t[k]);
-      //     log_msg(LOG_DEBUG, NULL,  ".");
-      // }
-      // log_msg(LOG_DEBUG, NULL,  " </ NODE INDEX:>");
-      np_bktree_insert(np_module(search)->searchnode.tree[buckets[j].index],
-                       pipeline->obj.entry->search_index.lower_dhkey,
-                       pipeline->obj.entry);
-
-      np_spinlock_unlock(&np_module(search)->table_lock[j]);
-
-      // np_bktree_insert(np_module(search)->searchnode.tree[ min_index[j] ],
-      // entry->search_index.upper_dhkey, entry);
-      // np_skipbi_add(&lsh->_skipbi[j], _lp);
-    }
-    // log_msg(LOG_DEBUG, NULL,  "");
+  if (pipeline->batch_count == 0) {
+    __np_search_store_entry(context,
+                            msg->uuid,
+                            pipeline->obj.entry,
+                            pipeline->remote_distribution_count);
   } else {
-    log_msg(LOG_DEBUG,
-            msg->uuid,
-            "distribution factor was %2d, not querying locally",
-            pipeline->remote_distribution_count);
-    np_searchentry_t *entry = pipeline->obj.entry;
-    np_index_destroy(&entry->search_index);
-    free(entry);
+    for (uint32_t i = 0; i < pipeline->batch_count; i++) {
+      __np_search_store_entry(context,
+                              msg->uuid,
+                              pipeline->batch_entries[i],
+                              pipeline->batch_distribution[i]);
+    }
   }
 
   pipeline->stop_time = np_time_now();
@@ -1268,42 +1585,19 @@ bool __np_search_add_entry(np_context                          *ac,
   return true;
 }
 
-bool __check_remote_peer_distribution(np_context                          *ac,
-                                      const struct np_e2e_message_s *const msg,
-                                      np_tree_t                           *body,
-                                      void *localdata) {
-  np_ctx_cast(ac);
-
-  np_tree_t                     *pipeline_results = (np_tree_t *)localdata;
-  struct search_pipeline_result *pipeline         = NULL;
-
-  NP_CAST(msg, struct np_e2e_message_s, old_msg);
-
-  np_spinlock_lock(&np_module(search)->pipeline_lock);
-  // if (NULL == np_tree_find_str(pipeline_results, msg->uuid)) abort();
-  pipeline = np_tree_find_uuid(pipeline_results, old_msg->uuid)->val.value.v;
-  np_spinlock_unlock(&np_module(search)->pipeline_lock);
-
-  pipeline->remote_distribution_count = 0;
-
+// choose the remote peer with the lowest hamming distance to the search index
+// in each of the 8 peer rows, a row without a closer peer is set to dhkey_zero
+static void __np_search_select_peers(np_state_t *context,
+                                     np_dhkey_t  search_index,
+                                     np_dhkey_t  peers[8]) {
   // check for chunked hamming distance to catch the index
   np_dhkey_t local_diff_index = {0};
   _np_dhkey_hamming_distance_each(&local_diff_index,
-                                  &pipeline->search_index,
+                                  &search_index,
                                   &np_module(search)->searchnode.node_id);
   // within the index choose the entry with the lowest overall hamming distance
-  // uint8_t dh_diff_target  = 0;
-  // _np_dhkey_hamming_distance(&dh_diff_target, &search_index,
-  // &np_module(search)->searchnode->node_id);
-
   bool is_zero = false;
 
-  struct __search_table_bucket buckets[8][32];
-  memset(&buckets,
-         0,
-         np_module(search)->searchnode.local_table_count *
-             sizeof(struct __search_table_bucket));
-
   for (uint8_t j = 0; j < 8; j++) {
     np_spinlock_lock(&np_module(search)->peer_lock[j]);
     uint8_t best_index     = 32;
@@ -1314,7 +1608,7 @@ bool __check_remote_peer_distribution(np_context                          *ac,
     np_dhkey_t peer_diff_index = {0};
     _np_dhkey_hamming_distance_each(
         &peer_diff_index,
-        &pipeline->search_index,
+        &search_index,
         &np_module(search)->searchnode.peers[j][local_index]);
 
     int32_t index = peer_diff_index.t[j];
@@ -1330,7 +1624,7 @@ bool __check_remote_peer_distribution(np_context                          *ac,
     while (index != 0) {
       _np_dhkey_hamming_distance_each(
           &peer_diff_index,
-          &pipeline->search_index,
+          &search_index,
           &np_module(search)->searchnode.peers[j][index]);
       // prevent follow up actions with empty cells
       is_zero = _np_dhkey_equal(&dhkey_zero,
@@ -1349,85 +1643,220 @@ bool __check_remote_peer_distribution(np_context                          *ac,
               NULL,
               "[%p]                       | peer distance %3d | next index %3d "
               "| best index %3d ",
-              ac,
+              context,
               peer_diff_index.t[j],
               index,
               best_index);
     }
 
     if (best_index < 32) {
-      np_dhkey_t localized_subject;
-      _np_dhkey_assign(&localized_subject, &pipeline->search_subject);
-      np_generate_subject(&localized_subject,
-                          &np_module(search)->searchnode.peers[j][best_index],
-                          NP_FINGERPRINT_BYTES);
-
-      np_dhkey_t out_dhkey =
-          _np_msgproperty_tweaked_dhkey(OUTBOUND, localized_subject);
-      np_msgproperty_run_t *out_property =
-          _np_msgproperty_run_get(context, OUTBOUND, localized_subject);
-
-      if (out_property) {
-        struct np_e2e_message_s *cloned_msg = NULL;
-        np_new_obj(np_message_t, cloned_msg);
-
-        _np_message_create(cloned_msg,
-                           out_property->current_fp,
-                           out_property->current_fp,
-                           localized_subject,
-                           body);
-        memcpy(cloned_msg->uuid, old_msg->uuid, NP_UUID_BYTES);
-
-        // np_message_clone(cloned_msg, old_msg);
-        // _np_dhkey_assign(cloned_msg->subject, &localized_subject);
-        // _np_dhkey_assign(cloned_msg->audience, &out_property->current_fp);
-
-        // TODO: add to message attributes
-        // np_tree_replace_str(
-        //     cloned_msg->msg_attributes,
-        //     _NP_MSG_HEADER_FROM,
-        //     np_treeval_new_dhkey(np_module(search)->searchnode.node_id));
-
-        np_util_event_t send_event = {.type      = (evt_internal | evt_message),
-                                      .user_data = cloned_msg,
-                                      .target_dhkey = out_property->current_fp};
-
-        // _np_keycache_handle_event(context, subject_dhkey, send_event, false);
-        if (!np_jobqueue_submit_event(
-                context,
-                0.0,
-                out_dhkey,
-                send_event,
-                "event: userspace message delivery request")) {
-          log_msg(
-              LOG_DEBUG,
-              NULL,
-              "rejecting possible sending of message, please check jobqueue "
-              "settings!");
-        } else {
-          char tmp[65];
-          np_id_str(tmp, &localized_subject);
-          log_msg(LOG_DEBUG,
-                  msg->uuid,
-                  "send new search object to peer: %" PRIx32 " via channel %s",
-                  np_module(search)->searchnode.peers[j][best_index].t[0],
-                  tmp);
-        }
-        np_unref_obj(np_message_t, cloned_msg, ref_obj_creation);
-        pipeline->remote_distribution_count++;
-
-      } else {
-        char temp[65] = {0};
-        log_warn(LOG_WARNING,
-                 NULL,
-                 "runtime property not found for index %" PRId16
-                 " and subject %s",
-                 best_index,
-                 np_id_str(temp, &localized_subject));
+      _np_dhkey_assign(&peers[j],
+                       &np_module(search)->searchnode.peers[j][best_index]);
+    } else {
+      _np_dhkey_assign(&peers[j], &dhkey_zero);
+    }
+    np_spinlock_unlock(&np_module(search)->peer_lock[j]);
+  }
+}
+
+// send a search object to the private subject of a remote peer. uuid is the
+// uuid of the original message, or NULL for a new message. Returns false if
+// there is no channel to the peer yet
+static bool __np_search_send_to_peer(np_state_t *context,
+                                     np_dhkey_t  search_subject,
+                                     np_dhkey_t *peer,
+                                     np_tree_t  *body,
+                                     const char *uuid) {
+  np_dhkey_t localized_subject;
+  _np_dhkey_assign(&localized_subject, &search_subject);
+  np_generate_subject(&localized_subject, peer, NP_FINGERPRINT_BYTES);
+
+  np_dhkey_t out_dhkey =
+      _np_msgproperty_tweaked_dhkey(OUTBOUND, localized_subject);
+  np_msgproperty_run_t *out_property =
+      _np_msgproperty_run_get(context, OUTBOUND, localized_subject);
+
+  if (out_property == NULL) {
+    char temp[65] = {0};
+    log_warn(LOG_WARNING,
+             NULL,
+             "runtime property not found for subject %s",
+             np_id_str(temp, &localized_subject));
+    return false;
+  }
+
+  struct np_e2e_message_s *cloned_msg = NULL;
+  np_new_obj(np_message_t, cloned_msg);
+
+  _np_message_create(cloned_msg,
+                     out_property->current_fp,
+                     out_property->current_fp,
+                     localized_subject,
+                     body);
+  if (uuid != NULL) memcpy(cloned_msg->uuid, uuid, NP_UUID_BYTES);
+
+  np_util_event_t send_event = {.type         = (evt_internal | evt_message),
+                                .user_data    = cloned_msg,
+                                .target_dhkey = out_property->current_fp};
+
+  if (!np_jobqueue_submit_event(context,
+                                0.0,
+                                out_dhkey,
+                                send_event,
+                                "event: userspace message delivery request")) {
+    log_msg(LOG_DEBUG,
+            NULL,
+            "rejecting possible sending of message, please check jobqueue "
+            "settings!");
+  } else {
+    char tmp[65];
+    np_id_str(tmp, &localized_subject);
+    log_msg(LOG_DEBUG,
+            cloned_msg->uuid,
+            "send new search object to peer: %" PRIx32 " via channel %s",
+            peer->t[0],
+            tmp);
+  }
+  np_unref_obj(np_message_t, cloned_msg, ref_obj_creation);
+
+  return true;
+}
+
+// entries of a batch that are sent to the same remote peer
+struct __search_peer_batch {
+  np_dhkey_t peer;
+  np_tree_t *entries;
+  uint16_t   count;
+  uint32_t   positions[NP_SEARCH_BATCH_ENTRIES];
+};
+
+static void
+__np_search_peer_batch_flush(np_state_t                    *context,
+                             struct search_pipeline_result *pipeline,
+                             struct __search_peer_batch    *batch) {
+  if (batch->count == 0) return;
+
+  np_tree_t *body = np_tree_create();
+  np_tree_insert_str(body, "entry.batch", np_treeval_new_tree(batch->entries));
+
+  if (__np_search_send_to_peer(context,
+                               pipeline->search_subject,
+                               &batch->peer,
+                               body,
+                               NULL)) {
+    for (uint16_t i = 0; i < batch->count; i++)
+      pipeline->batch_distribution[batch->positions[i]]++;
+  }
+  np_tree_free(body);
+
+  np_tree_clear(batch->entries);
+  batch->count = 0;
+}
+
+// group the entries of a batch by their target peers and send each peer a
+// message with up to NP_SEARCH_BATCH_ENTRIES entries
+static void
+__np_search_distribute_batch(np_state_t                    *context,
+                             struct search_pipeline_result *pipeline,
+                             np_tree_t                     *body) {
+  np_tree_elem_t *batch_elem = np_tree_find_str(body, "entry.batch");
+  if (batch_elem == NULL) return;
+
+  np_tree_t *batch_entries = batch_elem->val.value.tree;
+
+  uint16_t                    peer_count = 0;
+  struct __search_peer_batch *peer_batches =
+      calloc(8 * 32, sizeof(struct __search_peer_batch));
+
+  for (uint32_t i = 0; i < pipeline->batch_count; i++) {
+    np_tree_elem_t *entry_elem = np_tree_find_int(batch_entries, i);
+    if (entry_elem == NULL) continue;
+
+    np_dhkey_t peers[8];
+    __np_search_select_peers(
+        context,
+        pipeline->batch_entries[i]->search_index.lower_dhkey,
+        peers);
+
+    for (uint8_t j = 0; j < 8; j++) {
+      if (_np_dhkey_equal(&peers[j], &dhkey_zero)) continue;
+
+      // a peer can be the closest one in several rows
+      bool is_duplicate = false;
+      for (uint8_t l = 0; l < j; l++)
+        is_duplicate |= _np_dhkey_equal(&peers[l], &peers[j]);
+      if (is_duplicate) continue;
+
+      uint16_t k = 0;
+      while (k < peer_count &&
+             !_np_dhkey_equal(&peer_batches[k].peer, &peers[j]))
+        k++;
+
+      if (k == peer_count) {
+        _np_dhkey_assign(&peer_batches[k].peer, &peers[j]);
+        peer_batches[k].entries = np_tree_create();
+        peer_count++;
       }
+
+      struct __search_peer_batch *peer_batch = &peer_batches[k];
+      np_tree_insert_int(peer_batch->entries,
+                         peer_batch->count,
+                         np_treeval_new_tree(entry_elem->val.value.tree));
+      peer_batch->positions[peer_batch->count++] = i;
+
+      if (peer_batch->count == NP_SEARCH_BATCH_ENTRIES)
+        __np_search_peer_batch_flush(context, pipeline, peer_batch);
     }
+  }
 
-    np_spinlock_unlock(&np_module(search)->peer_lock[j]);
+  for (uint16_t k = 0; k < peer_count; k++) {
+    __np_search_peer_batch_flush(context, pipeline, &peer_batches[k]);
+    np_tree_free(peer_batches[k].entries);
+  }
+  free(peer_batches);
+
+  log_msg(LOG_DEBUG,
+          NULL,
+          "distributed batch of %" PRIu32 " entries to %" PRIu16 " peers",
+          pipeline->batch_count,
+          peer_count);
+}
+
+bool __check_remote_peer_distribution(np_context                          *ac,
+                                      const struct np_e2e_message_s *const msg,
+                                      np_tree_t                           *body,
+                                      void *localdata) {
+  np_ctx_cast(ac);
+
+  np_tree_t                     *pipeline_results = (np_tree_t *)localdata;
+  struct search_pipeline_result *pipeline         = NULL;
+
+  NP_CAST(msg, struct np_e2e_message_s, old_msg);
+
+  np_spinlock_lock(&np_module(search)->pipeline_lock);
+  // if (NULL == np_tree_find_str(pipeline_results, msg->uuid)) abort();
+  pipeline = np_tree_find_uuid(pipeline_results, old_msg->uuid)->val.value.v;
+  np_spinlock_unlock(&np_module(search)->pipeline_lock);
+
+  pipeline->remote_distribution_count = 0;
+
+  if (pipeline->batch_count > 0) {
+    __np_search_distribute_batch(context, pipeline, body);
+    return true;
+  }
+
+  np_dhkey_t peers[8];
+  __np_search_select_peers(context, pipeline->search_index, peers);
+
+  for (uint8_t j = 0; j < 8; j++) {
+    if (_np_dhkey_equal(&peers[j], &dhkey_zero)) continue;
+
+    if (__np_search_send_to_peer(context,
+                                 pipeline->search_subject,
+                                 &peers[j],
+                                 body,
+                                 old_msg->uuid))
+      pipeline->remote_distribution_count++;
   }
   return true;
 }
@@ -1444,6 +1873,8 @@ np_search_settings_t *np_default_searchsettings() {
   settings->enable_remote_peers  = true;
   // settings->local_table_count    = 16;
   settings->local_table_count = BKTREE_ARRAY_SIZE;
+  settings->index_layout      = SEARCH_INDEX_BKTREE;
+  settings->query_radius      = NP_SEARCH_QUERY_RADIUS;
   settings->node_type         = SEARCH_NODE_SERVER;
 
   memset(settings->search_space, 0, NP_FINGERPRINT_BYTES);
@@ -1457,6 +1888,103 @@ np_search_settings_t *np_default_searchsettings() {
   return settings;
 }
 
+// insert the entries of the mapped snapshot into the local tables
+static void __np_search_snapshot_restore(np_state_t *context) {
+  np_searchsnapshot_t *snapshot = &np_module(search)->snapshot;
+
+  struct __search_table_bucket
+      buckets[np_module(search)->searchnode.local_table_count];
+
+  for (uint32_t i = 0; i < snapshot->entry_count; i++) {
+    np_searchentry_t *entry = np_searchsnapshot_entry(snapshot, i);
+    uint8_t max_create_count =
+        __np_search_nearest_tables(context, entry, buckets);
+
+    for (uint8_t j = 0; j < max_create_count; j++) {
+      uint16_t table = buckets[j].index;
+      np_spinlock_lock(&np_module(search)->table_lock[table]);
+      __np_search_table_insert(context, table, entry);
+      np_spinlock_unlock(&np_module(search)->table_lock[table]);
+    }
+
+    if (max_create_count == 0) {
+      np_searchsnapshot_release(snapshot, entry);
+      np_index_destroy(&entry->search_index);
+      free(entry);
+    }
+  }
+
+  if (snapshot->entry_count > 0) {
+    log_msg(LOG_INFO,
+            NULL,
+            "restored %" PRIu32 " search entries from %s",
+            snapshot->entry_count,
+            np_module(search)->searchcfg.snapshot_file);
+  }
+}
+
+bool _snapshot_map_func(np_map_reduce_t *mr_struct, const void *element) {
+  if (element == NULL) return true;
+
+  np_searchentry_t *entry = (np_searchentry_t *)element;
+  np_tree_insert_str(mr_struct->reduce_result,
+                     entry->intent.uuid,
+                     np_treeval_new_v(entry));
+  return true;
+}
+
+// collect the entries of all local tables, write them to the snapshot file
+// and free them. An entry is stored in several tables, but only once in the
+// snapshot
+static void __np_search_snapshot_save(np_state_t *context) {
+  uint16_t table_count = np_module(search)->searchnode.local_table_count;
+
+  np_map_reduce_t mr = {0};
+  mr.map             = _snapshot_map_func;
+  mr.reduce_result   = np_tree_create();
+
+  np_dhkey_t seeds[table_count];
+  for (uint16_t i = 0; i < table_count; i++) {
+    _np_dhkey_assign(&seeds[i], __np_search_table_key(context, i));
+
+    np_spinlock_lock(&np_module(search)->table_lock[i]);
+    __np_search_table_foreach(context, i, &mr);
+    np_spinlock_unlock(&np_module(search)->table_lock[i]);
+  }
+
+  uint32_t           entry_count = 0;
+  np_searchentry_t **entries =
+      malloc(mr.reduce_result->size * sizeof(np_searchentry_t *));
+  np_tree_elem_t *tmp = NULL;
+  RB_FOREACH (tmp, np_tree_s, mr.reduce_result) {
+    entries[entry_count++] = (np_searchentry_t *)tmp->val.value.v;
+  }
+
+  if (np_module(search)->searchcfg.snapshot_file[0] != '\0') {
+    if (np_ok != np_searchsnapshot_write(
+                     np_module(search)->searchcfg.snapshot_file,
+                     seeds,
+                     table_count,
+                     entries,
+                     entry_count)) {
+      log_msg(LOG_WARNING,
+              NULL,
+              "could not write search snapshot to %s",
+              np_module(search)->searchcfg.snapshot_file);
+    }
+  }
+
+  for (uint32_t i = 0; i < entry_count; i++) {
+    np_searchsnapshot_release(&np_module(search)->snapshot, entries[i]);
+    np_index_destroy(&entries[i]->search_index);
+    free(entries[i]);
+  }
+  free(entries);
+  np_tree_free(mr.reduce_result);
+
+  np_searchsnapshot_close(&np_module(search)->snapshot);
+}
+
 // initialize the np_searchnode structure and associated message exchanges
 void np_searchnode_init(np_context *ac, np_search_settings_t *settings) {
   np_ctx_cast(ac);
@@ -1479,6 +2007,8 @@ void np_searchnode_init(np_context *ac, np_search_settings_t *settings) {
       memcpy(&np_module(search)->searchcfg,
              settings,
              sizeof(np_search_settings_t));
+      np_module(search)->searchnode.local_table_count =
+          settings->local_table_count;
       free(settings);
     }
     randombytes_buf(&np_module(search)->searchnode.node_id,
@@ -1500,18 +2030,38 @@ void np_searchnode_init(np_context *ac, np_search_settings_t *settings) {
     np_spinlock_init(&np_module(search)->pipeline_lock,
                      PTHREAD_PROCESS_PRIVATE);
 
+    np_spinlock_init(&np_module(search)->batch_lock, PTHREAD_PROCESS_PRIVATE);
+    sll_init(void_ptr, np_module(search)->table_batches);
+    sll_init(np_evt_callback_t, np_module(search)->table_batch_cb);
+    sll_append(np_evt_callback_t,
+               np_module(search)->table_batch_cb,
+               __np_search_table_batch_cb);
+
     char _tmp[65] = {0};
     np_id_str(_tmp, &np_module(search)->searchnode.node_id);
     log_msg(LOG_INFO, NULL, "starting up searchnode, peer id is: %s", _tmp);
 
+    // the table keys of a snapshot are re-used, so that restored entries
+    // are stored in the same tables as before
+    bool restore_seeds = false;
+    if (np_module(search)->searchcfg.snapshot_file[0] != '\0' &&
+        np_ok == np_searchsnapshot_open(
+                     &np_module(search)->snapshot,
+                     np_module(search)->searchcfg.snapshot_file)) {
+      restore_seeds = (np_module(search)->snapshot.table_count ==
+                       np_module(search)->searchcfg.local_table_count);
+    }
+
     for (uint16_t i = 0; i < np_module(search)->searchcfg.local_table_count;
          i++) {
       np_dhkey_t seed = {0};
-      randombytes_buf(&seed, sizeof(np_dhkey_t));
-      np_module(search)->searchnode.tree[i] = malloc(sizeof(np_bktree_t));
-      np_bktree_init(np_module(search)->searchnode.tree[i], seed, 10);
+      if (restore_seeds)
+        _np_dhkey_assign(&seed, &np_module(search)->snapshot.seeds[i]);
+      else randombytes_buf(&seed, sizeof(np_dhkey_t));
+      __np_search_table_init(context, i, seed);
       // np_bktree_init(__my_searchresults.entries[i], seed, 10);
     }
+    __np_search_snapshot_restore(context);
     memset(np_module(search)->searchnode.results,
            0,
            UINT8_MAX * sizeof(np_tree_t *));
@@ -1720,13 +2270,19 @@ void np_searchnode_destroy(np_context *ac) {
     np_module(search)->on_shutdown_route = true;
   }
 
+  // the entries of the local tables are written and freed first, the
+  // results below may still point to them
+  __np_search_snapshot_save(context);
+
   for (uint16_t i = 0; i < UINT8_MAX; i++) {
     if (np_module(search)->searchnode.results[i] != NULL) {
       np_tree_elem_t *tmp = NULL;
       RB_FOREACH (tmp, np_tree_s, np_module(search)->searchnode.results[i]) {
+        // result entries of local hits belong to the tables, results are
+        // released the same way as in np_search_query
         np_searchresult_t *x = (np_searchresult_t *)tmp->val.value.v;
-        np_index_destroy(&x->result_entry->search_index);
-        free(x->result_entry);
+        free(x->label);
+        free(x);
       }
     }
     np_tree_free(np_module(search)->searchnode.results[i]);
@@ -1735,13 +2291,17 @@ void np_searchnode_destroy(np_context *ac) {
 
   for (uint16_t i = 0; i < np_module(search)->searchnode.local_table_count;
        i++) {
-    np_bktree_destroy(np_module(search)->searchnode.tree[i]);
+    __np_search_table_destroy(context, i);
     np_spinlock_destroy(&np_module(search)->table_lock[i]);
   }
 
   for (uint8_t i = 0; i <= 8; i++) // 8+1
     np_spinlock_destroy(&np_module(search)->peer_lock[i]);
 
+  sll_free(void_ptr, np_module(search)->table_batches);
+  sll_free(np_evt_callback_t, np_module(search)->table_batch_cb);
+  np_spinlock_destroy(&np_module(search)->batch_lock);
+
   np_module_var(search);
   np_module_free(search);
 }
@@ -1929,6 +2489,35 @@ __np_cleanup__: {}
 //
 // serialization of search queries
 //
+// decode the entries of a batch into the pipeline, the batch is rejected if
+// one of its entries cannot be decoded
+bool __decode_search_entry_batch(np_tree_t                     *data,
+                                 struct search_pipeline_result *pipeline) {
+  pipeline->batch_count = 0;
+
+  pipeline->batch_entries = calloc(data->size, sizeof(np_searchentry_t *));
+  pipeline->batch_distribution = calloc(data->size, sizeof(uint8_t));
+
+  for (uint32_t i = 0; i < data->size; i++) {
+    np_tree_elem_t   *tmp   = np_tree_find_int(data, i);
+    np_searchentry_t *entry = NULL;
+    if (tmp != NULL) entry = __decode_search_entry(tmp->val.value.tree);
+
+    if (entry == NULL) {
+      for (uint32_t j = 0; j < pipeline->batch_count; j++) {
+        np_index_destroy(&pipeline->batch_entries[j]->search_index);
+        free(pipeline->batch_entries[j]);
+      }
+      free(pipeline->batch_entries);
+      free(pipeline->batch_distribution);
+      pipeline->batch_count = 0;
+      return false;
+    }
+    pipeline->batch_entries[pipeline->batch_count++] = entry;
+  }
+  return true;
+}
+
 np_tree_t *__encode_search_query(np_searchquery_t *data) {
   np_tree_t *query_as_tree = np_tree_create();
 
@@ -2405,6 +2994,75 @@ void np_search_add_entry(np_context *ac, np_searchentry_t *entry) {
   np_unref_obj(np_message_t, new_entry_msg, ref_obj_creation);
 }
 
+void np_search_add_entries(np_context        *ac,
+                           np_searchentry_t **entries,
+                           uint32_t           count) {
+  np_ctx_cast(ac);
+
+  if (count == 0) return;
+
+  struct search_pipeline_result *pipeline =
+      calloc(1, sizeof(struct search_pipeline_result));
+  pipeline->stop_time = pipeline->start_time = np_time_now();
+
+  np_generate_subject(&pipeline->search_subject,
+                      SEARCH_ENTRY_SUBJECT,
+                      strnlen(SEARCH_ENTRY_SUBJECT, 256));
+
+  pipeline->batch_count   = count;
+  pipeline->batch_entries = calloc(count, sizeof(np_searchentry_t *));
+  pipeline->batch_distribution = calloc(count, sizeof(uint8_t));
+  memcpy(pipeline->batch_entries, entries, count * sizeof(np_searchentry_t *));
+
+  np_tree_t *batch_entries = np_tree_create();
+  for (uint32_t i = 0; i < count; i++) {
+    np_tree_t *search_entry = __encode_search_entry(entries[i]);
+    np_tree_insert_int(batch_entries, i, np_treeval_new_tree(search_entry));
+    np_tree_free(search_entry);
+  }
+  np_tree_t *search_batch = np_tree_create();
+  np_tree_insert_str(search_batch,
+                     "entry.batch",
+                     np_treeval_new_tree(batch_entries));
+  np_tree_free(batch_entries);
+
+  struct np_e2e_message_s *new_entry_msg = NULL;
+  np_new_obj(np_message_t, new_entry_msg);
+
+  _np_message_create(new_entry_msg,
+                     pipeline->search_subject,
+                     np_module(search)->searchnode.node_id,
+                     pipeline->search_subject,
+                     search_batch);
+
+  log_msg(LOG_INFO,
+          new_entry_msg->uuid,
+          "using batch of %" PRIu32 " searchentries (%" PRIsizet " bytes)",
+          count,
+          search_batch->byte_size);
+
+  np_spinlock_lock(&np_module(search)->pipeline_lock);
+  np_tree_insert_uuid(&np_module(search)->pipeline_results,
+                      new_entry_msg->uuid,
+                      np_treeval_new_v(pipeline));
+  np_spinlock_unlock(&np_module(search)->pipeline_lock);
+
+  // manual execution of pipeline for now
+  __check_remote_peer_distribution(ac,
+                                   new_entry_msg,
+                                   search_batch,
+                                   &np_module(search)->pipeline_results);
+
+  if (FLAG_CMP(np_module(search)->searchcfg.node_type, SEARCH_NODE_SERVER))
+    __np_search_add_entry(ac,
+                          new_entry_msg,
+                          search_batch,
+                          &np_module(search)->pipeline_results);
+
+  np_tree_free(search_batch);
+  np_unref_obj(np_message_t, new_entry_msg, ref_obj_creation);
+}
+
 // send the query and search for entries
 void np_search_query(np_context *ac, np_searchquery_t *query) {
   np_ctx_cast(ac);
@@ -2583,14 +3241,30 @@ bool _np_new_searchentry_cb(np_context                          *ac,
           body->byte_size,
           body->size);
 
+  np_tree_elem_t *batch_elem = np_tree_find_str(body, "entry.batch");
+  if (batch_elem != NULL) {
+    if (!__decode_search_entry_batch(batch_elem->val.value.tree, pipeline)) {
+      log_msg(LOG_DEBUG, NULL, "could not decode searchentry batch");
+      free(pipeline);
+      return false;
+    }
+    np_spinlock_lock(&np_module(search)->pipeline_lock);
+    np_tree_insert_uuid(pipeline_results,
+                        entry_msg->uuid,
+                        np_treeval_new_v(pipeline));
+    np_spinlock_unlock(&np_module(search)->pipeline_lock);
+    return true;
+  }
+
   pipeline->obj.entry = __decode_search_entry(body);
-  _np_dhkey_assign(&pipeline->search_index,
-                   &pipeline->obj.entry->search_index.lower_dhkey);
 
   if (pipeline->obj.entry == NULL) {
     log_msg(LOG_DEBUG, NULL, "could not decode searchentry");
+    free(pipeline);
     return false;
   } else {
+    _np_dhkey_assign(&pipeline->search_index,
+                     &pipeline->obj.entry->search_index.lower_dhkey);
     np_spinlock_lock(&np_module(search)->pipeline_lock);
     np_tree_insert_uuid(pipeline_results,
                         entry_msg->uuid,
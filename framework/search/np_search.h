@@ -19,6 +19,24 @@ extern "C" {
 
 #define BKTREE_ARRAY_SIZE 256
 
+// default query radius of the local tables: entries further away from the
+// query index (hamming distance of the lower_dhkey) are not visited. the
+// default covers the whole key and returns the same results as an unpruned
+// search, a smaller radius trades recall for query speed
+#ifndef NP_SEARCH_QUERY_RADIUS
+#define NP_SEARCH_QUERY_RADIUS 256
+#endif
+
+// maximum number of results a single local query adds to its result set
+#ifndef NP_SEARCH_QUERY_TOP_K
+#define NP_SEARCH_QUERY_TOP_K 64
+#endif
+
+// maximum number of entries that are sent to a remote peer in one message
+#ifndef NP_SEARCH_BATCH_ENTRIES
+#define NP_SEARCH_BATCH_ENTRIES 16
+#endif
+
 typedef struct np_searchquery_s np_searchquery_t;
 
 // searchnode definition has been moved to the np_search.c file
@@ -91,6 +109,11 @@ bool np_create_searchquery(np_context       *ac,
 
 // ads the created searchentry to the global search index
 void np_search_add_entry(np_context *ac, np_searchentry_t *entry);
+// adds many entries at once, the entries are sent in batches to the remote
+// peers and tracked by a single pipeline
+void np_search_add_entries(np_context        *ac,
+                           np_searchentry_t **entries,
+                           uint32_t           count);
 // send the query and search for entries
 void np_search_query(np_context *context, np_searchquery_t *query);
 // retriev the result for a query
@@ -0,0 +1,218 @@
+//
+// SPDX-FileCopyrightText: 2016-2024 by pi-lar GmbH
+// SPDX-License-Identifier: OSL-3.0
+//
+
+#include "search/np_searchsnapshot.h"
+
+#include <assert.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static size_t __np_searchsnapshot_record_size(uint32_t bitset_size) {
+  size_t size = sizeof(struct np_searchsnapshot_record_s) + bitset_size;
+  // pad the records to keep the dhkeys aligned in the mapping
+  return (size + 7) & ~((size_t)7);
+}
+
+static size_t __np_searchsnapshot_bitset_size(const np_bloom_t *bloom) {
+  return bloom->_num_blocks * bloom->_size * bloom->_d / 8;
+}
+
+enum np_return np_searchsnapshot_open(np_searchsnapshot_t *snapshot,
+                                      const char          *filename) {
+  memset(snapshot, 0, sizeof(np_searchsnapshot_t));
+
+  int fd = open(filename, O_RDONLY);
+  if (-1 == fd) return np_operation_failed;
+
+  struct stat fileinfo;
+  if (0 != fstat(fd, &fileinfo) ||
+      fileinfo.st_size < (off_t)sizeof(struct np_searchsnapshot_header_s)) {
+    close(fd);
+    return np_operation_failed;
+  }
+
+  // private mapping: changes to the entries are never written back
+  void *data = mmap(NULL,
+                    fileinfo.st_size,
+                    PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE,
+                    fd,
+                    0);
+  close(fd);
+  if (data == MAP_FAILED) return np_operation_failed;
+
+  snapshot->_data = data;
+  snapshot->_size = fileinfo.st_size;
+
+  struct np_searchsnapshot_header_s *header =
+      (struct np_searchsnapshot_header_s *)snapshot->_data;
+
+  np_bloom_t *bloom       = _np_neuropil_bloom_create();
+  size_t      bitset_size = __np_searchsnapshot_bitset_size(bloom);
+  memcpy(&snapshot->_bloom, bloom, sizeof(np_bloom_t));
+  snapshot->_bloom._bitset = NULL;
+  _np_bloom_free(bloom);
+
+  size_t record_size = __np_searchsnapshot_record_size(bitset_size);
+  size_t body_size   = snapshot->_size - sizeof(*header);
+
+  if (0 != memcmp(header->magic, NP_SEARCHSNAPSHOT_MAGIC, 8) ||
+      header->version != NP_SEARCHSNAPSHOT_VERSION ||
+      header->bitset_size != bitset_size ||
+      body_size != header->table_count * sizeof(np_dhkey_t) +
+                       header->entry_count * record_size) {
+    np_searchsnapshot_close(snapshot);
+    return np_operation_failed;
+  }
+
+  unsigned char checksum[crypto_generichash_BYTES];
+  crypto_generichash(checksum,
+                     crypto_generichash_BYTES,
+                     snapshot->_data + sizeof(*header),
+                     body_size,
+                     NULL,
+                     0);
+  if (0 != sodium_memcmp(checksum, header->checksum, sizeof(checksum))) {
+    np_searchsnapshot_close(snapshot);
+    return np_operation_failed;
+  }
+
+  snapshot->table_count  = header->table_count;
+  snapshot->entry_count  = header->entry_count;
+  snapshot->seeds        = (np_dhkey_t *)(snapshot->_data + sizeof(*header));
+  snapshot->_record_size = record_size;
+
+  return np_ok;
+}
+
+void np_searchsnapshot_close(np_searchsnapshot_t *snapshot) {
+  if (snapshot->_data != NULL) {
+    munmap(snapshot->_data, snapshot->_size);
+  }
+  snapshot->_data       = NULL;
+  snapshot->_size       = 0;
+  snapshot->entry_count = 0;
+  snapshot->seeds       = NULL;
+}
+
+np_searchentry_t *np_searchsnapshot_entry(np_searchsnapshot_t *snapshot,
+                                          uint32_t             index) {
+  assert(index < snapshot->entry_count);
+
+  uint8_t *record_data = snapshot->_data +
+                         sizeof(struct np_searchsnapshot_header_s) +
+                         snapshot->table_count * sizeof(np_dhkey_t) +
+                         index * snapshot->_record_size;
+  struct np_searchsnapshot_record_s *record =
+      (struct np_searchsnapshot_record_s *)record_data;
+
+  np_searchentry_t *entry = calloc(1, sizeof(np_searchentry_t));
+  memcpy(&entry->search_index.lower_dhkey,
+         &record->lower_dhkey,
+         sizeof(np_dhkey_t));
+  memcpy(&entry->intent, &record->intent, sizeof(struct np_token));
+
+  entry->search_index._clk_hash = malloc(sizeof(np_bloom_t));
+  memcpy(entry->search_index._clk_hash, &snapshot->_bloom, sizeof(np_bloom_t));
+  entry->search_index._clk_hash->_free_items = record->free_items;
+  entry->search_index._clk_hash->_bitset =
+      record_data + sizeof(struct np_searchsnapshot_record_s);
+
+  entry->search_index._cbl_index         = NULL;
+  entry->search_index._cbl_index_counter = NULL;
+  entry->search_index.is_final           = true;
+
+  return entry;
+}
+
+void np_searchsnapshot_release(np_searchsnapshot_t *snapshot,
+                               np_searchentry_t    *entry) {
+  np_bloom_t *bloom = entry->search_index._clk_hash;
+  if (bloom == NULL || snapshot->_data == NULL) return;
+
+  if (bloom->_bitset >= snapshot->_data &&
+      bloom->_bitset < snapshot->_data + snapshot->_size) {
+    bloom->_bitset = NULL;
+  }
+}
+
+enum np_return np_searchsnapshot_write(const char        *filename,
+                                       const np_dhkey_t  *seeds,
+                                       uint32_t           table_count,
+                                       np_searchentry_t **entries,
+                                       uint32_t           entry_count) {
+  char tmp_filename[PATH_MAX];
+  snprintf(tmp_filename, PATH_MAX, "%s.tmp", filename);
+
+  FILE *file = fopen(tmp_filename, "wb");
+  if (file == NULL) return np_operation_failed;
+
+  np_bloom_t *bloom       = _np_neuropil_bloom_create();
+  uint32_t    bitset_size = __np_searchsnapshot_bitset_size(bloom);
+  _np_bloom_free(bloom);
+
+  struct np_searchsnapshot_header_s header = {
+      .version     = NP_SEARCHSNAPSHOT_VERSION,
+      .table_count = table_count,
+      .entry_count = entry_count,
+      .bitset_size = bitset_size,
+  };
+  memcpy(header.magic, NP_SEARCHSNAPSHOT_MAGIC, 8);
+
+  crypto_generichash_state state;
+  crypto_generichash_init(&state, NULL, 0, crypto_generichash_BYTES);
+
+  bool     ret         = (1 == fwrite(&header, sizeof(header), 1, file));
+  size_t   record_size = __np_searchsnapshot_record_size(bitset_size);
+  uint8_t *record_data = calloc(1, record_size);
+
+  if (ret && table_count > 0) {
+    ret = (table_count ==
+           fwrite(seeds, sizeof(np_dhkey_t), table_count, file));
+    crypto_generichash_update(&state,
+                              (const unsigned char *)seeds,
+                              table_count * sizeof(np_dhkey_t));
+  }
+
+  for (uint32_t i = 0; i < entry_count && ret; i++) {
+    struct np_searchsnapshot_record_s *record =
+        (struct np_searchsnapshot_record_s *)record_data;
+
+    memset(record_data, 0, record_size);
+    memcpy(&record->lower_dhkey,
+           &entries[i]->search_index.lower_dhkey,
+           sizeof(np_dhkey_t));
+    memcpy(&record->intent, &entries[i]->intent, sizeof(struct np_token));
+    record->free_items = entries[i]->search_index._clk_hash->_free_items;
+    memcpy(record_data + sizeof(struct np_searchsnapshot_record_s),
+           entries[i]->search_index._clk_hash->_bitset,
+           bitset_size);
+
+    ret = (1 == fwrite(record_data, record_size, 1, file));
+    crypto_generichash_update(&state, record_data, record_size);
+  }
+  free(record_data);
+
+  crypto_generichash_final(&state, header.checksum, crypto_generichash_BYTES);
+  if (ret) {
+    ret = (0 == fseek(file, 0, SEEK_SET)) &&
+          (1 == fwrite(&header, sizeof(header), 1, file));
+  }
+  // the data has to be on disk before the rename replaces the old snapshot
+  ret = ret && (0 == fflush(file)) && (0 == fsync(fileno(file)));
+  ret = (0 == fclose(file)) && ret;
+
+  // the old snapshot stays valid until the new one is complete
+  if (ret && 0 == rename(tmp_filename, filename)) return np_ok;
+
+  unlink(tmp_filename);
+  return np_operation_failed;
+}
@@ -0,0 +1,87 @@
+//
+// SPDX-FileCopyrightText: 2016-2024 by pi-lar GmbH
+// SPDX-License-Identifier: OSL-3.0
+//
+#ifndef NP_FWK_SEARCH_SNAPSHOT_H_
+#define NP_FWK_SEARCH_SNAPSHOT_H_
+
+#include <stdint.h>
+
+#include "sodium.h"
+
+#include "neuropil.h"
+
+#include "search/np_search.h"
+#include "util/np_bloom.h"
+
+#include "np_dhkey.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// on disk snapshot of the local search tables. The file is mapped private on
+// startup: the bloom filter bitsets of the restored entries point into the
+// mapping, so the kernel copies a page only once an entry is aged by the
+// deprecation job. The layout is in host byte order.
+#define NP_SEARCHSNAPSHOT_MAGIC   "npsearch"
+#define NP_SEARCHSNAPSHOT_VERSION 1
+
+struct np_searchsnapshot_header_s {
+  char     magic[8];
+  uint32_t version;
+  uint32_t table_count;
+  uint32_t entry_count;
+  uint32_t bitset_size; // bytes of each neuropil bloom filter bitset
+  // blake2b hash of everything behind the header
+  unsigned char checksum[crypto_generichash_BYTES];
+} NP_PACKED(1);
+
+// the header is followed by table_count seeds of the search tables and
+// entry_count records, each record is followed by the bloom filter bitset
+struct np_searchsnapshot_record_s {
+  np_dhkey_t      lower_dhkey;
+  uint16_t        free_items;
+  struct np_token intent;
+} NP_PACKED(1);
+
+struct np_searchsnapshot_s {
+  uint8_t *_data;
+  size_t   _size;
+
+  uint32_t          table_count;
+  uint32_t          entry_count;
+  const np_dhkey_t *seeds;
+
+  size_t     _record_size;
+  np_bloom_t _bloom; // template for the bloom filters of restored entries
+};
+typedef struct np_searchsnapshot_s np_searchsnapshot_t;
+
+// map and verify a snapshot file, returns np_operation_failed if there is no
+// snapshot or if it is damaged or of a different version
+enum np_return np_searchsnapshot_open(np_searchsnapshot_t *snapshot,
+                                      const char          *filename);
+void           np_searchsnapshot_close(np_searchsnapshot_t *snapshot);
+
+// create the entry stored at position index, its bloom filter bitset is
+// backed by the mapping
+np_searchentry_t *np_searchsnapshot_entry(np_searchsnapshot_t *snapshot,
+                                          uint32_t             index);
+// reset the bitset of a restored entry if it is still backed by the mapping,
+// must be called before the index of the entry is destroyed
+void np_searchsnapshot_release(np_searchsnapshot_t *snapshot,
+                               np_searchentry_t    *entry);
+
+// write the seeds and entries to a temporary file and move it in place
+enum np_return np_searchsnapshot_write(const char        *filename,
+                                       const np_dhkey_t  *seeds,
+                                       uint32_t           table_count,
+                                       np_searchentry_t **entries,
+                                       uint32_t           entry_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NP_FWK_SEARCH_SNAPSHOT_H_
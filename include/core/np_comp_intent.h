@@ -37,6 +37,29 @@ enum crud_op {
   crud_delete
 };
 
+// precomputed receiver of a subject, holds its own reference of the token
+struct np_intent_fanout_s {
+  np_aaatoken_t *token;
+  np_dhkey_t     issuer;
+  np_dhkey_t     audience;
+  double         expires_at;
+};
+
+struct __np_token_ledger {
+  np_pll_t(np_aaatoken_ptr, recv_tokens); // link to runtime interest data on
+                                          // which this node is interested in
+  np_pll_t(np_aaatoken_ptr, send_tokens); // link to runtime interest data on
+                                          // which this node is interested in
+
+  // valid receiver tokens of recv_tokens, rebuilt under the key_lock if the
+  // list changes or if the first of the cached tokens expires
+  struct np_intent_fanout_s *fanout;
+  uint32_t                   fanout_count;
+  uint32_t                   fanout_size;
+  double                     fanout_expiry;
+  bool                       fanout_dirty;
+};
+
 NP_API_INTERN
 bool __is_intent_authz(np_util_statemachine_t *statemachine,
                        const np_util_event_t   event);
@@ -61,10 +84,20 @@ NP_API_INTERN
 np_aaatoken_t *_np_intent_get_receiver(np_key_t        *subject_key,
                                        const np_dhkey_t target);
 
+// releases the token ledger of a subject key together with its tokens
+NP_API_INTERN
+void _np_intent_ledger_free(np_key_t *subject_key);
+
+// the caller holds the key_lock of the subject key
 NP_API_INTERN
 void _np_intent_get_all_receiver(np_key_t  *subject_key,
                                  np_dhkey_t audience,
                                  np_sll_t(np_aaatoken_ptr, *tmp_token_list));
+// collects the unexpired sender and receiver tokens of the peers of a subject
+NP_API_INTERN
+void _np_intent_get_all_tokens(np_key_t *subject_key,
+                               np_sll_t(np_aaatoken_ptr, *sender_list),
+                               np_sll_t(np_aaatoken_ptr, *receiver_list));
 
 NP_API_INTERN
 bool _np_intent_get_ack_session(np_key_t   *subject_key,
@@ -11,14 +11,18 @@
 #include "neuropil.h"
 
 #include "util/np_bloom.h"
+#include "util/np_dedup.h"
 #include "util/np_event.h"
 #include "util/np_list.h"
+#include "util/np_msgcache.h"
 #include "util/np_statemachine.h"
 
+#include "np_attributes.h"
 #include "np_dhkey.h"
 #include "np_legacy.h"
 #include "np_memory.h"
 #include "np_message.h"
+#include "np_responsecontainer.h"
 #include "np_types.h"
 #include "np_util.h"
 
@@ -331,10 +335,12 @@ struct np_msgproperty_conf_s {
   // cache which will hold up to max_threshold messages
   np_msgcache_policy_type cache_policy;
   uint16_t                cache_size;
+  size_t                  cache_max_bytes; // 0 disables the byte budget
 
   uint32_t max_threshold; // local threshhold size
 
-  bool unique_uuids_check;
+  bool     unique_uuids_check;
+  uint32_t unique_uuids_max; // memory ceiling of the duplicate check
 
   // internal message subject
   bool                     is_internal;
@@ -371,10 +377,15 @@ struct np_msgproperty_run_s {
   // differentiate between tx and rx
   double last_intent_update;
   double last_pheromone_update;
+  // current resend interval of our unchanged intent token
+  double intent_resend_interval;
+  // peers (issuer and audience of their intent token) which have been answered
+  // with our current intent token
+  np_tree_t *intent_replies;
 
   uint32_t msg_threshold; // current threshold size
 
-  np_dll_t(np_message_ptr, msg_cache);
+  np_msgcache_t *msg_cache;
 
   // callback function(s) to invoke when a message is received
   np_sll_t(np_evt_callback_t, callbacks); // internal neuropil supplied
@@ -384,16 +395,17 @@ struct np_msgproperty_run_s {
   TSP(bool, has_reply);
   np_sll_t(np_msgproperty_on_reply_t, on_reply);
 
-  uint32_t unique_uuids_max;
+  np_responsetable_t *response_handler;    // handler for ack messages
+  np_tree_t          *redelivery_messages; // storage for redelivery of messages
+  np_dedup_t         *unique_uuids;        // uuid check incoming messages
 
-  np_tree_t *response_handler;    // handler for ack messages
-  np_tree_t *redelivery_messages; // storage for redelivery of messages
-  np_tree_t *unique_uuids;        // uuid check incoming messages
+  // pending acknowledgements per peer, only used for msghandler NP_ACK
+  TSP(np_tree_t *, ack_batches);
 
   // a set of attributes for this data channel
   np_attributes_t attributes;
   // a set of required attributes / policy for this data channel
-  np_bloom_t *required_attributes_policy;
+  np_attribute_policy_t *required_attributes_policy;
 
 } NP_API_EXPORT;
 
@@ -515,6 +527,15 @@ NP_API_INTERN
 void __np_msgproperty_redeliver_messages(np_util_statemachine_t *statemachine,
                                          const np_util_event_t   event);
 
+/**
+ ** complete the response container of an acknowledged message uuid, returns
+ ** false if the uuid is unknown
+ **/
+NP_API_INTERN
+bool _np_msgproperty_complete_response(np_msgproperty_run_t *self,
+                                       const unsigned char  *uuid,
+                                       const np_util_event_t event);
+
 /**
  ** handle treshold breaches
  **/
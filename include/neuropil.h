@@ -124,6 +124,14 @@ enum np_return {
   np_startup,
 } NP_CONST_ENUM;
 
+enum np_event_backend {
+  np_event_backend_auto = 0,
+  np_event_backend_epoll,
+  np_event_backend_iouring,
+  np_event_backend_poll,
+  np_event_backend_select,
+} NP_CONST_ENUM;
+
 NP_API_EXPORT
 const char *np_error_str(enum np_return e);
 
@@ -199,6 +207,8 @@ struct np_settings {
   np_log_write_callback log_write_fn;
   uint16_t              jobqueue_size;
   uint16_t              max_msgs_per_sec;
+  enum np_event_backend event_backend;
+  char                  warmstart_file[256];
   // ...
 } NP_PACKED(1);
 
@@ -447,6 +457,23 @@ value)
 depending on the number of threads this should be sufficient for many use cases.
 High throuput cloud nodes could need larger jobqueues.
 
+.. c:member:: enum np_event_backend event_backend
+
+   The kernel interface used by the event loops of the node. The default
+``np_event_backend_auto`` lets the event library pick the best available
+backend, ``np_event_backend_iouring`` requests io_uring on Linux 5.6+. A
+backend that is not supported by the running system falls back to
+``np_event_backend_auto``.
+
+.. c:member:: char warmstart_file[256]
+
+   Pathname of a warm start snapshot. If set, the node periodically and on
+:c:func:`np_destroy` writes the node tokens of its routing table and leafset
+and the still valid intent tokens of its peers to this file. On the first
+:c:func:`np_run` the snapshot is loaded, every token is verified again, and the
+node rejoins its previous neighbours right away. The default is an empty
+string, which disables the snapshot.
+
 
 
 Identity management
@@ -73,7 +73,7 @@ enum np_data_return np_set_data(np_datablock_t     *block,
                                 np_data_value       data);
 NP_API_EXPORT
 enum np_data_return np_get_data(np_datablock_t      *block,
-                                char                 key[255],
+                                const char          *key,
                                 struct np_data_conf *out_data_config,
                                 np_data_value       *out_data);
 
@@ -33,9 +33,12 @@ The structure is described here to allow users the proper use of the
 
 #include "neuropil.h"
 
+#include "util/np_event.h"
 #include "util/np_list.h"
 
+#include "np_attributes.h"
 #include "np_crypto.h"
+#include "np_data.h"
 #include "np_dhkey.h"
 #include "np_memory.h"
 #include "np_threads.h"
@@ -211,6 +214,12 @@ struct np_aaatoken_s {
 
   bool is_signature_verified;
   bool is_signature_attributes_verified;
+
+  // key directory of the attributes, built once they are signed or verified
+  np_data_index_t attributes_index;
+  // attribute hashes for policy checks, built on first use
+  np_attribute_mask_t attributes_mask;
+  bool                attributes_mask_is_set;
 } NP_API_EXPORT;
 
 _NP_GENERATE_MEMORY_PROTOTYPES(np_aaatoken_t);
@@ -237,6 +246,62 @@ bool _np_aaatoken_is_valid(np_state_t           *context,
                            np_aaatoken_t        *token,
                            enum np_aaatoken_type expected_type);
 
+/**
+.. c:function:: void _np_aaatoken_verify_submit(np_state_t* context, np_aaatoken_t* token, enum np_aaatoken_type expected_type, np_util_event_t event, np_evt_callback_t on_valid)
+
+   queues a token for the batched verification stage. pending tokens are
+   verified in batches of NP_TOKEN_VERIFY_BATCH_SIZE on the worker threads.
+   if the token is valid, on_valid is called with the event, or, if on_valid
+   is NULL, the event is delivered to event.target_dhkey. invalid tokens are
+   dropped. if the stage is not available or full the token is verified
+   inline.
+
+   :param token: the token to check
+   :param expected_type: the expected type of the token
+   :param event: the event to pass on once the token is verified
+   :param on_valid: optional continuation for valid tokens
+
+*/
+NP_API_INTERN
+void _np_aaatoken_verify_submit(np_state_t           *context,
+                                np_aaatoken_t        *token,
+                                enum np_aaatoken_type expected_type,
+                                np_util_event_t       event,
+                                np_evt_callback_t     on_valid);
+
+/**
+.. c:function:: bool _np_aaatoken_verify_handshake(np_state_t* context, np_handshake_token_t* token, np_util_event_t event, np_evt_callback_t on_valid)
+
+   queues a handshake token for the handshake verification stage. expired
+   tokens and handshakes which have been seen for the same alias key within
+   NP_HANDSHAKE_DUPLICATE_WINDOW_SEC are rejected before any signature check.
+   in contrast to :c:func:`_np_aaatoken_verify_submit` a full queue drops the
+   handshake.
+
+   :param token: the decoded, but not yet verified handshake token
+   :param event: the event to pass on once the token is verified, its
+                 target_dhkey is the alias key of the sender
+   :param on_valid: continuation for valid tokens
+   :return: true if the handshake has been accepted for verification
+
+*/
+NP_API_INTERN
+bool _np_aaatoken_verify_handshake(np_state_t           *context,
+                                   np_handshake_token_t *token,
+                                   np_util_event_t       event,
+                                   np_evt_callback_t     on_valid);
+// current depth of the handshake queue, the average queueing delay since the
+// last call and the count of dropped handshakes
+NP_API_INTERN
+void _np_aaatoken_handshake_statistics(np_state_t *context,
+                                       uint16_t   *queue_depth,
+                                       double     *latency,
+                                       uint32_t   *dropped);
+NP_API_INTERN
+bool _np_aaatoken_init(np_state_t *context);
+NP_API_INTERN
+void _np_aaatoken_destroy(np_state_t *context);
+
 NP_API_INTERN
 np_dhkey_t np_aaatoken_get_fingerprint(np_aaatoken_t *token,
                                        bool           include_extensions);
@@ -283,6 +348,11 @@ void np_aaatoken_set_partner_fp(np_aaatoken_t *self, np_dhkey_t partner_fp);
 NP_API_INTERN
 np_dhkey_t np_aaatoken_get_partner_fp(np_aaatoken_t *self);
 NP_API_INTERN
+enum np_data_return _np_aaatoken_get_data(np_aaatoken_t       *self,
+                                          const char          *key,
+                                          struct np_data_conf *out_data_config,
+                                          np_data_value       *out_data);
+NP_API_INTERN
 void _np_aaatoken_set_signature(np_aaatoken_t *self, np_aaatoken_t *signee);
 NP_API_INTERN
 void _np_aaatoken_update_attributes_signature(np_aaatoken_t *self);
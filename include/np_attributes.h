@@ -15,6 +15,39 @@
 #ifdef __cplusplus
 extern "C" {
 #endif
+
+#ifndef NP_POLICY_RESULT_CACHE_SIZE
+#define NP_POLICY_RESULT_CACHE_SIZE 32
+#endif
+
+// one bit for each count field of a neuropil bloom filter (4 * 255 fields)
+#define NP_ATTRIBUTE_MASK_WORDS 16
+
+struct np_attribute_mask_s {
+  uint64_t bits[NP_ATTRIBUTE_MASK_WORDS];
+};
+typedef struct np_attribute_mask_s np_attribute_mask_t;
+
+// a policy of required attributes. The bloom filter is compiled into a mask
+// after each change, and the compliance results of tokens with verified
+// attributes are remembered per policy version and attribute signature.
+struct np_attribute_policy_s {
+  np_bloom_t *bloom;
+  uint32_t    version; // has to be incremented on each change of the bloom
+
+  uint32_t            compiled_version;
+  bool                is_empty;
+  np_attribute_mask_t required;
+
+  struct {
+    uint32_t       version;
+    bool           compliant;
+    np_signature_t attributes_signature;
+  } results[NP_POLICY_RESULT_CACHE_SIZE];
+  uint16_t next_result;
+};
+typedef struct np_attribute_policy_s np_attribute_policy_t;
+
 // neuropil setup functions
 NP_API_PROTEC
 bool _np_attributes_init(np_state_t *context);
@@ -38,6 +71,17 @@ bool _np_attribute_build_bloom(np_bloom_t *target, np_attributes_t *attributes);
 NP_API_INTERN
 np_bloom_t *_np_attribute_bloom();
 
+NP_API_INTERN
+np_attribute_policy_t *_np_attribute_policy_create();
+NP_API_INTERN
+void _np_attribute_policy_free(np_attribute_policy_t *policy);
+NP_API_INTERN
+bool _np_attribute_build_mask(np_attribute_mask_t *mask,
+                              np_attributes_t     *attributes);
+NP_API_INTERN
+bool _np_policy_check_token_compliance(np_attribute_policy_t *policy,
+                                       np_aaatoken_t         *token);
+
 #ifdef __cplusplus
 }
 #endif
@@ -50,6 +50,15 @@ bool _np_out_pheromone(np_state_t *context, np_util_event_t msg_event);
 // send an acknowledgement to the target node
 NP_API_INTERN
 bool _np_out_ack(np_state_t *context, np_util_event_t msg_event);
+// acknowledge the message uuid to to_dhkey, batched acknowledgements are sent
+// once NP_ACK_BATCH_MAX_UUIDS are collected or by _np_axon_flush_acks
+NP_API_INTERN
+void _np_axon_send_ack(np_state_t          *context,
+                       np_dhkey_t           to_dhkey,
+                       const unsigned char *uuid,
+                       bool                 use_batch);
+NP_API_INTERN
+bool _np_axon_flush_acks(np_state_t *context, np_util_event_t args);
 
 NP_API_INTERN
 bool _np_out_discovery_messages(np_state_t *context, np_util_event_t msg_event);
@@ -18,6 +18,29 @@ struct np_data {
   struct np_data_conf conf;
   np_data_value       value;
 };
+
+#ifndef NP_DATA_INDEX_SLOTS
+#define NP_DATA_INDEX_SLOTS 32 // power of two
+#endif
+
+// key directory of a datablock, filled with np_data_index_build. Lookups only
+// use it as long as the header of the block is unchanged, each hit is
+// verified against the encoded key. A block that is overwritten as a whole
+// has to be indexed again.
+struct np_data_index_s {
+  const np_datablock_t *block;
+  size_t                used_length;
+  uint32_t              object_count;
+  bool                  complete;
+
+  struct {
+    uint32_t hash;
+    uint32_t offset;
+    uint32_t end; // zero for empty slots
+  } slots[NP_DATA_INDEX_SLOTS];
+};
+typedef struct np_data_index_s np_data_index_t;
+
 // Internal methods
 NP_API_PROTEC
 enum np_data_return np_get_data_size(np_datablock_t *block,
@@ -25,6 +48,18 @@ enum np_data_return np_get_data_size(np_datablock_t *block,
 NP_API_PROTEC
 enum np_data_return np_get_object_count(np_datablock_t *block, uint32_t *count);
 NP_API_PROTEC
+void np_data_index_build(np_data_index_t *index, np_datablock_t *block);
+NP_API_PROTEC
+void np_data_index_reset(np_data_index_t *index);
+// same as np_get_data, but probes the index first. The index is never
+// modified, so a shared index can be used by concurrent readers
+NP_API_PROTEC
+enum np_data_return np_get_data_indexed(const np_data_index_t *index,
+                                        np_datablock_t        *block,
+                                        const char            *key,
+                                        struct np_data_conf   *out_data_config,
+                                        np_data_value         *out_data);
+NP_API_PROTEC
 enum np_data_return _np_iterate_data_mapreduce(np_datablock_t  *block,
                                                np_map_reduce_t *map);
 NP_API_PROTEC
@@ -17,6 +17,9 @@ extern "C" {
 // input message handlers
 NP_API_INTERN
 bool _np_in_handshake(np_state_t *context, np_util_event_t msg_event);
+NP_API_INTERN
+bool __np_in_handshake_verified(np_state_t     *context,
+                                np_util_event_t hs_event);
 
 NP_API_INTERN
 bool _check_and_send_destination_ack(np_state_t     *context,
@@ -24,11 +24,23 @@ void __np_event_runtime_start_with_event(np_state_t     *context,
                                          np_dhkey_t      dhkey,
                                          np_util_event_t event,
                                          char           *source);
+NP_API_INTERN
+void __np_event_runtime_start_with_job_event(np_state_t     *context,
+                                             np_dhkey_t      dhkey,
+                                             np_util_event_t event,
+                                             char           *source);
+NP_API_INTERN
+bool _np_event_runtime_has_capacity(np_event_runtime_t *runtime,
+                                    uint8_t             reserve);
+NP_API_INTERN
+bool _np_event_runtime_is_synchronous(np_event_runtime_t *runtime);
 
 #define _np_event_runtime_add_event(context, runtime, dhkey, event)            \
   __np_event_runtime_add_event(context, runtime, dhkey, event, FUNC);
 #define _np_event_runtime_start_with_event(context, dhkey, event)              \
   __np_event_runtime_start_with_event(context, dhkey, event, FUNC);
+#define _np_event_runtime_start_with_job_event(context, dhkey, event)          \
+  __np_event_runtime_start_with_job_event(context, dhkey, event, FUNC);
 
 #ifdef __cplusplus
 }
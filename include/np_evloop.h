@@ -44,6 +44,37 @@ NP_EVENT_EVLOOP_PROTOTYPE(out)
 NP_EVENT_EVLOOP_PROTOTYPE(http)
 NP_EVENT_EVLOOP_PROTOTYPE(file)
 
+/**
+.. c:function:: uint8_t _np_event_in_loop_count(np_state_t *context)
+
+   Returns the number of inbound event loops. The first inbound loop is the
+   one returned by ``_np_event_get_loop_in``, further loops only exist if
+   enough threads have been configured (see ``_np_event_in_loops_for_pool``)
+   and are each driven by their own thread.
+
+.. c:function:: uint8_t _np_event_in_loop_select(np_state_t *context, np_dhkey_t flow)
+
+   Returns the inbound loop for a flow (e.g. the dhkey of a remote host:port),
+   so that the packets of one peer are always read on the same loop.
+*/
+NP_API_INTERN
+uint8_t _np_event_in_loops_for_pool(uint8_t pool_size);
+NP_API_INTERN
+uint8_t _np_event_in_loop_count(np_state_t *context);
+NP_API_INTERN
+uint8_t _np_event_in_loop_select(np_state_t *context, np_dhkey_t flow);
+NP_API_INTERN
+struct ev_loop *_np_event_get_loop_in_shard(np_state_t *context,
+                                            uint8_t     shard);
+NP_API_INTERN
+void _np_event_suspend_loop_in_shard(np_state_t *context, uint8_t shard);
+NP_API_INTERN
+void _np_event_resume_loop_in_shard(np_state_t *context, uint8_t shard);
+NP_API_INTERN
+void _np_event_reconfigure_loop_in_shard(np_state_t *context, uint8_t shard);
+NP_API_INTERN
+void _np_event_in_shard_run(np_state_t *context, np_thread_t *thread);
+
 NP_API_INTERN
 bool _np_event_init(np_state_t *context);
 
@@ -58,6 +58,23 @@ struct np_key_entity_s {
   void            *ptr;
 };
 
+struct np_key_mailbox_entry_s {
+  np_util_event_t                event;
+  struct np_key_mailbox_entry_s *next;
+};
+
+// every event of a key passes the mailbox and is executed in arrival order,
+// either by the job thread that owns the mailbox or by a synchronous caller
+// that waits for its own event
+struct np_key_mailbox_s {
+  struct np_key_mailbox_entry_s *head;
+  struct np_key_mailbox_entry_s *tail;
+  uint32_t                       size;
+  bool                           busy;
+  uint64_t                       pushed;
+  uint64_t                       popped;
+};
+
 struct np_key_ro_s {
   np_dhkey_t       dhkey;
   enum np_key_type type;
@@ -88,6 +105,7 @@ struct np_key_s {
   void_ptr entity_array[8];
 
   np_mutex_t key_lock;
+  TSP(struct np_key_mailbox_s, mailbox);
 } NP_API_INTERN;
 
 _NP_GENERATE_MEMORY_PROTOTYPES(np_key_t);
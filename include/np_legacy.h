@@ -47,7 +47,7 @@ extern "C" {
 #define NP_CTX_MODULES                                                         \
   route, memory, threads, events, statistics, keycache, http, sysinfo, log,    \
       jobqueue, shutdown, bootstrap, time, msgproperties, pheromones,          \
-      attributes, search, files, network
+      attributes, search, files, network, aaatoken, warmstart
 
 /**
 \toggle_keepwhitespaces
@@ -119,6 +119,9 @@ void _np_message_setbody(struct np_e2e_message_s *msg, np_tree_t *body);
 
 NP_API_INTERN
 bool _np_message_readbody(struct np_e2e_message_s *msg);
+// zero-copy variant, nested structures are decoded on first access
+NP_API_INTERN
+bool _np_message_readbody_lazy(struct np_e2e_message_s *msg);
 
 NP_API_INTERN
 double _np_message_get_expiry(const struct np_e2e_message_s *const self);
@@ -135,6 +138,17 @@ void _np_message_add_response_handler(
     const np_util_event_t          event,
     bool                           use_destination_from_header_to_field);
 
+// stores the uuids of acknowledged messages in the body of an ack message
+NP_API_INTERN
+void _np_message_set_response_uuids(np_tree_t           *body,
+                                    const unsigned char *uuids,
+                                    uint16_t             count);
+// returns the acknowledged uuids of an ack message body, or NULL if the body
+// has no or a malformed uuid list
+NP_API_INTERN
+unsigned char *_np_message_get_response_uuids(np_tree_t *body,
+                                              uint32_t  *count);
+
 // msg header constants
 static const char *_NP_MSG_HEADER_TARGET  = "_np.target";
 static const char *_NP_MSG_HEADER_SUBJECT = "_np.subj";
@@ -149,6 +163,7 @@ static const char *_NP_MSG_INST_ACK_TO        = "_np.ack_to";
 static const char *_NP_MSG_INST_SEQ           = "_np.seq";
 static const char *_NP_MSG_INST_UUID          = "_np.uuid";
 static const char *_NP_MSG_INST_RESPONSE_UUID = "_np.response_uuid";
+static const char *_NP_MSG_INST_RESPONSE_UUIDS = "_np.response_uuids";
 static const char *_NP_MSG_INST_TTL           = "_np.ttl";
 static const char *_NP_MSG_INST_TSTAMP        = "_np.tstamp";
 
@@ -14,6 +14,7 @@
 #include "netdb.h"
 #include "sys/socket.h"
 
+#include "util/np_congestion.h"
 #include "util/np_list.h"
 
 #include "np_constants.h"
@@ -61,6 +62,14 @@ typedef enum np_network_type_e {
   np_network_type_client = 0x02,
 } np_network_type_e;
 
+// additional listener of a udp server network on another inbound loop, it
+// reads a duplicate of the descriptor of the server socket
+struct np_network_shard_s {
+  int     socket;
+  ev_io   watcher_in;
+  uint8_t in_loop;
+};
+
 struct np_network_s {
   bool              initialized;
   bool              is_multiuse_socket;
@@ -70,6 +79,11 @@ struct np_network_s {
   uint8_t           is_running;
   np_network_type_e type;
 
+  // inbound event loop watcher_in is started on (see np_evloop.h)
+  uint8_t                    in_loop;
+  uint8_t                    shard_count;
+  struct np_network_shard_s *shards;
+
   socket_type socket_type;
 
   struct sockaddr *remote_addr;
@@ -81,6 +95,21 @@ struct np_network_s {
   double   last_received_date;
   np_sll_t(void_ptr, out_events);
 
+  // tcp streams: packages may arrive or leave in parts, the missing bytes of
+  // the current package are read or written on the next event. A tcp network
+  // is read by a single watcher only (no shard listeners)
+  void    *stream_buffer;
+  uint16_t stream_fill;
+  uint16_t send_offset;
+  // the network which owns the socket if a tcp connection is used by a
+  // reading and a sending network
+  np_network_t *shared_connection;
+  // paces the out_events, fed with the round trip times and losses of the
+  // peer (see __np_node_handle_response). While the bucket is empty the
+  // write watcher is stopped and pacing_timer starts it again.
+  np_congestion_t congestion;
+  ev_timer        pacing_timer;
+
   char ip[CHAR_LENGTH_IP];
   char port[CHAR_LENGTH_PORT];
 
@@ -171,10 +200,24 @@ uint8_t _np_network_count_common_tuples(NP_UNUSED const np_network_t *ng,
                                         const char                   *remote_ip,
                                         const char                   *local_ip);
 
-// NP_API_INTERN
-// bool _np_network_send_data(np_state_t   *context,
-//                            np_network_t *network,
-//                            void         *data_to_send);
+// sends a single package. On a tcp stream a package may leave in parts, the
+// written bytes are kept in send_offset and the next call continues the
+// package. Returns true once the package has been sent completely
+NP_API_INTERN
+bool _np_network_send_data(np_state_t   *context,
+                           np_network_t *network,
+                           np_dhkey_t    target,
+                           void         *data_to_send);
+// reads the missing bytes of the current package of a tcp stream into the
+// stream buffer. A stream has no message boundaries, a package which has only
+// been received in parts stays in the stream buffer until the next call.
+// Returns the complete package (owned by the caller) or NULL. closed is set if
+// the peer has shut down the stream or the stream failed
+NP_API_INTERN
+void *_np_network_stream_read_package(np_state_t   *context,
+                                      np_network_t *ng,
+                                      int           fd,
+                                      bool         *closed);
 /**
  ** _np_network_append_msg_to_out_queue:
  ** Sends a message to host
@@ -186,6 +229,23 @@ NP_API_INTERN
 void _np_network_read(struct ev_loop *loop, ev_io *event, int revents);
 NP_API_INTERN
 void _np_network_accept(struct ev_loop *loop, ev_io *event, int revents);
+/** _np_network_register_stream:
+ ** registers a connected tcp socket as the inbound network of the alias key of
+ ** its peer address. the first packages of the stream are handed to
+ ** owner_dhkey until the alias key has received a handshake. if connection is
+ ** not NULL the socket is owned by the connection and shared with it.
+ **/
+NP_API_INTERN
+bool _np_network_register_stream(np_state_t   *context,
+                                 np_network_t *connection,
+                                 int           fd,
+                                 socket_type   type,
+                                 np_dhkey_t    owner_dhkey);
+// the socket of connection is used by self as well, connection is kept alive
+// until self is deleted
+NP_API_INTERN
+void _np_network_share_connection(np_network_t *self,
+                                  np_network_t *connection);
 NP_API_INTERN
 void _np_network_disable(np_network_t *self);
 NP_API_INTERN
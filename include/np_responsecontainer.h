@@ -26,10 +26,46 @@ struct np_responsecontainer_s {
       send_at; // this is the time the packet is transmitted (or retransmitted)
   double expires_at; // the time when the responsecontainer will expire and will
                      // be deleted
+
+  uint32_t _heap_index; // position in the expiry heap of a responsetable
 } NP_API_INTERN;
 
 _NP_GENERATE_MEMORY_PROTOTYPES(np_responsecontainer_t);
 
+/**
+ * The outstanding responsecontainers of a node, indexed by uuid (open
+ * addressing hash map) and by expires_at (binary min heap). Received
+ * acknowledgements are looked up and removed directly, timeouts are taken from
+ * the top of the heap once they are due, so no entry has to be visited twice.
+ *
+ * The table does not hold a reference of its containers, the expires_at value
+ * of a container must not change while it is stored. The structure is not
+ * thread safe, callers have to serialize the access.
+ */
+typedef struct np_responsetable_s np_responsetable_t;
+
+NP_API_INTERN
+np_responsetable_t *_np_responsetable_create();
+NP_API_INTERN
+void _np_responsetable_free(np_responsetable_t *table);
+
+// returns false if a container with the same uuid is already stored
+NP_API_INTERN
+bool _np_responsetable_insert(np_responsetable_t     *table,
+                              np_responsecontainer_t *entry);
+NP_API_INTERN
+np_responsecontainer_t *_np_responsetable_find(np_responsetable_t  *table,
+                                               const unsigned char *uuid);
+NP_API_INTERN
+np_responsecontainer_t *_np_responsetable_remove(np_responsetable_t  *table,
+                                                 const unsigned char *uuid);
+// removes and returns the container which expires first, if it has expired
+NP_API_INTERN
+np_responsecontainer_t *_np_responsetable_pop_expired(np_responsetable_t *table,
+                                                      double              now);
+NP_API_INTERN
+uint32_t _np_responsetable_size(np_responsetable_t *table);
+
 // NP_API_INTERN
 // void _np_responsecontainer_set(np_key_t* key, np_responsecontainer_t* entry);
 
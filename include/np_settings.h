@@ -104,6 +104,15 @@ extern "C" {
 #define NP_BOOTSTRAP_REACHABLE_CHECK_INTERVAL (NP_PI * 10)
 #endif
 
+// interval of the warm start snapshot, only used if a warmstart_file is set
+#ifndef NP_WARMSTART_WRITE_INTERVAL
+#define NP_WARMSTART_WRITE_INTERVAL (NP_PI * 20)
+#endif
+// upper limit of node and intent tokens per section of the snapshot
+#ifndef NP_WARMSTART_MAX_TOKENS
+#define NP_WARMSTART_MAX_TOKENS (512)
+#endif
+
 #ifndef NP_KEYCACHE_DEPRECATION_INTERVAL
 #define NP_KEYCACHE_DEPRECATION_INTERVAL (31.415)
 #endif
@@ -159,9 +168,43 @@ extern "C" {
 #define TOKEN_GRACETIME (10)
 #endif
 
+/*
+ * batched token verification, tokens received in bursts (handshakes, intent
+ * tokens) are verified in batches on the worker threads
+ */
+#ifndef NP_TOKEN_VERIFY_BATCH_SIZE
+#define NP_TOKEN_VERIFY_BATCH_SIZE (32)
+#endif
+#ifndef NP_TOKEN_VERIFY_QUEUE_SIZE
+#define NP_TOKEN_VERIFY_QUEUE_SIZE (1024)
+#endif
+#ifndef NP_TOKEN_VERIFY_INTERVAL_SEC
+#define NP_TOKEN_VERIFY_INTERVAL_SEC (NP_PI / 100)
+#endif
+
+/*
+ * handshakes are verified in a separate stage with its own bounded queue. at
+ * most NP_HANDSHAKE_MAX_BATCHES batch jobs of this stage wait in the jobqueue,
+ * so that a burst of handshakes cannot take over all worker threads. the same
+ * handshake of a peer is only accepted once per duplicate window.
+ */
+#ifndef NP_HANDSHAKE_QUEUE_SIZE
+#define NP_HANDSHAKE_QUEUE_SIZE (512)
+#endif
+#ifndef NP_HANDSHAKE_MAX_BATCHES
+#define NP_HANDSHAKE_MAX_BATCHES (2)
+#endif
+#ifndef NP_HANDSHAKE_DUPLICATE_WINDOW_SEC
+#define NP_HANDSHAKE_DUPLICATE_WINDOW_SEC (NP_PI)
+#endif
+
 #ifndef NP_TOKEN_MIN_RESEND_INTERVAL_SEC
 #define NP_TOKEN_MIN_RESEND_INTERVAL_SEC (10)
 #endif
+// the resend interval of an unchanged intent token doubles up to this limit
+#ifndef NP_TOKEN_MAX_RESEND_INTERVAL_SEC
+#define NP_TOKEN_MAX_RESEND_INTERVAL_SEC (NP_TOKEN_MIN_RESEND_INTERVAL_SEC * 8)
+#endif
 #ifndef NODE_RENEW_BEFORE_EOL_SEC
 #define NODE_RENEW_BEFORE_EOL_SEC (5)
 #endif
@@ -352,6 +395,121 @@ extern "C" {
 #define NP_MSG_FORWARD_FILTER_PRUNE_RATE 3
 #endif
 
+/*
+ * arena backed np_tree_t: size of the first chunk of an arena and the upper
+ * limit for the chunk growth
+ */
+#ifndef NP_TREE_ARENA_CHUNK_SIZE
+#define NP_TREE_ARENA_CHUNK_SIZE (4096)
+#endif
+#ifndef NP_TREE_ARENA_MAX_CHUNK_SIZE
+#define NP_TREE_ARENA_MAX_CHUNK_SIZE (65536)
+#endif
+
+/*
+ * duplicate message detection: count of rotating time buckets and the default
+ * maximum of uuids a msgproperty remembers
+ */
+#ifndef NP_DEDUP_BUCKETS
+#define NP_DEDUP_BUCKETS (8)
+#endif
+#ifndef NP_MSGPROPERTY_UNIQUE_UUIDS_MAX
+#define NP_MSGPROPERTY_UNIQUE_UUIDS_MAX (16384)
+#endif
+
+/*
+ * end-to-end acknowledgements for the same peer are collected for up to
+ * NP_ACK_BATCH_WINDOW seconds and sent as one message with up to
+ * NP_ACK_BATCH_MAX_UUIDS uuids. A window of 0 sends each acknowledgement on
+ * its own. Batches use the body key _np.response_uuids, which older nodes
+ * reject: only enable batching once all nodes of the network understand it.
+ */
+#ifndef NP_ACK_BATCH_WINDOW
+#define NP_ACK_BATCH_WINDOW (0.0)
+#endif
+#ifndef NP_ACK_BATCH_MAX_UUIDS
+#define NP_ACK_BATCH_MAX_UUIDS (32)
+#endif
+
+/*
+ * default memory budget of the message cache of a msgproperty, the cache is
+ * limited by cache_size and this byte budget, whichever is reached first
+ */
+#ifndef NP_MSGPROPERTY_CACHE_MAX_BYTES
+#define NP_MSGPROPERTY_CACHE_MAX_BYTES (4 * 1024 * 1024)
+#endif
+
+/*
+ * upper limit of inbound event loops, additional loops are created if more
+ * threads than needed for the workers and the in/out/file loops are configured
+ */
+#ifndef NP_EVENT_IN_LOOPS_MAX
+#define NP_EVENT_IN_LOOPS_MAX (8)
+#endif
+
+/*
+ * default kernel interface of the event loops (see enum np_event_backend),
+ * e.g. -DNP_EVENT_BACKEND=np_event_backend_iouring
+ */
+#ifndef NP_EVENT_BACKEND
+#define NP_EVENT_BACKEND np_event_backend_auto
+#endif
+
+/*
+ * number of udp packets received with / sent by a single system call
+ * (recvmmsg / sendmmsg on Linux), a value of 1 disables the batching
+ */
+#ifndef NP_NETWORK_IO_BATCH_SIZE
+#define NP_NETWORK_IO_BATCH_SIZE (16)
+#endif
+
+/*
+ * per peer congestion control of outbound packages (see util/np_congestion.h),
+ * windows are counted in packages per round trip
+ */
+#ifndef NP_CONGESTION_INITIAL_WINDOW
+#define NP_CONGESTION_INITIAL_WINDOW (32)
+#endif
+#ifndef NP_CONGESTION_MIN_WINDOW
+#define NP_CONGESTION_MIN_WINDOW (8)
+#endif
+#ifndef NP_CONGESTION_MAX_WINDOW
+#define NP_CONGESTION_MAX_WINDOW (4096)
+#endif
+#ifndef NP_CONGESTION_INITIAL_RTT_SEC
+#define NP_CONGESTION_INITIAL_RTT_SEC (NP_PI / 30)
+#endif
+#ifndef NP_CONGESTION_MIN_RTT_SEC
+#define NP_CONGESTION_MIN_RTT_SEC (0.001)
+#endif
+// multiplicative decrease of the window after a loss
+#ifndef NP_CONGESTION_DECREASE
+#define NP_CONGESTION_DECREASE (0.7)
+#endif
+// the pacing rate is slightly above cwnd / srtt to probe for more bandwidth
+#ifndef NP_CONGESTION_PACING_GAIN
+#define NP_CONGESTION_PACING_GAIN (1.25)
+#endif
+#ifndef NP_CONGESTION_LOSS_GAIN
+#define NP_CONGESTION_LOSS_GAIN (0.125)
+#endif
+// average loss rate below which a peer is no longer paced
+#ifndef NP_CONGESTION_PACING_LOSS
+#define NP_CONGESTION_PACING_LOSS (0.01)
+#endif
+
+/*
+ * maximum number of queued events a thread drains from a key mailbox before it
+ * hands the key back to the jobqueue, and the number of event chain slots that
+ * have to stay free for the events triggered by each drained event
+ */
+#ifndef NP_KEY_MAILBOX_DRAIN_MAX
+#define NP_KEY_MAILBOX_DRAIN_MAX (32)
+#endif
+#ifndef NP_KEY_MAILBOX_CHAIN_RESERVE
+#define NP_KEY_MAILBOX_CHAIN_RESERVE (32)
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -40,6 +40,9 @@ enum np_prometheus_exposed_metrics {
   np_prometheus_exposed_metrics_network_out_per_sec,
   np_prometheus_exposed_metrics_pheromones_inhale,
   np_prometheus_exposed_metrics_pheromones_exhale,
+  np_prometheus_exposed_metrics_handshake_queue_depth,
+  np_prometheus_exposed_metrics_handshake_latency,
+  np_prometheus_exposed_metrics_handshake_dropped,
   np_prometheus_exposed_metrics_END
 };
 
@@ -156,6 +159,12 @@ void __np_statistics_set_success_avg(np_state_t *context,
                                      np_dhkey_t  id,
                                      float       value);
 NP_API_INTERN
+void __np_statistics_set_congestion(np_state_t *context,
+                                    np_dhkey_t  id,
+                                    float       cwnd,
+                                    float       rtt,
+                                    float       loss);
+NP_API_INTERN
 void __np_statistics_increment_pheromones_inhale(np_state_t *context);
 NP_API_INTERN
 void __np_statistics_increment_pheromones_exhale(np_state_t *context);
@@ -164,6 +173,8 @@ void __np_statistics_increment_pheromones_exhale(np_state_t *context);
   __np_statistics_set_latency(context, id, value)
 #define _np_set_success_avg(id, value)                                         \
   __np_statistics_set_success_avg(context, id, value)
+#define _np_set_congestion(id, cwnd, rtt, loss)                                \
+  __np_statistics_set_congestion(context, id, cwnd, rtt, loss)
 #define _np_increment_forwarding_counter(subject)                              \
   __np_increment_forwarding_counter(context, subject)
 #define _np_increment_received_msgs_counter(subject)                           \
@@ -181,6 +192,7 @@ void __np_statistics_increment_pheromones_exhale(np_state_t *context);
 #else
 #define _np_set_latency(id, value)
 #define _np_set_success_avg(id, value)
+#define _np_set_congestion(id, cwnd, rtt, loss)
 #define _np_increment_forwarding_counter(subject)
 #define _np_increment_received_msgs_counter(subject)
 #define _np_increment_send_msgs_counter(subject)
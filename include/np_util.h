@@ -1790,7 +1790,9 @@ extern "C" {
       #e33, #e34, #e35, #e36, #e37, #e38, #e39, #e40, #e41, #e42, #e43, #e44,  \
       #e45, #e46, #e47, #e48, #e49, __GENERATE_ENUM_STR_END(NAME)
 
-// create a sha256 uuid string, take the current date into account
+// create a uuid by hashing a random per thread prefix and a per thread counter
+// with a per process secret, str and num are kept for compatibility and do
+// not influence the result
 NP_API_EXPORT
 char *
 np_uuid_create(const char *str, const uint32_t num, unsigned char **buffer);
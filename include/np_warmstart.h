@@ -0,0 +1,73 @@
+//
+// SPDX-FileCopyrightText: 2016-2024 by pi-lar GmbH
+// SPDX-License-Identifier: OSL-3.0
+//
+#ifndef _NP_WARMSTART_H_
+#define _NP_WARMSTART_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sodium.h"
+
+#include "util/np_tree.h"
+
+#include "np_legacy.h"
+#include "np_settings.h"
+#include "np_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// on disk snapshot of the neighbourhood of a node. The header is followed by
+// a serialized np_tree_t with one subtree of encoded tokens per section. Node
+// entries are the handshake tokens of our peers, they carry the address and
+// are signed by the peer. Every token is verified again when it is restored.
+#define NP_WARMSTART_MAGIC   "npwarmst"
+#define NP_WARMSTART_VERSION 1
+
+static const char *_NP_WARMSTART_LEAFSET   = "_np.warmstart.leafset";
+static const char *_NP_WARMSTART_ROUTES    = "_np.warmstart.routes";
+static const char *_NP_WARMSTART_SENDERS   = "_np.warmstart.senders";
+static const char *_NP_WARMSTART_RECEIVERS = "_np.warmstart.receivers";
+
+struct np_warmstart_header_s {
+  char     magic[8];
+  uint32_t version;
+  uint32_t body_size;
+  // blake2b hash of the serialized body
+  unsigned char checksum[crypto_generichash_BYTES];
+} NP_PACKED(1);
+
+// the module is only created if np_settings.warmstart_file is set
+NP_API_INTERN
+bool _np_warmstart_init(np_state_t *context);
+NP_API_INTERN
+void _np_warmstart_destroy(np_state_t *context);
+
+// rejoin the nodes and re-import the intent tokens of the snapshot and start
+// the periodic snapshot job, returns the number of restored tokens
+NP_API_INTERN
+uint32_t _np_warmstart_restore(np_state_t *context);
+// write the current neighbourhood of the node, an existing snapshot is kept
+// if the node does not know any peer
+NP_API_INTERN
+enum np_return _np_warmstart_write(np_state_t *context);
+
+// write body to a temporary file and move it in place
+NP_API_INTERN
+enum np_return _np_warmstart_write_file(np_state_t *context,
+                                        const char *filename,
+                                        np_tree_t  *body);
+// read and verify a snapshot file into body
+NP_API_INTERN
+enum np_return _np_warmstart_read_file(np_state_t *context,
+                                       const char *filename,
+                                       np_tree_t  *body);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _NP_WARMSTART_H_
@@ -0,0 +1,94 @@
+//
+// SPDX-FileCopyrightText: 2016-2024 by pi-lar GmbH
+// SPDX-License-Identifier: OSL-3.0
+//
+#ifndef NP_CONGESTION_H_
+#define NP_CONGESTION_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "neuropil.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Congestion control and pacing of the outbound packages of a single peer.
+ *
+ * The congestion window (in packages per round trip) follows an AIMD scheme:
+ * it doubles with every acknowledgement during slow start and grows by one
+ * package per acknowledgement afterwards. A loss reduces the window by
+ * NP_CONGESTION_DECREASE, at most once per smoothed round trip, so that the
+ * timeouts of one burst count as a single congestion event.
+ *
+ * A peer is only paced after a loss has been observed, and until its average
+ * loss rate drops below NP_CONGESTION_PACING_LOSS again. Most messages are
+ * not acknowledged, so while a peer is paced every window of sent packages
+ * opens the window by one package as well.
+ *
+ * Packages are paced with a token bucket. It is refilled with the pacing rate
+ * (NP_CONGESTION_PACING_GAIN * cwnd / srtt) and holds at most one window of
+ * packages.
+ *
+ * The structure is not thread safe, callers have to serialize the access.
+ */
+typedef struct np_congestion_s {
+  double cwnd;
+  double ssthresh;
+  double srtt;
+  double rttvar;
+  double min_rtt;
+  // average loss rate of the last acknowledgements and timeouts
+  double loss;
+  double last_decrease;
+  bool   paced;
+
+  double tokens;
+  double last_refill;
+} np_congestion_t;
+
+NP_API_INTERN
+void _np_congestion_init(np_congestion_t *cc, double now);
+
+/**
+.. c:function:: void _np_congestion_on_ack(np_congestion_t *cc, double rtt)
+
+   Feeds the round trip time of an acknowledged package (i.e. a ping or an
+   ack message) into the controller and opens the congestion window.
+
+   :param rtt: the measured round trip time in seconds
+*/
+NP_API_INTERN
+void _np_congestion_on_ack(np_congestion_t *cc, double rtt);
+NP_API_INTERN
+void _np_congestion_on_loss(np_congestion_t *cc, double now);
+
+/**
+.. c:function:: uint32_t _np_congestion_tokens(np_congestion_t *cc, double now)
+
+   Refills the token bucket and returns the count of packages which may be
+   sent now, UINT32_MAX if the peer is not paced. Sent packages have to be
+   reported with :c:func:`_np_congestion_on_send`.
+
+   :param now: the current time
+   :return: the count of packages which may be sent without delay
+*/
+NP_API_INTERN
+uint32_t _np_congestion_tokens(np_congestion_t *cc, double now);
+NP_API_INTERN
+void _np_congestion_on_send(np_congestion_t *cc, uint32_t count);
+// seconds until the next package may be sent, 0.0 if one may be sent now
+NP_API_INTERN
+double _np_congestion_delay(const np_congestion_t *cc);
+
+// current pacing rate in packages per second
+NP_API_INTERN
+double _np_congestion_rate(const np_congestion_t *cc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NP_CONGESTION_H_ */
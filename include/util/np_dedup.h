@@ -0,0 +1,88 @@
+//
+// SPDX-FileCopyrightText: 2016-2024 by pi-lar GmbH
+// SPDX-License-Identifier: OSL-3.0
+//
+#ifndef NP_DEDUP_H_
+#define NP_DEDUP_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "neuropil.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Duplicate detection for message uuids based on a ring of time buckets.
+ *
+ * Each bucket is a compact open addressing hash set of uuids which have been
+ * seen during one time window (ttl / (NP_DEDUP_BUCKETS - 1) seconds). New
+ * uuids are always added to the current bucket, a lookup probes all live
+ * buckets. Buckets are never cleaned up entry by entry: once the latest expiry
+ * of all uuids in a bucket has passed, the complete bucket is dropped at once.
+ *
+ * The memory ceiling is given as the maximum count of remembered uuids. If the
+ * ring wraps around before the oldest bucket has expired (i.e. more messages
+ * arrived than could be remembered), the oldest bucket is dropped early and the
+ * eviction is counted.
+ *
+ * The structure is not thread safe, callers have to serialize the access.
+ */
+
+typedef struct np_dedup_s np_dedup_t;
+
+/**
+.. c:function:: np_dedup_t *_np_dedup_create(double ttl, uint32_t max_entries)
+
+   Creates a new uuid deduplication filter.
+
+   :param ttl: the time window in seconds a uuid usually has to be remembered
+   :param max_entries: the maximum count of uuids remembered at the same time
+   :return: a new filter, or NULL if no memory could be allocated
+*/
+NP_API_INTERN
+np_dedup_t *_np_dedup_create(double ttl, uint32_t max_entries);
+NP_API_INTERN
+void _np_dedup_free(np_dedup_t *dedup);
+
+/**
+.. c:function:: bool _np_dedup_check_and_add(np_dedup_t *dedup, const unsigned char *uuid, double expiry, double now)
+
+   Checks whether the uuid has been seen before, and remembers it if not.
+
+   :param uuid: the uuid (NP_UUID_BYTES) to check
+   :param expiry: the point in time after which the uuid can be forgotten
+   :param now: the current time
+   :return: true if the uuid is unique, false if it is a duplicate
+*/
+NP_API_INTERN
+bool _np_dedup_check_and_add(np_dedup_t          *dedup,
+                             const unsigned char *uuid,
+                             double               expiry,
+                             double               now);
+NP_API_INTERN
+bool _np_dedup_contains(np_dedup_t *dedup, const unsigned char *uuid);
+NP_API_INTERN
+bool _np_dedup_remove(np_dedup_t *dedup, const unsigned char *uuid);
+
+/**
+.. c:function:: uint32_t _np_dedup_expire(np_dedup_t *dedup, double now)
+
+   Drops all buckets which only contain expired uuids.
+
+   :return: the count of uuids which have been forgotten
+*/
+NP_API_INTERN
+uint32_t _np_dedup_expire(np_dedup_t *dedup, double now);
+NP_API_INTERN
+uint32_t _np_dedup_size(np_dedup_t *dedup);
+NP_API_INTERN
+uint32_t _np_dedup_evicted(np_dedup_t *dedup);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NP_DEDUP_H_ */
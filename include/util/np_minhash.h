@@ -53,6 +53,12 @@ extern "C" {
  *
  */
 
+// number of shingles that are hashed before the signature is updated in one
+// pass (multi value scheme only)
+#ifndef NP_MINHASH_BATCH_SIZE
+#define NP_MINHASH_BATCH_SIZE 64
+#endif
+
 enum np_mixhash_mode {
   MIXHASH_MULTI              = 0,
   MIXHASH_SINGLE             = 1,
@@ -93,6 +99,14 @@ void np_minhash_push(np_minhash_t        *minhash,
                      const unsigned char *bytes,
                      uint16_t             bytes_length);
 
+// pushes count string values at once, for the multi value scheme the
+// signature is updated in a single pass. The result is the same as pushing the
+// values one by one
+void np_minhash_push_batch(np_minhash_t               *minhash,
+                           const unsigned char *const *bytes,
+                           const uint16_t             *bytes_length,
+                           uint16_t                    count);
+
 // push a complete tree structure into the minhash
 void np_minhash_push_tree(np_minhash_t    *minhash,
                           const np_tree_t *tree,
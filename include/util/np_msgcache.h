@@ -0,0 +1,104 @@
+//
+// SPDX-FileCopyrightText: 2016-2024 by pi-lar GmbH
+// SPDX-License-Identifier: OSL-3.0
+//
+#ifndef NP_MSGCACHE_H_
+#define NP_MSGCACHE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "neuropil.h"
+
+#include "np_dhkey.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Indexed cache for messages which cannot be delivered yet.
+ *
+ * Items are kept in a slot array which is linked in insertion order, so that
+ * the oldest and the newest item can be evicted in O(1). Each item is
+ * additionally linked into the list of its audience (the session the message
+ * belongs to) and into a min heap ordered by expiry. Draining the messages of
+ * one audience or dropping expired messages therefore only touches the
+ * affected items, and never rescans the complete cache.
+ *
+ * The cache only stores references, the caller is responsible for the
+ * reference counting of the items and for applying size limits. The structure
+ * is not thread safe.
+ */
+
+typedef struct np_msgcache_s np_msgcache_t;
+
+/**
+.. c:type:: bool (*np_msgcache_item_cb)(void *item, void *userdata)
+
+   Called for each item removed by :c:func:`_np_msgcache_drain`. The callback
+   must not modify the cache. Return false to stop draining.
+*/
+typedef bool (*np_msgcache_item_cb)(void *item, void *userdata);
+typedef bool (*np_msgcache_audience_cb)(np_dhkey_t audience, void *userdata);
+
+NP_API_INTERN
+np_msgcache_t *_np_msgcache_create(uint32_t initial_size);
+NP_API_INTERN
+void _np_msgcache_free(np_msgcache_t *cache);
+
+NP_API_INTERN
+bool _np_msgcache_add(np_msgcache_t *cache,
+                      void          *item,
+                      np_dhkey_t     audience,
+                      double         expiry,
+                      size_t         bytes);
+/**
+.. c:function:: void *_np_msgcache_pop(np_msgcache_t *cache, bool newest)
+
+   Removes the oldest (FIFO) or the newest (LIFO) item from the cache.
+
+   :return: the removed item, or NULL if the cache is empty
+*/
+NP_API_INTERN
+void *_np_msgcache_pop(np_msgcache_t *cache, bool newest);
+/**
+.. c:function:: void *_np_msgcache_pop_expired(np_msgcache_t *cache, double now)
+
+   Removes the item with the earliest expiry, if it expired before now.
+
+   :return: the removed item, or NULL if no item has been expired
+*/
+NP_API_INTERN
+void *_np_msgcache_pop_expired(np_msgcache_t *cache, double now);
+/**
+.. c:function:: uint32_t _np_msgcache_drain(np_msgcache_t *cache, const np_dhkey_t *audience, bool newest, np_msgcache_audience_cb select, np_msgcache_item_cb consume, void *userdata)
+
+   Removes the items of one audience, or of all audiences accepted by the
+   select callback if audience is NULL, and hands them over to consume.
+
+   :param newest: if true the items of an audience are drained newest first
+   :return: the count of removed items
+*/
+NP_API_INTERN
+uint32_t _np_msgcache_drain(np_msgcache_t          *cache,
+                            const np_dhkey_t       *audience,
+                            bool                    newest,
+                            np_msgcache_audience_cb select,
+                            np_msgcache_item_cb     consume,
+                            void                   *userdata);
+
+NP_API_INTERN
+uint32_t _np_msgcache_size(np_msgcache_t *cache);
+NP_API_INTERN
+size_t _np_msgcache_bytes(np_msgcache_t *cache);
+NP_API_INTERN
+uint32_t _np_msgcache_audience_size(np_msgcache_t   *cache,
+                                    const np_dhkey_t audience);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NP_MSGCACHE_H_ */
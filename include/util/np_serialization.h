@@ -64,6 +64,21 @@ void np_serializer_read_map(np_state_t              *context,
                             np_deserialize_buffer_t *buffer,
                             np_tree_t               *tree);
 
+/**
+ * @brief lazy deserialization: only the top-level map is indexed, nested maps
+ * are kept as encoded values (np_treeval_type_encoded) and decoded with
+ * np_serializer_read_encoded when they are looked up for the first time. Use
+ * it together with np_tree_create_view to get zero-copy binary values.
+ */
+NP_API_INTERN
+void np_serializer_read_map_lazy(np_state_t              *context,
+                                 np_deserialize_buffer_t *buffer,
+                                 np_tree_t               *tree);
+NP_API_INTERN
+bool np_serializer_read_encoded(np_tree_t    *tree,
+                                np_treeval_t  encoded,
+                                np_treeval_t *value);
+
 /**
  * @brief (de-) serialization of a datablock (attributes) into a document
  *
@@ -100,7 +115,7 @@ enum np_data_return np_serializer_calculate_object_size(np_kv_buffer_t kv_pair,
 
 NP_API_INTERN
 enum np_data_return np_serializer_search_object(np_datablock_header_t *block,
-                                                char                  *key,
+                                                const char            *key,
                                                 np_kv_buffer_t        *kv_pair,
                                                 uint32_t data_magic_no);
 
@@ -27,15 +27,39 @@ typedef bool (*np_util_statemachine_cond)(np_util_statemachine_t *sm,
 typedef void (*np_util_statemachine_func)(np_util_statemachine_t *sm,
                                           const np_util_event_t   ev);
 
+typedef uint8_t (*np_util_statemachine_data_type)(const np_util_event_t ev);
+
 struct np_util_statemachine_transition_s {
   bool                      _active;
   uint8_t                   _source_state, _target_state;
   np_util_statemachine_func f_action;
   np_util_statemachine_cond f_condition;
+
+  // event type bits that have to be set and the type of the event user_data
+  // (0 matches any type), checked before the condition is called
+  uint16_t _event_mask;
+  uint8_t  _data_type;
+
+  // condition calls and executed transitions (not synchronized, profiling)
+  uint64_t _evaluated;
+  uint64_t _hits;
 };
 typedef struct np_utile_statemachine_transition_s
     np_utile_statemachine_transition_t;
 
+// maximum number of transitions of a state that can be precompiled
+#define NP_UTIL_STATEMACHINE_DISPATCH_MAX (32)
+
+// candidate transitions of a state as bitsets, indexed by the lower and upper
+// byte of the event type and by the type of the event user_data
+struct np_util_statemachine_dispatch_s {
+  np_util_statemachine_data_type f_data_type;
+  uint8_t                        _data_types;
+  uint32_t                       _by_event_low[256];
+  uint32_t                       _by_event_high[256];
+  uint32_t                      *_by_data_type;
+};
+
 struct np_util_statemachine_state_s {
   uint8_t                   _state_id;
   char                      _state_name[25];
@@ -45,6 +69,7 @@ struct np_util_statemachine_state_s {
 
   uint8_t                                   _transitions;
   struct np_util_statemachine_transition_s *_transition_table;
+  struct np_util_statemachine_dispatch_s   *_dispatch;
 };
 typedef struct np_util_statemachine_state_s np_util_statemachine_state_t;
 
@@ -75,6 +100,17 @@ void np_util_statemachine_add_transition(
     uint8_t                                  state,
     struct np_util_statemachine_transition_s trans);
 
+/**
+ * Builds the dispatch tables of all states once all transitions have been
+ * added. f_data_type maps the user_data of an event to a type below
+ * data_types. States with more than NP_UTIL_STATEMACHINE_DISPATCH_MAX
+ * transitions keep evaluating every transition.
+ */
+void np_util_statemachine_compile(np_util_statemachine_state_t **states,
+                                  uint8_t                        state_count,
+                                  np_util_statemachine_data_type f_data_type,
+                                  uint8_t                        data_types);
+
 bool np_util_statemachine_invoke_auto_transition(
     np_util_statemachine_t *machine, const np_util_event_t event);
 
@@ -104,6 +140,25 @@ np_util_statemachine_transition(np_util_statemachine_t *machine,
           .f_action      = ACTION,                                             \
           .f_condition   = CONDITION})
 
+#define NP_UTIL_STATEMACHINE_TRANSITION_ON(MACHINE,                            \
+                                           SOURCE_STATE,                       \
+                                           TARGET_STATE,                       \
+                                           ACTION,                             \
+                                           CONDITION,                          \
+                                           EVENT_MASK,                         \
+                                           DATA_TYPE)                          \
+  np_util_statemachine_add_transition(                                         \
+      MACHINE,                                                                 \
+      SOURCE_STATE,                                                            \
+      (struct np_util_statemachine_transition_s){                              \
+          ._active       = true,                                               \
+          ._source_state = SOURCE_STATE,                                       \
+          ._target_state = TARGET_STATE,                                       \
+          .f_action      = ACTION,                                             \
+          .f_condition   = CONDITION,                                          \
+          ._event_mask   = EVENT_MASK,                                         \
+          ._data_type    = DATA_TYPE})
+
 #define NP_UTIL_STATEMACHINE_STATE(MACHINE,                                    \
                                    STATE,                                      \
                                    NAME,                                       \
@@ -82,12 +82,16 @@ several np_tree_t elements that form the different message parts.
 
 */
 
+struct np_tree_arena_s;
+
 struct np_tree_s {
   struct np_tree_elem_s *rbh_root;
 
   size_t         size;
   size_t         byte_size;
   np_tree_conf_t attr;
+
+  struct np_tree_arena_s *arena;
 } NP_API_EXPORT;
 
 typedef struct np_tree_elem_s np_tree_elem_t;
@@ -114,6 +118,28 @@ RB_PROTOTYPE(np_tree_s, np_tree_elem_s, link, _val_cmp);
 NP_API_EXPORT
 np_tree_t *np_tree_create();
 
+/**
+.. c:function:: np_tree_t* np_tree_create_arena(size_t size_hint)
+.. c:function:: np_tree_t* np_tree_create_view(size_t size_hint)
+
+   create a new instance of a np_tree_t structure, which takes all elements,
+copied values and subtrees from one bump allocator. Deleting elements does not
+give memory back, the whole tree (including all subtrees) is released at once
+with :c:func:`np_tree_free` on the returned root.
+
+   A view additionally keeps binary values in place, i.e. after deserialization
+they point directly into the received buffer. The buffer has to outlive the
+tree. Strings are still copied into the arena to add the terminating zero.
+
+   :param size_hint: expected amount of bytes, used for the first arena chunk
+   :return: the newly constructed np_tree_t
+
+*/
+NP_API_EXPORT
+np_tree_t *np_tree_create_arena(size_t size_hint);
+NP_API_EXPORT
+np_tree_t *np_tree_create_view(size_t size_hint);
+
 /**
 .. c:function:: void np_free_tree(np_tree_t* root)
 
@@ -342,6 +368,14 @@ void np_tree_copy_inplace(np_tree_t *source, np_tree_t *target);
 NP_API_INTERN
 void np_tree_del_element(np_tree_t *tree, np_tree_elem_t *to_delete);
 
+// allocation helper, memory is taken from the arena of the tree (if present)
+NP_API_INTERN
+void *_np_tree_malloc(np_tree_t *tree, size_t size);
+NP_API_INTERN
+char *_np_tree_strndup(np_tree_t *tree, const char *s, size_t len);
+NP_API_INTERN
+np_tree_t *_np_tree_create_subtree(np_tree_t *parent);
+
 NP_API_INTERN
 void np_tree_insert_element(np_tree_t *tree, np_tree_elem_t *ele);
 
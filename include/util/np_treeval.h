@@ -81,7 +81,8 @@ enum np_treeval_type_t {
   np_treeval_type_special_char_ptr,
   np_treeval_type_cwt,
   np_treeval_type_cose_signed,
-  np_treeval_type_cose_encrypted
+  np_treeval_type_cose_encrypted,
+  np_treeval_type_encoded // (not yet) decoded subtree, see np_tree_find_*
 };
 
 /* The Jval -- a type that can hold any type */
@@ -497,10 +497,10 @@ void __np_create_session(np_util_statemachine_t         *statemachine,
   struct np_data_conf cfg;
   np_data_value       remote_hs_prio = {0};
 
-  if (np_get_data(handshake_token->attributes,
-                  NP_HS_PRIO,
-                  &cfg,
-                  &remote_hs_prio) != np_ok) {
+  if (_np_aaatoken_get_data(handshake_token,
+                            NP_HS_PRIO,
+                            &cfg,
+                            &remote_hs_prio) != np_ok) {
     log_error(handshake_token->uuid,
               "structural error in token. Missing %s key",
               NP_HS_PRIO);
@@ -10,7 +10,9 @@
 
 #include "core/np_comp_intent.h"
 
+#include <float.h>
 #include <inttypes.h>
+#include <math.h>
 
 #include "neuropil.h"
 #include "neuropil_data.h"
@@ -27,13 +29,6 @@
 #include "np_memory.h"
 #include "np_message.h"
 
-struct __np_token_ledger {
-  np_pll_t(np_aaatoken_ptr, recv_tokens); // link to runtime interest data on
-                                          // which this node is interested in
-  np_pll_t(np_aaatoken_ptr, send_tokens); // link to runtime interest data on
-                                          // which this node is interested in
-};
-
 static int8_t _np_intent_cmp(np_aaatoken_ptr first, np_aaatoken_ptr second) {
   int8_t ret_check = 0;
 
@@ -112,7 +107,7 @@ np_aaatoken_t *_np_intent_add_sender(np_key_t      *subject_key,
   enum np_data_return get_data_ret;
 
   if ((get_data_ret =
-           np_get_data(token->attributes, "mep_type", &conf, &mep_type)) !=
+           _np_aaatoken_get_data(token, "mep_type", &conf, &mep_type)) !=
       np_ok) {
     mep_type.unsigned_integer = DEFAULT_TYPE;
     log_warn(LOG_AAATOKEN,
@@ -121,7 +116,7 @@ np_aaatoken_t *_np_intent_add_sender(np_key_t      *subject_key,
              get_data_ret);
   }
   if ((get_data_ret =
-           np_get_data(token->attributes, "ack_mode", &conf, &ack_mode)) !=
+           _np_aaatoken_get_data(token, "ack_mode", &conf, &ack_mode)) !=
       np_ok) {
     ack_mode.unsigned_integer = ACK_NONE;
     log_warn(LOG_AAATOKEN,
@@ -129,10 +124,10 @@ np_aaatoken_t *_np_intent_add_sender(np_key_t      *subject_key,
              "token is missing attribute \"ack_mode\" code: %" PRIu32,
              get_data_ret);
   }
-  if ((get_data_ret = np_get_data(token->attributes,
-                                  "max_threshold",
-                                  &conf,
-                                  &max_threshold)) != np_ok) {
+  if ((get_data_ret = _np_aaatoken_get_data(token,
+                                            "max_threshold",
+                                            &conf,
+                                            &max_threshold)) != np_ok) {
     max_threshold.unsigned_integer = 0;
     log_warn(LOG_AAATOKEN,
              token->uuid,
@@ -301,10 +296,10 @@ np_aaatoken_t *_np_intent_add_receiver(np_key_t      *subject_key,
   np_data_value       max_threshold = {0}, mep_type = {0};
   enum np_data_return get_data_ret;
 
-  if ((get_data_ret = np_get_data(token->attributes,
-                                  "max_threshold",
-                                  &conf,
-                                  &max_threshold) != np_ok)) {
+  if ((get_data_ret = _np_aaatoken_get_data(token,
+                                            "max_threshold",
+                                            &conf,
+                                            &max_threshold) != np_ok)) {
     max_threshold.unsigned_integer = 0;
     log_warn(LOG_AAATOKEN,
              token->uuid,
@@ -312,7 +307,7 @@ np_aaatoken_t *_np_intent_add_receiver(np_key_t      *subject_key,
              get_data_ret);
   }
   if ((get_data_ret =
-           np_get_data(token->attributes, "mep_type", &conf, &mep_type) !=
+           _np_aaatoken_get_data(token, "mep_type", &conf, &mep_type) !=
            np_ok)) {
     mep_type.unsigned_integer = DEFAULT_TYPE;
     log_warn(LOG_AAATOKEN,
@@ -360,6 +355,7 @@ np_aaatoken_t *_np_intent_add_receiver(np_key_t      *subject_key,
     } else {
       token->state = ret->state;
     }
+    ledger->fanout_dirty = true;
 
     if (IS_AUTHORIZED(token->state)) {
       _np_intent_update_receiver_session(subject_key, token, crud_mode);
@@ -464,14 +460,35 @@ np_aaatoken_t *_np_intent_get_receiver(np_key_t        *subject_key,
   return (return_token);
 }
 
-void _np_intent_get_all_receiver(np_key_t  *subject_key,
-                                 np_dhkey_t audience,
-                                 np_sll_t(np_aaatoken_ptr, *tmp_token_list)) {
-  np_ctx_memory(subject_key);
+// releases the tokens of the fan-out array, the caller holds the key_lock
+static void __np_intent_fanout_release(np_state_t               *context,
+                                       struct __np_token_ledger *ledger) {
+  for (uint32_t i = 0; i < ledger->fanout_count; i++) {
+    np_unref_obj(np_aaatoken_t, ledger->fanout[i].token, "_np_intent_fanout");
+  }
+  ledger->fanout_count = 0;
+}
 
-  np_sll_t(np_aaatoken_ptr, result_list = *tmp_token_list);
-  NP_CAST_RAW(subject_key->entity_array[2], struct __np_token_ledger, ledger);
-  NP_CAST_RAW(subject_key->entity_array[1], np_msgproperty_run_t, run_prop);
+// collect the valid receiver tokens of the ledger together with their parsed
+// issuer and audience, so that a lookup does not need to verify tokens or to
+// parse hex strings. The caller holds the key_lock, the array keeps its own
+// reference of each token as recv_tokens may drop it at any time.
+static void __np_intent_fanout_update(np_state_t               *context,
+                                      struct __np_token_ledger *ledger) {
+  double now = np_time_now();
+
+  if (!ledger->fanout_dirty && now <= ledger->fanout_expiry) return;
+
+  __np_intent_fanout_release(context, ledger);
+
+  uint32_t count = pll_size(ledger->recv_tokens);
+  if (count > ledger->fanout_size) {
+    ledger->fanout =
+        realloc(ledger->fanout, count * sizeof(struct np_intent_fanout_s));
+    ledger->fanout_size = count;
+  }
+
+  ledger->fanout_expiry = DBL_MAX;
 
   pll_iterator(np_aaatoken_ptr) tmp = pll_first(ledger->recv_tokens);
   while (NULL != tmp) {
@@ -481,41 +498,119 @@ void _np_intent_get_all_receiver(np_key_t  *subject_key,
       log_debug(LOG_AAATOKEN,
                 tmp->val->uuid,
                 "ignoring receiver msg token as it is (now) invalid");
-    } else if (IS_NOT_AUTHORIZED(tmp->val->state)) {
+    } else {
+      struct np_intent_fanout_s *receiver =
+          &ledger->fanout[ledger->fanout_count++];
+
+      np_ref_obj(np_aaatoken_t, tmp->val, "_np_intent_fanout");
+      receiver->token      = tmp->val;
+      receiver->issuer     = np_dhkey_create_from_hash(tmp->val->issuer);
+      receiver->audience   = np_dhkey_create_from_hash(tmp->val->audience);
+      receiver->expires_at = tmp->val->expires_at;
+
+      ledger->fanout_expiry = fmin(ledger->fanout_expiry, tmp->val->expires_at);
+    }
+    pll_next(tmp);
+  }
+  ledger->fanout_dirty = false;
+}
+
+void _np_intent_ledger_free(np_key_t *subject_key) {
+  np_ctx_memory(subject_key);
+
+  if (subject_key->entity_array[2] == NULL) return;
+  NP_CAST_RAW(subject_key->entity_array[2], struct __np_token_ledger, ledger);
+
+  __np_intent_fanout_release(context, ledger);
+  free(ledger->fanout);
+
+  pll_iterator(np_aaatoken_ptr) iter = pll_first(ledger->recv_tokens);
+  while (NULL != iter) {
+    np_unref_obj(np_aaatoken_t, iter->val, ref_aaatoken_local_mx_tokens);
+    pll_next(iter);
+  }
+  iter = pll_first(ledger->send_tokens);
+  while (NULL != iter) {
+    np_unref_obj(np_aaatoken_t, iter->val, ref_aaatoken_local_mx_tokens);
+    pll_next(iter);
+  }
+  pll_free(np_aaatoken_ptr, ledger->recv_tokens);
+  pll_free(np_aaatoken_ptr, ledger->send_tokens);
+
+  free(ledger);
+  subject_key->entity_array[2] = NULL;
+}
+
+void _np_intent_get_all_receiver(np_key_t  *subject_key,
+                                 np_dhkey_t audience,
+                                 np_sll_t(np_aaatoken_ptr, *tmp_token_list)) {
+  np_ctx_memory(subject_key);
+
+  np_sll_t(np_aaatoken_ptr, result_list = *tmp_token_list);
+  NP_CAST_RAW(subject_key->entity_array[2], struct __np_token_ledger, ledger);
+  NP_CAST_RAW(subject_key->entity_array[1], np_msgproperty_run_t, run_prop);
+
+  __np_intent_fanout_update(context, ledger);
+
+  bool to_all = _np_dhkey_equal(&audience, &run_prop->current_fp);
+
+  for (uint32_t i = 0; i < ledger->fanout_count; i++) {
+    struct np_intent_fanout_s *receiver = &ledger->fanout[i];
+
+    // authorization may be granted after the token has been added
+    if (IS_NOT_AUTHORIZED(receiver->token->state)) {
       log_debug(LOG_AAATOKEN,
-                tmp->val->uuid,
+                receiver->token->uuid,
                 "ignoring receiver msg token as it is not authorized");
+    } else if (to_all || _np_dhkey_equal(&audience, &receiver->issuer) ||
+               _np_dhkey_equal(&audience, &receiver->audience)) {
+      log_debug(LOG_ROUTING,
+                receiver->token->uuid,
+                "found valid receiver token (issuer: %s))",
+                receiver->token->issuer);
+      np_ref_obj(np_aaatoken_t, receiver->token, FUNC);
+      // only pick key from a list if the subject msg_treshold is bigger than
+      // zero and the sending threshold is bigger than zero as well and we
+      // actually have a receiver node in the list
+      sll_append(np_aaatoken_ptr, result_list, receiver->token);
     } else {
-      np_dhkey_t issuer         = np_dhkey_create_from_hash(tmp->val->issuer);
-      np_dhkey_t token_audience = np_dhkey_create_from_hash(tmp->val->audience);
-      bool       include_token  = false;
-
-      include_token = _np_dhkey_equal(&audience, &issuer) ||
-                      _np_dhkey_equal(&audience, &token_audience) ||
-                      _np_dhkey_equal(&audience, &run_prop->current_fp);
-
-      if (include_token == true) {
-        log_debug(LOG_ROUTING,
-                  tmp->val->uuid,
-                  "found valid receiver token (issuer: %s))",
-                  tmp->val->issuer);
-        np_ref_obj(np_aaatoken_t, tmp->val, FUNC);
-        // only pick key from a list if the subject msg_treshold is bigger than
-        // zero and the sending threshold is bigger than zero as well and we
-        // actually have a receiver node in the list
-        sll_append(np_aaatoken_ptr, result_list, tmp->val);
-      } else {
-        char buf[65] = {0};
-        log_debug(LOG_AAATOKEN,
-                  tmp->val->uuid,
-                  "ignoring receiver token for issuer %s as it is not in "
-                  "audience \"%s\"",
-                  tmp->val->issuer,
-                  np_id_str(buf, *(np_id *)&audience));
-      }
+      char buf[65] = {0};
+      log_debug(LOG_AAATOKEN,
+                receiver->token->uuid,
+                "ignoring receiver token for issuer %s as it is not in "
+                "audience \"%s\"",
+                receiver->token->issuer,
+                np_id_str(buf, *(np_id *)&audience));
     }
+  }
+}
 
-    pll_next(tmp);
+void _np_intent_get_all_tokens(np_key_t *subject_key,
+                               np_sll_t(np_aaatoken_ptr, *sender_list),
+                               np_sll_t(np_aaatoken_ptr, *receiver_list)) {
+  np_ctx_memory(subject_key);
+
+  if (subject_key->entity_array[2] == NULL) return;
+  NP_CAST_RAW(subject_key->entity_array[2], struct __np_token_ledger, ledger);
+
+  double now = np_time_now();
+
+  pll_iterator(np_aaatoken_ptr) iter = pll_first(ledger->send_tokens);
+  while (NULL != iter) {
+    if (iter->val->expires_at > now) {
+      np_ref_obj(np_aaatoken_t, iter->val, FUNC);
+      sll_append(np_aaatoken_ptr, *sender_list, iter->val);
+    }
+    pll_next(iter);
+  }
+
+  iter = pll_first(ledger->recv_tokens);
+  while (NULL != iter) {
+    if (iter->val->expires_at > now) {
+      np_ref_obj(np_aaatoken_t, iter->val, FUNC);
+      sll_append(np_aaatoken_ptr, *receiver_list, iter->val);
+    }
+    pll_next(iter);
   }
 }
 
@@ -605,6 +700,7 @@ void __np_intent_check(np_util_statemachine_t *statemachine,
                  ledger->recv_tokens,
                  tmp_token,
                  _np_intent_cmp_exact);
+      ledger->fanout_dirty = true;
       np_unref_obj(np_aaatoken_t, tmp_token, ref_aaatoken_local_mx_tokens);
       break;
     }
@@ -10,6 +10,7 @@
 
 #include "core/np_comp_msgproperty.h"
 
+#include <float.h>
 #include <inttypes.h>
 #include <math.h>
 #include <stddef.h>
@@ -20,7 +21,9 @@
 
 #include "core/np_comp_intent.h"
 #include "util/np_bloom.h"
+#include "util/np_dedup.h"
 #include "util/np_event.h"
+#include "util/np_msgcache.h"
 #include "util/np_statemachine.h"
 #include "util/np_tree.h"
 #include "util/np_treeval.h"
@@ -121,13 +124,15 @@ void _np_msgproperty_conf_t_new(np_state_t       *context,
 
   // cache which will hold up to max_threshold messages
   prop->cache_policy  = FIFO | OVERFLOW_PURGE;
-  prop->cache_size    = 16;
-  prop->max_threshold = 2;
+  prop->cache_size      = 16;
+  prop->cache_max_bytes = NP_MSGPROPERTY_CACHE_MAX_BYTES;
+  prop->max_threshold   = 2;
 
   prop->is_internal   = false;
   prop->audience_type = NP_MX_AUD_PUBLIC;
 
   prop->unique_uuids_check = false;
+  prop->unique_uuids_max   = NP_MSGPROPERTY_UNIQUE_UUIDS_MAX;
 
   memset(&prop->audience_id, 0, NP_FINGERPRINT_BYTES);
   memset(&prop->subject_dhkey, 0, NP_FINGERPRINT_BYTES);
@@ -148,22 +153,29 @@ void _np_msgproperty_run_t_new(np_state_t       *context,
 
   prop->msg_threshold = 0;
 
-  prop->response_handler = np_tree_create(); // only used for msghandler NP_ACK
+  prop->response_handler =
+      _np_responsetable_create(); // only used for msghandler NP_ACK
   prop->redelivery_messages =
       np_tree_create(); // only used for msghandler "is_internal=false"
 
-  dll_init(np_message_ptr, prop->msg_cache);
+  prop->msg_cache = _np_msgcache_create(0);
 
-  prop->unique_uuids = np_tree_create();
+  prop->unique_uuids = NULL; // created on first use
+
+  TSP_INITD(prop->ack_batches, NULL); // created on first use
 
   np_init_datablock(prop->attributes, sizeof(prop->attributes));
 
-  double now                  = np_time_now();
-  prop->last_update           = now;
-  prop->last_intent_update    = 0;
-  prop->last_pheromone_update = 0;
+  double now                   = np_time_now();
+  prop->last_update            = now;
+  prop->last_intent_update     = 0;
+  prop->last_pheromone_update  = 0;
+  prop->intent_resend_interval = 0;
+  prop->intent_replies         = np_tree_create();
 
   prop->authorize_func = NULL;
+
+  prop->required_attributes_policy = NULL;
 }
 
 void _np_msgproperty_conf_t_del(NP_UNUSED np_state_t *context,
@@ -203,18 +215,38 @@ void _np_msgproperty_run_t_del(NP_UNUSED np_state_t *context,
 
   assert(prop != NULL);
 
-  np_tree_free(prop->unique_uuids);
-  np_tree_free(prop->response_handler);    //
-  np_tree_free(prop->redelivery_messages); //
+  _np_dedup_free(prop->unique_uuids);
+  np_responsecontainer_t *response = NULL;
+  while (NULL != (response = _np_responsetable_pop_expired(
+                      prop->response_handler,
+                      DBL_MAX))) {
+    np_unref_obj(np_responsecontainer_t,
+                 response,
+                 "_np_message_add_response_handler");
+  }
+  _np_responsetable_free(prop->response_handler); //
+  np_tree_free(prop->redelivery_messages);        //
+  np_tree_free(prop->intent_replies);
+
+  if (prop->ack_batches != NULL) {
+    np_tree_elem_t *iter = NULL;
+    RB_FOREACH (iter, np_tree_s, prop->ack_batches) {
+      free(iter->val.value.v);
+    }
+    np_tree_free(prop->ack_batches);
+  }
+  TSP_DESTROY(prop->ack_batches);
 
   if (prop->msg_cache != NULL) {
-    dll_free(np_message_ptr, prop->msg_cache);
+    _np_msgcache_free(prop->msg_cache);
   }
 
   if (prop->user_callbacks != NULL) {
     sll_free(np_usercallback_ptr, prop->user_callbacks);
   }
   sll_free(np_evt_callback_t, prop->callbacks);
+
+  _np_attribute_policy_free(prop->required_attributes_policy);
 }
 
 /**
@@ -466,78 +498,44 @@ bool _np_msgproperty_check_msg_uniquety(np_msgproperty_conf_t   *self_conf,
                                         struct np_e2e_message_s *msg_to_check) {
   bool ret = true;
   if (self_conf->unique_uuids_check) {
+    np_ctx_memory(self_conf);
 
-    if (np_tree_find_uuid(self_run->unique_uuids, msg_to_check->uuid) == NULL) {
-      np_tree_insert_uuid(
-          self_run->unique_uuids,
-          msg_to_check->uuid,
-          np_treeval_new_d(_np_message_get_expiry(msg_to_check)));
-    } else {
-      ret = false;
+    if (self_run->unique_uuids == NULL) {
+      self_run->unique_uuids =
+          _np_dedup_create(self_conf->msg_ttl, self_conf->unique_uuids_max);
+      if (self_run->unique_uuids == NULL) return ret;
     }
+    ret = _np_dedup_check_and_add(self_run->unique_uuids,
+                                  msg_to_check->uuid,
+                                  _np_message_get_expiry(msg_to_check),
+                                  np_time_now());
   }
   return ret;
 }
 
 void _np_msgproperty_remove_msg_from_uniquety_list(
     np_msgproperty_run_t *self, struct np_e2e_message_s *msg_to_remove) {
-  np_tree_del_uuid(self->unique_uuids, msg_to_remove->uuid);
+  if (self->unique_uuids != NULL)
+    _np_dedup_remove(self->unique_uuids, msg_to_remove->uuid);
 }
 
 void _np_msgproperty_job_msg_uniquety(np_msgproperty_conf_t *self_conf,
                                       np_msgproperty_run_t  *self_run) {
   np_ctx_memory(self_conf);
-  // TODO: iter over msgproeprties and remove expired msg uuid from unique_uuids
-  double now;
-  if (self_conf->unique_uuids_check) {
-    sll_init_full(void_ptr, to_remove);
 
-    np_tree_elem_t *iter_tree = NULL;
-    now                       = np_time_now();
-    RB_FOREACH (iter_tree, np_tree_s, self_run->unique_uuids) {
-      if (iter_tree->val.value.d < now) {
-        sll_append(void_ptr, to_remove, iter_tree->key.value.uuid);
-      }
-    }
-
-    sll_iterator(void_ptr) iter_to_rm = sll_first(to_remove);
-    if (iter_to_rm != NULL) {
+  if (self_conf->unique_uuids_check && self_run->unique_uuids != NULL) {
+    // expired uuids are dropped bucket wise, no need to visit single entries
+    uint32_t removed = _np_dedup_expire(self_run->unique_uuids, np_time_now());
+    if (removed > 0) {
       log_debug(LOG_MSGPROPERTY,
                 NULL,
-                "UNIQUITY removing %" PRIu32 " from %" PRIsizet
-                " items from unique_uuids for %s",
-                sll_size(to_remove),
-                self_run->unique_uuids->size,
-                self_conf->msg_subject);
-      while (iter_to_rm != NULL) {
-        np_tree_del_uuid(self_run->unique_uuids, iter_to_rm->val);
-        sll_next(iter_to_rm);
-      }
+                "UNIQUITY removing %" PRIu32 " items from unique_uuids for %s, "
+                "%" PRIu32 " remaining, %" PRIu32 " evicted before expiry",
+                removed,
+                self_conf->msg_subject,
+                _np_dedup_size(self_run->unique_uuids),
+                _np_dedup_evicted(self_run->unique_uuids));
     }
-    // sll_clear(char_ptr, to_remove);
-
-    // iter_tree = NULL;
-    // RB_FOREACH(iter_tree, np_tree_s, self->unique_uuids_out)
-    // {
-    //     if (iter_tree->val.value.d < now) {
-    //         sll_append(void_ptr, to_remove, iter_tree->key.value.bin);
-    //     }
-    // }
-
-    // iter_to_rm = sll_first(to_remove);
-    // if(iter_to_rm != NULL) {
-    //     log_debug_msg(LOG_DEBUG | LOG_MSGPROPERTY , NULL,"UNIQUITY removing
-    //     %"PRIu32" from %"PRIu16" items from unique_uuids for %s",
-    //                                                 sll_size(to_remove),
-    //                                                 self->unique_uuids_out->size,
-    //                                                 self->msg_subject);
-    //     while (iter_to_rm != NULL)
-    //     {
-    //         np_tree_del_uuid(self->unique_uuids_out, iter_to_rm->val);
-    //         sll_next(iter_to_rm);
-    //     }
-    // }
-    sll_free(void_ptr, to_remove);
   }
 }
 
@@ -548,112 +546,170 @@ void __np_msgproperty_event_cleanup_response_handler(void           *context,
                "_np_msgproperty_cleanup_response_handler");
 }
 
-void _np_msgproperty_cleanup_response_handler(np_msgproperty_run_t *self,
-                                              const np_util_event_t event) {
+static void
+__np_msgproperty_response_notify(np_msgproperty_run_t   *self,
+                                 np_responsecontainer_t *current,
+                                 const np_util_event_t   event,
+                                 enum event_type         type) {
   np_ctx_memory(self);
 
-  // remove expired msg uuid from response uuids
-  double now = np_time_now();
-  sll_init_full(void_ptr, to_remove);
-
-  np_tree_elem_t         *iter_tree = NULL;
-  np_responsecontainer_t *current   = NULL;
-  now                               = np_time_now();
-  uint8_t max_events                = NP_PI_INT * 10;
-
-  RB_FOREACH (iter_tree, np_tree_s, self->response_handler) {
-    bool handle_event = false;
-
-    current = (np_responsecontainer_t *)iter_tree->val.value.v;
-    // TODO: find correct dhkey from responsecontainer and use it as
-    // target_dhkey
-    np_util_event_t response_event = {.user_data = current};
-
-    if (current->expires_at < now) { // notify about timeout
-      response_event.type = (evt_timeout | evt_response);
-      handle_event        = true;
-    } else if (current->received_at != 0) { // notify about ack response
-      response_event.type = (evt_internal | evt_response);
-      handle_event        = true;
+  // TODO: find correct dhkey from responsecontainer and use it as
+  // target_dhkey
+  np_util_event_t response_event = {.user_data = current, .type = type};
+
+  if (!_np_dhkey_equal(&current->msg_dhkey,
+                       &dhkey_zero)) { // clean up message redlivery
+
+    np_ref_obj(np_responsecontainer_t, response_event.user_data, FUNC);
+    // response_event.cleanup =
+    //     __np_msgproperty_event_cleanup_response_handler;
+
+    response_event.target_dhkey = current->msg_dhkey;
+    _np_event_runtime_add_event(context,
+                                event.current_run,
+                                current->msg_dhkey,
+                                response_event);
+    /* POSSIBLE ASYNC POINT
+    char buf[100];
+    snprintf(buf, 100, "urn:np:responsecontainer:message:%s",
+    current->uuid); if(!np_jobqueue_submit_event(context, 0,
+    current->dest_dhkey, response_event, buf)){ log_error("Jobqueue rejected
+    new job for responsecontainer message id %s", current->uuid
+        );
     }
+    */
+    np_unref_obj(np_responsecontainer_t, response_event.user_data, FUNC);
+  }
 
-    if (handle_event) {
-
-      if (!_np_dhkey_equal(&current->msg_dhkey,
-                           &dhkey_zero)) { // clean up message redlivery
-
-        np_ref_obj(np_responsecontainer_t, response_event.user_data, FUNC);
-        // response_event.cleanup =
-        //     __np_msgproperty_event_cleanup_response_handler;
-
-        response_event.target_dhkey = current->msg_dhkey;
-        _np_event_runtime_add_event(context,
-                                    event.current_run,
-                                    current->msg_dhkey,
-                                    response_event);
-        /* POSSIBLE ASYNC POINT
-        char buf[100];
-        snprintf(buf, 100, "urn:np:responsecontainer:message:%s",
-        current->uuid); if(!np_jobqueue_submit_event(context, 0,
-        current->dest_dhkey, response_event, buf)){ log_error("Jobqueue rejected
-        new job for responsecontainer message id %s", current->uuid
-            );
-        }
-        */
-        np_unref_obj(np_responsecontainer_t, response_event.user_data, FUNC);
-      }
+  if (!_np_dhkey_equal(&current->dest_dhkey, &dhkey_zero) &&
+      _np_keycache_exists(context,
+                          current->dest_dhkey,
+                          NULL)) { // clean up ping ack
 
-      if (!_np_dhkey_equal(&current->dest_dhkey, &dhkey_zero) &&
-          _np_keycache_exists(context,
-                              current->dest_dhkey,
-                              NULL)) { // clean up ping ack
-
-        np_ref_obj(np_responsecontainer_t, response_event.user_data, FUNC);
-        // response_event.cleanup =
-        //     __np_msgproperty_event_cleanup_response_handler;
-
-        response_event.target_dhkey = current->dest_dhkey;
-        _np_event_runtime_add_event(context,
-                                    event.current_run,
-                                    current->dest_dhkey,
-                                    response_event);
-        /* POSSIBLE ASYNC POINT
-        char buf[100];
-        snprintf(buf, 100, "urn:np:responsecontainer:ping_ack:%s",
-        current->uuid); if(!np_jobqueue_submit_event(context, 0,
-        current->dest_dhkey, response_event, buf)){ log_error("Jobqueue rejected
-        new job for responsecontainer ping_ack id %s", current->uuid
-            );
-        }
-        */
-        np_unref_obj(np_responsecontainer_t, response_event.user_data, FUNC);
-      }
+    np_ref_obj(np_responsecontainer_t, response_event.user_data, FUNC);
+    // response_event.cleanup =
+    //     __np_msgproperty_event_cleanup_response_handler;
 
-      np_unref_obj(np_responsecontainer_t,
-                   current,
-                   "_np_message_add_response_handler");
-      sll_append(void_ptr, to_remove, &iter_tree->key.value.uuid);
+    response_event.target_dhkey = current->dest_dhkey;
+    _np_event_runtime_add_event(context,
+                                event.current_run,
+                                current->dest_dhkey,
+                                response_event);
+    /* POSSIBLE ASYNC POINT
+    char buf[100];
+    snprintf(buf, 100, "urn:np:responsecontainer:ping_ack:%s",
+    current->uuid); if(!np_jobqueue_submit_event(context, 0,
+    current->dest_dhkey, response_event, buf)){ log_error("Jobqueue rejected
+    new job for responsecontainer ping_ack id %s", current->uuid
+        );
     }
+    */
+    np_unref_obj(np_responsecontainer_t, response_event.user_data, FUNC);
+  }
+
+  np_unref_obj(np_responsecontainer_t,
+               current,
+               "_np_message_add_response_handler");
+}
+
+bool _np_msgproperty_complete_response(np_msgproperty_run_t *self,
+                                       const unsigned char  *uuid,
+                                       const np_util_event_t event) {
+  np_ctx_memory(self);
+
+  np_responsecontainer_t *current =
+      _np_responsetable_remove(self->response_handler, uuid);
+  if (current == NULL) return false;
 
-    /// prevent overload of eventqueue
-    if (max_events == 0) break;
-    max_events--;
+  // notify about ack response
+  current->received_at = np_time_now();
+  __np_msgproperty_response_notify(self,
+                                   current,
+                                   event,
+                                   (evt_internal | evt_response));
+  return true;
+}
+
+void _np_msgproperty_cleanup_response_handler(np_msgproperty_run_t *self,
+                                              const np_util_event_t event) {
+  np_ctx_memory(self);
+
+  // acknowledged responses are completed on arrival, only the containers at
+  // the top of the expiry heap have to be checked for a timeout
+  double                  now        = np_time_now();
+  uint32_t                removed    = 0;
+  uint8_t                 max_events = NP_PI_INT * 10;
+  np_responsecontainer_t *current    = NULL;
+
+  /// prevent overload of eventqueue
+  while (removed < max_events) {
+    current = _np_responsetable_pop_expired(self->response_handler, now);
+    if (current == NULL) break;
+
+    // notify about timeout
+    __np_msgproperty_response_notify(self,
+                                     current,
+                                     event,
+                                     (evt_timeout | evt_response));
+    removed++;
   }
 
-  sll_iterator(void_ptr) iter_to_rm = sll_first(to_remove);
-  if (iter_to_rm != NULL) {
+  if (removed > 0) {
     log_debug(LOG_MSGPROPERTY,
               NULL,
-              "RESPONSE removing %" PRIu32 " of %" PRIsizet
-              " items from response_handler",
-              sll_size(to_remove),
-              self->response_handler->size);
-    while (iter_to_rm != NULL) {
-      np_tree_del_uuid(self->response_handler, iter_to_rm->val);
-      sll_next(iter_to_rm);
-    }
+              "RESPONSE removing %" PRIu32 " expired items from "
+              "response_handler, %" PRIu32 " remaining",
+              removed,
+              _np_responsetable_size(self->response_handler));
   }
-  sll_free(void_ptr, to_remove);
+}
+
+struct __np_msgcache_drain_s {
+  np_key_t              *property_key;
+  np_msgproperty_conf_t *property_conf;
+  np_msgproperty_run_t  *property_run;
+  np_util_event_t        event;
+  bool                   is_send;
+  bool                   is_recv;
+};
+
+static bool __np_msgproperty_msgcache_has_session(np_dhkey_t audience,
+                                                  void      *userdata) {
+  struct __np_msgcache_drain_s *drain = userdata;
+  return _np_intent_has_crypto_session(drain->property_key, audience);
+}
+
+static bool __np_msgproperty_msgcache_resend(void *item, void *userdata) {
+  struct __np_msgcache_drain_s *drain   = userdata;
+  struct np_e2e_message_s      *msg_out = item;
+  np_ctx_memory(drain->property_key);
+
+  log_debug(LOG_ROUTING,
+            msg_out->uuid,
+            "message in %s cache found and initialize resend",
+            drain->is_send ? "sender" : "receiver");
+
+  np_util_event_t msg_event = {.user_data = msg_out};
+
+  _np_dhkey_assign(&msg_event.target_dhkey, _np_message_get_sessionid(msg_out));
+
+  if (drain->is_send) {
+    msg_event.type = (evt_internal | evt_userspace | evt_message);
+    _np_event_runtime_add_event(context,
+                                drain->event.current_run,
+                                drain->property_conf->subject_dhkey_out,
+                                msg_event);
+  }
+  if (drain->is_recv) {
+    msg_event.type = (evt_external | evt_message);
+    _np_event_runtime_add_event(context,
+                                drain->event.current_run,
+                                drain->property_conf->subject_dhkey_in,
+                                msg_event);
+  }
+
+  np_unref_obj(np_message_t, msg_out, ref_msgproperty_msgcache);
+  return true;
 }
 
 void _np_msgproperty_check_msgcache(np_util_statemachine_t *statemachine,
@@ -666,86 +722,59 @@ void _np_msgproperty_check_msgcache(np_util_statemachine_t *statemachine,
           property_conf);
   NP_CAST(my_property_key->entity_array[1], np_msgproperty_run_t, property_run);
   // NP_CAST(event.user_data, np_message_t, message);
-  bool is_send = _np_dhkey_equal(&my_property_key->dhkey,
-                                 &property_conf->subject_dhkey_out);
-  bool is_recv = _np_dhkey_equal(&my_property_key->dhkey,
-                                 &property_conf->subject_dhkey_in);
+  struct __np_msgcache_drain_s drain = {
+      .property_key  = my_property_key,
+      .property_conf = property_conf,
+      .property_run  = property_run,
+      .event         = event,
+      .is_send       = _np_dhkey_equal(&my_property_key->dhkey,
+                                 &property_conf->subject_dhkey_out),
+      .is_recv       = _np_dhkey_equal(&my_property_key->dhkey,
+                                 &property_conf->subject_dhkey_in),
+  };
 
   // check if we are (one of the) sending node(s) of this kind of message
   // should not return NULL
   log_debug(LOG_ROUTING,
             NULL,
             "this node is one %s of messages, checking msgcache (%p / %u) ...",
-            is_send ? "sender" : "receiver",
+            drain.is_send ? "sender" : "receiver",
             property_run->msg_cache,
-            dll_size(property_run->msg_cache));
-
-  // get message from cache (maybe only for one way mep ?!)
-  uint32_t msg_visit_counter        = dll_size(property_run->msg_cache);
-  dll_iterator(np_message_ptr) peek = NULL;
-
-  while (0 < msg_visit_counter &&
-         msg_visit_counter <= property_conf->cache_size) {
-    struct np_e2e_message_s *msg_out = NULL;
-    // if messages are available in cache, send them !
-    if (FLAG_CMP(property_conf->cache_policy, FIFO)) {
-      peek = (peek == NULL) ? dll_first(property_run->msg_cache) : peek;
-      if (peek != NULL && peek->val != NULL &&
-          _np_intent_has_crypto_session(
-              my_property_key,
-              *_np_message_get_sessionid(peek->val))) {
-        msg_out = peek->val;
-        dll_next(peek);
-      }
-
-    } else if (FLAG_CMP(property_conf->cache_policy, LIFO)) {
-      peek = (peek == NULL) ? dll_last(property_run->msg_cache) : peek;
-      if (peek != NULL && peek->val != NULL &&
-          _np_intent_has_crypto_session(
-              my_property_key,
-              *_np_message_get_sessionid(peek->val))) {
-        msg_out = peek->val;
-        dll_previous(peek);
-      }
-    }
+            _np_msgcache_size(property_run->msg_cache));
+
+  // the crypto session is checked once per audience, messages of audiences
+  // without a session are not visited at all
+  _np_msgcache_drain(property_run->msg_cache,
+                     NULL,
+                     FLAG_CMP(property_conf->cache_policy, LIFO),
+                     __np_msgproperty_msgcache_has_session,
+                     __np_msgproperty_msgcache_resend,
+                     &drain);
+}
 
-    // check for more messages in cache after head/tail command
-    // msg_available = dll_size(send_prop->msg_cache_out);
-    msg_visit_counter--;
+static bool __np_msgproperty_msgcache_redeliver(void *item, void *userdata) {
+  struct __np_msgcache_drain_s *drain = userdata;
+  struct np_e2e_message_s      *msg   = item;
+  np_ctx_memory(drain->property_key);
 
-    if (NULL != msg_out) {
-      log_debug(LOG_ROUTING,
-                msg_out->uuid,
-                "message in %s cache found and initialize resend",
-                is_send ? "sender" : "receiver");
+  log_debug(LOG_MESSAGE | LOG_ROUTING,
+            msg->uuid,
+            "message in receiver cache found and initialize redelivery for");
 
-      np_util_event_t msg_event = {.user_data = msg_out};
+  np_util_event_t msg_in_event = {.type      = (evt_external | evt_message),
+                                  .user_data = msg};
+  _np_dhkey_assign(&msg_in_event.target_dhkey, _np_message_get_sessionid(msg));
 
-      _np_dhkey_assign(&msg_event.target_dhkey,
-                       _np_message_get_sessionid(msg_out));
+  _np_event_runtime_add_event(context,
+                              drain->event.current_run,
+                              drain->property_conf->subject_dhkey_in,
+                              msg_in_event);
 
-      if (is_send) {
-        msg_event.type = (evt_internal | evt_userspace | evt_message);
-        _np_event_runtime_add_event(context,
-                                    event.current_run,
-                                    property_conf->subject_dhkey_out,
-                                    msg_event);
-      }
-      if (is_recv) {
-        msg_event.type = (evt_external | evt_message);
-        _np_event_runtime_add_event(context,
-                                    event.current_run,
-                                    property_conf->subject_dhkey_in,
-                                    msg_event);
-      }
+  np_unref_obj(np_message_t, msg, ref_msgproperty_msgcache);
 
-      np_unref_obj(np_message_t, msg_out, ref_msgproperty_msgcache);
-      dll_remove(np_message_ptr, property_run->msg_cache, msg_out);
-    }
-    if (peek == NULL) {
-      break;
-    }
-  }
+  // do not continue processing message if max treshold is reached
+  return drain->property_run->msg_threshold <=
+         drain->property_conf->max_threshold;
 }
 
 void _np_msgproperty_check_msgcache_for(np_util_statemachine_t *statemachine,
@@ -765,72 +794,26 @@ void _np_msgproperty_check_msgcache_for(np_util_statemachine_t *statemachine,
             "this node is the receiver of messages, checking msgcache "
             "(%p / %u) %s ...",
             property_run->msg_cache,
-            dll_size(property_run->msg_cache),
+            _np_msgcache_size(property_run->msg_cache),
             np_id_str(buf, &event.target_dhkey));
   // get message from cache (maybe only for one way mep ?!)
 
   if (!_np_intent_has_crypto_session(my_property_key, event.target_dhkey))
     return;
 
-  uint32_t msg_visit_counter = dll_size(property_run->msg_cache);
-
-  dll_iterator(np_message_ptr) peek = NULL;
-  while (0 < msg_visit_counter &&
-         msg_visit_counter <= property_conf->cache_size) {
-    // grab a message
-    struct np_e2e_message_s *msg = NULL;
-    // if messages are available in cache, try to decode them !
-    if (FLAG_CMP(property_conf->cache_policy, FIFO)) {
-      peek = (peek == NULL) ? dll_first(property_run->msg_cache) : peek;
-      if (peek != NULL && peek->val != NULL &&
-          _np_dhkey_equal(_np_message_get_sessionid(peek->val),
-                          &event.target_dhkey)) {
-        msg = peek->val;
-        dll_next(peek);
-      }
-    } else if (FLAG_CMP(property_conf->cache_policy, LIFO)) {
-      peek = (peek == NULL) ? dll_last(property_run->msg_cache) : peek;
-      if (peek != NULL && peek->val != NULL &&
-          _np_dhkey_equal(_np_message_get_sessionid(peek->val),
-                          &event.target_dhkey)) {
-        msg = peek->val;
-        dll_previous(peek);
-      }
-    }
-    msg_visit_counter--;
-
-    // handle selected message
-    if (NULL != msg) {
-      log_debug(
-          LOG_MESSAGE | LOG_ROUTING,
-          msg->uuid,
-          "message in receiver cache found and initialize redelivery for");
-      // recalc number of available messages
-      np_dhkey_t in_handler =
-          property_conf->subject_dhkey_in; // (INBOUND,
-                                           // property_conf->msg_subject);
-
-      np_util_event_t msg_in_event = {.type      = (evt_external | evt_message),
-                                      .user_data = msg};
-      _np_dhkey_assign(&msg_in_event.target_dhkey,
-                       _np_message_get_sessionid(msg));
-
-      _np_event_runtime_add_event(context,
-                                  event.current_run,
-                                  in_handler,
-                                  msg_in_event);
-
-      np_unref_obj(np_message_t, msg, ref_msgproperty_msgcache);
-      dll_remove(np_message_ptr, property_run->msg_cache, msg);
-    }
-
-    if (peek == NULL) {
-      break;
-    }
-
-    // do not continue processing message if max treshold is reached
-    if (property_run->msg_threshold > property_conf->max_threshold) break;
-  }
+  struct __np_msgcache_drain_s drain = {
+      .property_key  = my_property_key,
+      .property_conf = property_conf,
+      .property_run  = property_run,
+      .event         = event,
+  };
+  // only the messages of the new receiver are touched
+  _np_msgcache_drain(property_run->msg_cache,
+                     &event.target_dhkey,
+                     FLAG_CMP(property_conf->cache_policy, LIFO),
+                     NULL,
+                     __np_msgproperty_msgcache_redeliver,
+                     &drain);
 }
 
 void _np_msgproperty_cleanup_cache(np_util_statemachine_t         *statemachine,
@@ -848,25 +831,18 @@ void _np_msgproperty_cleanup_cache(np_util_statemachine_t         *statemachine,
             "checking for outdated messages in msgcache (%s: %p / %u) ...",
             property_conf->msg_subject,
             property_run->msg_cache,
-            dll_size(property_run->msg_cache));
-
-  dll_iterator(np_message_ptr) iter_prop_msg_cache =
-      dll_first(property_run->msg_cache);
-  while (iter_prop_msg_cache != NULL) {
-    dll_iterator(np_message_ptr) old_iter = iter_prop_msg_cache;
-    dll_next(iter_prop_msg_cache); // we need to iterate before we delete the
-                                   // old iter
-
-    struct np_e2e_message_s *old_msg = old_iter->val;
-    ASSERT(old_msg != NULL, "cannot have an empty element");
-    if (_np_message_is_expired(old_msg)) {
-      log_debug(LOG_MESSAGE,
-                old_msg->uuid,
-                "purging expired message (subj: %s) from receiver cache ...",
-                property_conf->msg_subject);
-      dll_delete(np_message_ptr, property_run->msg_cache, old_iter);
-      np_unref_obj(np_message_t, old_msg, ref_msgproperty_msgcache);
-    }
+            _np_msgcache_size(property_run->msg_cache));
+
+  // the expiry index returns expired messages only, earliest first
+  double                   now     = np_time_now();
+  struct np_e2e_message_s *old_msg = NULL;
+  while (NULL !=
+         (old_msg = _np_msgcache_pop_expired(property_run->msg_cache, now))) {
+    log_debug(LOG_MESSAGE,
+              old_msg->uuid,
+              "purging expired message (subj: %s) from receiver cache ...",
+              property_conf->msg_subject);
+    np_unref_obj(np_message_t, old_msg, ref_msgproperty_msgcache);
   }
   log_debug(LOG_MSGPROPERTY,
             NULL,
@@ -884,45 +860,55 @@ void __np_property_add_msg_to_cache(np_util_statemachine_t *statemachine,
           property_conf);
   NP_CAST(my_property_key->entity_array[1], np_msgproperty_run_t, property_run);
   NP_CAST(event.user_data, struct np_e2e_message_s, message);
+
+  np_msgcache_t *msg_cache = property_run->msg_cache;
+  size_t         msg_bytes = MSG_CHUNK_SIZE_1024;
+  if (message->binary_length > 0) msg_bytes = message->binary_length;
+
   // cache already full ?
-  if (property_conf->cache_size <= dll_size(property_run->msg_cache)) {
+  while (_np_msgcache_size(msg_cache) > 0 &&
+         (property_conf->cache_size <= _np_msgcache_size(msg_cache) ||
+          (property_conf->cache_max_bytes > 0 &&
+           property_conf->cache_max_bytes <
+               _np_msgcache_bytes(msg_cache) + msg_bytes))) {
     log_debug(LOG_MSGPROPERTY,
               NULL,
               "msg cache full, checking overflow policy ...");
 
-    if (FLAG_CMP(property_conf->cache_policy, OVERFLOW_PURGE)) {
-      log_debug(LOG_MSGPROPERTY,
-                NULL,
-                "OVERFLOW_PURGE: discarding message in msgcache for %s",
-                property_conf->msg_subject);
-      struct np_e2e_message_s *old_msg = NULL;
-
-      if (FLAG_CMP(property_conf->cache_policy, FIFO)) {
-        old_msg = dll_head(np_message_ptr, property_run->msg_cache);
-      } else if (FLAG_CMP(property_conf->cache_policy, LIFO)) {
-        old_msg = dll_tail(np_message_ptr, property_run->msg_cache);
-      }
-
-      if (old_msg != NULL) {
-        log_warn(
-            LOG_MSGPROPERTY,
-            old_msg->uuid,
-            "(policy: PURGE) discarding old message because cache is full");
-        // TODO: add callback hook to allow user space handling of
-        // discarded message
-        np_unref_obj(np_message_t, old_msg, ref_msgproperty_msgcache);
-      }
-    }
-
     if (FLAG_CMP(property_conf->cache_policy, OVERFLOW_REJECT)) {
       log_warn(LOG_WARNING,
                message->uuid,
                "(policy: REJECT) rejecting new message because cache is full");
       return;
     }
-  }
 
-  dll_append(np_message_ptr, property_run->msg_cache, message);
+    log_debug(LOG_MSGPROPERTY,
+              NULL,
+              "OVERFLOW_PURGE: discarding message in msgcache for %s",
+              property_conf->msg_subject);
+    struct np_e2e_message_s *old_msg = _np_msgcache_pop(
+        msg_cache,
+        FLAG_CMP(property_conf->cache_policy, LIFO));
+    if (old_msg == NULL) break;
+
+    log_warn(LOG_MSGPROPERTY,
+             old_msg->uuid,
+             "(policy: PURGE) discarding old message because cache is full");
+    // TODO: add callback hook to allow user space handling of
+    // discarded message
+    np_unref_obj(np_message_t, old_msg, ref_msgproperty_msgcache);
+  }
+
+  if (!_np_msgcache_add(msg_cache,
+                        message,
+                        *_np_message_get_sessionid(message),
+                        _np_message_get_expiry(message),
+                        msg_bytes)) {
+    log_warn(LOG_MSGPROPERTY,
+             message->uuid,
+             "could not add message to msgcache, dropping message");
+    return;
+  }
   np_ref_obj(np_message_t, message, ref_msgproperty_msgcache);
 
   log_debug(LOG_MSGPROPERTY | LOG_ROUTING,
@@ -992,13 +978,6 @@ void __np_msgproperty_redeliver_messages(np_util_statemachine_t *statemachine,
   }
 }
 
-struct __np_token_ledger {
-  np_pll_t(np_aaatoken_ptr, recv_tokens); // link to runtime interest data on
-                                          // which this node is interested in
-  np_pll_t(np_aaatoken_ptr, send_tokens); // link to runtime interest data on
-                                          // which this node is interested in
-};
-
 static int8_t _np_aaatoken_cmp(np_aaatoken_ptr first, np_aaatoken_ptr second) {
   int8_t ret_check = 0;
 
@@ -1149,7 +1128,7 @@ void _np_msgproperty_create_token_ledger(np_util_statemachine_t *statemachine,
               property->msg_subject,
               _np_key_as_str(my_property_key));
     struct __np_token_ledger *token_ledger =
-        malloc(sizeof(struct __np_token_ledger));
+        calloc(1, sizeof(struct __np_token_ledger));
     pll_init(np_aaatoken_ptr, token_ledger->recv_tokens);
     pll_init(np_aaatoken_ptr, token_ledger->send_tokens);
 
@@ -1159,6 +1138,7 @@ void _np_msgproperty_create_token_ledger(np_util_statemachine_t *statemachine,
 
     pll_clear(np_aaatoken_ptr, token_ledger->recv_tokens);
     pll_clear(np_aaatoken_ptr, token_ledger->send_tokens);
+    token_ledger->fanout_dirty = true;
   }
 }
 
@@ -1347,6 +1327,7 @@ void _np_msgproperty_upsert_token(np_util_statemachine_t         *statemachine,
                  msg_token_new,
                  false,
                  _np_aaatoken_cmp);
+      ledger->fanout_dirty = true;
       // create own crypto session with random values
       _np_intent_update_session(my_property_key,
                                 msg_token_new,
@@ -1370,6 +1351,7 @@ void _np_msgproperty_upsert_token(np_util_statemachine_t         *statemachine,
                                              token_list,
                                              msg_token_new,
                                              _np_aaatoken_cmp);
+      ledger->fanout_dirty = true;
       // update own crypto session with random values
       _np_intent_update_session(my_property_key,
                                 msg_token_new,
@@ -1657,7 +1639,8 @@ void __np_property_update(np_util_statemachine_t *statemachine,
   *old_property = *new_property;
 }
 
-void __np_msgproperty_send_available_messages(
+// returns true if our intent token has been sent
+bool __np_msgproperty_send_available_messages(
     np_util_statemachine_t *statemachine, const np_util_event_t event) {
   np_ctx_memory(statemachine->_user_data);
 
@@ -1670,15 +1653,26 @@ void __np_msgproperty_send_available_messages(
       _np_msgproperty_get_mxtoken(context, property_key);
   if (NULL == intent_token) {
     log_msg(LOG_ERROR, NULL, "missing peer intent token");
-    return;
+    return false;
   }
 
-  double now = np_time_now();
+  bool       sent         = false;
+  double     now          = np_time_now();
+  double     min_interval = MIN((double)property_conf->token_min_ttl,
+                                NP_TOKEN_MIN_RESEND_INTERVAL_SEC);
+  np_dhkey_t intent_fp    = np_aaatoken_get_fingerprint(intent_token, false);
+
+  // a new intent token is sent right away, the resend interval of an unchanged
+  // token grows, our peers already know it and answer with their own tokens
+  if (!_np_dhkey_equal(&intent_fp, &property_run->current_fp)) {
+    property_run->last_intent_update     = 0;
+    property_run->intent_resend_interval = min_interval;
+    np_tree_clear(property_run->intent_replies);
+  }
 
   if (property_run->last_intent_update == 0 ||
       (now - property_run->last_intent_update) >
-          MIN((double)property_conf->token_min_ttl,
-              NP_TOKEN_MIN_RESEND_INTERVAL_SEC)) {
+          property_run->intent_resend_interval) {
 
     np_tree_t *intent_data = np_tree_create();
     np_tree_t *msg_body    = np_tree_create();
@@ -1763,8 +1757,13 @@ void __np_msgproperty_send_available_messages(
                                 available_out_dhkey,
                                 available_event);
     property_run->last_intent_update = now;
+    property_run->intent_resend_interval =
+        MAX(min_interval,
+            MIN(2 * property_run->intent_resend_interval,
+                NP_TOKEN_MAX_RESEND_INTERVAL_SEC));
     // set the session identifier for default messages
-    property_run->current_fp = np_aaatoken_get_fingerprint(intent_token, false);
+    property_run->current_fp = intent_fp;
+    sent                     = true;
 
     np_tree_free(intent_data);
     np_tree_free(msg_body);
@@ -1780,6 +1779,7 @@ void __np_msgproperty_send_available_messages(
               now - property_run->last_intent_update);
   }
   np_unref_obj(np_aaatoken_t, intent_token, "_np_msgproperty_get_mxtoken");
+  return sent;
 }
 
 void __np_msgproperty_send_pheromone_messages(
@@ -2048,7 +2048,7 @@ void __np_property_handle_in_msg(np_util_statemachine_t *statemachine,
 
   if (ret) _np_increment_received_msgs_counter(property_conf->subject_dhkey);
 
-  if (dll_size(property_run->msg_cache) > 0)
+  if (_np_msgcache_size(property_run->msg_cache) > 0)
     _np_msgproperty_check_msgcache_for(statemachine, event);
 }
 
@@ -2239,11 +2239,11 @@ void __np_response_handler_set(np_util_statemachine_t *statemachine,
   np_tree_elem_t *msg_tree_elem = NULL;
   if (property_conf->is_internal) { // registration of response handler for
                                     // message type NP_ACK
-    if (np_tree_find_uuid(property_run->response_handler,
-                          &responsehandler->uuid) == NULL)
-      np_tree_insert_uuid(property_run->response_handler,
-                          &responsehandler->uuid,
-                          np_treeval_new_v(responsehandler));
+    if (_np_responsetable_find(property_run->response_handler,
+                               (unsigned char *)responsehandler->uuid) ==
+        NULL)
+      _np_responsetable_insert(property_run->response_handler,
+                               responsehandler);
   } else { // a responsehandler reporting a timeout or an acknowledgement
     if ((msg_tree_elem = np_tree_find_uuid(property_run->redelivery_messages,
                                            &responsehandler->uuid)) != NULL) {
@@ -2310,8 +2310,9 @@ void __np_property_handle_intent(np_util_statemachine_t *statemachine,
     np_str_id((np_id *)&audience_id, intent_token->audience);
   }
 
-  if (_np_policy_check_compliance(property_run->required_attributes_policy,
-                                  &intent_token->attributes) &&
+  if (_np_policy_check_token_compliance(
+          property_run->required_attributes_policy,
+          intent_token) &&
       (_np_dhkey_equal(&context->my_identity->dhkey, &audience_id) ||
        _np_dhkey_equal(&context->realm_id, &audience_id))) {
     log_info(LOG_AAATOKEN,
@@ -2363,12 +2364,22 @@ void __np_property_handle_intent(np_util_statemachine_t *statemachine,
     if (_np_dhkey_equal(&property_conf->subject_dhkey_out,
                         &my_property_key->dhkey)) {
 
-      if (IS_AUTHORIZED(intent_token->state)) {
-        // TODO: should be done better - respect the uuid of the token and only
-        // load each token once
-        // first send out own intent token again
+      // first send out own intent token again, but only once for each peer.
+      // The peer is identified by issuer and audience of its token, the
+      // fingerprint changes with every refresh of the peer token. Refreshes
+      // are answered by the periodic resend of our own token.
+      np_dhkey_t peer_id = {0};
+      np_dhkey_t peer_audience_id =
+          np_dhkey_create_from_hash(intent_token->audience);
+      _np_dhkey_xor(&peer_id, &sendtoken_issuer_key, &peer_audience_id);
+      if (IS_AUTHORIZED(intent_token->state) &&
+          NULL == np_tree_find_dhkey(property_run->intent_replies, peer_id)) {
         property_run->last_intent_update = 0;
-        __np_msgproperty_send_available_messages(statemachine, event);
+        if (__np_msgproperty_send_available_messages(statemachine, event)) {
+          np_tree_insert_dhkey(property_run->intent_replies,
+                               peer_id,
+                               np_treeval_new_d(np_time_now()));
+        }
       }
 
       // now import the new receiver token
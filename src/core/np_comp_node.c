@@ -29,6 +29,7 @@
 #include "np_pheromones.h"
 #include "np_responsecontainer.h"
 #include "np_route.h"
+#include "np_statistics.h"
 
 // IN_SETUP -> IN_USE transition condition / action #1
 bool __is_node_handshake_token(np_util_statemachine_t *statemachine,
@@ -1237,6 +1238,20 @@ void __np_node_send_shutdown(np_util_statemachine_t *statemachine,
   node->leave_send_at = np_time_now();
 }
 
+// checks whether the alias key reads from a tcp connection which the peer has
+// opened to us
+static bool __np_node_alias_has_stream(np_key_t *alias_key,
+                                       np_key_t *node_key) {
+  np_network_t *alias_network = _np_key_get_network(alias_key);
+
+  return alias_key != node_key && NULL != alias_network &&
+         FLAG_CMP(alias_network->socket_type, TCP) &&
+         FLAG_CMP(alias_network->type, np_network_type_server) &&
+         !FLAG_CMP(alias_network->type, np_network_type_client) &&
+         NULL == alias_network->shared_connection &&
+         alias_network->socket > 0;
+}
+
 void __np_create_client_network(np_util_statemachine_t         *statemachine,
                                 NP_UNUSED const np_util_event_t event) {
   np_ctx_memory(statemachine->_user_data);
@@ -1384,6 +1399,37 @@ void __np_create_client_network(np_util_statemachine_t         *statemachine,
         }
         //_np_network_set_key(new_network, context->my_identity->dhkey);
       }
+    } else if (FLAG_CMP(node_trinity.node->protocol, TCP) &&
+               NULL != alias_key &&
+               __np_node_alias_has_stream(alias_key, node_key)) {
+      // the peer has connected to us, send on the same tcp connection
+      // instead of opening a second one
+      np_network_t *alias_network = _np_key_get_network(alias_key);
+      if (_np_network_init(new_network,
+                           false,
+                           node_trinity.node->protocol,
+                           node_trinity.node->ip_string,
+                           node_trinity.node->port,
+                           node_trinity.node->max_messages_per_sec,
+                           alias_network->socket,
+                           UNKNOWN_PROTO)) {
+        _np_network_share_connection(new_network, alias_network);
+        _np_network_set_key(new_network, node_key->dhkey);
+        node_key->entity_array[e_network] = new_network;
+        ref_replace_reason(np_network_t,
+                           new_network,
+                           ref_obj_creation,
+                           "__np_create_client_network");
+        log_debug(LOG_NETWORK,
+                  NULL,
+                  "reusing tcp connection of alias %s for node %s:%s",
+                  _np_key_as_str(alias_key),
+                  node_trinity.node->ip_string,
+                  node_trinity.node->port);
+        _np_network_enable(new_network);
+      } else {
+        np_unref_obj(np_network_t, new_network, ref_obj_creation);
+      }
     } else {
       if (_np_network_init(new_network,
                            false,
@@ -1414,6 +1460,14 @@ void __np_create_client_network(np_util_statemachine_t         *statemachine,
         } else {
           // or use our node dhkey for other types of network connections
           _np_network_set_key(new_network, node_key->dhkey);
+          // the peer may answer on our tcp connection, read from it as well
+          if (FLAG_CMP(node_trinity.node->protocol, TCP)) {
+            _np_network_register_stream(context,
+                                        new_network,
+                                        new_network->socket,
+                                        new_network->socket_type,
+                                        outgoing_key->dhkey);
+          }
         }
         node_key->entity_array[e_network] = new_network;
         ref_replace_reason(np_network_t,
@@ -1923,10 +1977,19 @@ void __np_node_handle_response(np_util_statemachine_t *statemachine,
 
   NP_CAST(event.user_data, np_responsecontainer_t, response);
 
+  // the round trip times and losses of the peer drive the congestion
+  // controller which paces the outbound packages of its network
+  np_network_t *network = _np_key_get_network(node_key);
+
   if (FLAG_CMP(event.type, evt_timeout)) {
     node->success_win[node->success_win_index % NP_NODE_SUCCESS_WINDOW] = 0;
     node->latency_win[node->latency_win_index % NP_NODE_SUCCESS_WINDOW] =
         (response->expires_at - response->send_at);
+    if (network != NULL) {
+      _LOCK_ACCESS(&network->access_lock) {
+        _np_congestion_on_loss(&network->congestion, np_time_now());
+      }
+    }
   }
 
   if (FLAG_CMP(event.type, evt_response)) {
@@ -1946,5 +2009,21 @@ void __np_node_handle_response(np_util_statemachine_t *statemachine,
       node->latency_win[node->latency_win_index % NP_NODE_SUCCESS_WINDOW] =
           node->latency;
     }
+    if (network != NULL) {
+      _LOCK_ACCESS(&network->access_lock) {
+        _np_congestion_on_ack(&network->congestion, new_latency_value);
+      }
+    }
   }
+
+#ifdef NP_STATISTICS_COUNTER
+  if (network != NULL) {
+    np_congestion_t congestion;
+    _LOCK_ACCESS(&network->access_lock) { congestion = network->congestion; }
+    _np_set_congestion(node_key->dhkey,
+                       congestion.cwnd,
+                       congestion.srtt,
+                       congestion.loss);
+  }
+#endif
 }
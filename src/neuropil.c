@@ -50,6 +50,7 @@
 #include "np_token_factory.h"
 #include "np_types.h"
 #include "np_util.h"
+#include "np_warmstart.h"
 
 static const char *error_strings[] = {
     "",
@@ -157,6 +158,8 @@ struct np_settings *np_default_settings(struct np_settings *settings) {
 
   ret->leafset_size     = NP_LEAFSET_MAX_ENTRIES;
   ret->jobqueue_size    = JOBQUEUE_MAX_SIZE;
+  ret->event_backend    = NP_EVENT_BACKEND;
+  memset(ret->warmstart_file, 0, sizeof(ret->warmstart_file));
   ret->log_write_fn     = NULL;
   ret->max_msgs_per_sec = 0;
 
@@ -249,6 +252,14 @@ np_context *np_new_context(struct np_settings *settings_in) {
             strerror(errno));
     status = np_startup;
 
+  } else if (_np_aaatoken_init(context) == false) {
+    log_msg(LOG_ERROR, NULL, "neuropil_init: _np_aaatoken_init failed");
+    status = np_startup;
+
+  } else if (_np_warmstart_init(context) == false) {
+    log_msg(LOG_ERROR, NULL, "neuropil_init: _np_warmstart_init failed");
+    status = np_startup;
+
   } else if (!_np_network_module_init(context)) {
     log_msg(LOG_ERROR,
             NULL,
@@ -556,7 +567,9 @@ bool np_has_receiver_for(np_context *ac, np_subject subject) {
   sll_init(np_aaatoken_ptr, receiver_list);
 
   np_dhkey_t null_dhkey = {0};
-  _np_intent_get_all_receiver(prop_key, null_dhkey, &receiver_list);
+  _LOCK_ACCESS(&prop_key->key_lock) {
+    _np_intent_get_all_receiver(prop_key, null_dhkey, &receiver_list);
+  }
 
   if (sll_size(receiver_list) > 0) ret = true;
 
@@ -962,6 +975,7 @@ enum np_return np_run(np_context *ac, double duration) {
   np_ctx_cast(ac);
   enum np_return ret    = np_ok;
   np_thread_t   *thread = _np_threads_get_self(context);
+  bool           start  = false;
 
   if (context->main_ip == NULL) {
     ret = np_listen(ac,
@@ -990,6 +1004,7 @@ enum np_return np_run(np_context *ac, double duration) {
                _np_key_as_str(context->my_node_key),
                _np_key_as_str(context->my_identity));
       _np_log_fflush(context, true);
+      start = true;
     }
     ret = np_ok;
   }
@@ -999,6 +1014,8 @@ enum np_return np_run(np_context *ac, double duration) {
 
   if (ret == np_ok) {
     TSP_SET(context->status, np_running);
+    // rejoin the neighbourhood of the last run
+    if (start) _np_warmstart_restore(context);
 
     if (duration <= 0) {
       np_threads_busyness(context, thread, true);
@@ -1068,6 +1085,9 @@ void np_destroy(np_context *ac, bool gracefully) {
   }
   if (cancel) return;
 
+  // snapshot of the neighbourhood before the peers are notified
+  _np_warmstart_write(context);
+
   if (gracefully) {
     np_shutdown_add_callback(context, _np_shutdown_notify_others);
   }
@@ -1098,6 +1118,8 @@ void np_destroy(np_context *ac, bool gracefully) {
   // _np_sysinfo_destroy_cache(context);
   _np_shutdown_destroy(context);
 
+  _np_warmstart_destroy(context);
+  _np_aaatoken_destroy(context);
   _np_jobqueue_destroy(context);
   _np_time_destroy(context);
 
@@ -8,6 +8,8 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "neuropil.h"
 #include "neuropil_data.h"
@@ -15,6 +17,7 @@
 #include "util/np_bloom.h"
 #include "util/np_mapreduce.h"
 
+#include "np_aaatoken.h"
 #include "np_attributes.h"
 #include "np_data.h"
 #include "np_dhkey.h"
@@ -163,30 +166,24 @@ enum np_data_return np_set_mxp_attr_policy_bin(np_context    *ac,
         _np_msgproperty_run_get(context, INBOUND, subject_dhkey);
     if (property != NULL) {
       if (property->required_attributes_policy == NULL)
-        property->required_attributes_policy = _np_attribute_bloom();
-
-      if (value == NULL)
-        _np_policy_set_key(property->required_attributes_policy, key);
-      else
-        _np_policy_set_bin(property->required_attributes_policy,
-                           key,
-                           value,
-                           value_size);
+        property->required_attributes_policy = _np_attribute_policy_create();
+
+      np_attribute_policy_t *policy = property->required_attributes_policy;
+      if (value == NULL) _np_policy_set_key(policy->bloom, key);
+      else _np_policy_set_bin(policy->bloom, key, value, value_size);
+      policy->version++;
       // ret = np_data_ok;
     }
     property = NULL;
     property = _np_msgproperty_run_get(context, OUTBOUND, subject_dhkey);
     if (property != NULL) {
       if (property->required_attributes_policy == NULL)
-        property->required_attributes_policy = _np_attribute_bloom();
-
-      if (value == NULL)
-        _np_policy_set_key(property->required_attributes_policy, key);
-      else
-        _np_policy_set_bin(property->required_attributes_policy,
-                           key,
-                           value,
-                           value_size);
+        property->required_attributes_policy = _np_attribute_policy_create();
+
+      np_attribute_policy_t *policy = property->required_attributes_policy;
+      if (value == NULL) _np_policy_set_key(policy->bloom, key);
+      else _np_policy_set_bin(policy->bloom, key, value, value_size);
+      policy->version++;
       ret = np_data_ok;
     }
 
@@ -281,35 +278,111 @@ bool _np_attribute_build_bloom(np_bloom_t      *target,
   return r == np_data_ok;
 }
 
+np_attribute_policy_t *_np_attribute_policy_create() {
+  np_attribute_policy_t *policy = calloc(1, sizeof(np_attribute_policy_t));
+  policy->bloom                 = _np_attribute_bloom();
+  policy->version               = 1;
+  return policy;
+}
+
+void _np_attribute_policy_free(np_attribute_policy_t *policy) {
+  if (policy == NULL) return;
+  _np_bloom_free(policy->bloom);
+  free(policy);
+}
+
+static void __np_attribute_bloom_to_mask(np_attribute_mask_t *mask,
+                                         np_bloom_t          *bloom) {
+  uint16_t fields = bloom->_num_blocks * bloom->_size * bloom->_d / 16;
+  ASSERT(fields <= NP_ATTRIBUTE_MASK_WORDS * 64,
+         "bloom filter does not fit into the attribute mask");
+
+  memset(mask, 0, sizeof(np_attribute_mask_t));
+  // only the count field is relevant, the age is ignored
+  for (uint16_t k = 0; k < fields; k++) {
+    if (bloom->_bitset[2 * k + 1] > 0)
+      mask->bits[k / 64] |= ((uint64_t)1 << (k % 64));
+  }
+}
+
+// true if all fields set in required are set in mask as well
+static bool __np_attribute_mask_covers(const np_attribute_mask_t *mask,
+                                       const np_attribute_mask_t *required) {
+  uint64_t missing = 0;
+  for (uint8_t i = 0; i < NP_ATTRIBUTE_MASK_WORDS; i++) {
+    missing |= required->bits[i] & ~mask->bits[i];
+  }
+  return missing == 0;
+}
+
+static bool __np_attribute_mask_is_empty(const np_attribute_mask_t *mask) {
+  uint64_t set = 0;
+  for (uint8_t i = 0; i < NP_ATTRIBUTE_MASK_WORDS; i++) set |= mask->bits[i];
+  return set == 0;
+}
+
+bool _np_attribute_build_mask(np_attribute_mask_t *mask,
+                              np_attributes_t     *attributes) {
+  np_bloom_t *bloom = _np_attribute_bloom();
+  bool        ret   = _np_attribute_build_bloom(bloom, attributes);
+  if (ret) __np_attribute_bloom_to_mask(mask, bloom);
+  _np_bloom_free(bloom);
+  return ret;
+}
+
 bool _np_policy_check_compliance(np_bloom_t      *policy,
                                  np_attributes_t *attributes) {
-  bool        ret                               = false;
-  np_bloom_t *all_relevant_hashes_of_attributes = _np_attribute_bloom();
-
   // test for empty policy
-  if (policy == NULL ||
-      _np_neuropil_bloom_cmp(all_relevant_hashes_of_attributes, policy) == 0) {
-    ret = true;
-  } else {
-    ret = _np_attribute_build_bloom(all_relevant_hashes_of_attributes,
-                                    attributes);
-
-    if (ret) {
-      np_bloom_t *policy_relevant_elements_of_attributes =
-          _np_attribute_bloom();
-      policy_relevant_elements_of_attributes->op.union_cb(
-          policy_relevant_elements_of_attributes,
-          policy);
-      policy_relevant_elements_of_attributes->op.intersect_cb(
-          policy_relevant_elements_of_attributes,
-          all_relevant_hashes_of_attributes);
-
-      ret = _np_neuropil_bloom_cmp(policy,
-                                   policy_relevant_elements_of_attributes) == 0;
-
-      _np_bloom_free(policy_relevant_elements_of_attributes);
+  if (policy == NULL) return true;
+
+  np_attribute_mask_t required;
+  __np_attribute_bloom_to_mask(&required, policy);
+  if (__np_attribute_mask_is_empty(&required)) return true;
+
+  np_attribute_mask_t mask;
+  if (!_np_attribute_build_mask(&mask, attributes)) return false;
+
+  return __np_attribute_mask_covers(&mask, &required);
+}
+
+bool _np_policy_check_token_compliance(np_attribute_policy_t *policy,
+                                       np_aaatoken_t         *token) {
+  if (policy == NULL) return true;
+
+  if (policy->compiled_version != policy->version) {
+    __np_attribute_bloom_to_mask(&policy->required, policy->bloom);
+    policy->is_empty         = __np_attribute_mask_is_empty(&policy->required);
+    policy->compiled_version = policy->version;
+  }
+  if (policy->is_empty) return true;
+
+  // the signature identifies the attributes only once it has been verified,
+  // a refreshed intent token carries the same signature
+  bool memoize = token->is_signature_attributes_verified;
+  for (uint16_t i = 0; memoize && i < NP_POLICY_RESULT_CACHE_SIZE; i++) {
+    if (policy->results[i].version == policy->version &&
+        0 == memcmp(policy->results[i].attributes_signature,
+                    token->attributes_signature,
+                    NP_SIGNATURE_BYTES)) {
+      return policy->results[i].compliant;
     }
   }
-  _np_bloom_free(all_relevant_hashes_of_attributes);
+
+  if (!token->attributes_mask_is_set) {
+    token->attributes_mask_is_set =
+        _np_attribute_build_mask(&token->attributes_mask, &token->attributes);
+    if (!token->attributes_mask_is_set) return false;
+  }
+  bool ret = __np_attribute_mask_covers(&token->attributes_mask,
+                                        &policy->required);
+
+  if (memoize) {
+    uint16_t slot = policy->next_result++ % NP_POLICY_RESULT_CACHE_SIZE;
+    policy->results[slot].version   = policy->version;
+    policy->results[slot].compliant = ret;
+    memcpy(policy->results[slot].attributes_signature,
+           token->attributes_signature,
+           NP_SIGNATURE_BYTES);
+  }
   return ret;
 }
@@ -6,6 +6,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "neuropil.h"
 
@@ -208,7 +209,7 @@ enum np_data_return np_set_data(np_datablock_t     *block,
 }
 
 enum np_data_return np_get_data(np_datablock_t      *block,
-                                char                 key[255],
+                                const char          *key,
                                 struct np_data_conf *out_data_config,
                                 np_data_value       *out_data) {
 
@@ -232,6 +233,130 @@ enum np_data_return np_get_data(np_datablock_t      *block,
   return ret;
 }
 
+// FNV-1a of the key
+static uint32_t __np_data_key_hash(const char *key) {
+  uint32_t hash = 2166136261u;
+  for (uint16_t i = 0; i < 255 && key[i] != '\0'; i++) {
+    hash = (hash ^ (uint8_t)key[i]) * 16777619u;
+  }
+  return hash;
+}
+
+static bool __np_data_index_insert(np_data_index_t *index,
+                                   const char      *key,
+                                   uint32_t         offset,
+                                   uint32_t         end) {
+  uint32_t hash = __np_data_key_hash(key);
+  uint32_t slot = hash & (NP_DATA_INDEX_SLOTS - 1);
+  uint32_t tries = 0;
+
+  // linear probing keeps the order of duplicate keys
+  while (index->slots[slot].end != 0) {
+    if (++tries == NP_DATA_INDEX_SLOTS) return false;
+    slot = (slot + 1) & (NP_DATA_INDEX_SLOTS - 1);
+  }
+  index->slots[slot].hash   = hash;
+  index->slots[slot].offset = offset;
+  index->slots[slot].end    = end;
+  return true;
+}
+
+static bool __np_data_index_matches(const np_data_index_t *index,
+                                    np_datablock_header_t *db_header) {
+  return index->block == db_header->_inner_blob &&
+         index->used_length == db_header->used_length &&
+         index->object_count == db_header->object_count;
+}
+
+void np_data_index_reset(np_data_index_t *index) {
+  memset(index, 0, sizeof(np_data_index_t));
+}
+
+void np_data_index_build(np_data_index_t *index, np_datablock_t *block) {
+  np_data_index_reset(index);
+
+  np_datablock_header_t db_header = {._inner_blob = block};
+  if (np_data_ok !=
+      np_serializer_read_datablock_header(&db_header, NP_DATA_MAGIC_NO))
+    return;
+
+  index->block        = block;
+  index->used_length  = db_header.used_length;
+  index->object_count = db_header.object_count;
+  // keep the load factor below 3/4, larger blocks are searched linearly
+  if (db_header.object_count > NP_DATA_INDEX_SLOTS * 3 / 4) return;
+
+  unsigned char *block_end = block + db_header.used_length;
+  np_kv_buffer_t container = {.buffer_start =
+                                  np_skip_datablock_header(&db_header)};
+
+  for (uint32_t i = 0; i < db_header.object_count; i++) {
+    container.buffer_end = block_end;
+    if (np_data_ok != np_serializer_read_object(&container) ||
+        !__np_data_index_insert(index,
+                                container.key,
+                                container.buffer_start - block,
+                                container.buffer_end - block))
+      return;
+    container.buffer_start = container.buffer_end;
+  }
+  index->complete = true;
+}
+
+static enum np_data_return
+__np_data_index_find(const np_data_index_t *index,
+                     np_datablock_header_t *db_header,
+                     const char            *key,
+                     np_kv_buffer_t        *kv_pair) {
+  unsigned char *block = db_header->_inner_blob;
+  uint32_t       hash  = __np_data_key_hash(key);
+  uint32_t       slot  = hash & (NP_DATA_INDEX_SLOTS - 1);
+
+  for (uint32_t tries = 0;
+       tries < NP_DATA_INDEX_SLOTS && index->slots[slot].end != 0;
+       tries++) {
+    if (index->slots[slot].hash == hash) {
+      kv_pair->buffer_start = block + index->slots[slot].offset;
+      kv_pair->buffer_end   = block + db_header->used_length;
+      if (np_data_ok != np_serializer_read_object(kv_pair) ||
+          kv_pair->buffer_end != block + index->slots[slot].end) {
+        // the block has been modified in place, the index is outdated
+        return np_serializer_search_object(db_header,
+                                           key,
+                                           kv_pair,
+                                           NP_DATA_MAGIC_NO);
+      }
+      if (0 == strncmp(kv_pair->key, key, 255)) return np_data_ok;
+    }
+    slot = (slot + 1) & (NP_DATA_INDEX_SLOTS - 1);
+  }
+  return np_key_not_found;
+}
+
+enum np_data_return np_get_data_indexed(const np_data_index_t *index,
+                                        np_datablock_t        *block,
+                                        const char            *key,
+                                        struct np_data_conf   *out_data_config,
+                                        np_data_value         *out_data) {
+  enum np_data_return   ret       = np_could_not_read_object;
+  np_datablock_header_t db_header = {._inner_blob = block};
+
+  ret = np_serializer_read_datablock_header(&db_header, NP_DATA_MAGIC_NO);
+  if (ret != np_data_ok) return ret;
+
+  if (index == NULL || !index->complete ||
+      !__np_data_index_matches(index, &db_header)) {
+    return np_get_data(block, key, out_data_config, out_data);
+  }
+
+  np_kv_buffer_t kv_pair = {0};
+  ret = __np_data_index_find(index, &db_header, key, &kv_pair);
+  if (ret == np_data_ok) {
+    __convert_kv_to_conf(out_data_config, out_data, &kv_pair);
+  }
+  return ret;
+}
+
 enum np_data_return np_get_data_size(np_datablock_t *block,
                                      size_t         *out_block_size) {
   assert(out_block_size != NULL);
@@ -262,6 +387,22 @@ enum np_data_return np_get_object_count(np_datablock_t *block,
   return ret;
 }
 
+// copy the encoded object to the end of the datablock
+static enum np_data_return
+__np_data_append_object(np_datablock_header_t *db_header,
+                        const np_kv_buffer_t  *kv_pair) {
+  size_t object_size = kv_pair->buffer_end - kv_pair->buffer_start;
+  if (object_size > db_header->total_length - db_header->used_length)
+    return np_insufficient_memory;
+
+  memcpy(db_header->_inner_blob + db_header->used_length,
+         kv_pair->buffer_start,
+         object_size);
+  db_header->used_length += object_size;
+  db_header->object_count++;
+  return np_serializer_write_datablock_header(db_header, NP_DATA_MAGIC_NO);
+}
+
 enum np_data_return np_merge_data(np_datablock_t *dest, np_datablock_t *src) {
   enum np_data_return ret = np_could_not_read_object;
   if (src != NULL) {
@@ -269,6 +410,10 @@ enum np_data_return np_merge_data(np_datablock_t *dest, np_datablock_t *src) {
     ret = np_serializer_read_datablock_header(&db_header, NP_DATA_MAGIC_NO);
     unsigned char *max_buffer_end =
         db_header._inner_blob + db_header.used_length;
+
+    np_data_index_t dest_index;
+    np_data_index_build(&dest_index, dest);
+
     if (ret == np_data_ok) {
       uint16_t       objects_read = 0;
       np_kv_buffer_t kv_pair      = {.buffer_start =
@@ -277,11 +422,56 @@ enum np_data_return np_merge_data(np_datablock_t *dest, np_datablock_t *src) {
       while (objects_read < db_header.object_count) {
         if (np_data_ok == np_serializer_read_object(&kv_pair)) {
 
-          struct np_data_conf data_cfg;
-          np_data_value       data_val;
-          __convert_kv_to_conf(&data_cfg, &data_val, &kv_pair);
+          np_datablock_header_t dest_header = {._inner_blob = dest};
+          np_kv_buffer_t        dest_pair   = {0};
+
+          ret = np_serializer_read_datablock_header(&dest_header,
+                                                    NP_DATA_MAGIC_NO);
+          if (ret != np_data_ok) break;
 
-          ret = np_set_data(dest, data_cfg, data_val);
+          enum np_data_return found = np_key_not_found;
+          if (dest_index.complete &&
+              __np_data_index_matches(&dest_index, &dest_header)) {
+            found = __np_data_index_find(&dest_index,
+                                         &dest_header,
+                                         kv_pair.key,
+                                         &dest_pair);
+          } else {
+            found = np_serializer_search_object(&dest_header,
+                                                kv_pair.key,
+                                                &dest_pair,
+                                                NP_DATA_MAGIC_NO);
+          }
+
+          size_t object_size = kv_pair.buffer_end - kv_pair.buffer_start;
+          if (found == np_data_ok &&
+              object_size == (size_t)(dest_pair.buffer_end -
+                                      dest_pair.buffer_start) &&
+              0 == memcmp(dest_pair.buffer_start,
+                          kv_pair.buffer_start,
+                          object_size)) {
+            // unchanged object, nothing to do
+            ret = np_data_ok;
+          } else if (found == np_key_not_found) {
+            // new keys are copied over as they are, without re-encoding
+            uint32_t offset = dest_header.used_length;
+            ret             = __np_data_append_object(&dest_header, &kv_pair);
+            if (ret == np_data_ok && dest_index.complete) {
+              uint32_t end            = dest_header.used_length;
+              dest_index.used_length  = dest_header.used_length;
+              dest_index.object_count = dest_header.object_count;
+              dest_index.complete =
+                  __np_data_index_insert(&dest_index, kv_pair.key, offset, end);
+            }
+          } else {
+            struct np_data_conf data_cfg;
+            np_data_value       data_val;
+            __convert_kv_to_conf(&data_cfg, &data_val, &kv_pair);
+
+            ret = np_set_data(dest, data_cfg, data_val);
+            // the object may have been resized
+            np_data_index_build(&dest_index, dest);
+          }
 
           if (ret != np_data_ok) break;
 
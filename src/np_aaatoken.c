@@ -22,6 +22,7 @@
 
 #include "core/np_comp_msgproperty.h"
 #include "core/np_comp_node.h"
+#include "util/np_dedup.h"
 #include "util/np_event.h"
 #include "util/np_serialization.h"
 #include "util/np_tree.h"
@@ -30,6 +31,8 @@
 #include "np_constants.h"
 #include "np_data.h"
 #include "np_dhkey.h"
+#include "np_eventqueue.h"
+#include "np_jobqueue.h"
 #include "np_key.h"
 #include "np_keycache.h"
 #include "np_legacy.h"
@@ -96,6 +99,8 @@ void _np_aaatoken_t_new(np_state_t       *context,
             expire_sec);
 
   np_init_datablock(aaa_token->attributes, sizeof(aaa_token->attributes));
+  np_data_index_reset(&aaa_token->attributes_index);
+  aaa_token->attributes_mask_is_set = false;
   aaa_token->state = AAA_UNKNOWN;
 
   aaa_token->type         = np_aaatoken_type_undefined;
@@ -241,6 +246,8 @@ bool np_aaatoken_decode(np_tree_t *data, np_aaatoken_t *token) {
     memcpy(token->attributes,
            tmp->val.value.bin,
            fmin(tmp->val.size, sizeof(token->attributes)));
+    np_data_index_reset(&token->attributes_index);
+    token->attributes_mask_is_set = false;
 
     if (ret && NULL != (tmp = np_tree_find_str(data, "np.t.sie"))) {
       memcpy(token->attributes_signature,
@@ -459,6 +466,8 @@ bool _np_aaatoken_is_valid(np_state_t           *context,
                 "checksum verification success",
                 token->subject);
       token->is_signature_attributes_verified = true;
+      // the attributes are final now
+      np_data_index_build(&token->attributes_index, token->attributes);
     }
   }
 
@@ -470,9 +479,9 @@ bool _np_aaatoken_is_valid(np_state_t           *context,
     log_debug(LOG_AAATOKEN, token->uuid, "try to find max/msg threshold ");
 
     np_data_value max_threshold, msg_threshold;
-    if (np_get_data(token->attributes, "max_threshold", NULL, &max_threshold) ==
+    if (_np_aaatoken_get_data(token, "max_threshold", NULL, &max_threshold) ==
             np_ok &&
-        np_get_data(token->attributes, "msg_threshold", NULL, &msg_threshold) ==
+        _np_aaatoken_get_data(token, "msg_threshold", NULL, &msg_threshold) ==
             np_ok) {
       uint32_t token_max_threshold = max_threshold.unsigned_integer;
       uint32_t token_msg_threshold = msg_threshold.unsigned_integer;
@@ -515,6 +524,427 @@ bool _np_aaatoken_is_valid(np_state_t           *context,
   return (true);
 }
 
+struct np_aaatoken_verification_s {
+  np_aaatoken_t        *token;
+  enum np_aaatoken_type expected_type;
+  np_util_event_t       event;
+  np_evt_callback_t     on_valid;
+  double                queued_at;
+  // handshakes only: the entry in recent_handshakes which is removed again
+  // if the token turns out to be invalid
+  bool          has_replay_id;
+  unsigned char replay_id[NP_UUID_BYTES];
+};
+
+// ring buffer of token checks waiting for a verification batch
+struct np_aaatoken_stage_s {
+  TSP(struct np_aaatoken_verification_s *, pending);
+  uint16_t queue_size;
+  uint16_t pending_head;
+  uint16_t pending_count;
+  uint16_t scheduled_batches;
+  // the count of batch jobs of this stage which may wait or run at once
+  uint16_t max_batches;
+
+  // queueing delay of the entries taken since the last statistics call
+  double   latency_sum;
+  uint32_t latency_count;
+  uint32_t dropped;
+
+  np_sll_t(np_evt_callback_t, batch_cb);
+};
+
+np_module_struct(aaatoken) {
+  np_state_t                *context;
+  struct np_aaatoken_stage_s tokens;
+  struct np_aaatoken_stage_s handshakes;
+
+  // handshakes seen recently, keyed by token signature and alias key
+  TSP(np_dedup_t *, recent_handshakes);
+};
+
+static void __np_aaatoken_verified(np_state_t                        *context,
+                                   struct np_aaatoken_verification_s *entry) {
+  if (entry->on_valid != NULL) {
+    entry->on_valid(context, entry->event);
+  } else {
+    _np_event_runtime_add_event(context,
+                                entry->event.current_run,
+                                entry->event.target_dhkey,
+                                entry->event);
+  }
+}
+
+static void __np_aaatoken_stage_init(struct np_aaatoken_stage_s *stage,
+                                     uint16_t                    queue_size,
+                                     uint16_t                    max_batches,
+                                     np_evt_callback_t           batch_cb) {
+  TSP_INIT(stage->pending);
+  stage->pending =
+      calloc(queue_size, sizeof(struct np_aaatoken_verification_s));
+  CHECK_MALLOC(stage->pending);
+  stage->queue_size        = queue_size;
+  stage->pending_head      = 0;
+  stage->pending_count     = 0;
+  stage->scheduled_batches = 0;
+  stage->max_batches       = max_batches;
+  stage->latency_sum       = 0.0;
+  stage->latency_count     = 0;
+  stage->dropped           = 0;
+
+  sll_init(np_evt_callback_t, stage->batch_cb);
+  sll_append(np_evt_callback_t, stage->batch_cb, batch_cb);
+}
+
+static void __np_aaatoken_stage_destroy(np_state_t                 *context,
+                                        struct np_aaatoken_stage_s *stage) {
+  TSP_SCOPE(stage->pending) {
+    while (stage->pending_count > 0) {
+      struct np_aaatoken_verification_s *entry =
+          &stage->pending[stage->pending_head];
+      if (entry->event.user_data != NULL)
+        np_unref_obj(np_unknown_t,
+                     entry->event.user_data,
+                     "_np_aaatoken_verify_submit");
+      np_unref_obj(np_aaatoken_t, entry->token, "_np_aaatoken_verify_submit");
+      stage->pending_head = (stage->pending_head + 1) % stage->queue_size;
+      stage->pending_count--;
+    }
+    free(stage->pending);
+  }
+  TSP_DESTROY(stage->pending);
+  sll_free(np_evt_callback_t, stage->batch_cb);
+}
+
+// a new batch is needed if the scheduled batches cannot take all pending
+// entries, as long as the stage has not used up its batch budget
+static bool __np_aaatoken_stage_need_batch(struct np_aaatoken_stage_s *stage) {
+  return stage->pending_count >
+             stage->scheduled_batches * NP_TOKEN_VERIFY_BATCH_SIZE &&
+         stage->scheduled_batches < stage->max_batches;
+}
+
+static void __np_aaatoken_stage_schedule(np_state_t                 *context,
+                                         struct np_aaatoken_stage_s *stage) {
+  np_util_event_t batch_event = {.type = evt_internal};
+  np_jobqueue_submit_event_callbacks(context,
+                                     0.0,
+                                     dhkey_zero,
+                                     batch_event,
+                                     stage->batch_cb,
+                                     "__np_aaatoken_verify_batch");
+}
+
+/**
+ * adds a token check to the ring buffer of the stage. the entry holds a
+ * reference to the token and the event data until its batch has run.
+ */
+static bool
+__np_aaatoken_stage_submit(np_state_t                        *context,
+                           struct np_aaatoken_stage_s        *stage,
+                           struct np_aaatoken_verification_s *entry) {
+  bool queued = false;
+  bool submit = false;
+
+  // the current event runtime lives on the stack of the caller and cannot
+  // be used once the entry leaves this function
+  entry->event.current_run = NULL;
+  entry->queued_at         = np_time_now();
+
+  np_ref_obj(np_aaatoken_t, entry->token, "_np_aaatoken_verify_submit");
+  if (entry->event.user_data != NULL)
+    np_ref_obj(np_unknown_t,
+               entry->event.user_data,
+               "_np_aaatoken_verify_submit");
+
+  TSP_SCOPE(stage->pending) {
+    if (stage->pending_count < stage->queue_size) {
+      uint16_t idx = (stage->pending_head + stage->pending_count) %
+                     stage->queue_size;
+      stage->pending[idx] = *entry;
+      stage->pending_count++;
+      queued = true;
+
+      if (__np_aaatoken_stage_need_batch(stage)) {
+        stage->scheduled_batches++;
+        submit = true;
+      }
+    } else {
+      stage->dropped++;
+    }
+  }
+
+  if (!queued) {
+    if (entry->event.user_data != NULL)
+      np_unref_obj(np_unknown_t,
+                   entry->event.user_data,
+                   "_np_aaatoken_verify_submit");
+    np_unref_obj(np_aaatoken_t, entry->token, "_np_aaatoken_verify_submit");
+  }
+  if (submit) __np_aaatoken_stage_schedule(context, stage);
+
+  return queued;
+}
+
+/**
+ * drains up to NP_TOKEN_VERIFY_BATCH_SIZE pending token checks of a stage.
+ * several batches can run in parallel on different worker threads, each of
+ * them owns the entries it has removed from the ring buffer.
+ */
+static void __np_aaatoken_verify_run(np_state_t                 *context,
+                                     struct np_aaatoken_stage_s *stage,
+                                     bool                        scheduled) {
+  struct np_aaatoken_verification_s batch[NP_TOKEN_VERIFY_BATCH_SIZE];
+  uint16_t                          batch_count = 0;
+  bool                              reschedule  = false;
+  double                            now         = np_time_now();
+
+  TSP_SCOPE(stage->pending) {
+    if (scheduled && stage->scheduled_batches > 0) stage->scheduled_batches--;
+    while (batch_count < NP_TOKEN_VERIFY_BATCH_SIZE &&
+           stage->pending_count > 0) {
+      batch[batch_count] = stage->pending[stage->pending_head];
+      stage->latency_sum += now - batch[batch_count].queued_at;
+      stage->latency_count++;
+      batch_count++;
+      stage->pending_head = (stage->pending_head + 1) % stage->queue_size;
+      stage->pending_count--;
+    }
+    if (__np_aaatoken_stage_need_batch(stage)) {
+      stage->scheduled_batches++;
+      reschedule = true;
+    }
+  }
+
+  if (reschedule) __np_aaatoken_stage_schedule(context, stage);
+
+  for (uint16_t i = 0; i < batch_count; i++) {
+    np_aaatoken_t *token = batch[i].token;
+    // every token is checked on its own: tokens with the same signature may
+    // still differ in their content
+    if (_np_aaatoken_is_valid(context, token, batch[i].expected_type)) {
+      __np_aaatoken_verified(context, &batch[i]);
+    } else {
+      log_warn(LOG_AAATOKEN,
+               token->uuid,
+               "token for subject \"%s\": dropped after batch verification",
+               token->subject);
+      // a forged handshake must not suppress the genuine one
+      if (batch[i].has_replay_id) {
+        TSP_SCOPE(np_module(aaatoken)->recent_handshakes) {
+          _np_dedup_remove(np_module(aaatoken)->recent_handshakes,
+                           batch[i].replay_id);
+        }
+      }
+    }
+    if (batch[i].event.user_data != NULL)
+      np_unref_obj(np_unknown_t,
+                   batch[i].event.user_data,
+                   "_np_aaatoken_verify_submit");
+    np_unref_obj(np_aaatoken_t, token, "_np_aaatoken_verify_submit");
+  }
+}
+
+bool __np_aaatoken_verify_batch(np_state_t               *context,
+                                NP_UNUSED np_util_event_t event) {
+  if (np_module_initiated(aaatoken))
+    __np_aaatoken_verify_run(context, &np_module(aaatoken)->tokens, true);
+  return true;
+}
+
+bool __np_aaatoken_verify_handshake_batch(np_state_t               *context,
+                                          NP_UNUSED np_util_event_t event) {
+  if (np_module_initiated(aaatoken))
+    __np_aaatoken_verify_run(context, &np_module(aaatoken)->handshakes, true);
+  return true;
+}
+
+bool __np_aaatoken_verify_pending(np_state_t               *context,
+                                  NP_UNUSED np_util_event_t event) {
+  if (np_module_initiated(aaatoken)) {
+    np_module_var(aaatoken);
+    __np_aaatoken_verify_run(context, &_module->tokens, false);
+    __np_aaatoken_verify_run(context, &_module->handshakes, false);
+
+    TSP_SCOPE(_module->recent_handshakes) {
+      _np_dedup_expire(_module->recent_handshakes, np_time_now());
+    }
+  }
+  return true;
+}
+
+void _np_aaatoken_verify_submit(np_state_t           *context,
+                                np_aaatoken_t        *token,
+                                enum np_aaatoken_type expected_type,
+                                np_util_event_t       event,
+                                np_evt_callback_t     on_valid) {
+  assert(token != NULL);
+
+  struct np_aaatoken_verification_s entry = {.token         = token,
+                                             .expected_type = expected_type,
+                                             .event         = event,
+                                             .on_valid      = on_valid};
+  bool queued = false;
+
+  if (np_module_initiated(aaatoken)) {
+    queued = __np_aaatoken_stage_submit(context,
+                                        &np_module(aaatoken)->tokens,
+                                        &entry);
+  }
+
+  if (!queued) {
+    // no verification stage available or its queue is full, verify inline
+    entry.event = event;
+    if (_np_aaatoken_is_valid(context, token, expected_type)) {
+      __np_aaatoken_verified(context, &entry);
+    }
+  }
+}
+
+bool _np_aaatoken_verify_handshake(np_state_t           *context,
+                                   np_handshake_token_t *token,
+                                   np_util_event_t       event,
+                                   np_evt_callback_t     on_valid) {
+  assert(token != NULL);
+
+  struct np_aaatoken_verification_s entry = {
+      .token         = token,
+      .expected_type = np_aaatoken_type_handshake,
+      .event         = event,
+      .on_valid      = on_valid};
+
+  if (!np_module_initiated(aaatoken)) {
+    if (!_np_aaatoken_is_valid(context, token, np_aaatoken_type_handshake))
+      return false;
+    __np_aaatoken_verified(context, &entry);
+    return true;
+  }
+  np_module_var(aaatoken);
+
+  double now = np_time_now();
+  // cheap checks first, the signature is only verified for handshakes which
+  // could lead to a new session
+  if (!FLAG_CMP(token->type, np_aaatoken_type_handshake) ||
+      now > token->expires_at) {
+    log_debug(LOG_HANDSHAKE,
+              token->uuid,
+              "rejecting expired or malformed handshake token");
+    TSP_SCOPE(_module->handshakes.pending) { _module->handshakes.dropped++; }
+    return false;
+  }
+
+  // the node token of a peer is the same in all of its handshakes. the same
+  // token for the same alias key within a short time is a retransmission or a
+  // replay, the session of the first one is set up already. The id is
+  // removed again if the signature check of the handshake fails.
+  unsigned char *handshake_id = entry.replay_id;
+  entry.has_replay_id         = true;
+  crypto_generichash(handshake_id,
+                     NP_UUID_BYTES,
+                     token->signature,
+                     crypto_sign_BYTES,
+                     (unsigned char *)&event.target_dhkey,
+                     sizeof(np_dhkey_t));
+
+  bool unique = true;
+  TSP_SCOPE(_module->recent_handshakes) {
+    unique = _np_dedup_check_and_add(_module->recent_handshakes,
+                                     handshake_id,
+                                     now + NP_HANDSHAKE_DUPLICATE_WINDOW_SEC,
+                                     now);
+  }
+  if (!unique) {
+    log_debug(LOG_HANDSHAKE,
+              token->uuid,
+              "rejecting duplicate handshake for subject \"%s\"",
+              token->subject);
+    TSP_SCOPE(_module->handshakes.pending) { _module->handshakes.dropped++; }
+    return false;
+  }
+
+  // in contrast to other tokens a full handshake queue sheds load, the peer
+  // will send its handshake again
+  if (!__np_aaatoken_stage_submit(context, &_module->handshakes, &entry)) {
+    log_info(LOG_HANDSHAKE,
+             token->uuid,
+             "handshake queue is full, dropping handshake for subject \"%s\"",
+             token->subject);
+    TSP_SCOPE(_module->recent_handshakes) {
+      _np_dedup_remove(_module->recent_handshakes, handshake_id);
+    }
+    return false;
+  }
+  return true;
+}
+
+void _np_aaatoken_handshake_statistics(np_state_t *context,
+                                       uint16_t   *queue_depth,
+                                       double     *latency,
+                                       uint32_t   *dropped) {
+  *queue_depth = 0;
+  *latency     = 0.0;
+  *dropped     = 0;
+
+  if (np_module_initiated(aaatoken)) {
+    struct np_aaatoken_stage_s *stage = &np_module(aaatoken)->handshakes;
+    TSP_SCOPE(stage->pending) {
+      *queue_depth = stage->pending_count;
+      *dropped     = stage->dropped;
+      if (stage->latency_count > 0)
+        *latency = stage->latency_sum / stage->latency_count;
+      stage->latency_sum   = 0.0;
+      stage->latency_count = 0;
+    }
+  }
+}
+
+bool _np_aaatoken_init(np_state_t *context) {
+  if (!np_module_initiated(aaatoken)) {
+    np_module_malloc(aaatoken);
+
+    __np_aaatoken_stage_init(&_module->tokens,
+                             NP_TOKEN_VERIFY_QUEUE_SIZE,
+                             UINT16_MAX,
+                             __np_aaatoken_verify_batch);
+    __np_aaatoken_stage_init(&_module->handshakes,
+                             NP_HANDSHAKE_QUEUE_SIZE,
+                             NP_HANDSHAKE_MAX_BATCHES,
+                             __np_aaatoken_verify_handshake_batch);
+
+    TSP_INIT(_module->recent_handshakes);
+    _module->recent_handshakes =
+        _np_dedup_create(NP_HANDSHAKE_DUPLICATE_WINDOW_SEC,
+                         NP_HANDSHAKE_QUEUE_SIZE * 4);
+    CHECK_MALLOC(_module->recent_handshakes);
+
+    // catches entries whose batch job has been rejected by the jobqueue and
+    // handshakes left over once the batch budget has been used up
+    np_jobqueue_submit_event_periodic(context,
+                                      NP_PRIORITY_HIGH,
+                                      NP_TOKEN_VERIFY_INTERVAL_SEC,
+                                      NP_TOKEN_VERIFY_INTERVAL_SEC,
+                                      __np_aaatoken_verify_pending,
+                                      "__np_aaatoken_verify_pending");
+  }
+  return true;
+}
+
+void _np_aaatoken_destroy(np_state_t *context) {
+  if (np_module_initiated(aaatoken)) {
+    np_module_var(aaatoken);
+
+    __np_aaatoken_stage_destroy(context, &_module->tokens);
+    __np_aaatoken_stage_destroy(context, &_module->handshakes);
+
+    TSP_SCOPE(_module->recent_handshakes) {
+      _np_dedup_free(_module->recent_handshakes);
+    }
+    TSP_DESTROY(_module->recent_handshakes);
+
+    np_module_free(aaatoken);
+  }
+}
+
 np_dhkey_t _np_aaatoken_get_issuer(np_aaatoken_t *self) {
   np_dhkey_t ret = np_dhkey_create_from_hash(self->issuer);
   return ret;
@@ -612,6 +1042,18 @@ void np_aaatoken_set_partner_fp(np_aaatoken_t *self, np_dhkey_t partner_fp) {
   _np_aaatoken_update_attributes_signature(self);
 }
 
+enum np_data_return _np_aaatoken_get_data(np_aaatoken_t       *self,
+                                          const char          *key,
+                                          struct np_data_conf *out_data_config,
+                                          np_data_value       *out_data) {
+  assert(self != NULL);
+  return np_get_data_indexed(&self->attributes_index,
+                             self->attributes,
+                             key,
+                             out_data_config,
+                             out_data);
+}
+
 np_dhkey_t np_aaatoken_get_partner_fp(np_aaatoken_t *self) {
   assert(self != NULL);
   np_state_t *context = np_ctx_by_memory(self);
@@ -621,7 +1063,7 @@ np_dhkey_t np_aaatoken_get_partner_fp(np_aaatoken_t *self) {
   struct np_data_conf conf;
   np_data_value       val;
   enum np_data_return r =
-      np_get_data(self->attributes, "_np.partner_fp", &conf, &val);
+      _np_aaatoken_get_data(self, "_np.partner_fp", &conf, &val);
 
   ASSERT(r == np_ok || r == np_key_not_found,
          "token (%8s): \"_np.partner_fp\" extraction error %" PRIu32,
@@ -764,6 +1206,9 @@ void _np_aaatoken_update_attributes_signature(np_aaatoken_t *self) {
                      "attribute signature hash is %s");
 
   free(hash);
+
+  np_data_index_build(&self->attributes_index, self->attributes);
+  self->attributes_mask_is_set = false;
 }
 
 unsigned char *__np_aaatoken_get_attributes_hash(np_aaatoken_t *self) {
@@ -957,6 +1402,8 @@ np_aaatoken_t *np_user4aaatoken(np_aaatoken_t *dest, struct np_token *src) {
   ASSERT(sizeof(dest->attributes) == sizeof(src->attributes),
          "Attribute sizes need to be compatible");
   memcpy(dest->attributes, src->attributes, sizeof(dest->attributes));
+  np_data_index_reset(&dest->attributes_index);
+  dest->attributes_mask_is_set = false;
 
   ASSERT(sizeof(dest->attributes_signature) ==
              sizeof(src->attributes_signature),
@@ -674,6 +674,135 @@ bool _np_out_ack(np_state_t *context, np_util_event_t event) {
   return ret;
 }
 
+struct __np_ack_batch_s {
+  np_dhkey_t    to_dhkey;
+  uint16_t      count;
+  unsigned char uuids[NP_ACK_BATCH_MAX_UUIDS][NP_UUID_BYTES];
+};
+
+static void __np_axon_submit_ack(np_state_t          *context,
+                                 np_dhkey_t           to_dhkey,
+                                 const unsigned char *uuids,
+                                 uint16_t             count) {
+  np_dhkey_t ack_subject = {0};
+  np_generate_subject(&ack_subject, _NP_MSG_ACK, strnlen(_NP_MSG_ACK, 256));
+
+  np_dhkey_t ack_out_dhkey =
+      _np_msgproperty_tweaked_dhkey(OUTBOUND, ack_subject);
+
+  np_tree_t *msg_body = np_tree_create();
+  _np_message_set_response_uuids(msg_body, uuids, count);
+
+  struct np_e2e_message_s *msg_out = NULL;
+  np_new_obj(np_message_t, msg_out);
+  _np_message_create(msg_out,
+                     to_dhkey,
+                     context->my_node_key->dhkey,
+                     ack_subject,
+                     msg_body);
+  log_debug(LOG_MESSAGE,
+            msg_out->uuid,
+            "ack of %" PRIu16 " message(s)",
+            count);
+
+  np_util_event_t ack_event = {.type         = evt_message | evt_internal,
+                               .target_dhkey = ack_out_dhkey,
+                               .user_data    = msg_out};
+  np_jobqueue_submit_event(context,
+                           0.0,
+                           ack_out_dhkey,
+                           ack_event,
+                           "event: ack out");
+  np_tree_free(msg_body);
+  np_unref_obj(np_message_t, msg_out, ref_obj_creation);
+}
+
+void _np_axon_send_ack(np_state_t          *context,
+                       np_dhkey_t           to_dhkey,
+                       const unsigned char *uuid,
+                       bool                 use_batch) {
+  np_dhkey_t ack_subject = {0};
+  np_generate_subject(&ack_subject, _NP_MSG_ACK, strnlen(_NP_MSG_ACK, 256));
+
+  np_msgproperty_run_t *ack_run = NULL;
+  if (use_batch && NP_ACK_BATCH_WINDOW > 0.0)
+    ack_run = _np_msgproperty_run_get(context, OUTBOUND, ack_subject);
+
+  if (ack_run == NULL) {
+    __np_axon_submit_ack(context, to_dhkey, uuid, 1);
+    return;
+  }
+
+  struct __np_ack_batch_s *full_batch = NULL;
+  np_spinlock_lock(&ack_run->ack_batches_lock);
+  {
+    if (ack_run->ack_batches == NULL) ack_run->ack_batches = np_tree_create();
+
+    struct __np_ack_batch_s *batch = NULL;
+    np_tree_elem_t *elem = np_tree_find_dhkey(ack_run->ack_batches, to_dhkey);
+    if (elem != NULL) {
+      batch = elem->val.value.v;
+    } else {
+      batch           = calloc(1, sizeof(struct __np_ack_batch_s));
+      batch->to_dhkey = to_dhkey;
+      np_tree_insert_dhkey(ack_run->ack_batches,
+                           to_dhkey,
+                           np_treeval_new_v(batch));
+    }
+    memcpy(batch->uuids[batch->count], uuid, NP_UUID_BYTES);
+    batch->count++;
+
+    if (batch->count == NP_ACK_BATCH_MAX_UUIDS) {
+      np_tree_del_dhkey(ack_run->ack_batches, to_dhkey);
+      full_batch = batch;
+    }
+  }
+  np_spinlock_unlock(&ack_run->ack_batches_lock);
+
+  if (full_batch != NULL) {
+    __np_axon_submit_ack(context,
+                         full_batch->to_dhkey,
+                         full_batch->uuids[0],
+                         full_batch->count);
+    free(full_batch);
+  }
+}
+
+bool _np_axon_flush_acks(np_state_t *context, NP_UNUSED np_util_event_t args) {
+  np_dhkey_t ack_subject = {0};
+  np_generate_subject(&ack_subject, _NP_MSG_ACK, strnlen(_NP_MSG_ACK, 256));
+
+  np_msgproperty_run_t *ack_run =
+      _np_msgproperty_run_get(context, OUTBOUND, ack_subject);
+  if (ack_run == NULL) return true;
+
+  // detach all pending batches, messages are created outside of the lock
+  np_tree_t *batches = NULL;
+  np_spinlock_lock(&ack_run->ack_batches_lock);
+  {
+    if (ack_run->ack_batches != NULL && ack_run->ack_batches->size > 0) {
+      batches              = ack_run->ack_batches;
+      ack_run->ack_batches = NULL;
+    }
+  }
+  np_spinlock_unlock(&ack_run->ack_batches_lock);
+
+  if (batches == NULL) return true;
+
+  np_tree_elem_t *iter = NULL;
+  RB_FOREACH (iter, np_tree_s, batches) {
+    struct __np_ack_batch_s *batch = iter->val.value.v;
+    __np_axon_submit_ack(context,
+                         batch->to_dhkey,
+                         batch->uuids[0],
+                         batch->count);
+    free(batch);
+  }
+  np_tree_free(batches);
+
+  return true;
+}
+
 bool _np_out_ping(np_state_t *context, const np_util_event_t event) {
 
   NP_CAST(event.user_data, struct np_e2e_message_s, ping_msg);
@@ -111,44 +111,12 @@ bool _check_and_send_destination_ack(np_state_t     *context,
       np_unref_obj(np_key_t, subject_key, "_np_keycache_find");
     }
 
-    np_dhkey_t ack_subject = {0};
-    np_generate_subject(&ack_subject, _NP_MSG_ACK, strnlen(_NP_MSG_ACK, 256));
-
-    np_dhkey_t ack_out_dhkey =
-        _np_msgproperty_tweaked_dhkey(OUTBOUND, ack_subject);
-
-    np_tree_t *msg_body = np_tree_create();
-    np_tree_insert_str(msg_body,
-                       _NP_MSG_INST_RESPONSE_UUID,
-                       np_treeval_new_bin(msg->uuid, NP_UUID_BYTES));
-
-    struct np_e2e_message_s *msg_out = NULL;
-    np_new_obj(np_message_t, msg_out);
-    _np_message_create(msg_out,
-                       from_dhkey,
-                       context->my_node_key->dhkey,
-                       ack_subject,
-                       msg_body);
-#ifdef DEBUG
-    char tmp[NP_UUID_BYTES * 2 + 1];
-    sodium_bin2hex(tmp, NP_UUID_BYTES * 2 + 1, msg_out->uuid, NP_UUID_BYTES);
-    log_debug(LOG_MESSAGE, msg->uuid, "ack of message with %s", tmp);
-#endif
-
-    np_util_event_t ack_event = {.type         = evt_message | evt_internal,
-                                 .target_dhkey = ack_out_dhkey,
-                                 .user_data    = msg_out};
-    np_jobqueue_submit_event(context,
-                             0.0,
-                             ack_out_dhkey,
-                             ack_event,
-                             "event: ack out");
-    // _np_event_runtime_add_event(context,
-    //                             msg_event.current_run,
-    //                             ack_out_dhkey,
-    //                             ack_event);
-    np_tree_free(msg_body);
-    np_unref_obj(np_message_t, msg_out, ref_obj_creation);
+    // hop-by-hop acks are used for the latency measurement of a node, only
+    // end-to-end acks are batched
+    _np_axon_send_ack(context,
+                      from_dhkey,
+                      (unsigned char *)msg->uuid,
+                      !_use_node_ack);
   }
   return true;
 }
@@ -306,7 +274,7 @@ bool _np_in_callback_wrapper(np_state_t *context, np_util_event_t msg_event) {
 
   ret = _np_message_decrypt_payload(msg_in, &crypto_session);
 
-  if (ret == np_ok && false == _np_message_readbody(msg_in)) {
+  if (ret == np_ok && false == _np_message_readbody_lazy(msg_in)) {
     log_debug(LOG_MESSAGE, msg_in->uuid, "couldn't read message body");
     return false;
   }
@@ -578,43 +546,46 @@ bool _np_in_ack(np_state_t *context, np_util_event_t msg_event) {
     return false;
   }
 
-  CHECK_STR_FIELD(msg->msg_body, _NP_MSG_INST_RESPONSE_UUID, ack_uuid);
+  // either a single uuid or a batch of uuids
+  uint32_t       count = 0;
+  unsigned char *ack_uuids =
+      _np_message_get_response_uuids(msg->msg_body, &count);
+  if (ack_uuids == NULL) {
+    log_warn(LOG_MESSAGE, msg->uuid, "received acknowledgement without uuid");
+    return true;
+  }
 
   np_dhkey_t ack_in_dhkey = _np_msgproperty_dhkey(INBOUND, _NP_MSG_ACK);
   np_key_t  *ack_key      = _np_keycache_find(context, ack_in_dhkey);
   NP_CAST(ack_key->entity_array[1], np_msgproperty_run_t, property);
 
-  np_tree_elem_t *response_entry =
-      np_tree_find_str(property->response_handler, ack_uuid.value.bin);
+  for (uint32_t i = 0; i < count; i++) {
+    unsigned char *ack_uuid = ack_uuids + i * NP_UUID_BYTES;
 
 #ifdef DEBUG
-  char tmp[NP_UUID_BYTES * 2 + 1];
-  sodium_bin2hex(tmp, NP_UUID_BYTES * 2 + 1, ack_uuid.value.bin, NP_UUID_BYTES);
+    char tmp[NP_UUID_BYTES * 2 + 1];
+    sodium_bin2hex(tmp, NP_UUID_BYTES * 2 + 1, ack_uuid, NP_UUID_BYTES);
 #endif
 
-  if (response_entry != NULL) {
     // just an acknowledgement of own messages send out earlier
-    NP_CAST(response_entry->val.value.v, np_responsecontainer_t, response);
-    response->received_at = np_time_now();
-
+    if (_np_msgproperty_complete_response(property, ack_uuid, msg_event)) {
 #ifdef DEBUG
-    log_info(LOG_MESSAGE, msg->uuid, "msg is acknowledgment of uuid=%s", tmp);
+      log_info(LOG_MESSAGE, msg->uuid, "msg is acknowledgment of uuid=%s", tmp);
 #endif
 
-  } else {
+    } else {
 #ifdef DEBUG
-    log_warn(LOG_MESSAGE,
-             msg->uuid,
-             "msg is acknowledgment of uuid=%s but we do not "
-             "know of this msg",
-             tmp);
+      log_warn(LOG_MESSAGE,
+               msg->uuid,
+               "msg is acknowledgment of uuid=%s but we do not "
+               "know of this msg",
+               tmp);
 #endif
+    }
   }
 
   np_unref_obj(np_key_t, ack_key, "_np_keycache_find");
 
-__np_cleanup__: {}
-
   return true;
 }
 
@@ -683,6 +654,19 @@ bool _np_in_update(np_state_t *context, np_util_event_t msg_event) {
 
 // TODO: handle both available message with the same message callback. Only
 // the msg_mode is different and depends on the message type
+// intent tokens are only decoded here, their signatures are checked by the
+// batch verification stage (see _np_aaatoken_verify_submit)
+static np_aaatoken_t *__np_in_decode_intent(np_state_t *context,
+                                            np_tree_t  *tree) {
+  np_aaatoken_t *ret = NULL;
+  np_new_obj(np_aaatoken_t, ret, FUNC);
+  if (!np_aaatoken_decode(tree, ret) || strnlen(ret->subject, 255) < 2) {
+    np_unref_obj(np_aaatoken_t, ret, FUNC);
+    ret = NULL;
+  }
+  return ret;
+}
+
 bool _np_in_available_sender(np_state_t *context, np_util_event_t msg_event) {
 
   NP_CAST(msg_event.user_data, struct np_e2e_message_s, available_msg_in);
@@ -704,8 +688,7 @@ bool _np_in_available_sender(np_state_t *context, np_util_event_t msg_event) {
     log_warn(LOG_ROUTING, available_msg_in->uuid, "received no sender token");
     return true;
   }
-  msg_token = np_token_factory_read_from_tree(context,
-                                              intent_token_ele->val.value.tree);
+  msg_token = __np_in_decode_intent(context, intent_token_ele->val.value.tree);
   if (msg_token) {
     // TODO: cross check with message header subject field: dhkey has to
     // match the subject in the token
@@ -717,11 +700,15 @@ bool _np_in_available_sender(np_state_t *context, np_util_event_t msg_event) {
     np_util_event_t authz_event = {.type =
                                        (evt_token | evt_external | evt_authz),
                                    .user_data    = msg_token,
-                                   .target_dhkey = available_msg_type};
-    _np_event_runtime_add_event(context,
-                                msg_event.current_run,
-                                available_msg_type,
-                                authz_event);
+                                   .target_dhkey = available_msg_type,
+                                   .current_run  = msg_event.current_run};
+    // bursts of intent tokens are verified in batches before they reach the
+    // msgproperty
+    _np_aaatoken_verify_submit(context,
+                               msg_token,
+                               np_aaatoken_type_message_intent,
+                               authz_event,
+                               NULL);
 
 #ifdef DEBUG
     char uuid_hex[2 * NP_UUID_BYTES + 1];
@@ -734,7 +721,7 @@ bool _np_in_available_sender(np_state_t *context, np_util_event_t msg_event) {
               "received sender token (%8s)",
               uuid_hex);
 #endif
-    np_unref_obj(np_aaatoken_t, msg_token, "np_token_factory_read_from_tree");
+    np_unref_obj(np_aaatoken_t, msg_token, "__np_in_decode_intent");
   } else {
     log_warn(LOG_ROUTING, available_msg_in->uuid, "received no sender token");
   }
@@ -756,8 +743,7 @@ bool _np_in_available_receiver(np_state_t *context, np_util_event_t msg_event) {
   np_message_intent_public_token_t *msg_token = NULL;
   np_tree_elem_t                   *intent_token_ele =
       np_tree_find_str(available_msg_in->msg_body, _NP_URN_INTENT_PREFIX);
-  msg_token = np_token_factory_read_from_tree(context,
-                                              intent_token_ele->val.value.tree);
+  msg_token = __np_in_decode_intent(context, intent_token_ele->val.value.tree);
   if (msg_token) {
     // TODO: cross check with message header subject field: dhkey has to
     // match the subject in the token
@@ -769,11 +755,15 @@ bool _np_in_available_receiver(np_state_t *context, np_util_event_t msg_event) {
     np_util_event_t authz_event = {.type =
                                        (evt_token | evt_external | evt_authz),
                                    .user_data    = msg_token,
-                                   .target_dhkey = available_msg_type};
-    _np_event_runtime_add_event(context,
-                                msg_event.current_run,
-                                available_msg_type,
-                                authz_event);
+                                   .target_dhkey = available_msg_type,
+                                   .current_run  = msg_event.current_run};
+    // bursts of intent tokens are verified in batches before they reach the
+    // msgproperty
+    _np_aaatoken_verify_submit(context,
+                               msg_token,
+                               np_aaatoken_type_message_intent,
+                               authz_event,
+                               NULL);
 #ifdef DEBUG
     char uuid_hex[2 * NP_UUID_BYTES + 1];
     sodium_bin2hex(uuid_hex,
@@ -785,7 +775,7 @@ bool _np_in_available_receiver(np_state_t *context, np_util_event_t msg_event) {
               "received receiver token (%8s)",
               uuid_hex);
 #endif
-    np_unref_obj(np_aaatoken_t, msg_token, "np_token_factory_read_from_tree");
+    np_unref_obj(np_aaatoken_t, msg_token, "__np_in_decode_intent");
 
   } else {
     log_warn(LOG_ROUTING, available_msg_in->uuid, "received no receiver token");
@@ -934,48 +924,35 @@ bool _np_in_pheromone(np_state_t *context, np_util_event_t msg_event) {
   return true;
 }
 
-bool _np_in_handshake(np_state_t *context, np_util_event_t msg_event) {
+bool __np_in_handshake_verified(np_state_t     *context,
+                                np_util_event_t hs_event) {
 
-  NP_CAST(msg_event.user_data, struct np_e2e_message_s, msg);
+  NP_CAST(hs_event.user_data, np_handshake_token_t, handshake_token);
 
-  np_handshake_token_t *handshake_token = NULL;
-  np_key_t             *msg_source_key  = NULL;
-  np_key_t             *hs_wildcard_key = NULL;
-  np_key_t             *hs_alias_key    = NULL;
+  np_key_t *msg_source_key  = NULL;
+  np_key_t *hs_wildcard_key = NULL;
+  np_key_t *hs_alias_key    = NULL;
 
-  np_tree_elem_t *hs_token_ele =
-      np_tree_find_str(msg->msg_body, _NP_URN_HANDSHAKE_PREFIX);
-  handshake_token =
-      np_token_factory_read_from_tree(context, hs_token_ele->val.value.tree);
-
-  if (handshake_token == NULL ||
-      !_np_aaatoken_is_valid(context,
-                             handshake_token,
-                             np_aaatoken_type_handshake)) {
-    log_msg(LOG_ERROR, msg->uuid, "incorrect handshake signature in message");
-    goto __np_cleanup__;
-  } else {
-    log_debug(LOG_HANDSHAKE,
-              msg->uuid,
-              "decoding of handshake message from %s / %s (i:%f/e:%f) complete",
-              handshake_token->subject,
-              handshake_token->issuer,
-              handshake_token->issued_at,
-              handshake_token->expires_at);
-  }
+  log_debug(LOG_HANDSHAKE,
+            handshake_token->uuid,
+            "decoding of handshake message from %s / %s (i:%f/e:%f) complete",
+            handshake_token->subject,
+            handshake_token->issuer,
+            handshake_token->issued_at,
+            handshake_token->expires_at);
+
+  // the handshake event is sent towards the alias key of the sender
+  np_dhkey_t alias_dhkey = hs_event.target_dhkey;
 
   // store the handshake data in the node cache,
   np_dhkey_t search_dhkey = np_dhkey_create_from_hash(handshake_token->issuer);
   msg_source_key          = _np_keycache_find_or_create(context, search_dhkey);
   if (NULL == msg_source_key) { // should never happen
-    log_msg(LOG_ERROR, msg->uuid, "handshake key is NULL!");
-    goto __np_cleanup__;
+    log_msg(LOG_ERROR, handshake_token->uuid, "handshake key is NULL!");
+    return false;
   }
 
   // setup sending encryption
-  np_util_event_t hs_event = msg_event;
-  hs_event.user_data       = handshake_token;
-  hs_event.type            = (evt_external | evt_token);
   /*
   Sollte eigentlich _np_event_runtime_add_event sein,
   aber der folgende code muss dann in eine cleanup methode
@@ -984,24 +961,23 @@ bool _np_in_handshake(np_state_t *context, np_util_event_t msg_event) {
   _np_event_runtime_start_with_event(context, search_dhkey, hs_event);
 
   log_debug(LOG_HANDSHAKE,
-            msg->uuid,
+            handshake_token->uuid,
             "Update node key done! %p",
             msg_source_key);
 
   // network init could have failed
   if (FLAG_CMP(msg_source_key->type, np_key_type_node)) {
     // setup inbound decryption session with the alias key
-    hs_alias_key = _np_keycache_find_or_create(context, msg_event.target_dhkey);
+    hs_alias_key = _np_keycache_find_or_create(context, alias_dhkey);
     hs_alias_key->parent_dhkey = msg_source_key->dhkey;
 
-    hs_event.type = (evt_external | evt_token);
     _np_event_runtime_add_event(context,
-                                msg_event.current_run,
+                                hs_event.current_run,
                                 hs_alias_key->dhkey,
                                 hs_event);
 
     log_trace_msg(LOG_HANDSHAKE,
-                  msg->uuid,
+                  handshake_token->uuid,
                   "Update alias key done! %p",
                   hs_alias_key);
     np_unref_obj(np_key_t, hs_alias_key, "_np_keycache_find_or_create");
@@ -1016,24 +992,61 @@ bool _np_in_handshake(np_state_t *context, np_util_event_t msg_event) {
     if (NULL != hs_wildcard_key) {
       hs_wildcard_key->parent_dhkey = msg_source_key->dhkey;
 
-      np_util_event_t hs_event = msg_event;
-      hs_event.type            = (evt_external | evt_token);
-      hs_event.user_data       = handshake_token;
       _np_event_runtime_add_event(context,
-                                  msg_event.current_run,
+                                  hs_event.current_run,
                                   hs_wildcard_key->dhkey,
                                   hs_event);
       np_unref_obj(np_key_t, hs_wildcard_key, "_np_keycache_find");
 
-      log_trace_msg(LOG_TRACE, msg->uuid, "Update wildcard key done!");
+      log_trace_msg(LOG_TRACE,
+                    handshake_token->uuid,
+                    "Update wildcard key done!");
     }
   }
 
-__np_cleanup__:
-  np_unref_obj(np_aaatoken_t,
-               handshake_token,
-               "np_token_factory_read_from_tree");
   np_unref_obj(np_key_t, msg_source_key, "_np_keycache_find_or_create");
 
   return true;
 }
+
+bool _np_in_handshake(np_state_t *context, np_util_event_t msg_event) {
+
+  NP_CAST(msg_event.user_data, struct np_e2e_message_s, msg);
+
+  np_handshake_token_t *handshake_token = NULL;
+
+  np_tree_elem_t *hs_token_ele =
+      np_tree_find_str(msg->msg_body, _NP_URN_HANDSHAKE_PREFIX);
+  if (hs_token_ele == NULL) {
+    log_msg(LOG_ERROR, msg->uuid, "no handshake token in message");
+    return true;
+  }
+
+  // only decode the token here, the handshake stage rejects duplicates and
+  // expired tokens before the signature is checked
+  np_new_obj(np_aaatoken_t, handshake_token, FUNC);
+  if (!np_aaatoken_decode(hs_token_ele->val.value.tree, handshake_token)) {
+    log_msg(LOG_ERROR, msg->uuid, "could not decode handshake token");
+    np_unref_obj(np_aaatoken_t, handshake_token, FUNC);
+    return true;
+  }
+
+  // signature checks of handshake bursts (i.e. after a restart of a cluster)
+  // are done in batches, the key updates continue once the token is verified
+  np_util_event_t hs_event = msg_event;
+  hs_event.user_data       = handshake_token;
+  hs_event.type            = (evt_external | evt_token);
+  if (!_np_aaatoken_verify_handshake(context,
+                                     handshake_token,
+                                     hs_event,
+                                     __np_in_handshake_verified)) {
+    log_debug(LOG_HANDSHAKE,
+              msg->uuid,
+              "handshake from %s has been rejected",
+              handshake_token->issuer);
+  }
+
+  np_unref_obj(np_aaatoken_t, handshake_token, FUNC);
+
+  return true;
+}
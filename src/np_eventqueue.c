@@ -49,6 +49,8 @@ enum { np_event_runtime_max_size = 255 };
 struct np_event_runtime_s {
   np_util_event_t  __chained_events[np_event_runtime_max_size];
   volatile uint8_t __chained_events_size;
+  // the caller waits for the key state, events are not left in key mailboxes
+  bool __synchronous;
 };
 /**
  * @brief Adds an event to a given event chain to be executed after the current
@@ -148,17 +150,35 @@ void __np_event_runtime_add_event(np_state_t         *context,
   runtime->__chained_events_size++;
 }
 /**
- * @brief Starts a synchronus executed event chain.
+ * @brief Checks whether an event chain can take further events.
  *
- * @param[in] context The application Context to work in.
- * @param[in] dhkey   The target key for the event
- * @param[in] event   The event configuration itself
+ * @param[in] runtime The event chain, NULL if no chain is running.
+ * @param[in] reserve The number of slots that have to remain free.
  */
-void __np_event_runtime_start_with_event(np_state_t     *context,
-                                         np_dhkey_t      dhkey,
-                                         np_util_event_t event,
-                                         char           *source) {
+bool _np_event_runtime_has_capacity(np_event_runtime_t *runtime,
+                                    uint8_t             reserve) {
+  if (runtime == NULL) return true;
+  return (runtime->__chained_events_size + reserve) < np_event_runtime_max_size;
+}
+
+/**
+ * @brief Checks whether the caller of an event chain relies on the key state
+ * once the chain returns.
+ *
+ * @param[in] runtime The event chain, NULL if no chain is running.
+ */
+bool _np_event_runtime_is_synchronous(np_event_runtime_t *runtime) {
+  if (runtime == NULL) return true;
+  return runtime->__synchronous;
+}
+
+static void __np_event_runtime_run(np_state_t     *context,
+                                   np_dhkey_t      dhkey,
+                                   np_util_event_t event,
+                                   char           *source,
+                                   bool            synchronous) {
   np_event_runtime_t _run = {0};
+  _run.__synchronous      = synchronous;
 
   unsigned char  run_id[NP_UUID_BYTES];
   unsigned char *run_id2 = &run_id[0];
@@ -219,3 +239,32 @@ void __np_event_runtime_start_with_event(np_state_t     *context,
             chained_events_idx,
             (chained_events_idx / (np_event_runtime_max_size + .0)) * 100);
 }
+
+/**
+ * @brief Starts a synchronus executed event chain.
+ *
+ * @param[in] context The application Context to work in.
+ * @param[in] dhkey   The target key for the event
+ * @param[in] event   The event configuration itself
+ */
+void __np_event_runtime_start_with_event(np_state_t     *context,
+                                         np_dhkey_t      dhkey,
+                                         np_util_event_t event,
+                                         char           *source) {
+  __np_event_runtime_run(context, dhkey, event, source, true);
+}
+
+/**
+ * @brief Starts the event chain of a job. Events for keys that are handled by
+ * another thread are left in the mailbox of the key.
+ *
+ * @param[in] context The application Context to work in.
+ * @param[in] dhkey   The target key for the event
+ * @param[in] event   The event configuration itself
+ */
+void __np_event_runtime_start_with_job_event(np_state_t     *context,
+                                             np_dhkey_t      dhkey,
+                                             np_util_event_t event,
+                                             char           *source) {
+  __np_event_runtime_run(context, dhkey, event, source, false);
+}
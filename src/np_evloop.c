@@ -50,8 +50,7 @@
   ev_loop_destroy(_module->__loop_##LOOPNAME);
 
 #define __NP_EVENT_EVLOOP_INIT(LOOPNAME)                                       \
-  np_module(events)->__loop_##LOOPNAME =                                       \
-      ev_loop_new(EVFLAG_AUTO | EVFLAG_FORKCHECK);                             \
+  np_module(events)->__loop_##LOOPNAME = __np_event_loop_new(context);        \
   if (np_module(events)->__loop_##LOOPNAME == false) {                         \
     ABORT("ERROR: cannot init " #LOOPNAME " event loop");                      \
   }                                                                            \
@@ -161,6 +160,13 @@
     }                                                                          \
   }
 
+// additional inbound loops, the first inbound loop is always __loop_in
+struct __np_event_in_shard_s {
+  struct ev_loop *loop;
+  ev_async        async;
+  np_mutex_t      lock;
+};
+
 np_module_struct(events) {
   np_state_t *context;
 
@@ -168,6 +174,10 @@ np_module_struct(events) {
   __NP_EVENT_EVLOOP_STRUCTS(out);
   __NP_EVENT_EVLOOP_STRUCTS(http);
   __NP_EVENT_EVLOOP_STRUCTS(file);
+
+  uint8_t                      __in_count;
+  struct __np_event_in_shard_s __in_shard[NP_EVENT_IN_LOOPS_MAX];
+  TSP(uint8_t, __in_claimed);
 };
 
 __NP_EVENT_LOOP_FNs(in);
@@ -175,10 +185,175 @@ __NP_EVENT_LOOP_FNs(out);
 __NP_EVENT_LOOP_FNs(http);
 __NP_EVENT_LOOP_FNs(file);
 
+static unsigned int __np_event_backend_flag(enum np_event_backend backend) {
+  switch (backend) {
+  case np_event_backend_epoll:
+    return EVBACKEND_EPOLL;
+  case np_event_backend_iouring:
+    return EVBACKEND_IOURING;
+  case np_event_backend_poll:
+    return EVBACKEND_POLL;
+  case np_event_backend_select:
+    return EVBACKEND_SELECT;
+  default:
+    return 0;
+  }
+}
+
+static struct ev_loop *__np_event_loop_new(np_state_t *context) {
+  struct ev_loop *ret = NULL;
+  unsigned int    backend =
+      __np_event_backend_flag(context->settings->event_backend);
+
+  if (backend != 0 && (ev_supported_backends() & backend) == 0) {
+    log_msg(LOG_WARNING,
+            NULL,
+            "event backend %d not supported, using default backend",
+            context->settings->event_backend);
+    backend = 0;
+  }
+  if (backend != 0) {
+    // io_uring may still be refused at runtime (e.g. by seccomp or memlock
+    // limits), fall back to the default backend in this case
+    ret = ev_loop_new(backend | EVFLAG_FORKCHECK);
+  }
+  if (ret == NULL) {
+    ret = ev_loop_new(EVFLAG_AUTO | EVFLAG_FORKCHECK);
+  }
+  return ret;
+}
+
 void async_cb(EV_P_ NP_UNUSED ev_async *w, NP_UNUSED int revents) {
   /* just used for the side effects */
 }
 
+uint8_t _np_event_in_loops_for_pool(uint8_t pool_size) {
+  // mirrors np_threads_start_workers: the threads above the worker threads
+  // drive the in, out and file loop, any further thread gets its own inbound
+  // loop
+  uint8_t worker_threads = ((int)pool_size / 2) + 1;
+  uint8_t io_threads =
+      (pool_size > worker_threads) ? pool_size - worker_threads : 0;
+  uint8_t in_loops = (io_threads > 3) ? io_threads - 2 : 1;
+
+  return MIN(in_loops, NP_EVENT_IN_LOOPS_MAX);
+}
+
+static struct __np_event_in_shard_s *
+__np_event_in_shard_of(np_state_t *context, struct ev_loop *loop) {
+  for (uint8_t i = 1; i < np_module(events)->__in_count; i++) {
+    if (np_module(events)->__in_shard[i].loop == loop)
+      return &np_module(events)->__in_shard[i];
+  }
+  return NULL;
+}
+
+static void _l_acquire_in_shard(EV_P) {
+  np_state_t                   *context = ev_userdata(EV_A);
+  struct __np_event_in_shard_s *shard   = __np_event_in_shard_of(context, loop);
+  _np_threads_mutex_lock(context, &shard->lock, FUNC);
+}
+
+static void _l_release_in_shard(EV_P) {
+  np_state_t                   *context = ev_userdata(EV_A);
+  struct __np_event_in_shard_s *shard   = __np_event_in_shard_of(context, loop);
+  _np_threads_mutex_unlock(context, &shard->lock);
+  if (np_get_status(context) >= np_shutdown) {
+    ev_break(EV_A_ EVBREAK_ALL);
+  }
+}
+
+uint8_t _np_event_in_loop_count(np_state_t *context) {
+  return np_module(events)->__in_count;
+}
+
+uint8_t _np_event_in_loop_select(np_state_t *context, np_dhkey_t flow) {
+  // the same flow is always read on the same inbound loop
+  return flow.t[0] % np_module(events)->__in_count;
+}
+
+struct ev_loop *_np_event_get_loop_in_shard(np_state_t *context,
+                                            uint8_t     shard) {
+  if (shard == 0 || shard >= np_module(events)->__in_count)
+    return _np_event_get_loop_in(context);
+  return np_module(events)->__in_shard[shard].loop;
+}
+
+void _np_event_suspend_loop_in_shard(np_state_t *context, uint8_t shard) {
+  if (shard == 0 || shard >= np_module(events)->__in_count)
+    _np_event_suspend_loop_in(context);
+  else
+    _np_threads_mutex_lock(context,
+                           &np_module(events)->__in_shard[shard].lock,
+                           FUNC);
+}
+
+void _np_event_resume_loop_in_shard(np_state_t *context, uint8_t shard) {
+  if (shard == 0 || shard >= np_module(events)->__in_count)
+    _np_event_resume_loop_in(context);
+  else
+    _np_threads_mutex_unlock(context,
+                             &np_module(events)->__in_shard[shard].lock);
+}
+
+void _np_event_reconfigure_loop_in_shard(np_state_t *context, uint8_t shard) {
+  if (shard == 0 || shard >= np_module(events)->__in_count)
+    _np_event_reconfigure_loop_in(context);
+  else
+    ev_async_send(np_module(events)->__in_shard[shard].loop,
+                  &np_module(events)->__in_shard[shard].async);
+}
+
+void _np_event_in_shard_run(np_state_t *context, np_thread_t *thread) {
+  uint8_t shard = 0;
+  TSP_SCOPE(np_module(events)->__in_claimed) {
+    shard = ++np_module(events)->__in_claimed;
+  }
+  if (shard >= np_module(events)->__in_count) {
+    log_msg(LOG_WARNING,
+            NULL,
+            "thread %" PRIsizet " has no inbound event loop to run",
+            thread->id);
+    return;
+  }
+
+  struct __np_event_in_shard_s *in_shard =
+      &np_module(events)->__in_shard[shard];
+  _np_threads_mutex_lock(context, &in_shard->lock, FUNC);
+  ev_run(in_shard->loop, 0);
+  _np_threads_mutex_unlock(context, &in_shard->lock);
+}
+
+static void __np_event_in_shards_init(np_state_t *context) {
+  np_module(events)->__in_count =
+      _np_event_in_loops_for_pool(context->settings->n_threads);
+  TSP_INITD(np_module(events)->__in_claimed, 0);
+
+  for (uint8_t i = 1; i < np_module(events)->__in_count; i++) {
+    struct __np_event_in_shard_s *shard = &np_module(events)->__in_shard[i];
+
+    shard->loop = __np_event_loop_new(context);
+    if (shard->loop == NULL) {
+      ABORT("ERROR: cannot init inbound event loop %" PRIu8, i);
+    }
+    _np_threads_mutex_init(context, &shard->lock, "np_event_in_shard_lock");
+    ev_async_init(&shard->async, async_cb);
+    ev_async_start(shard->loop, &shard->async);
+    ev_set_userdata(shard->loop, context);
+    ev_set_loop_release_cb(shard->loop,
+                           _l_release_in_shard,
+                           _l_acquire_in_shard);
+  }
+}
+
+static void __np_event_in_shards_destroy(np_state_t *context) {
+  for (uint8_t i = 1; i < np_module(events)->__in_count; i++) {
+    ev_loop_destroy(np_module(events)->__in_shard[i].loop);
+    _np_threads_mutex_destroy(context, &np_module(events)->__in_shard[i].lock);
+  }
+  TSP_DESTROY(np_module(events)->__in_claimed);
+}
+
 bool _np_event_init(np_state_t *context) {
   bool ret = false;
   if (!np_module_initiated(events)) {
@@ -187,6 +362,7 @@ bool _np_event_init(np_state_t *context) {
     __NP_EVENT_EVLOOP_INIT(out);
     __NP_EVENT_EVLOOP_INIT(http);
     __NP_EVENT_EVLOOP_INIT(file);
+    __np_event_in_shards_init(context);
     ret = true;
   }
   return ret;
@@ -195,6 +371,7 @@ bool _np_event_init(np_state_t *context) {
 void _np_event_destroy(np_state_t *context) {
   if (np_module_initiated(events)) {
     np_module_var(events);
+    __np_event_in_shards_destroy(context);
     __NP_EVENT_EVLOOP_DEINIT(in);
     __NP_EVENT_EVLOOP_DEINIT(out);
     __NP_EVENT_EVLOOP_DEINIT(http);
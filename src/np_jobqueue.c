@@ -26,6 +26,7 @@
 #include "util/np_heap.h"
 #include "util/np_list.h"
 
+#include "np_axon.h"
 #include "np_constants.h"
 #include "np_eventqueue.h"
 #include "np_key.h"
@@ -360,6 +361,14 @@ bool _np_jobqueue_init(np_state_t *context) {
                                       MISC_KEYCACHE_CLEANUP_INTERVAL_SEC,
                                       _np_keycache_exists_state,
                                       "_np_keycache_exists_state");
+    if (NP_ACK_BATCH_WINDOW > 0.0) {
+      np_jobqueue_submit_event_periodic(context,
+                                        NP_PRIORITY_HIGH,
+                                        NP_ACK_BATCH_WINDOW,
+                                        NP_ACK_BATCH_WINDOW,
+                                        _np_axon_flush_acks,
+                                        "_np_axon_flush_acks");
+    }
   }
   return (true);
 }
@@ -774,9 +783,9 @@ void __np_jobqueue_run_once(np_state_t *context, np_job_t job_to_execute) {
     }
 #endif
 
-    _np_event_runtime_start_with_event(context,
-                                       job_to_execute.next,
-                                       job_to_execute.evt);
+    _np_event_runtime_start_with_job_event(context,
+                                           job_to_execute.next,
+                                           job_to_execute.evt);
 
 #ifdef DEBUG_CALLBACKS
     double                  n2 = np_time_now() - n1;
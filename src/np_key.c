@@ -30,6 +30,7 @@
 #include "util/np_treeval.h"
 
 #include "np_constants.h"
+#include "np_eventqueue.h"
 #include "np_jobqueue.h"
 #include "np_keycache.h"
 #include "np_legacy.h"
@@ -41,6 +42,8 @@
 
 _NP_GENERATE_MEMORY_IMPLEMENTATION(np_key_t);
 
+static const char _np_ref_key_mailbox[] = "_np_key_mailbox";
+
 NP_SLL_GENERATE_IMPLEMENTATION_COMPARATOR(void_ptr);
 NP_SLL_GENERATE_IMPLEMENTATION(void_ptr);
 
@@ -157,6 +160,10 @@ void __add_transitions_for(const np_key_t  *my_key,
   }
 }
 
+static uint8_t __np_key_event_data_type(const np_util_event_t event) {
+  return np_memory_get_type(event.user_data);
+}
+
 void __np_key_populate_states(np_key_t *key) {
   np_ctx_memory(key);
 
@@ -215,21 +222,25 @@ void __np_key_populate_states(np_key_t *key) {
         states, IN_SETUP_ALIAS, "IN_SETUP_ALIAS",
         __keystate_noop, __np_create_session, __keystate_noop); 
     // decrypt transport encryption
-    NP_UTIL_STATEMACHINE_TRANSITION(
+    NP_UTIL_STATEMACHINE_TRANSITION_ON(
         states, IN_SETUP_ALIAS, IN_SETUP_ALIAS,
-        __np_alias_decrypt, __is_crypted_message);
+        __np_alias_decrypt, __is_crypted_message,
+        evt_message | evt_external, np_memory_types_BLOB_1024);
     // join and leave message are allowed
-    NP_UTIL_STATEMACHINE_TRANSITION(
+    NP_UTIL_STATEMACHINE_TRANSITION_ON(
         states, IN_SETUP_ALIAS, IN_SETUP_ALIAS,
-        __np_handle_np_message, __is_join_in_message);
+        __np_handle_np_message, __is_join_in_message,
+        evt_message | evt_external, np_memory_types_np_messagepart_t);
     // only here for state transition
-    NP_UTIL_STATEMACHINE_TRANSITION(
+    NP_UTIL_STATEMACHINE_TRANSITION_ON(
         states, IN_SETUP_ALIAS, IN_SETUP_ALIAS,
-        __np_node_update_token, __is_node_token); 
+        __np_node_update_token, __is_node_token,
+        evt_token | evt_external, np_memory_types_np_aaatoken_t); 
     // only here for state transition
-    NP_UTIL_STATEMACHINE_TRANSITION(
+    NP_UTIL_STATEMACHINE_TRANSITION_ON(
         states, IN_SETUP_ALIAS, IN_USE_ALIAS,
-        __np_node_upgrade, __is_node_authn); 
+        __np_node_upgrade, __is_node_authn,
+        evt_internal | evt_token | evt_authn, np_memory_types_np_aaatoken_t); 
     // node has left, invalidate node
     NP_UTIL_STATEMACHINE_TRANSITION(
         states, IN_SETUP_ALIAS, IN_DESTROY,
@@ -240,41 +251,50 @@ void __np_key_populate_states(np_key_t *key) {
         states, IN_SETUP_NODE, "IN_SETUP_NODE",
         __keystate_noop, __np_create_client_network, __keystate_noop);
     // send handshake message to remote side
-    NP_UTIL_STATEMACHINE_TRANSITION(
+    NP_UTIL_STATEMACHINE_TRANSITION_ON(
         states, IN_SETUP_NODE, IN_SETUP_NODE,
-        __np_node_send_direct, __is_handshake_message); 
+        __np_node_send_direct, __is_handshake_message,
+        evt_internal | evt_message, np_memory_types_np_messagepart_t); 
     // received authn information (eventually through identity join)
-    NP_UTIL_STATEMACHINE_TRANSITION(
+    NP_UTIL_STATEMACHINE_TRANSITION_ON(
         states, IN_SETUP_NODE, IN_SETUP_NODE,
-        __np_node_send_encrypted, __is_join_out_message); 
+        __np_node_send_encrypted, __is_join_out_message,
+        evt_internal | evt_message, np_memory_types_np_messagepart_t); 
      // received authn information (eventually through identity join)
-    NP_UTIL_STATEMACHINE_TRANSITION(
+    NP_UTIL_STATEMACHINE_TRANSITION_ON(
         states, IN_SETUP_NODE, IN_SETUP_NODE,
-        __np_node_discard_message, __is_invalid_message);
+        __np_node_discard_message, __is_invalid_message,
+        evt_internal | evt_message, np_memory_types_np_messagepart_t);
     // received a full message which needs to be chunked
-    NP_UTIL_STATEMACHINE_TRANSITION(
+    NP_UTIL_STATEMACHINE_TRANSITION_ON(
         states, IN_SETUP_NODE, IN_SETUP_NODE,
-        __np_node_split_message, __is_np_message); 
+        __np_node_split_message, __is_np_message,
+        evt_internal | evt_message, np_memory_types_np_message_t); 
     // received handshake token (from other node)
-    NP_UTIL_STATEMACHINE_TRANSITION(
+    NP_UTIL_STATEMACHINE_TRANSITION_ON(
         states, IN_SETUP_NODE, IN_SETUP_NODE,
-        __np_node_update_token, __is_node_handshake_token); 
+        __np_node_update_token, __is_node_handshake_token,
+        evt_token | evt_external, np_memory_types_np_aaatoken_t); 
     // received a full node token (join)
-    NP_UTIL_STATEMACHINE_TRANSITION(
+    NP_UTIL_STATEMACHINE_TRANSITION_ON(
         states, IN_SETUP_NODE, IN_SETUP_NODE,
-        __np_node_update_token, __is_node_token); 
+        __np_node_update_token, __is_node_token,
+        evt_token | evt_external, np_memory_types_np_aaatoken_t); 
     // received authn information (eventually through identity join)
-    NP_UTIL_STATEMACHINE_TRANSITION(
+    NP_UTIL_STATEMACHINE_TRANSITION_ON(
         states, IN_SETUP_NODE, IN_USE_NODE,
-        __np_node_identity_upgrade, __is_node_identity_authn); 
+        __np_node_identity_upgrade, __is_node_identity_authn,
+        evt_internal | evt_token | evt_authn, np_memory_types_np_aaatoken_t); 
     // received authn information (eventually through identity join)
-    NP_UTIL_STATEMACHINE_TRANSITION(
+    NP_UTIL_STATEMACHINE_TRANSITION_ON(
         states, IN_SETUP_NODE, IN_USE_NODE,
-        __np_node_upgrade, __is_node_authn); 
+        __np_node_upgrade, __is_node_authn,
+        evt_internal | evt_token | evt_authn, np_memory_types_np_aaatoken_t); 
     // node is told to shutdown (i.e. authn failed)
-    NP_UTIL_STATEMACHINE_TRANSITION(
+    NP_UTIL_STATEMACHINE_TRANSITION_ON(
         states, IN_SETUP_NODE, IN_DESTROY,
-        __np_node_destroy, __is_shutdown_event); 
+        __np_node_destroy, __is_shutdown_event,
+        evt_shutdown, 0); 
     // node is not used anymore
     NP_UTIL_STATEMACHINE_TRANSITION(
         states, IN_SETUP_NODE, IN_DESTROY, 
@@ -323,41 +343,49 @@ void __np_key_populate_states(np_key_t *key) {
         states, IN_USE_ALIAS, "IN_USE_ALIAS",
         __keystate_noop, __keystate_noop, __keystate_noop);
     // decrypt transport encryption
-    NP_UTIL_STATEMACHINE_TRANSITION(
+    NP_UTIL_STATEMACHINE_TRANSITION_ON(
         states, IN_USE_ALIAS, IN_USE_ALIAS,
-        __np_alias_decrypt, __is_crypted_message); 
+        __np_alias_decrypt, __is_crypted_message,
+        evt_message | evt_external, np_memory_types_BLOB_1024); 
     // pass on to the specific message intent
-    NP_UTIL_STATEMACHINE_TRANSITION(
+    NP_UTIL_STATEMACHINE_TRANSITION_ON(
         states, IN_USE_ALIAS, IN_USE_ALIAS,
-        __np_handle_usr_msg, __is_usr_in_message);
+        __np_handle_usr_msg, __is_usr_in_message,
+        evt_message | evt_external, np_memory_types_np_messagepart_t);
     // handle dht messages (ping, piggy, leave, update, ack)
-    NP_UTIL_STATEMACHINE_TRANSITION(
+    NP_UTIL_STATEMACHINE_TRANSITION_ON(
         states, IN_USE_ALIAS, IN_USE_ALIAS,
-        __np_handle_np_message, __is_dht_message); 
+        __np_handle_np_message, __is_dht_message,
+        evt_message | evt_external, np_memory_types_np_messagepart_t); 
     // handle pheromone messages
-    NP_UTIL_STATEMACHINE_TRANSITION(
+    NP_UTIL_STATEMACHINE_TRANSITION_ON(
         states, IN_USE_ALIAS, IN_USE_ALIAS,
-        __np_handle_pheromone, __is_pheromone_message); 
+        __np_handle_pheromone, __is_pheromone_message,
+        evt_message | evt_external, np_memory_types_np_messagepart_t); 
     // handle discovery messages (sender list, discover sender, ...)
-    NP_UTIL_STATEMACHINE_TRANSITION(
+    NP_UTIL_STATEMACHINE_TRANSITION_ON(
         states, IN_USE_ALIAS, IN_USE_ALIAS,
-        __np_handle_np_discovery, __is_discovery_message); 
+        __np_handle_np_discovery, __is_discovery_message,
+        evt_message | evt_external, np_memory_types_np_messagepart_t); 
     // handle forwarding of all other messages , but fill ara routing table
-    NP_UTIL_STATEMACHINE_TRANSITION(
+    NP_UTIL_STATEMACHINE_TRANSITION_ON(
         states, IN_USE_ALIAS, IN_USE_ALIAS,
-        __np_handle_np_forward, __is_forward_message); 
+        __np_handle_np_forward, __is_forward_message,
+        evt_message | evt_external, np_memory_types_np_messagepart_t); 
     // node has left, invalidate node
     NP_UTIL_STATEMACHINE_TRANSITION(
         states, IN_USE_ALIAS, IN_DESTROY,
         __np_alias_destroy, __is_alias_invalid); 
     // node is not used anymore
-    NP_UTIL_STATEMACHINE_TRANSITION(
+    NP_UTIL_STATEMACHINE_TRANSITION_ON(
         states, IN_USE_ALIAS, IN_USE_ALIAS,
-        __np_alias_shutdown, __is_shutdown_event);
+        __np_alias_shutdown, __is_shutdown_event,
+        evt_shutdown, 0);
     // dupplicate authn event?
-    NP_UTIL_STATEMACHINE_TRANSITION(
+    NP_UTIL_STATEMACHINE_TRANSITION_ON(
         states, IN_USE_ALIAS, IN_USE_ALIAS,
-        NULL, __is_node_authn);
+        NULL, __is_node_authn,
+        evt_internal | evt_token | evt_authn, np_memory_types_np_aaatoken_t);
     // cleanup message part cache for incoming messages
     NP_UTIL_STATEMACHINE_TRANSITION(
         states, IN_USE_ALIAS, IN_USE_ALIAS,
@@ -369,21 +397,25 @@ void __np_key_populate_states(np_key_t *key) {
         states, IN_USE_NODE, "IN_USE_NODE",
         __keystate_noop, __np_node_add_to_leafset, __np_node_destroy);
     // received a single chunk (forward) message
-    NP_UTIL_STATEMACHINE_TRANSITION(
+    NP_UTIL_STATEMACHINE_TRANSITION_ON(
         states, IN_USE_NODE, IN_USE_NODE,
-        __np_node_send_encrypted, __is_np_messagepart); 
+        __np_node_send_encrypted, __is_np_messagepart,
+        evt_internal | evt_message, np_memory_types_np_messagepart_t); 
     // received a full message which needs to be chunked
-    NP_UTIL_STATEMACHINE_TRANSITION(
+    NP_UTIL_STATEMACHINE_TRANSITION_ON(
         states, IN_USE_NODE, IN_USE_NODE,
-        __np_node_split_message, __is_np_message); 
+        __np_node_split_message, __is_np_message,
+        evt_internal | evt_message, np_memory_types_np_message_t); 
     // user changed mx_properties
-    NP_UTIL_STATEMACHINE_TRANSITION(
-        states, IN_USE_NODE,IN_USE_NODE,
-        __np_node_handle_response, __is_response_event); 
+    NP_UTIL_STATEMACHINE_TRANSITION_ON(
+        states, IN_USE_NODE, IN_USE_NODE,
+        __np_node_handle_response, __is_response_event,
+        evt_response, np_memory_types_np_responsecontainer_t); 
     // node invalidated by leave message or own shutdown event
-    NP_UTIL_STATEMACHINE_TRANSITION(
+    NP_UTIL_STATEMACHINE_TRANSITION_ON(
         states, IN_USE_NODE, IN_USE_NODE,
-        __np_node_send_shutdown, __is_shutdown_event); 
+        __np_node_send_shutdown, __is_shutdown_event,
+        evt_shutdown, 0); 
     // check last ping received value, or node not in leafset/routing table
     NP_UTIL_STATEMACHINE_TRANSITION(
         states, IN_USE_NODE, IN_USE_NODE,
@@ -487,6 +519,10 @@ void __np_key_populate_states(np_key_t *key) {
 
     // clang-format on
 
+    np_util_statemachine_compile(states,
+                                 MAX_KEY_STATES,
+                                 __np_key_event_data_type,
+                                 np_memory_types_MAX_TYPE);
     population_done = true;
   }
 
@@ -521,6 +557,10 @@ void _np_key_destroy(np_key_t *to_destroy) {
 
   _np_keycache_remove(context, to_destroy->dhkey);
 
+  if (FLAG_CMP(to_destroy->type, np_key_type_subject)) {
+    _np_intent_ledger_free(to_destroy);
+  }
+
   log_debug(LOG_KEY | LOG_DEBUG,
             NULL,
             "cleanup of key and associated data structures done.");
@@ -550,6 +590,14 @@ void _np_key_t_new(np_state_t       *context,
   char mutex_str[100] = {0};
   snprintf(mutex_str, 100, "urn:np:key_lock:%s", _np_key_as_str(new_key));
   _np_threads_mutex_init(context, &new_key->key_lock, mutex_str);
+
+  TSP_INIT(new_key->mailbox);
+  new_key->mailbox.head   = NULL;
+  new_key->mailbox.tail   = NULL;
+  new_key->mailbox.size   = 0;
+  new_key->mailbox.busy   = false;
+  new_key->mailbox.pushed = 0;
+  new_key->mailbox.popped = 0;
 }
 
 void _np_key_t_del(np_state_t       *context,
@@ -565,13 +613,24 @@ void _np_key_t_del(np_state_t       *context,
 
   memset(old_key->entity_array, 0, 8 * sizeof(void_ptr));
 
+  // events that have not been handled anymore
+  struct np_key_mailbox_entry_s *entry = old_key->mailbox.head;
+  while (entry != NULL) {
+    struct np_key_mailbox_entry_s *next = entry->next;
+    if (entry->event.user_data != NULL) {
+      np_unref_obj(np_unknown_t, entry->event.user_data, _np_ref_key_mailbox);
+    }
+    free(entry);
+    entry = next;
+  }
+  TSP_DESTROY(old_key->mailbox);
+
   _np_threads_mutex_destroy(context, &old_key->key_lock);
 }
 
-void _np_key_handle_event(np_key_t *key, np_util_event_t event) {
-  assert(key != NULL);
-  np_ctx_memory(key);
-
+static void __np_key_execute_event(np_state_t     *context,
+                                   np_key_t       *key,
+                                   np_util_event_t event) {
   _LOCK_ACCESS(&key->key_lock) {
     char *old_state = key->sm._state_table[key->sm._current_state]->_state_name;
     // push down all event from queue and execute this event
@@ -607,6 +666,173 @@ void _np_key_handle_event(np_key_t *key, np_util_event_t event) {
   }
 }
 
+// appends an event to the mailbox of the key and returns its sequence number,
+// the caller holds the mailbox lock
+static uint64_t __np_key_mailbox_push(np_state_t     *context,
+                                      np_key_t       *key,
+                                      np_util_event_t event) {
+  struct np_key_mailbox_entry_s *entry = malloc(sizeof(*entry));
+  CHECK_MALLOC(entry);
+
+  // the event chain that submitted the event releases its data when it is
+  // done, keep the data alive until the event has been executed
+  if (event.user_data != NULL) {
+    np_ref_obj(np_unknown_t, event.user_data, _np_ref_key_mailbox);
+  }
+  entry->event = event;
+  entry->next  = NULL;
+
+  if (key->mailbox.tail != NULL) {
+    key->mailbox.tail->next = entry;
+  } else {
+    key->mailbox.head = entry;
+  }
+  key->mailbox.tail = entry;
+  key->mailbox.size++;
+  return key->mailbox.pushed++;
+}
+
+// removes the first event from the mailbox of the key, the caller holds the
+// mailbox lock
+static bool __np_key_mailbox_pop(np_key_t *key, np_util_event_t *event) {
+  struct np_key_mailbox_entry_s *entry = key->mailbox.head;
+  if (entry == NULL) return false;
+
+  key->mailbox.head = entry->next;
+  if (key->mailbox.head == NULL) key->mailbox.tail = NULL;
+  key->mailbox.size--;
+  key->mailbox.popped++;
+
+  *event = entry->event;
+  free(entry);
+  return true;
+}
+
+// executes the oldest event of the mailbox if its sequence number is not past
+// `until`. The caller holds the key_lock, so that events are popped and
+// executed in the same order.
+static bool __np_key_mailbox_execute_next(np_state_t         *context,
+                                          np_key_t           *key,
+                                          np_event_runtime_t *runtime,
+                                          uint64_t            until) {
+  np_util_event_t next_event;
+  uint64_t        seq      = 0;
+  bool            has_next = false;
+  TSP_SCOPE(key->mailbox) {
+    seq = key->mailbox.popped;
+    if (seq <= until) has_next = __np_key_mailbox_pop(key, &next_event);
+  }
+  if (!has_next) return false;
+
+  // events queued by other threads add their follow-up events to this chain,
+  // when it is full they start their own chain right away
+  next_event.current_run = runtime;
+  if (seq != until &&
+      !_np_event_runtime_has_capacity(runtime, NP_KEY_MAILBOX_CHAIN_RESERVE)) {
+    next_event.current_run = NULL;
+  }
+  __np_key_execute_event(context, key, next_event);
+
+  if (next_event.user_data != NULL) {
+    np_unref_obj(np_unknown_t, next_event.user_data, _np_ref_key_mailbox);
+  }
+  return true;
+}
+
+void _np_key_handle_event(np_key_t *key, np_util_event_t event) {
+  assert(key != NULL);
+  np_ctx_memory(key);
+
+  bool     synchronous = _np_event_runtime_is_synchronous(event.current_run);
+  bool     owner       = false;
+  uint64_t seq         = 0;
+  uint32_t queued      = 0;
+  TSP_SCOPE(key->mailbox) {
+    seq = __np_key_mailbox_push(context, key, event);
+    if (!synchronous && !key->mailbox.busy) {
+      owner             = true;
+      key->mailbox.busy = true;
+    }
+    queued = key->mailbox.size;
+  }
+
+  if (synchronous) {
+    // the caller inspects the key right after the event, execute the events
+    // queued before it and the event itself. The key_lock is recursive, nested
+    // events of the same thread end up here as well and keep their order.
+    _LOCK_ACCESS(&key->key_lock) {
+      while (__np_key_mailbox_execute_next(context,
+                                           key,
+                                           event.current_run,
+                                           seq))
+        ;
+    }
+    return;
+  }
+  if (!owner) {
+    log_debug(LOG_EVENT,
+              NULL,
+              "key: %s/%p event: %" PRIu32 " queued in mailbox (%" PRIu32 ")",
+              _np_key_as_str(key),
+              key,
+              event.type,
+              queued);
+    return;
+  }
+
+  // drain the mailbox including the own event, the events triggered by the
+  // queued events are appended to the event chain of this thread
+  uint16_t drained = 0;
+  bool     pending = false;
+  while (true) {
+    bool may_drain =
+        drained < NP_KEY_MAILBOX_DRAIN_MAX &&
+        _np_event_runtime_has_capacity(event.current_run,
+                                       NP_KEY_MAILBOX_CHAIN_RESERVE);
+    bool executed = false;
+    if (may_drain) {
+      _LOCK_ACCESS(&key->key_lock) {
+        executed = __np_key_mailbox_execute_next(context,
+                                                 key,
+                                                 event.current_run,
+                                                 UINT64_MAX);
+      }
+    }
+    if (executed) {
+      drained++;
+      continue;
+    }
+
+    bool released = false;
+    TSP_SCOPE(key->mailbox) {
+      pending = (key->mailbox.head != NULL);
+      if (!pending || !may_drain) {
+        key->mailbox.busy = false;
+        released          = true;
+      }
+    }
+    if (released) break;
+  }
+
+  if (pending) {
+    // hand the remaining events to the next worker thread
+    np_util_event_t noop_event = {.type         = evt_noop,
+                                  .user_data    = NULL,
+                                  .target_dhkey = key->dhkey};
+    if (!np_jobqueue_submit_event(context,
+                                  0.0,
+                                  key->dhkey,
+                                  noop_event,
+                                  "event: key mailbox")) {
+      log_warn(LOG_EVENT | LOG_JOBS,
+               NULL,
+               "key: %s/%p could not reschedule its mailbox",
+               _np_key_as_str(key),
+               key);
+    }
+  }
+}
+
 void _np_key_readonly_copy(np_state_t  *context,
                            np_key_ro_t *buffer,
                            np_key_t    *source) {
@@ -541,7 +541,7 @@ bool _np_message_deserialize_chunks(struct np_e2e_message_s *msg) {
   return true;
 }
 
-bool _np_message_readbody(struct np_e2e_message_s *msg) {
+static bool __np_message_readbody(struct np_e2e_message_s *msg, bool lazy) {
   np_ctx_memory(msg);
   bool ret = true;
 
@@ -550,8 +550,11 @@ bool _np_message_readbody(struct np_e2e_message_s *msg) {
 
   if (msg->msg_body != NULL) np_tree_free(msg->msg_body);
 
-  msg->msg_body = np_tree_create();
-  msg->state    = msgstate_raw;
+  // one arena for the whole body, released with a single np_tree_free. A lazy
+  // body is a view into binary_message and only indexes the top-level map
+  if (lazy) msg->msg_body = np_tree_create_view(0);
+  else msg->msg_body = np_tree_create_arena(msg->binary_length);
+  msg->state = msgstate_raw;
 
   np_deserialize_buffer_t body_deserializer = {
       ._target_tree = msg->msg_body,
@@ -560,7 +563,9 @@ bool _np_message_readbody(struct np_e2e_message_s *msg) {
       ._buffer_size = msg->binary_length,
       ._bytes_read  = 0,
       ._error       = 0};
-  np_serializer_read_map(context, &body_deserializer, msg->msg_body);
+  if (lazy)
+    np_serializer_read_map_lazy(context, &body_deserializer, msg->msg_body);
+  else np_serializer_read_map(context, &body_deserializer, msg->msg_body);
 
   if (body_deserializer._error != 0) {
     msg->state = msgstate_binary;
@@ -571,6 +576,14 @@ bool _np_message_readbody(struct np_e2e_message_s *msg) {
   return ret;
 }
 
+bool _np_message_readbody(struct np_e2e_message_s *msg) {
+  return __np_message_readbody(msg, false);
+}
+
+bool _np_message_readbody_lazy(struct np_e2e_message_s *msg) {
+  return __np_message_readbody(msg, true);
+}
+
 /**
  ** message_create:
  ** creates the message to the destination #dest# the message format would be
@@ -673,6 +686,13 @@ inline void _np_message_setbody(struct np_e2e_message_s *msg,
 
   assert(msg->state == msgstate_raw);
 
+  np_tree_t *detached_body = NULL;
+  if (new_body == msg->msg_body && new_body->attr.in_place == true) {
+    // a lazy body points into binary_message, which is overwritten below
+    detached_body = np_tree_clone(new_body);
+    new_body      = detached_body;
+  }
+
   size_t fixed_header_bytes = MSG_NONCE_SIZE + MSG_MAC_SIZE + MSG_HEADER_SIZE;
 
   size_t object_size = 0;
@@ -701,6 +721,7 @@ inline void _np_message_setbody(struct np_e2e_message_s *msg,
       ._bytes_written = 0,
       ._error         = 0};
   np_serializer_write_map(context, &buffer, new_body);
+  if (detached_body != NULL) np_tree_free(detached_body);
   if (buffer._error != 0) {
     return /*np_operation_failed*/;
   }
@@ -855,3 +876,40 @@ _np_message_get_sessionid(const struct np_e2e_message_s *const self) {
 
   return self->audience;
 }
+
+void _np_message_set_response_uuids(np_tree_t           *body,
+                                    const unsigned char *uuids,
+                                    uint16_t             count) {
+  // a single uuid uses the key which is understood by every node
+  if (count == 1) {
+    np_tree_insert_str(body,
+                       _NP_MSG_INST_RESPONSE_UUID,
+                       np_treeval_new_bin((void *)uuids, NP_UUID_BYTES));
+  } else {
+    np_tree_insert_str(
+        body,
+        _NP_MSG_INST_RESPONSE_UUIDS,
+        np_treeval_new_bin((void *)uuids, count * NP_UUID_BYTES));
+  }
+}
+
+unsigned char *_np_message_get_response_uuids(np_tree_t *body,
+                                              uint32_t  *count) {
+  *count = 0;
+
+  np_tree_elem_t *ack_uuids =
+      np_tree_find_str(body, _NP_MSG_INST_RESPONSE_UUIDS);
+  if (ack_uuids != NULL) {
+    if (ack_uuids->val.type != np_treeval_type_bin ||
+        ack_uuids->val.size == 0 || ack_uuids->val.size % NP_UUID_BYTES != 0)
+      return NULL;
+  } else {
+    ack_uuids = np_tree_find_str(body, _NP_MSG_INST_RESPONSE_UUID);
+    if (ack_uuids == NULL || ack_uuids->val.type != np_treeval_type_bin ||
+        ack_uuids->val.size != NP_UUID_BYTES)
+      return NULL;
+  }
+
+  *count = ack_uuids->val.size / NP_UUID_BYTES;
+  return ack_uuids->val.value.bin;
+}
@@ -10,6 +10,10 @@
 ** description:
 */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // recvmmsg / sendmmsg
+#endif
+
 #include "np_network.h"
 
 #include <arpa/inet.h>
@@ -54,6 +58,10 @@
 #include "np_types.h"
 #include "np_util.h"
 
+#if defined(__linux__) && NP_NETWORK_IO_BATCH_SIZE > 1
+#define NP_NETWORK_USE_MMSG
+#endif
+
 static char *URN_TCP_V4 = "tcp4";
 static char *URN_TCP_V6 = "tcp6";
 static char *URN_PAS_V4 = "pas4";
@@ -63,11 +71,31 @@ static char *URN_UDP_V6 = "udp6";
 static char *URN_IP_V4  = "ip4";
 static char *URN_IP_V6  = "ip6";
 
+// user data of a watcher. Every inbound watcher of a network (i.e. the
+// shard listeners on other inbound loops) has its own instance, state
+// which is used while reading has to live here and not in the np_network_t
 typedef struct _np_network_data_s {
   np_network_t *network;
   np_dhkey_t    owner_dhkey;
+#ifdef NP_NETWORK_USE_MMSG
+  // receive buffers of the batched udp read, kept between read events. only
+  // the buffers of packages which have been handed on are replaced
+  void *read_buffers[NP_NETWORK_IO_BATCH_SIZE];
+#endif
 } _np_network_data_t;
 
+static void __np_network_data_free(np_state_t         *context,
+                                   _np_network_data_t *network_data) {
+  if (network_data == NULL) return;
+#ifdef NP_NETWORK_USE_MMSG
+  for (uint16_t i = 0; i < NP_NETWORK_IO_BATCH_SIZE; i++) {
+    if (network_data->read_buffers[i] != NULL)
+      np_unref_obj(BLOB_1024, network_data->read_buffers[i], ref_obj_creation);
+  }
+#endif
+  free(network_data);
+}
+
 enum _np_network_runtime_status {
   np_network_stopped = 0,
   np_network_server_started,
@@ -85,6 +113,10 @@ np_module_struct(network) {
 
   TSP(np_bloom_t *, __msgs_per_sec_in);
   TSP(np_bloom_t *, __msgs_per_sec_out);
+
+  // stops networks on behalf of the read callbacks (see
+  // __np_network_disable_deferred)
+  np_sll_t(np_evt_callback_t, __disable_cb);
 };
 
 bool __np_network_module_periodic_capacity_reset(
@@ -113,6 +145,35 @@ bool __np_network_module_periodic_capacity_reset(
   return true;
 }
 
+static bool __np_network_disable_job(np_state_t     *context,
+                                     np_util_event_t event) {
+  _np_network_disable((np_network_t *)event.user_data);
+  return true;
+}
+
+// the read callbacks hold the lock of their inbound loop, _np_network_stop
+// would take the locks of the other loops in the opposite order. The network
+// is stopped by a job instead, which takes the locks from outside the loops.
+static void __np_network_disable_deferred(np_state_t   *context,
+                                          np_network_t *ng) {
+  bool submit = false;
+  TSP_SCOPE(ng->can_be_enabled) {
+    submit             = ng->can_be_enabled;
+    ng->can_be_enabled = false;
+  }
+  if (!submit) return;
+
+  // released by the jobqueue once the job has run
+  np_ref_obj(np_network_t, ng, "np_jobqueue_submit_event");
+  np_util_event_t disable_event = {.type = evt_internal, .user_data = ng};
+  np_jobqueue_submit_event_callbacks(context,
+                                     0.0,
+                                     dhkey_zero,
+                                     disable_event,
+                                     np_module(network)->__disable_cb,
+                                     "__np_network_disable_job");
+}
+
 bool _np_network_module_init(np_state_t *context) {
   if (!np_module_initiated(network)) {
     np_module_malloc(network);
@@ -129,6 +190,11 @@ bool _np_network_module_init(np_state_t *context) {
     _module->__msgs_per_sec_out = _np_counting_bloom_create(filter_size, 8, 1);
     TSP_INIT(_module->__msgs_per_sec_out);
 
+    sll_init(np_evt_callback_t, _module->__disable_cb);
+    sll_append(np_evt_callback_t,
+               _module->__disable_cb,
+               __np_network_disable_job);
+
     // we want max_messages per second "on average"
     // this callback reduces the contained counters by half of the current value
     np_jobqueue_submit_event_periodic(
@@ -147,6 +213,7 @@ void _np_network_module_destroy(np_state_t *context) {
     np_module_var(network);
     TSP_DESTROY(_module->__msgs_per_sec_in);
     TSP_DESTROY(_module->__msgs_per_sec_out);
+    sll_free(np_evt_callback_t, _module->__disable_cb);
 
     np_module_free(route);
   }
@@ -207,6 +274,14 @@ void __np_network_close(np_network_t *self) {
             self,
             self->socket);
   close(self->socket);
+
+  for (uint8_t i = 0; i < self->shard_count; i++) {
+    close(self->shards[i].socket);
+    __np_network_data_free(context, self->shards[i].watcher_in.data);
+  }
+  free(self->shards);
+  self->shards      = NULL;
+  self->shard_count = 0;
 }
 
 /** network_address:
@@ -276,6 +351,11 @@ bool _np_network_send_data(np_state_t   *context,
   ssize_t  write_per_data        = 0;
   uint32_t current_load_capacity = 0;
   bool     ret                   = false;
+  bool     is_stream             = FLAG_CMP(network->socket_type, TCP);
+  int      l_errno               = 0;
+
+  // the rest of a partially sent package has to follow on a tcp stream
+  if (is_stream) write_per_data = network->send_offset;
 
 #ifdef DEBUG
   unsigned char hash[crypto_generichash_BYTES] = {0};
@@ -299,7 +379,7 @@ bool _np_network_send_data(np_state_t   *context,
             hex);
 #endif // DEBUG
 
-  if (np_module_initiated(network) &&
+  if (write_per_data == 0 && np_module_initiated(network) &&
       np_module(network)->max_msgs_per_sec > 0) {
     TSP_SCOPE(np_module(network)->__msgs_per_sec_out) {
       _np_counting_bloom_check_r(np_module(network)->__msgs_per_sec_out,
@@ -350,11 +430,17 @@ bool _np_network_send_data(np_state_t   *context,
         bytes_written <= (MSG_CHUNK_SIZE_1024 + MSG_INSTRUCTIONS_SIZE)) {
       write_per_data += bytes_written;
     } else {
+      l_errno = errno;
       break;
     }
 
   } while (write_per_data < (MSG_CHUNK_SIZE_1024 + MSG_INSTRUCTIONS_SIZE));
 
+  if (is_stream) {
+    network->send_offset =
+        write_per_data % (MSG_CHUNK_SIZE_1024 + MSG_INSTRUCTIONS_SIZE);
+  }
+
   if (write_per_data == (MSG_CHUNK_SIZE_1024 + MSG_INSTRUCTIONS_SIZE)) {
     _np_statistics_add_send_bytes(write_per_data);
 
@@ -371,6 +457,13 @@ bool _np_network_send_data(np_state_t   *context,
       TSP_SCOPE(np_module(network)->__msgs_per_sec_out) {
         _np_counting_bloom_add(np_module(network)->__msgs_per_sec_out, target);
       }
+  } else if (is_stream && (l_errno == EAGAIN || l_errno == EWOULDBLOCK)) {
+    log_debug(LOG_NETWORK,
+              NULL,
+              "Continuing package %p (%zd/%d) with the next write event",
+              data_to_send,
+              write_per_data,
+              MSG_CHUNK_SIZE_1024 + MSG_INSTRUCTIONS_SIZE);
   } else {
     log_error(NULL,
               "Could not send package %p (%zd/%d) over fd: %d msg: %s (%d)",
@@ -378,10 +471,111 @@ bool _np_network_send_data(np_state_t   *context,
               write_per_data,
               MSG_CHUNK_SIZE_1024 + MSG_INSTRUCTIONS_SIZE,
               network->socket,
+              strerror(l_errno),
+              l_errno);
+  }
+  return ret;
+}
+
+#ifdef NP_NETWORK_USE_MMSG
+// sends up to max_packages (at most NP_NETWORK_IO_BATCH_SIZE) queued udp
+// packages with a single system call and removes the delivered packages from
+// the out queue
+static uint32_t __np_network_send_batch(np_state_t   *context,
+                                        np_network_t *network,
+                                        np_dhkey_t    target,
+                                        uint32_t      max_packages) {
+  struct mmsghdr msgs[NP_NETWORK_IO_BATCH_SIZE]   = {0};
+  struct iovec   iovecs[NP_NETWORK_IO_BATCH_SIZE] = {0};
+  uint32_t       current_load_capacity            = 0;
+  uint32_t       max_batch = MIN(NP_NETWORK_IO_BATCH_SIZE, max_packages);
+  uint32_t       count                            = 0;
+
+  if (np_module_initiated(network) &&
+      np_module(network)->max_msgs_per_sec > 0) {
+    TSP_SCOPE(np_module(network)->__msgs_per_sec_out) {
+      _np_counting_bloom_check_r(np_module(network)->__msgs_per_sec_out,
+                                 target,
+                                 &current_load_capacity);
+    }
+    if (current_load_capacity > np_module(network)->max_msgs_per_sec) {
+      log_warn(LOG_NETWORK,
+               NULL,
+               "Re-scheduling data package due to msgs per sec constraint "
+               "(current: %" PRIu32 " / max: %" PRIu16 " | OUT)",
+               current_load_capacity,
+               np_module(network)->max_msgs_per_sec);
+      return 0;
+    }
+    // do not overshoot the msgs per sec constraint with a single batch
+    max_batch = MIN(max_batch,
+                    np_module(network)->max_msgs_per_sec -
+                        current_load_capacity);
+  }
+
+  sll_iterator(void_ptr) iter = sll_first(network->out_events);
+  while (iter != NULL && count < max_batch) {
+    struct msghdr *hdr     = &msgs[count].msg_hdr;
+    iovecs[count].iov_base = iter->val;
+    iovecs[count].iov_len  = MSG_CHUNK_SIZE_1024 + MSG_INSTRUCTIONS_SIZE;
+    hdr->msg_iov           = &iovecs[count];
+    hdr->msg_iovlen        = 1;
+    if (FLAG_CMP(network->socket_type, PASSIVE)) {
+      hdr->msg_name    = network->remote_addr;
+      hdr->msg_namelen = network->remote_addr_len;
+    }
+    count++;
+    sll_next(iter);
+  }
+
+  int sent = sendmmsg(network->socket,
+                      msgs,
+                      count,
+#ifdef MSG_NOSIGNAL
+                      MSG_NOSIGNAL
+#else
+                      0
+#endif
+  );
+  if (sent < 0) {
+    log_error(NULL,
+              "Could not send %" PRIu32 " packages over fd: %d msg: %s (%d)",
+              count,
+              network->socket,
               strerror(errno),
               errno);
+    return 0;
   }
-  return ret;
+
+  for (int i = 0; i < sent; i++) {
+    // a datagram is either sent completely or not at all
+    _np_statistics_add_send_bytes(msgs[i].msg_len);
+    if (np_module(network)->max_msgs_per_sec > 0)
+      TSP_SCOPE(np_module(network)->__msgs_per_sec_out) {
+        _np_counting_bloom_add(np_module(network)->__msgs_per_sec_out, target);
+      }
+
+    void *data_to_send = sll_head(void_ptr, network->out_events);
+    np_unref_obj(BLOB_1024, data_to_send, ref_obj_usage);
+  }
+  if (sent > 0) network->last_send_date = np_time_now();
+
+  log_debug(LOG_NETWORK,
+            NULL,
+            "Did send %d of %" PRIu32 " packages via %p -> %d",
+            sent,
+            count,
+            network,
+            network->socket);
+  return sent;
+}
+#endif
+
+// the token bucket of a paced network has been refilled
+static void
+__np_network_pacing_resume(struct ev_loop *loop, ev_timer *timer, int revents) {
+  np_network_t *network = (np_network_t *)timer->data;
+  ev_io_start(EV_A_ & network->watcher_out);
 }
 
 void _np_network_write(struct ev_loop *loop, ev_io *event, int revents) {
@@ -397,8 +591,27 @@ void _np_network_write(struct ev_loop *loop, ev_io *event, int revents) {
   np_network_t *network = ((_np_network_data_t *)event->data)->network;
 
   _TRYLOCK_ACCESS(&network->access_lock) {
+    // packages leave with the pacing rate of the congestion controller. A
+    // partially written package of a tcp stream is always completed.
+    uint32_t allowance =
+        _np_congestion_tokens(&network->congestion, np_time_now());
+    if (allowance == 0 && network->send_offset > 0) allowance = 1;
+
     // if a data packet is available, try to send it
-    if (sll_size(network->out_events) > 0) {
+    bool batched = false;
+#ifdef NP_NETWORK_USE_MMSG
+    batched = FLAG_CMP(network->socket_type, UDP) &&
+              sll_size(network->out_events) > 1 && allowance > 1;
+    if (batched) {
+      uint32_t sent = __np_network_send_batch(
+          context,
+          network,
+          ((_np_network_data_t *)event->data)->owner_dhkey,
+          allowance);
+      _np_congestion_on_send(&network->congestion, sent);
+    }
+#endif
+    if (!batched && allowance > 0 && sll_size(network->out_events) > 0) {
       if (_np_network_send_data(
               context,
               network,
@@ -406,6 +619,7 @@ void _np_network_write(struct ev_loop *loop, ev_io *event, int revents) {
               sll_first(network->out_events)->val)) {
         void *data_to_send = sll_head(void_ptr, network->out_events);
         np_unref_obj(BLOB_1024, data_to_send, ref_obj_usage);
+        _np_congestion_on_send(&network->congestion, 1);
       }
     }
 
@@ -429,6 +643,14 @@ void _np_network_write(struct ev_loop *loop, ev_io *event, int revents) {
                 network->ip,
                 network->port);
       network->is_running &= np_network_server_started;
+    } else if (_np_congestion_delay(&network->congestion) > 0.0) {
+      // the peer is paced, wait for the next token instead of polling the
+      // writable socket
+      ev_io_stop(EV_A_ & network->watcher_out);
+      ev_timer_set(&network->pacing_timer,
+                   _np_congestion_delay(&network->congestion),
+                   0.0);
+      ev_timer_start(EV_A_ & network->pacing_timer);
     }
   }
 }
@@ -495,6 +717,89 @@ void __create_new_alias_key(np_state_t *context,
   np_unref_obj(np_key_t, temp_alias_key, "_np_keycache_find_or_create");
 }
 
+bool _np_network_register_stream(np_state_t   *context,
+                                 np_network_t *connection,
+                                 int           fd,
+                                 socket_type   type,
+                                 np_dhkey_t    owner_dhkey) {
+  struct __np_network_data data_container = {0};
+  socklen_t                fromlen        = sizeof(struct sockaddr_storage);
+  bool                     ret            = false;
+
+  if (0 != getpeername(fd, (struct sockaddr *)&data_container.from, &fromlen)) {
+    log_msg(LOG_NETWORK | LOG_WARNING,
+            NULL,
+            "could not get the peer address of fd %d: %s",
+            fd,
+            strerror(errno));
+    return false;
+  }
+  __np_network_get_ip_and_port(&data_container);
+
+  np_dhkey_t search_key =
+      np_dhkey_create_from_hostport(&data_container.ipstr[0],
+                                    &data_container.port[0]);
+  np_key_t *alias_key = _np_keycache_find_or_create(context, search_key);
+
+  if (alias_key->entity_array[e_network] != NULL) {
+    log_warn(LOG_NETWORK,
+             NULL,
+             "alias %s already has a network, ignoring tcp stream on fd %d",
+             _np_key_as_str(alias_key),
+             fd);
+  } else {
+    np_network_t *new_network = NULL;
+    np_new_obj(np_network_t, new_network);
+
+    if (_np_network_init(new_network,
+                         true,
+                         type,
+                         data_container.ipstr,
+                         data_container.port,
+                         context->settings->max_msgs_per_sec,
+                         fd,
+                         UNKNOWN_PROTO)) {
+      // the peer of a stream does not change, its packages are accounted to
+      // this address
+      strncpy(new_network->ip, data_container.ipstr, CHAR_LENGTH_IP - 1);
+      strncpy(new_network->port, data_container.port, CHAR_LENGTH_PORT - 1);
+
+      if (NULL == connection) {
+        // the stream owns the accepted socket
+        new_network->is_multiuse_socket = false;
+      } else {
+        _np_network_share_connection(new_network, connection);
+      }
+
+      alias_key->entity_array[e_network] = new_network;
+      // will be reset to alias key after first (handshake) message
+      _np_network_set_key(new_network, owner_dhkey);
+
+      log_debug(LOG_NETWORK,
+                NULL,
+                "%p -> %d network is receiving. alias: %s",
+                new_network,
+                new_network->socket,
+                _np_key_as_str(alias_key));
+
+      _np_network_enable(new_network);
+      ret = true;
+    } else {
+      np_unref_obj(np_network_t, new_network, ref_obj_creation);
+    }
+  }
+  np_unref_obj(np_key_t, alias_key, "_np_keycache_find_or_create");
+
+  if (ret) {
+    __create_new_alias_key(context,
+                           TCP,
+                           data_container.ipstr,
+                           data_container.port,
+                           search_key);
+  }
+  return ret;
+}
+
 void _np_network_accept(struct ev_loop *loop, ev_io *event, int revents) {
   np_ctx_decl(ev_userdata(loop));
 
@@ -531,57 +836,339 @@ void _np_network_accept(struct ev_loop *loop, ev_io *event, int revents) {
               data_container.ipstr,
               data_container.port);
 
-    np_network_t *new_network = NULL;
-    np_new_obj(np_network_t, new_network);
+    if (!_np_network_register_stream(
+            context,
+            NULL,
+            client_fd,
+            ng->socket_type,
+            ((_np_network_data_t *)event->data)->owner_dhkey)) {
+      close(client_fd);
+    }
+  }
+}
 
-    if (_np_network_init(new_network,
-                         true,
-                         ng->socket_type,
-                         data_container.ipstr,
-                         data_container.port,
-                         context->settings->max_msgs_per_sec,
-                         client_fd,
-                         UNKNOWN_PROTO)) {
-      new_network->is_multiuse_socket = false;
-      // it could be a passive socket
+// hands a single received package over to the owner or alias key, returns
+// true if the package passed the msgs per sec constraint
+static bool __np_network_handle_package(np_state_t               *context,
+                                        np_network_t             *ng,
+                                        np_dhkey_t                owner_dhkey,
+                                        struct __np_network_data *package,
+                                        int                       fd) {
+  bool    ret        = false;
+  int16_t in_msg_len = package->in_msg_len;
+
+  if (FLAG_CMP(ng->socket_type, TCP)) {
+    memcpy(package->ipstr, ng->ip, CHAR_LENGTH_IP);
+    memcpy(package->port, ng->port, CHAR_LENGTH_PORT);
+  } else {
+    __np_network_get_ip_and_port(package);
+  }
+  _np_statistics_add_received_bytes(in_msg_len);
 
-      np_dhkey_t search_key =
-          np_dhkey_create_from_hostport(&data_container.ipstr[0],
-                                        &data_container.port[0]);
-      np_key_t *alias_key = _np_keycache_find_or_create(context, search_key);
+#ifdef DEBUG
+  char msg_hex[2 * in_msg_len + 1];
+  sodium_bin2hex(msg_hex,
+                 2 * in_msg_len + 1,
+                 package->data,
+                 in_msg_len);
+  log_debug(LOG_NETWORK,
+            NULL,
+            "Did receive data (%" PRIi16 " bytes / %p) via fd: %d hex: 0x%s",
+            in_msg_len,
+            package->data,
+            fd,
+            msg_hex);
+#endif
 
-      ASSERT(alias_key->entity_array[e_network] == NULL,
-             "There should be no network for a tcp connection yet");
+  if (in_msg_len == MSG_CHUNK_SIZE_1024 + MSG_INSTRUCTIONS_SIZE) {
 
-      alias_key->entity_array[e_network] = new_network;
-      // will be reset to alias key after first (handshake) message
-      _np_network_set_key(new_network,
-                          ((_np_network_data_t *)event->data)->owner_dhkey);
-      // new_network->__tcp_alias_dhkey = search_key;
+    np_dhkey_t search_key =
+        np_dhkey_create_from_hostport(&package->ipstr[0],
+                                      &package->port[0]);
 
-      log_debug(LOG_NETWORK,
-                NULL,
-                "%p -> %d network is receiving. alias: %s",
-                new_network,
-                new_network->socket,
-                _np_key_as_str(alias_key));
+    uint32_t current_load_capacity = 0;
+    if (np_module_initiated(network) &&
+        np_module(network)->max_msgs_per_sec > 0) {
 
-      _np_network_enable(new_network);
+      TSP_SCOPE(np_module(network)->__msgs_per_sec_in) {
+        _np_counting_bloom_check_r(np_module(network)->__msgs_per_sec_in,
+                                   search_key,
+                                   &current_load_capacity);
+      }
+    }
+    if (current_load_capacity > np_module(network)->max_msgs_per_sec) {
+      log_warn(LOG_WARNING,
+               NULL,
+               "Dropping data package due to msgs per sec constraint "
+               "(current: %" PRIu32 " / max: %" PRIu16 " | IN)",
+               current_load_capacity,
+               np_module(network)->max_msgs_per_sec);
+      return false;
+    }
+    ret = true;
+    if (np_module_initiated(network) &&
+        np_module(network)->max_msgs_per_sec > 0) {
+      TSP_SCOPE(np_module(network)->__msgs_per_sec_in) {
+        _np_counting_bloom_add(np_module(network)->__msgs_per_sec_in,
+                               search_key);
+      }
+    }
+
+    np_key_t *alias_key = _np_keycache_find(context, search_key);
+
+    np_util_event_t in_event = {
+        .type      = evt_external | evt_message,
+        .user_data = package->data,
+        // .cleanup = _np_network_read_msg_event_cleanup,
+        .target_dhkey = search_key};
+
+    if (NULL == alias_key) // && FLAG_CMP(ng->socket_type, UDP))
+    {
+      __create_new_alias_key(context,
+                             UDP,
+                             package->ipstr,
+                             package->port,
+                             search_key);
+    }
+
+    char msg_identifier[crypto_generichash_BYTES * 2 + 1 + 30] =
+        "urn:np:event:extern_message";
+#ifdef DEBUG
+    unsigned char hash[crypto_generichash_BYTES] = {0};
+    crypto_generichash(hash,
+                       sizeof hash,
+                       package->data,
+                       MSG_CHUNK_SIZE_1024,
+                       NULL,
+                       0);
+    // char hex[MSG_CHUNK_SIZE_1024 * 2 + 1];
+    // sodium_bin2hex(hex, MSG_CHUNK_SIZE_1024 * 2 + 1, data_to_send,
+    // MSG_CHUNK_SIZE_1024);
+    char hex[crypto_generichash_BYTES * 2 + 1] = {0};
+    sodium_bin2hex(hex,
+                   crypto_generichash_BYTES * 2 + 1,
+                   hash,
+                   crypto_generichash_BYTES);
+
+    log_debug(LOG_NETWORK | LOG_EXPERIMENT,
+              NULL,
+              "IN DATAPACKAGE %s:%s %s",
+              package->ipstr,
+              package->port,
+              hex);
+    snprintf(msg_identifier, 95, "urn:np:event:extern_message:%s", hex);
+#endif // DEBUG
+
+    // get handshake status lock conform...
+    enum np_node_status _handshake_status = np_node_status_Disconnected;
+    if (alias_key) {
+      _LOCK_ACCESS(&alias_key->key_lock) {
+        np_node_t *alias_node = _np_key_get_node(alias_key);
+
+        if (alias_node) {
+          _handshake_status = alias_node->_handshake_status;
+        }
+      }
+    }
+
+    if (FLAG_CMP(ng->socket_type, PASSIVE) ||
+        (_handshake_status < np_node_status_Initiated)) {
+      char buf[100] = {0};
       log_debug(LOG_NETWORK,
                 NULL,
-                "created network for key: %s and watching it.",
+                "send data to owner %s",
+                np_id_str(buf, (np_id *)&owner_dhkey));
+      if (!np_jobqueue_submit_event(context,
+                                    0.0,
+                                    owner_dhkey,
+                                    in_event,
+                                    msg_identifier)) {
+        log_error(
+            NULL,
+            "%s",
+            "Dropping data package send to owner as jobqueue is rejecting "
+            "it");
+      }
+    } else if (NULL != alias_key) {
+      log_debug(LOG_NETWORK, NULL, "send data to alias");
+      if (!np_jobqueue_submit_event(context,
+                                    0.0,
+                                    alias_key->dhkey,
+                                    in_event,
+                                    msg_identifier)) {
+        log_error(NULL,
+                  "%s",
+                  "Dropping data package send to alias key as jobqueue is "
+                  "rejecting it");
+      }
+    } else {
+      log_debug(LOG_ERROR,
+                NULL,
+                "network in unknown state for key %s",
                 _np_key_as_str(alias_key));
-      np_unref_obj(np_key_t, alias_key, "_np_keycache_find_or_create");
+    }
 
-      __create_new_alias_key(context,
-                             TCP,
-                             data_container.ipstr,
-                             data_container.port,
-                             search_key);
+    if (NULL != alias_key) {
+      np_unref_obj(np_key_t, alias_key, "_np_keycache_find");
+    }
+  } else {
+    if (in_msg_len == 0) {
+      log_info(LOG_NETWORK,
+               NULL,
+               "Stopping network due to zero size package (%" PRIu16 ")",
+               in_msg_len);
+      __np_network_disable_deferred(context, ng);
+      // stop = true;
     } else {
-      np_unref_obj(np_network_t, new_network, ref_obj_creation);
+      log_info(LOG_NETWORK,
+               NULL,
+               "Dropping data package due to invalid package size (%" PRIu16
+               ")",
+               in_msg_len);
     }
   }
+  return ret;
+}
+
+#ifdef NP_NETWORK_USE_MMSG
+// reads up to NP_NETWORK_IO_BATCH_SIZE datagrams with a single system call,
+// each datagram is received into its own pooled BLOB_1024 buffer
+static void __np_network_read_batch(np_state_t         *context,
+                                    _np_network_data_t *network_data,
+                                    int                 fd) {
+  struct mmsghdr           msgs[NP_NETWORK_IO_BATCH_SIZE]     = {0};
+  struct iovec             iovecs[NP_NETWORK_IO_BATCH_SIZE]   = {0};
+  struct __np_network_data packages[NP_NETWORK_IO_BATCH_SIZE] = {0};
+  uint16_t                 msgs_received                      = 0;
+
+  for (uint16_t i = 0; i < NP_NETWORK_IO_BATCH_SIZE; i++) {
+    if (network_data->read_buffers[i] == NULL)
+      np_new_obj(BLOB_1024, network_data->read_buffers[i]);
+    packages[i].data            = network_data->read_buffers[i];
+    iovecs[i].iov_base          = packages[i].data;
+    iovecs[i].iov_len           = MSG_CHUNK_SIZE_1024 + MSG_INSTRUCTIONS_SIZE;
+    msgs[i].msg_hdr.msg_iov     = &iovecs[i];
+    msgs[i].msg_hdr.msg_iovlen  = 1;
+    msgs[i].msg_hdr.msg_name    = &packages[i].from;
+    msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+  }
+
+  int received =
+      recvmmsg(fd, msgs, NP_NETWORK_IO_BATCH_SIZE, MSG_DONTWAIT, NULL);
+  if (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+    log_msg(LOG_NETWORK | LOG_WARNING,
+            NULL,
+            "Receive stopped. Reason: %s (%" PRId32 "/ %" PRId32 ")",
+            strerror(errno),
+            errno,
+            received);
+  }
+
+  for (int i = 0; i < received; i++) {
+    packages[i].in_msg_len = msgs[i].msg_len;
+    if (__np_network_handle_package(context,
+                                    network_data->network,
+                                    network_data->owner_dhkey,
+                                    &packages[i],
+                                    fd)) {
+      // the package is in use by its event now, read into a new buffer
+      np_unref_obj(BLOB_1024, network_data->read_buffers[i], ref_obj_creation);
+      network_data->read_buffers[i] = NULL;
+      msgs_received++;
+    }
+  }
+
+  log_info(LOG_NETWORK | LOG_VERBOSE,
+           NULL,
+           "Received %" PRIu16 " messages in one batch.",
+           msgs_received);
+}
+#endif
+
+void *_np_network_stream_read_package(np_state_t   *context,
+                                      np_network_t *ng,
+                                      int           fd,
+                                      bool         *closed) {
+  void *package = NULL;
+  *closed       = false;
+
+  while (NULL == package && !*closed) {
+    if (NULL == ng->stream_buffer) {
+      np_new_obj(BLOB_1024, ng->stream_buffer);
+      ng->stream_fill = 0;
+    }
+
+    ssize_t last_recv_result =
+        recv(fd,
+             ((unsigned char *)ng->stream_buffer) + ng->stream_fill,
+             MSG_CHUNK_SIZE_1024 + MSG_INSTRUCTIONS_SIZE - ng->stream_fill,
+             0);
+
+    if (last_recv_result == 0) {
+      // orderly shutdown of the peer
+      *closed = true;
+    } else if (last_recv_result < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        log_msg(LOG_NETWORK | LOG_WARNING,
+                NULL,
+                "Receive stopped. Reason: %s (%" PRId32 ")",
+                strerror(errno),
+                errno);
+        *closed = true;
+      }
+      break;
+    } else {
+      ng->stream_fill += last_recv_result;
+      if (ng->stream_fill == MSG_CHUNK_SIZE_1024 + MSG_INSTRUCTIONS_SIZE) {
+        package           = ng->stream_buffer;
+        ng->stream_buffer = NULL;
+        ng->stream_fill   = 0;
+      }
+    }
+  }
+  return package;
+}
+
+// reads the complete packages which are available on a tcp stream, returns
+// true if the stream has been closed
+static bool __np_network_read_stream(np_state_t   *context,
+                                     np_network_t *ng,
+                                     np_dhkey_t    owner_dhkey,
+                                     int           fd) {
+  struct __np_network_data data_container = {0};
+  uint16_t                 msgs_received  = 0;
+  bool                     closed         = false;
+
+  // limit the packages per event, other streams of the loop want to be read
+  for (uint16_t i = 0; i < NP_NETWORK_IO_BATCH_SIZE && !closed; i++) {
+    data_container.data =
+        _np_network_stream_read_package(context, ng, fd, &closed);
+    if (NULL == data_container.data) break;
+
+    data_container.in_msg_len = MSG_CHUNK_SIZE_1024 + MSG_INSTRUCTIONS_SIZE;
+    if (__np_network_handle_package(context,
+                                    ng,
+                                    owner_dhkey,
+                                    &data_container,
+                                    fd)) {
+      msgs_received++;
+    }
+    np_unref_obj(BLOB_1024, data_container.data, ref_obj_creation);
+  }
+
+  if (closed) {
+    log_info(LOG_NETWORK,
+             NULL,
+             "Stopping network %p as the tcp stream on fd %d has been closed",
+             ng,
+             fd);
+    __np_network_disable_deferred(context, ng);
+  }
+  log_info(LOG_NETWORK | LOG_VERBOSE,
+           NULL,
+           "Received %" PRIu16 " messages.",
+           msgs_received);
+  return closed;
 }
 
 /**
@@ -606,13 +1193,27 @@ void _np_network_read(struct ev_loop *loop, ev_io *event, int revents) {
   np_dhkey_t    owner_dhkey = ((_np_network_data_t *)event->data)->owner_dhkey;
   np_network_t *ng          = ((_np_network_data_t *)event->data)->network;
 
+  if (FLAG_CMP(ng->socket_type, TCP)) {
+    if (__np_network_read_stream(context, ng, owner_dhkey, event->fd)) {
+      // a closed stream stays readable, the watcher of this loop can be
+      // stopped right away as the callback holds the lock of the loop
+      ev_io_stop(EV_A_ event);
+    }
+    return;
+  }
+#ifdef NP_NETWORK_USE_MMSG
+  if (FLAG_CMP(ng->socket_type, UDP)) {
+    __np_network_read_batch(context, event->data, event->fd);
+    return;
+  }
+#endif
+
   /* receive the new data */
   int      last_recv_result = 0;
   uint16_t msgs_received    = 0;
 
   // catch multiple msgs waiting in this pipe
   // double timeout_start = np_time_now();
-  bool    network_receive_timeout = false;
   int16_t in_msg_len;
   bool    stop = false;
 
@@ -624,21 +1225,13 @@ void _np_network_read(struct ev_loop *loop, ev_io *event, int revents) {
   // catch a msg even if it was chunked into smaller byte parts by the
   // underlying network
   do {
-    if (FLAG_CMP(ng->socket_type, TCP)) {
-      last_recv_result =
-          recv(event->fd,
-               ((char *)data_container.data) + in_msg_len,
-               MSG_CHUNK_SIZE_1024 + MSG_INSTRUCTIONS_SIZE - in_msg_len,
-               0);
-    } else {
-      last_recv_result =
-          recvfrom(event->fd,
-                   ((unsigned char *)data_container.data) + in_msg_len,
-                   MSG_CHUNK_SIZE_1024 + MSG_INSTRUCTIONS_SIZE - in_msg_len,
-                   0,
-                   (struct sockaddr *)&data_container.from,
-                   &fromlen);
-    }
+    last_recv_result =
+        recvfrom(event->fd,
+                 ((unsigned char *)data_container.data) + in_msg_len,
+                 MSG_CHUNK_SIZE_1024 + MSG_INSTRUCTIONS_SIZE - in_msg_len,
+                 0,
+                 (struct sockaddr *)&data_container.from,
+                 &fromlen);
 
     if (last_recv_result < 0) {
       log_msg(LOG_NETWORK | LOG_WARNING,
@@ -661,189 +1254,13 @@ void _np_network_read(struct ev_loop *loop, ev_io *event, int revents) {
                          MSG_INSTRUCTIONS_SIZE)); //! network_receive_timeout);
 
   if (!stop) {
-    if (FLAG_CMP(ng->socket_type, TCP)) {
-      int err = -1;
-      do {
-        err = getpeername(event->fd,
-                          (struct sockaddr *)&data_container.from,
-                          &fromlen);
-      } while (0 != err && errno != ENOTCONN);
-    }
-    __np_network_get_ip_and_port(&data_container);
-    _np_statistics_add_received_bytes(in_msg_len);
-
-#ifdef DEBUG
-    char msg_hex[2 * in_msg_len + 1];
-    sodium_bin2hex(msg_hex,
-                   2 * in_msg_len + 1,
-                   data_container.data,
-                   in_msg_len);
-    log_debug(LOG_NETWORK,
-              NULL,
-              "Did receive data (%" PRIi16 " bytes / %p) via fd: %d hex: 0x%s",
-              in_msg_len,
-              data_container.data,
-              event->fd,
-              msg_hex);
-#endif
-
-    if (in_msg_len == MSG_CHUNK_SIZE_1024 + MSG_INSTRUCTIONS_SIZE) {
-
-      np_dhkey_t search_key =
-          np_dhkey_create_from_hostport(&data_container.ipstr[0],
-                                        &data_container.port[0]);
-
-      uint32_t current_load_capacity = 0;
-      if (np_module_initiated(network) &&
-          np_module(network)->max_msgs_per_sec > 0) {
-
-        TSP_SCOPE(np_module(network)->__msgs_per_sec_in) {
-          _np_counting_bloom_check_r(np_module(network)->__msgs_per_sec_in,
-                                     search_key,
-                                     &current_load_capacity);
-        }
-      }
-      if (current_load_capacity > np_module(network)->max_msgs_per_sec) {
-        log_warn(LOG_WARNING,
-                 NULL,
-                 "Dropping data package due to msgs per sec constraint "
-                 "(current: %" PRIu32 " / max: %" PRIu16 " | IN)",
-                 current_load_capacity,
-                 np_module(network)->max_msgs_per_sec);
-        np_unref_obj(BLOB_1024, data_container.data, ref_obj_creation);
-        return;
-      }
+    data_container.in_msg_len = in_msg_len;
+    if (__np_network_handle_package(context,
+                                    ng,
+                                    owner_dhkey,
+                                    &data_container,
+                                    event->fd)) {
       msgs_received++;
-      if (np_module_initiated(network) &&
-          np_module(network)->max_msgs_per_sec > 0) {
-        TSP_SCOPE(np_module(network)->__msgs_per_sec_in) {
-          _np_counting_bloom_add(np_module(network)->__msgs_per_sec_in,
-                                 search_key);
-        }
-      }
-
-      data_container.in_msg_len = in_msg_len;
-
-      np_key_t *alias_key = _np_keycache_find(context, search_key);
-
-      np_util_event_t in_event = {
-          .type      = evt_external | evt_message,
-          .user_data = data_container.data,
-          // .cleanup = _np_network_read_msg_event_cleanup,
-          .target_dhkey = search_key};
-
-      if (NULL == alias_key) // && FLAG_CMP(ng->socket_type, UDP))
-      {
-        __create_new_alias_key(context,
-                               UDP,
-                               data_container.ipstr,
-                               data_container.port,
-                               search_key);
-      }
-
-      char msg_identifier[crypto_generichash_BYTES * 2 + 1 + 30] =
-          "urn:np:event:extern_message";
-#ifdef DEBUG
-      unsigned char hash[crypto_generichash_BYTES] = {0};
-      crypto_generichash(hash,
-                         sizeof hash,
-                         data_container.data,
-                         MSG_CHUNK_SIZE_1024,
-                         NULL,
-                         0);
-      // char hex[MSG_CHUNK_SIZE_1024 * 2 + 1];
-      // sodium_bin2hex(hex, MSG_CHUNK_SIZE_1024 * 2 + 1, data_to_send,
-      // MSG_CHUNK_SIZE_1024);
-      char hex[crypto_generichash_BYTES * 2 + 1] = {0};
-      sodium_bin2hex(hex,
-                     crypto_generichash_BYTES * 2 + 1,
-                     hash,
-                     crypto_generichash_BYTES);
-
-      log_debug(LOG_NETWORK | LOG_EXPERIMENT,
-                NULL,
-                "IN DATAPACKAGE %s:%s %s",
-                data_container.ipstr,
-                data_container.port,
-                hex);
-      snprintf(msg_identifier, 95, "urn:np:event:extern_message:%s", hex);
-#endif // DEBUG
-
-      // get handshake status lock conform...
-      enum np_node_status _handshake_status = np_node_status_Disconnected;
-      if (alias_key) {
-        _LOCK_ACCESS(&alias_key->key_lock) {
-          np_node_t *alias_node = _np_key_get_node(alias_key);
-
-          if (alias_node) {
-            _handshake_status = alias_node->_handshake_status;
-          }
-        }
-      }
-
-      if (FLAG_CMP(ng->socket_type, PASSIVE) ||
-          (_handshake_status < np_node_status_Initiated)) {
-        char buf[100] = {0};
-        log_debug(LOG_NETWORK,
-                  NULL,
-                  "send data to owner %s",
-                  np_id_str(buf, (np_id *)&owner_dhkey));
-        if (!np_jobqueue_submit_event(context,
-                                      0.0,
-                                      owner_dhkey,
-                                      in_event,
-                                      msg_identifier)) {
-          log_error(
-              NULL,
-              "%s",
-              "Dropping data package send to owner as jobqueue is rejecting "
-              "it");
-        }
-      } else if (NULL != alias_key) {
-        log_debug(LOG_NETWORK, NULL, "send data to alias");
-        if (!np_jobqueue_submit_event(context,
-                                      0.0,
-                                      alias_key->dhkey,
-                                      in_event,
-                                      msg_identifier)) {
-          log_error(NULL,
-                    "%s",
-                    "Dropping data package send to alias key as jobqueue is "
-                    "rejecting it");
-        }
-      } else {
-        log_debug(LOG_ERROR,
-                  NULL,
-                  "network in unknown state for key %s",
-                  _np_key_as_str(alias_key));
-      }
-
-      if (NULL != alias_key) {
-        np_unref_obj(np_key_t, alias_key, "_np_keycache_find");
-      }
-    } else {
-      if (network_receive_timeout) {
-        log_info(LOG_NETWORK,
-                 NULL,
-                 "Network receive iteration stopped due to timeout (Received "
-                 "Data: %" PRIu16 ")",
-                 in_msg_len);
-      }
-
-      if (in_msg_len == 0) {
-        log_info(LOG_NETWORK,
-                 NULL,
-                 "Stopping network due to zero size package (%" PRIu16 ")",
-                 in_msg_len);
-        _np_network_disable(ng);
-        // stop = true;
-      } else {
-        log_info(LOG_NETWORK,
-                 NULL,
-                 "Dropping data package due to invalid package size (%" PRIu16
-                 ")",
-                 in_msg_len);
-      }
     }
   }
 
@@ -867,13 +1284,22 @@ void _np_network_stop(np_network_t *network, bool force) {
                   NULL,
                   "stopping server network %p",
                   network);
-        loop = _np_event_get_loop_in(context);
-        _np_event_suspend_loop_in(context);
+        loop = _np_event_get_loop_in_shard(context, network->in_loop);
+        _np_event_suspend_loop_in_shard(context, network->in_loop);
         ev_io_stop(EV_A_ & network->watcher_in);
         // ev_io_set(&network->watcher, network->socket, EV_NONE);
         // ev_io_start(EV_A_ &network->watcher);
-        _np_event_reconfigure_loop_in(context);
-        _np_event_resume_loop_in(context);
+        _np_event_reconfigure_loop_in_shard(context, network->in_loop);
+        _np_event_resume_loop_in_shard(context, network->in_loop);
+
+        for (uint8_t i = 0; i < network->shard_count; i++) {
+          struct np_network_shard_s *shard = &network->shards[i];
+          loop = _np_event_get_loop_in_shard(context, shard->in_loop);
+          _np_event_suspend_loop_in_shard(context, shard->in_loop);
+          ev_io_stop(EV_A_ & shard->watcher_in);
+          _np_event_reconfigure_loop_in_shard(context, shard->in_loop);
+          _np_event_resume_loop_in_shard(context, shard->in_loop);
+        }
         network->is_running &= np_network_client_started;
       }
     }
@@ -887,6 +1313,7 @@ void _np_network_stop(np_network_t *network, bool force) {
         loop = _np_event_get_loop_out(context);
         _np_event_suspend_loop_out(context);
         ev_io_stop(EV_A_ & network->watcher_out);
+        ev_timer_stop(EV_A_ & network->pacing_timer);
         // ev_io_set(&network->watcher, network->socket, EV_NONE);
         // ev_io_start(EV_A_ &network->watcher);
         _np_event_reconfigure_loop_out(context);
@@ -912,13 +1339,22 @@ void _np_network_start(np_network_t *network, bool force) {
                     NULL,
                     "starting server network %p",
                     network);
-          loop = _np_event_get_loop_in(context);
-          _np_event_suspend_loop_in(context);
+          loop = _np_event_get_loop_in_shard(context, network->in_loop);
+          _np_event_suspend_loop_in_shard(context, network->in_loop);
           ev_io_start(EV_A_ & network->watcher_in);
           // ev_io_set(&network->watcher, network->socket, EV_NONE);
           // ev_io_start(EV_A_ &network->watcher);
-          _np_event_reconfigure_loop_in(context);
-          _np_event_resume_loop_in(context);
+          _np_event_reconfigure_loop_in_shard(context, network->in_loop);
+          _np_event_resume_loop_in_shard(context, network->in_loop);
+
+          for (uint8_t i = 0; i < network->shard_count; i++) {
+            struct np_network_shard_s *shard = &network->shards[i];
+            loop = _np_event_get_loop_in_shard(context, shard->in_loop);
+            _np_event_suspend_loop_in_shard(context, shard->in_loop);
+            ev_io_start(EV_A_ & shard->watcher_in);
+            _np_event_reconfigure_loop_in_shard(context, shard->in_loop);
+            _np_event_resume_loop_in_shard(context, shard->in_loop);
+          }
           network->is_running |= np_network_server_started;
         }
       }
@@ -965,10 +1401,14 @@ void _np_network_t_del(np_state_t       *context,
     sll_free(void_ptr, network->out_events);
   }
 
-  free(network->watcher_in.data);
-  free(network->watcher_out.data);
+  __np_network_data_free(context, network->watcher_in.data);
+  __np_network_data_free(context, network->watcher_out.data);
   free(network->remote_addr);
 
+  if (NULL != network->stream_buffer) {
+    np_unref_obj(BLOB_1024, network->stream_buffer, ref_obj_creation);
+  }
+
   if ((network->socket >= 0) && !network->is_multiuse_socket) {
     log_info(LOG_NETWORK,
              NULL,
@@ -976,6 +1416,11 @@ void _np_network_t_del(np_state_t       *context,
              network);
     __np_network_close(network);
   }
+  if (NULL != network->shared_connection) {
+    np_unref_obj(np_network_t,
+                 network->shared_connection,
+                 "_np_network_share_connection");
+  }
 
   // freeaddrinfo(network->addr_in);
   network->initialized = false;
@@ -1002,6 +1447,16 @@ void _np_network_t_new(np_state_t       *context,
   ng->last_received_date      = 0.0;
   ng->max_messages_per_second = context->settings->max_msgs_per_sec;
   ng->seqend                  = 0;
+  ng->in_loop                 = 0;
+  ng->shard_count             = 0;
+  ng->shards                  = NULL;
+  ng->stream_buffer           = NULL;
+  ng->stream_fill             = 0;
+  ng->send_offset             = 0;
+  ng->shared_connection       = NULL;
+  _np_congestion_init(&ng->congestion, np_time_now());
+  ev_timer_init(&ng->pacing_timer, __np_network_pacing_resume, 0.0, 0.0);
+  ng->pacing_timer.data = ng;
 
   ng->ip[0]   = 0;
   ng->port[0] = 0;
@@ -1046,6 +1501,54 @@ void __set_keepalive(int socket) {
   }
 }
 
+// reads the udp socket of a server network on every additional inbound event
+// loop. The socket stays bound exclusively, each loop watches a duplicate of
+// its descriptor and the kernel hands every datagram to one of the readers.
+void __np_network_init_shards(np_network_t *ng) {
+  np_ctx_memory(ng);
+
+  uint8_t in_loops = _np_event_in_loop_count(context);
+  if (in_loops < 2) return;
+
+  ng->shards = calloc(in_loops - 1, sizeof(struct np_network_shard_s));
+  CHECK_MALLOC(ng->shards);
+
+  for (uint8_t i = 1; i < in_loops; i++) {
+    int fd = dup(ng->socket);
+    if (0 > fd) {
+      log_warn(LOG_NETWORK,
+               NULL,
+               "network: %p could not add a listener on inbound loop %" PRIu8
+               ": %s",
+               ng,
+               i,
+               strerror(errno));
+      break;
+    }
+
+    struct np_network_shard_s *shard = &ng->shards[ng->shard_count];
+    shard->socket                    = fd;
+    shard->in_loop                   = i;
+    ev_io_init(&shard->watcher_in, _np_network_read, fd, EV_READ);
+    // the loops read concurrently, each listener gets its own watcher data
+    shard->watcher_in.data = calloc(1, sizeof(_np_network_data_t));
+    CHECK_MALLOC(shard->watcher_in.data);
+    memcpy(shard->watcher_in.data,
+           ng->watcher_in.data,
+           sizeof(_np_network_data_t));
+#ifdef NP_NETWORK_USE_MMSG
+    _np_network_data_t *shard_data = shard->watcher_in.data;
+    memset(shard_data->read_buffers, 0, sizeof(shard_data->read_buffers));
+#endif
+    ng->shard_count++;
+  }
+  log_debug(LOG_NETWORK,
+            NULL,
+            "network: %p reads on %" PRIu8 " inbound loops",
+            ng,
+            ng->shard_count + 1);
+}
+
 /** _np_network_init:
  ** initiates the networking layer structures required for a target_node
  ** if the port number is bigger than zero, it will create a socket and bind it
@@ -1187,6 +1690,16 @@ bool _np_network_init(np_network_t *ng,
     }
     ((_np_network_data_t *)ng->watcher_in.data)->network = ng;
 
+    if (prepared_socket_fd > 0) {
+      // accepted or passive connections: pin the flow to one inbound loop
+      ng->in_loop = _np_event_in_loop_select(
+          context,
+          np_dhkey_create_from_hostport(hostname, service));
+    } else if (FLAG_CMP(type, UDP)) {
+      // every inbound loop reads from the socket
+      __np_network_init_shards(ng);
+    }
+
     ng->initialized = true;
     log_debug(LOG_NETWORK, NULL, "created local listening socket");
   } else {
@@ -1666,9 +2179,25 @@ void _np_network_enable(np_network_t *self) {
   }
 }
 
+void _np_network_share_connection(np_network_t *self,
+                                  np_network_t *connection) {
+  np_ctx_memory(self);
+  assert(NULL == self->shared_connection);
+
+  np_ref_obj(np_network_t, connection, "_np_network_share_connection");
+  self->shared_connection  = connection;
+  self->is_multiuse_socket = true;
+}
+
 void _np_network_set_key(np_network_t *self, np_dhkey_t dhkey) {
   _np_dhkey_assign(&((_np_network_data_t *)self->watcher_in.data)->owner_dhkey,
                    &dhkey);
+  for (uint8_t i = 0; i < self->shard_count; i++) {
+    _np_dhkey_assign(
+        &((_np_network_data_t *)self->shards[i].watcher_in.data)
+             ->owner_dhkey,
+        &dhkey);
+  }
   _np_dhkey_assign(&((_np_network_data_t *)self->watcher_out.data)->owner_dhkey,
                    &dhkey);
 }
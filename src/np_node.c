@@ -431,10 +431,10 @@ np_node_t *_np_node_from_token(np_handshake_token_t *token,
   struct np_data_conf conf;
   enum np_data_return get_data_ret;
 
-  if ((get_data_ret = np_get_data(token->attributes,
-                                  NP_HS_PRIO,
-                                  &conf,
-                                  &handshake_priority)) == np_ok) {
+  if ((get_data_ret = _np_aaatoken_get_data(token,
+                                            NP_HS_PRIO,
+                                            &conf,
+                                            &handshake_priority)) == np_ok) {
     new_node->handshake_priority = handshake_priority.unsigned_integer;
 
   } else {
@@ -447,10 +447,11 @@ np_node_t *_np_node_from_token(np_handshake_token_t *token,
   }
 
   // Extract max_messages_per_seconds from token attributes
-  if ((get_data_ret = np_get_data(token->attributes,
-                                  NP_NW_MAX_MSGS_PER_SEC,
-                                  &conf,
-                                  &max_messages_per_seconds)) == np_ok) {
+  if ((get_data_ret = _np_aaatoken_get_data(token,
+                                            NP_NW_MAX_MSGS_PER_SEC,
+                                            &conf,
+                                            &max_messages_per_seconds)) ==
+      np_ok) {
     new_node->max_messages_per_sec = max_messages_per_seconds.unsigned_integer;
   } else {
     log_msg(LOG_DEBUG | LOG_AAATOKEN,
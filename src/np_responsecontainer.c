@@ -4,6 +4,11 @@
 //
 #include "np_responsecontainer.h"
 
+#include <stdlib.h>
+#include <string.h>
+
+#include "sodium.h"
+
 #include "neuropil_log.h"
 
 #include "np_constants.h"
@@ -26,6 +31,7 @@ void _np_responsecontainer_t_new(NP_UNUSED np_state_t *context,
   entry->expires_at  = 0.0;
   entry->received_at = 0.0;
   entry->send_at     = 0.0;
+  entry->_heap_index = 0;
 }
 
 void _np_responsecontainer_t_del(np_state_t       *context,
@@ -34,3 +40,216 @@ void _np_responsecontainer_t_del(np_state_t       *context,
                                  void             *obj) {
   // empty
 }
+
+struct np_responsetable_s {
+  np_responsecontainer_t **slots; // hash map by uuid, linear probing
+  uint32_t                 capacity;
+
+  np_responsecontainer_t **heap; // min heap by expires_at
+  uint32_t                 count;
+
+  unsigned char hash_key[crypto_shorthash_KEYBYTES];
+};
+
+static inline uint32_t __np_responsetable_slot(const np_responsetable_t *table,
+                                               const unsigned char      *uuid) {
+  uint64_t hash = 0;
+  crypto_shorthash_siphash24((unsigned char *)&hash,
+                             uuid,
+                             NP_UUID_BYTES,
+                             table->hash_key);
+  return (uint32_t)hash & (table->capacity - 1);
+}
+
+static bool __np_responsetable_find_slot(const np_responsetable_t *table,
+                                         const unsigned char      *uuid,
+                                         uint32_t                 *pos) {
+  uint32_t mask = table->capacity - 1;
+  uint32_t i    = __np_responsetable_slot(table, uuid);
+  // the load factor ensures that there always is an empty slot to stop at
+  while (table->slots[i] != NULL) {
+    if (memcmp(table->slots[i]->uuid, uuid, NP_UUID_BYTES) == 0) {
+      *pos = i;
+      return true;
+    }
+    i = (i + 1) & mask;
+  }
+  *pos = i;
+  return false;
+}
+
+static void __np_responsetable_heap_set(np_responsetable_t     *table,
+                                        uint32_t                i,
+                                        np_responsecontainer_t *entry) {
+  table->heap[i]     = entry;
+  entry->_heap_index = i;
+}
+
+static void __np_responsetable_sift_up(np_responsetable_t *table, uint32_t i) {
+  np_responsecontainer_t *entry = table->heap[i];
+  while (i > 0) {
+    uint32_t parent = (i - 1) / 2;
+    if (table->heap[parent]->expires_at <= entry->expires_at) break;
+    __np_responsetable_heap_set(table, i, table->heap[parent]);
+    i = parent;
+  }
+  __np_responsetable_heap_set(table, i, entry);
+}
+
+static void __np_responsetable_sift_down(np_responsetable_t *table,
+                                         uint32_t            i) {
+  np_responsecontainer_t *entry = table->heap[i];
+  while (2 * i + 1 < table->count) {
+    uint32_t child = 2 * i + 1;
+    if (child + 1 < table->count &&
+        table->heap[child + 1]->expires_at < table->heap[child]->expires_at)
+      child++;
+    if (entry->expires_at <= table->heap[child]->expires_at) break;
+    __np_responsetable_heap_set(table, i, table->heap[child]);
+    i = child;
+  }
+  __np_responsetable_heap_set(table, i, entry);
+}
+
+static bool __np_responsetable_grow(np_responsetable_t *table) {
+  uint32_t                 capacity = table->capacity << 1;
+  np_responsecontainer_t **slots = calloc(capacity, sizeof(*slots));
+  np_responsecontainer_t **heap =
+      realloc(table->heap, (capacity / 4 * 3) * sizeof(*heap));
+  if (slots == NULL || heap == NULL) {
+    free(slots);
+    if (heap != NULL) table->heap = heap;
+    return false;
+  }
+  table->heap = heap;
+
+  np_responsecontainer_t **old_slots    = table->slots;
+  uint32_t                 old_capacity = table->capacity;
+  table->slots                          = slots;
+  table->capacity                       = capacity;
+
+  for (uint32_t i = 0; i < old_capacity; i++) {
+    if (old_slots[i] == NULL) continue;
+    uint32_t pos;
+    __np_responsetable_find_slot(table,
+                                 (unsigned char *)old_slots[i]->uuid,
+                                 &pos);
+    table->slots[pos] = old_slots[i];
+  }
+  free(old_slots);
+  return true;
+}
+
+// backward shift deletion, keeps the probe sequences free of tombstones
+static void __np_responsetable_delete_slot(np_responsetable_t *table,
+                                           uint32_t            pos) {
+  uint32_t mask = table->capacity - 1;
+  uint32_t i    = pos;
+  uint32_t j    = pos;
+
+  table->slots[i] = NULL;
+  while (true) {
+    j = (j + 1) & mask;
+    if (table->slots[j] == NULL) break;
+
+    uint32_t home =
+        __np_responsetable_slot(table, (unsigned char *)table->slots[j]->uuid);
+    // move the entry if its home slot is not in the cyclic range (i, j]
+    if ((j > i && (home <= i || home > j)) ||
+        (j < i && (home <= i && home > j))) {
+      table->slots[i] = table->slots[j];
+      table->slots[j] = NULL;
+      i               = j;
+    }
+  }
+}
+
+static void __np_responsetable_delete_heap(np_responsetable_t *table,
+                                           uint32_t            i) {
+  table->count--;
+  if (i == table->count) return;
+
+  __np_responsetable_heap_set(table, i, table->heap[table->count]);
+  if (i > 0 &&
+      table->heap[i]->expires_at < table->heap[(i - 1) / 2]->expires_at)
+    __np_responsetable_sift_up(table, i);
+  else __np_responsetable_sift_down(table, i);
+}
+
+np_responsetable_t *_np_responsetable_create() {
+  np_responsetable_t *table = calloc(1, sizeof(np_responsetable_t));
+  if (table == NULL) return NULL;
+
+  table->capacity = 64;
+  table->slots    = calloc(table->capacity, sizeof(np_responsecontainer_t *));
+  table->heap =
+      calloc(table->capacity / 4 * 3, sizeof(np_responsecontainer_t *));
+  if (table->slots == NULL || table->heap == NULL) {
+    _np_responsetable_free(table);
+    return NULL;
+  }
+  // acknowledgements and their uuids are remote controlled
+  randombytes_buf(table->hash_key, crypto_shorthash_KEYBYTES);
+
+  return table;
+}
+
+void _np_responsetable_free(np_responsetable_t *table) {
+  if (table == NULL) return;
+
+  free(table->slots);
+  free(table->heap);
+  free(table);
+}
+
+bool _np_responsetable_insert(np_responsetable_t     *table,
+                              np_responsecontainer_t *entry) {
+  uint32_t pos;
+  if (__np_responsetable_find_slot(table,
+                                   (unsigned char *)entry->uuid,
+                                   &pos))
+    return false;
+
+  // keep the load factor <= 0.75
+  if (table->count + 1 > table->capacity / 4 * 3) {
+    if (!__np_responsetable_grow(table)) return false;
+    __np_responsetable_find_slot(table, (unsigned char *)entry->uuid, &pos);
+  }
+  table->slots[pos] = entry;
+
+  __np_responsetable_heap_set(table, table->count, entry);
+  table->count++;
+  __np_responsetable_sift_up(table, entry->_heap_index);
+
+  return true;
+}
+
+np_responsecontainer_t *_np_responsetable_find(np_responsetable_t  *table,
+                                               const unsigned char *uuid) {
+  uint32_t pos;
+  if (!__np_responsetable_find_slot(table, uuid, &pos)) return NULL;
+  return table->slots[pos];
+}
+
+np_responsecontainer_t *_np_responsetable_remove(np_responsetable_t  *table,
+                                                 const unsigned char *uuid) {
+  uint32_t pos;
+  if (!__np_responsetable_find_slot(table, uuid, &pos)) return NULL;
+
+  np_responsecontainer_t *entry = table->slots[pos];
+  __np_responsetable_delete_slot(table, pos);
+  __np_responsetable_delete_heap(table, entry->_heap_index);
+
+  return entry;
+}
+
+np_responsecontainer_t *_np_responsetable_pop_expired(np_responsetable_t *table,
+                                                      double              now) {
+  if (table->count == 0 || table->heap[0]->expires_at >= now) return NULL;
+
+  return _np_responsetable_remove(table, (unsigned char *)table->heap[0]->uuid);
+}
+
+uint32_t _np_responsetable_size(np_responsetable_t *table) {
+  return table->count;
+}
@@ -19,6 +19,7 @@
 #include "util/np_scache.h"
 #include "util/np_tree.h"
 
+#include "np_aaatoken.h"
 #include "np_jobqueue.h"
 #include "np_key.h"
 #include "np_legacy.h"
@@ -127,6 +128,26 @@ bool __np_statistics_gather_data_clb(np_state_t               *context,
                             [np_prometheus_exposed_metrics_routing_route_count],
                         _np_route_my_key_count_routes(context));
 
+  uint16_t hs_queue_depth = 0;
+  double   hs_latency     = 0.0;
+  uint32_t hs_dropped     = 0;
+  _np_aaatoken_handshake_statistics(context,
+                                    &hs_queue_depth,
+                                    &hs_latency,
+                                    &hs_dropped);
+  prometheus_metric_set(
+      _module->_prometheus_metrics
+          [np_prometheus_exposed_metrics_handshake_queue_depth],
+      hs_queue_depth);
+  prometheus_metric_set(
+      _module->_prometheus_metrics
+          [np_prometheus_exposed_metrics_handshake_latency],
+      hs_latency);
+  prometheus_metric_set(
+      _module->_prometheus_metrics
+          [np_prometheus_exposed_metrics_handshake_dropped],
+      hs_dropped);
+
   return true;
 }
 int _np_http_handle_metrics(ht_request_t  *request,
@@ -205,6 +226,21 @@ bool _np_statistics_init(np_state_t *context) {
         prometheus_register_metric(_module->_prometheus_context,
                                    NP_STATISTICS_PROMETHEUS_PREFIX
                                    "pheromones_exhale");
+    _module->_prometheus_metrics
+        [np_prometheus_exposed_metrics_handshake_queue_depth] =
+        prometheus_register_metric(_module->_prometheus_context,
+                                   NP_STATISTICS_PROMETHEUS_PREFIX
+                                   "handshake_queue_depth");
+    _module
+        ->_prometheus_metrics[np_prometheus_exposed_metrics_handshake_latency] =
+        prometheus_register_metric(_module->_prometheus_context,
+                                   NP_STATISTICS_PROMETHEUS_PREFIX
+                                   "handshake_latency_seconds");
+    _module
+        ->_prometheus_metrics[np_prometheus_exposed_metrics_handshake_dropped] =
+        prometheus_register_metric(_module->_prometheus_context,
+                                   NP_STATISTICS_PROMETHEUS_PREFIX
+                                   "handshake_dropped_sum");
 
     _module->_prometheus_metrics
         [np_prometheus_exposed_metrics_network_in_per_sec] =
@@ -329,6 +365,9 @@ __np_statistics_get_subject_metrics(np_state_t *context,
 typedef struct np_statistics_per_dhkey_metrics_s {
   prometheus_metric *latency;
   prometheus_metric *success_avg;
+  prometheus_metric *congestion_window;
+  prometheus_metric *rtt;
+  prometheus_metric *loss;
 } np_statistics_per_dhkey_metrics;
 
 np_statistics_per_dhkey_metrics *
@@ -356,6 +395,24 @@ __np_statistics_get_dhkey_metrics(np_state_t *context, np_dhkey_t id) {
     prometheus_metric_add_label(ret->success_avg, label);
     _np_statistics_update_prometheus_labels(context, ret->success_avg);
 
+    ret->congestion_window = prometheus_register_metric(
+        _module->_prometheus_context,
+        NP_STATISTICS_PROMETHEUS_PREFIX "congestion_window");
+    prometheus_metric_add_label(ret->congestion_window, label);
+    _np_statistics_update_prometheus_labels(context, ret->congestion_window);
+
+    ret->rtt =
+        prometheus_register_metric(_module->_prometheus_context,
+                                   NP_STATISTICS_PROMETHEUS_PREFIX "rtt");
+    prometheus_metric_add_label(ret->rtt, label);
+    _np_statistics_update_prometheus_labels(context, ret->rtt);
+
+    ret->loss =
+        prometheus_register_metric(_module->_prometheus_context,
+                                   NP_STATISTICS_PROMETHEUS_PREFIX "loss");
+    prometheus_metric_add_label(ret->loss, label);
+    _np_statistics_update_prometheus_labels(context, ret->loss);
+
     np_tree_insert_dhkey(np_module(statistics)->_per_dhkey_metrics,
                          id,
                          np_treeval_new_v(ret));
@@ -890,6 +947,22 @@ void __np_statistics_set_success_avg(np_state_t *context,
         value);
   }
 }
+void __np_statistics_set_congestion(np_state_t *context,
+                                    np_dhkey_t  id,
+                                    float       cwnd,
+                                    float       rtt,
+                                    float       loss) {
+  if (np_module_initiated(statistics)) {
+    // the node handlers of different peers report concurrently
+    _LOCK_MODULE(np_utilstatistics_t) {
+      np_statistics_per_dhkey_metrics *metrics =
+          __np_statistics_get_dhkey_metrics(context, id);
+      prometheus_metric_set(metrics->congestion_window, cwnd);
+      prometheus_metric_set(metrics->rtt, rtt);
+      prometheus_metric_set(metrics->loss, loss);
+    }
+  }
+}
 
 void __np_increment_forwarding_counter(np_state_t          *context,
                                        NP_UNUSED np_dhkey_t subject) {
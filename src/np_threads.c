@@ -1015,6 +1015,9 @@ void np_threads_shutdown_workers(np_state_t *context) {
   // _np_event_invoke_out(context);
   _np_event_reconfigure_loop_in(context);
   // _np_event_invoke_in(context);
+  for (uint8_t i = 1; i < _np_event_in_loop_count(context); i++) {
+    _np_event_reconfigure_loop_in_shard(context, i);
+  }
   _np_event_reconfigure_loop_file(context);
   // _np_event_invoke_file(context);
   _np_event_reconfigure_loop_http(context);
@@ -1162,6 +1165,20 @@ void np_threads_start_workers(NP_UNUSED np_state_t *context,
                                       "_np_events_read_file");
   }
 
+  // every further io thread drives one more inbound loop
+  for (uint8_t i = 1;
+       i < _np_event_in_loop_count(context) && pool_size > worker_threads;
+       i++) {
+    pool_size--;
+    special_thread = __np_createThread(context,
+                                       _np_event_in_shard_run,
+                                       true,
+                                       np_thread_type_eventloop);
+#ifdef DEBUG_CALLBACKS
+    strncpy(special_thread->job.ident, "_np_event_in_shard_run", 255);
+#endif
+  }
+
   // just a bunch of threads trying to get the first element from a priority
   // queue
   for (int8_t i = 0; i < pool_size; i++) {
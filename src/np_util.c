@@ -52,8 +52,52 @@ NP_SLL_GENERATE_IMPLEMENTATION(char_ptr);
 NP_SLL_GENERATE_IMPLEMENTATION_COMPARATOR(np_key_ptr);
 NP_SLL_GENERATE_IMPLEMENTATION(np_key_ptr);
 
-char *
-np_uuid_create(const char *str, const uint32_t num, unsigned char **buffer) {
+// every thread creates its uuids from a random prefix and a counter, the
+// prefix is drawn again in a forked child process. Prefix and counter are
+// hashed with a per process secret before they leave the process, so that
+// peers cannot predict the next uuids of a node
+struct __np_uuid_state_s {
+  uint8_t  prefix[8];
+  uint64_t counter;
+  uint32_t generation;
+};
+
+static pthread_key_t     __np_uuid_key;
+static pthread_once_t    __np_uuid_once       = PTHREAD_ONCE_INIT;
+static volatile uint32_t __np_uuid_generation = 1;
+static unsigned char     __np_uuid_secret[crypto_generichash_blake2b_KEYBYTES];
+
+static void __np_uuid_atfork_child(void) {
+  randombytes_buf(__np_uuid_secret, sizeof(__np_uuid_secret));
+  __np_uuid_generation++;
+}
+
+static void __np_uuid_init_once(void) {
+  randombytes_buf(__np_uuid_secret, sizeof(__np_uuid_secret));
+  pthread_key_create(&__np_uuid_key, free);
+  pthread_atfork(NULL, NULL, __np_uuid_atfork_child);
+}
+
+static struct __np_uuid_state_s *__np_uuid_state(void) {
+  pthread_once(&__np_uuid_once, __np_uuid_init_once);
+
+  struct __np_uuid_state_s *state = pthread_getspecific(__np_uuid_key);
+  if (state == NULL) {
+    state = calloc(1, sizeof(struct __np_uuid_state_s));
+    CHECK_MALLOC(state);
+    pthread_setspecific(__np_uuid_key, state);
+  }
+  if (state->generation != __np_uuid_generation) {
+    randombytes_buf(state->prefix, sizeof(state->prefix));
+    randombytes_buf(&state->counter, sizeof(state->counter));
+    state->generation = __np_uuid_generation;
+  }
+  return state;
+}
+
+char *np_uuid_create(NP_UNUSED const char    *str,
+                     NP_UNUSED const uint32_t num,
+                     unsigned char          **buffer) {
   unsigned char *uuid_out = NULL;
   if (buffer == NULL) {
     uuid_out = calloc(1, NP_UUID_BYTES);
@@ -61,17 +105,20 @@ np_uuid_create(const char *str, const uint32_t num, unsigned char **buffer) {
   } else {
     uuid_out = *buffer;
   }
-  char input[256] = {0};
 
-  double now = _np_time_now(NULL);
-  snprintf(input, 255, "%64s:%010u:%16.16f", str, num, now);
+  struct __np_uuid_state_s *state   = __np_uuid_state();
+  uint64_t                  counter = state->counter++;
+
+  unsigned char input[sizeof(state->prefix) + sizeof(counter)];
+  memcpy(input, state->prefix, sizeof(state->prefix));
+  memcpy(&input[sizeof(state->prefix)], &counter, sizeof(counter));
 
   crypto_generichash_blake2b(uuid_out,
-                             16,
-                             (unsigned char *)input,
-                             256,
-                             NULL,
-                             0);
+                             NP_UUID_BYTES,
+                             input,
+                             sizeof(input),
+                             __np_uuid_secret,
+                             sizeof(__np_uuid_secret));
 
   return uuid_out;
 }
@@ -0,0 +1,440 @@
+//
+// SPDX-FileCopyrightText: 2016-2024 by pi-lar GmbH
+// SPDX-License-Identifier: OSL-3.0
+//
+
+#include "np_warmstart.h"
+
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "neuropil_log.h"
+
+#include "core/np_comp_intent.h"
+#include "core/np_comp_msgproperty.h"
+#include "util/np_event.h"
+#include "util/np_list.h"
+#include "util/np_serialization.h"
+#include "util/np_tree.h"
+#include "util/np_treeval.h"
+
+#include "np_aaatoken.h"
+#include "np_constants.h"
+#include "np_jobqueue.h"
+#include "np_key.h"
+#include "np_keycache.h"
+#include "np_legacy.h"
+#include "np_log.h"
+#include "np_memory.h"
+#include "np_network.h"
+#include "np_node.h"
+#include "np_route.h"
+#include "np_threads.h"
+#include "np_time.h"
+#include "np_token_factory.h"
+#include "np_util.h"
+
+np_module_struct(warmstart) {
+  np_state_t *context;
+  // serializes the periodic job and the final snapshot of np_destroy
+  np_mutex_t write_lock;
+  // nothing is written before the old snapshot has been restored
+  bool restored;
+};
+
+static bool __np_warmstart_write_job(np_state_t               *context,
+                                     NP_UNUSED np_util_event_t event) {
+  _np_warmstart_write(context);
+  return true;
+}
+
+bool _np_warmstart_init(np_state_t *context) {
+  if (context->settings->warmstart_file[0] == '\0') return true;
+
+  if (!np_module_initiated(warmstart)) {
+    np_module_malloc(warmstart);
+    _np_threads_mutex_init(context,
+                           &_module->write_lock,
+                           "urn:np:warmstart:write");
+    _module->restored = false;
+  }
+  return true;
+}
+
+void _np_warmstart_destroy(np_state_t *context) {
+  if (np_module_initiated(warmstart)) {
+    np_module_var(warmstart);
+
+    _np_threads_mutex_destroy(context, &_module->write_lock);
+    np_module_free(warmstart);
+  }
+}
+
+enum np_return _np_warmstart_write_file(np_state_t *context,
+                                        const char *filename,
+                                        np_tree_t  *body) {
+  char tmp_filename[PATH_MAX];
+  snprintf(tmp_filename, PATH_MAX, "%s.tmp", filename);
+
+  size_t   body_size = np_tree_get_byte_size(body);
+  uint8_t *data      = malloc(body_size);
+  CHECK_MALLOC(data);
+
+  np_serialize_buffer_t serializer = {._tree          = body,
+                                      ._target_buffer = data,
+                                      ._buffer_size   = body_size,
+                                      ._bytes_written = 0,
+                                      ._error         = 0};
+  np_serializer_write_map(context, &serializer, body);
+
+  struct np_warmstart_header_s header = {
+      .version   = NP_WARMSTART_VERSION,
+      .body_size = serializer._bytes_written,
+  };
+  memcpy(header.magic, NP_WARMSTART_MAGIC, 8);
+  crypto_generichash(header.checksum,
+                     crypto_generichash_BYTES,
+                     data,
+                     header.body_size,
+                     NULL,
+                     0);
+
+  bool  ret  = (serializer._error == 0 && header.body_size > 0);
+  FILE *file = ret ? fopen(tmp_filename, "wb") : NULL;
+  if (file != NULL) {
+    ret = (1 == fwrite(&header, sizeof(header), 1, file)) &&
+          (1 == fwrite(data, header.body_size, 1, file));
+    ret = (0 == fclose(file)) && ret;
+  } else {
+    ret = false;
+  }
+  free(data);
+
+  // the old snapshot stays valid until the new one is complete
+  if (ret && 0 == rename(tmp_filename, filename)) return np_ok;
+
+  unlink(tmp_filename);
+  return np_operation_failed;
+}
+
+enum np_return _np_warmstart_read_file(np_state_t *context,
+                                       const char *filename,
+                                       np_tree_t  *body) {
+  FILE *file = fopen(filename, "rb");
+  if (file == NULL) return np_operation_failed;
+
+  struct np_warmstart_header_s header = {0};
+  struct stat                  fileinfo;
+  uint8_t                     *data = NULL;
+
+  bool ret = (0 == fstat(fileno(file), &fileinfo)) &&
+             (1 == fread(&header, sizeof(header), 1, file)) &&
+             0 == memcmp(header.magic, NP_WARMSTART_MAGIC, 8) &&
+             header.version == NP_WARMSTART_VERSION && header.body_size > 0 &&
+             fileinfo.st_size == (off_t)(sizeof(header) + header.body_size);
+  if (ret) {
+    data = malloc(header.body_size);
+    CHECK_MALLOC(data);
+    ret = (1 == fread(data, header.body_size, 1, file));
+  }
+  fclose(file);
+
+  if (ret) {
+    unsigned char checksum[crypto_generichash_BYTES];
+    crypto_generichash(checksum,
+                       crypto_generichash_BYTES,
+                       data,
+                       header.body_size,
+                       NULL,
+                       0);
+    ret = (0 == sodium_memcmp(checksum, header.checksum, sizeof(checksum)));
+  }
+  if (ret) {
+    np_deserialize_buffer_t deserializer = {._target_tree = body,
+                                            ._buffer      = data,
+                                            ._buffer_size = header.body_size,
+                                            ._bytes_read  = 0,
+                                            ._error       = 0};
+    np_serializer_read_map(context, &deserializer, body);
+    ret = (deserializer._error == 0);
+  }
+  free(data);
+
+  return ret ? np_ok : np_operation_failed;
+}
+
+static void __np_warmstart_node_tokens(np_state_t *context,
+                                       np_sll_t(np_key_ptr, node_keys),
+                                       np_sll_t(np_aaatoken_ptr, tokens)) {
+  double now = np_time_now();
+
+  sll_iterator(np_key_ptr) iter = sll_first(node_keys);
+  while (iter != NULL) {
+    // the handshake token of a peer is signed by the peer and contains its
+    // address
+    _LOCK_ACCESS(&iter->val->key_lock) {
+      np_aaatoken_t *token = iter->val->entity_array[e_handshake_token];
+      if (token != NULL && token->expires_at > now) {
+        np_ref_obj(np_aaatoken_t, token, FUNC);
+        sll_append(np_aaatoken_ptr, tokens, token);
+      }
+    }
+    sll_next(iter);
+  }
+}
+
+static uint32_t __np_warmstart_add_tokens(np_tree_t  *body,
+                                          const char *section,
+                                          np_sll_t(np_aaatoken_ptr, tokens)) {
+  np_tree_t *section_data = np_tree_create();
+  int16_t    count        = 0;
+
+  sll_iterator(np_aaatoken_ptr) iter = sll_first(tokens);
+  while (iter != NULL && count < NP_WARMSTART_MAX_TOKENS) {
+    np_tree_t *token_data = np_tree_create();
+    np_aaatoken_encode(token_data, iter->val);
+    np_tree_insert_int(section_data, count, np_treeval_new_cwt(token_data));
+    np_tree_free(token_data);
+    count++;
+    sll_next(iter);
+  }
+
+  if (count > 0) {
+    np_tree_insert_str(body, section, np_treeval_new_tree(section_data));
+  }
+  np_tree_free(section_data);
+
+  return count;
+}
+
+static uint32_t __np_warmstart_add_nodes(np_state_t *context,
+                                         np_tree_t  *body,
+                                         const char *section,
+                                         np_sll_t(np_key_ptr, node_keys)) {
+  sll_init_full(np_aaatoken_ptr, tokens);
+
+  __np_warmstart_node_tokens(context, node_keys, tokens);
+  uint32_t ret = __np_warmstart_add_tokens(body, section, tokens);
+
+  np_aaatoken_unref_list(tokens, "__np_warmstart_node_tokens");
+  sll_free(np_aaatoken_ptr, tokens);
+
+  return ret;
+}
+
+static void __np_warmstart_add_intents(np_state_t *context, np_tree_t *body) {
+  sll_init_full(np_aaatoken_ptr, senders);
+  sll_init_full(np_aaatoken_ptr, receivers);
+
+  np_sll_t(np_key_ptr, keys)    = _np_keycache_get_all(context);
+  sll_iterator(np_key_ptr) iter = sll_first(keys);
+  while (iter != NULL) {
+    _LOCK_ACCESS(&iter->val->key_lock) {
+      if (FLAG_CMP(iter->val->type, np_key_type_subject)) {
+        _np_intent_get_all_tokens(iter->val, &senders, &receivers);
+      }
+    }
+    sll_next(iter);
+  }
+  np_key_unref_list(keys, "_np_keycache_get_all");
+  sll_free(np_key_ptr, keys);
+
+  __np_warmstart_add_tokens(body, _NP_WARMSTART_SENDERS, senders);
+  __np_warmstart_add_tokens(body, _NP_WARMSTART_RECEIVERS, receivers);
+
+  np_aaatoken_unref_list(senders, "_np_intent_get_all_tokens");
+  sll_free(np_aaatoken_ptr, senders);
+  np_aaatoken_unref_list(receivers, "_np_intent_get_all_tokens");
+  sll_free(np_aaatoken_ptr, receivers);
+}
+
+enum np_return _np_warmstart_write(np_state_t *context) {
+  if (np_module_not_initiated(warmstart)) return np_invalid_operation;
+  np_module_var(warmstart);
+
+  enum np_return ret = np_invalid_operation;
+
+  _LOCK_ACCESS(&_module->write_lock) {
+    if (_module->restored) {
+      np_tree_t *body  = np_tree_create();
+      uint32_t   nodes = 0;
+
+      np_sll_t(np_key_ptr, leafset) = _np_route_neighbors(context);
+      nodes += __np_warmstart_add_nodes(context,
+                                        body,
+                                        _NP_WARMSTART_LEAFSET,
+                                        leafset);
+      np_key_unref_list(leafset, "_np_route_neighbors");
+      sll_free(np_key_ptr, leafset);
+
+      np_sll_t(np_key_ptr, routes) = _np_route_get_table(context);
+      nodes += __np_warmstart_add_nodes(context,
+                                        body,
+                                        _NP_WARMSTART_ROUTES,
+                                        routes);
+      np_key_unref_list(routes, "_np_route_get_table");
+      sll_free(np_key_ptr, routes);
+
+      __np_warmstart_add_intents(context, body);
+
+      // a node without peers keeps the snapshot of its last neighbourhood
+      if (nodes > 0) {
+        ret = _np_warmstart_write_file(context,
+                                       context->settings->warmstart_file,
+                                       body);
+      }
+      log_debug(LOG_MISC,
+                NULL,
+                "warm start snapshot of %" PRIu32 " nodes written: %s",
+                nodes,
+                np_error_str(ret));
+      np_tree_free(body);
+    }
+  }
+  return ret;
+}
+
+static uint32_t __np_warmstart_join_nodes(np_state_t *context,
+                                          np_tree_t  *body,
+                                          const char *section,
+                                          np_tree_t  *joined) {
+  np_tree_elem_t *section_data = np_tree_find_str(body, section);
+  if (section_data == NULL) return 0;
+
+  uint32_t        ret  = 0;
+  np_tree_elem_t *iter = NULL;
+  RB_FOREACH (iter, np_tree_s, section_data->val.value.tree) {
+    // checks the signature and the expiry of the token
+    np_aaatoken_t *token =
+        np_token_factory_read_from_tree(context, iter->val.value.tree);
+    if (token == NULL) continue;
+
+    np_node_t *node = NULL;
+    if (FLAG_CMP(token->type, np_aaatoken_type_handshake) &&
+        NULL == np_tree_find_str(joined, token->issuer) &&
+        0 != strncmp(token->issuer, _np_key_as_str(context->my_node_key), 64)) {
+      node = _np_node_from_token(token, np_aaatoken_type_handshake);
+    }
+
+    // passive nodes cannot be contacted, they have to join us
+    if (node != NULL && !FLAG_CMP(node->protocol, PASSIVE)) {
+      char *connection_str = np_build_connection_string(
+          node->host_key,
+          _np_network_get_protocol_string(context, node->protocol),
+          node->ip_string,
+          node->port,
+          true);
+      log_debug(LOG_ROUTING,
+                token->uuid,
+                "rejoining warm start node %s",
+                connection_str);
+      np_send_join(context, connection_str);
+      np_tree_insert_str(joined, token->issuer, np_treeval_new_i(1));
+      free(connection_str);
+      ret++;
+    }
+
+    if (node != NULL) np_unref_obj(np_node_t, node, "_np_node_from_token");
+    np_unref_obj(np_aaatoken_t, token, "np_token_factory_read_from_tree");
+  }
+  return ret;
+}
+
+static uint32_t __np_warmstart_import_intents(np_state_t      *context,
+                                              np_tree_t       *body,
+                                              const char      *section,
+                                              np_msg_mode_type mode_type) {
+  np_tree_elem_t *section_data = np_tree_find_str(body, section);
+  if (section_data == NULL) return 0;
+
+  uint32_t        ret  = 0;
+  np_tree_elem_t *iter = NULL;
+  RB_FOREACH (iter, np_tree_s, section_data->val.value.tree) {
+    np_aaatoken_t *token =
+        np_token_factory_read_from_tree(context, iter->val.value.tree);
+    if (token == NULL) continue;
+
+    if (FLAG_CMP(token->type, np_aaatoken_type_message_intent)) {
+      np_dhkey_t subject_dhkey = {0};
+      np_str_id((np_id *)&subject_dhkey, token->subject);
+      np_dhkey_t property_dhkey =
+          _np_msgproperty_tweaked_dhkey(mode_type, subject_dhkey);
+
+      // same path as a token of an available message, the msgproperty
+      // checks the policy and asks for authorization again
+      np_util_event_t authz_event = {.type =
+                                         (evt_token | evt_external | evt_authz),
+                                     .user_data    = token,
+                                     .target_dhkey = property_dhkey,
+                                     .current_run  = NULL};
+      _np_aaatoken_verify_submit(context,
+                                 token,
+                                 np_aaatoken_type_message_intent,
+                                 authz_event,
+                                 NULL);
+      ret++;
+    }
+    np_unref_obj(np_aaatoken_t, token, "np_token_factory_read_from_tree");
+  }
+  return ret;
+}
+
+uint32_t _np_warmstart_restore(np_state_t *context) {
+  if (np_module_not_initiated(warmstart)) return 0;
+  np_module_var(warmstart);
+
+  uint32_t   ret  = 0;
+  np_tree_t *body = np_tree_create();
+
+  if (np_ok == _np_warmstart_read_file(context,
+                                       context->settings->warmstart_file,
+                                       body)) {
+    // leafset first, the joins run in parallel
+    np_tree_t *joined = np_tree_create();
+    ret += __np_warmstart_join_nodes(context,
+                                     body,
+                                     _NP_WARMSTART_LEAFSET,
+                                     joined);
+    ret +=
+        __np_warmstart_join_nodes(context, body, _NP_WARMSTART_ROUTES, joined);
+    np_tree_free(joined);
+
+    // sender tokens are stored at the inbound, receiver tokens at the
+    // outbound msgproperty
+    ret += __np_warmstart_import_intents(context,
+                                         body,
+                                         _NP_WARMSTART_SENDERS,
+                                         INBOUND);
+    ret += __np_warmstart_import_intents(context,
+                                         body,
+                                         _NP_WARMSTART_RECEIVERS,
+                                         OUTBOUND);
+
+    log_info(LOG_MISC,
+             NULL,
+             "restored %" PRIu32 " tokens of warm start snapshot %s",
+             ret,
+             context->settings->warmstart_file);
+  } else {
+    log_debug(LOG_MISC,
+              NULL,
+              "no valid warm start snapshot %s",
+              context->settings->warmstart_file);
+  }
+  np_tree_free(body);
+
+  _LOCK_ACCESS(&_module->write_lock) { _module->restored = true; }
+
+  np_jobqueue_submit_event_periodic(context,
+                                    NP_PRIORITY_LOWEST,
+                                    NP_WARMSTART_WRITE_INTERVAL,
+                                    NP_WARMSTART_WRITE_INTERVAL,
+                                    __np_warmstart_write_job,
+                                    "__np_warmstart_write_job");
+  return ret;
+}
@@ -0,0 +1,103 @@
+//
+// SPDX-FileCopyrightText: 2016-2024 by pi-lar GmbH
+// SPDX-License-Identifier: OSL-3.0
+//
+#include "util/np_congestion.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "neuropil.h"
+
+#include "np_settings.h"
+
+void _np_congestion_init(np_congestion_t *cc, double now) {
+  cc->cwnd          = NP_CONGESTION_INITIAL_WINDOW;
+  cc->ssthresh      = NP_CONGESTION_MAX_WINDOW;
+  cc->srtt          = NP_CONGESTION_INITIAL_RTT_SEC;
+  cc->rttvar        = NP_CONGESTION_INITIAL_RTT_SEC / 2;
+  cc->min_rtt       = 0.0; // no sample yet
+  cc->loss          = 0.0;
+  cc->last_decrease = 0.0;
+  cc->paced         = false;
+
+  cc->tokens      = NP_CONGESTION_INITIAL_WINDOW;
+  cc->last_refill = now;
+}
+
+void _np_congestion_on_ack(np_congestion_t *cc, double rtt) {
+  if (rtt > 0.0) {
+    if (cc->min_rtt == 0.0) {
+      cc->srtt    = rtt;
+      cc->rttvar  = rtt / 2;
+      cc->min_rtt = rtt;
+    } else {
+      // smoothing as for the tcp retransmission timer (rfc 6298)
+      cc->rttvar  = 0.75 * cc->rttvar + 0.25 * fabs(cc->srtt - rtt);
+      cc->srtt    = 0.875 * cc->srtt + 0.125 * rtt;
+      cc->min_rtt = fmin(cc->min_rtt, rtt);
+    }
+  }
+  cc->loss = (1.0 - NP_CONGESTION_LOSS_GAIN) * cc->loss;
+  if (cc->loss < NP_CONGESTION_PACING_LOSS) cc->paced = false;
+
+  if (cc->cwnd < cc->ssthresh) {
+    cc->cwnd = fmin(cc->cwnd * 2.0, cc->ssthresh);
+  } else {
+    cc->cwnd += 1.0;
+  }
+  cc->cwnd = fmin(cc->cwnd, NP_CONGESTION_MAX_WINDOW);
+}
+
+void _np_congestion_on_loss(np_congestion_t *cc, double now) {
+  cc->loss = (1.0 - NP_CONGESTION_LOSS_GAIN) * cc->loss +
+             NP_CONGESTION_LOSS_GAIN;
+
+  // the timeouts of one window are a single congestion event, otherwise a
+  // lossy link would shrink the window with every lost package
+  if ((now - cc->last_decrease) < cc->srtt) return;
+
+  if (!cc->paced) {
+    // start with a full bucket, the peer has not been paced so far
+    cc->paced       = true;
+    cc->tokens      = cc->cwnd;
+    cc->last_refill = now;
+  }
+  cc->last_decrease = now;
+  cc->ssthresh =
+      fmax(cc->cwnd * NP_CONGESTION_DECREASE, NP_CONGESTION_MIN_WINDOW);
+  cc->cwnd   = cc->ssthresh;
+  cc->tokens = fmin(cc->tokens, cc->cwnd);
+}
+
+double _np_congestion_rate(const np_congestion_t *cc) {
+  return NP_CONGESTION_PACING_GAIN * cc->cwnd /
+         fmax(cc->srtt, NP_CONGESTION_MIN_RTT_SEC);
+}
+
+uint32_t _np_congestion_tokens(np_congestion_t *cc, double now) {
+  if (!cc->paced) return UINT32_MAX;
+
+  double elapsed = now - cc->last_refill;
+  if (elapsed > 0.0) {
+    cc->tokens =
+        fmin(cc->tokens + elapsed * _np_congestion_rate(cc), cc->cwnd);
+    cc->last_refill = now;
+  }
+  return (uint32_t)cc->tokens;
+}
+
+void _np_congestion_on_send(np_congestion_t *cc, uint32_t count) {
+  if (!cc->paced) return;
+
+  cc->tokens = fmax(cc->tokens - count, 0.0);
+  // packages without an acknowledgement open the window as well, by one
+  // package per window of sent packages
+  cc->cwnd = fmin(cc->cwnd + count / cc->cwnd, NP_CONGESTION_MAX_WINDOW);
+}
+
+double _np_congestion_delay(const np_congestion_t *cc) {
+  if (!cc->paced || cc->tokens >= 1.0) return 0.0;
+  return (1.0 - cc->tokens) / _np_congestion_rate(cc);
+}
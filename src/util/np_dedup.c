@@ -0,0 +1,238 @@
+//
+// SPDX-FileCopyrightText: 2016-2024 by pi-lar GmbH
+// SPDX-License-Identifier: OSL-3.0
+//
+#include "util/np_dedup.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sodium.h"
+
+#include "neuropil.h"
+
+#include "np_settings.h"
+
+struct np_dedup_bucket_s {
+  unsigned char (*slots)[NP_UUID_BYTES]; // allocated on first insert
+  uint32_t count;
+  bool     has_null; // the all zero uuid marks an empty slot
+  double   opened_at;
+  double   max_expiry;
+};
+
+struct np_dedup_s {
+  struct np_dedup_bucket_s bucket[NP_DEDUP_BUCKETS];
+  uint8_t                  current;
+
+  uint32_t capacity; // slots per bucket, always a power of two
+  uint32_t limit;    // max uuids per bucket, keeps the load factor <= 0.75
+  double   span;     // time window of a single bucket
+
+  uint32_t evicted;
+  unsigned char
+      hash_key[crypto_shorthash_KEYBYTES]; // uuids are remote controlled
+};
+
+static const unsigned char __np_dedup_null[NP_UUID_BYTES] = {0};
+
+static inline uint32_t __np_dedup_slot(const np_dedup_t    *dedup,
+                                       const unsigned char *uuid) {
+  uint64_t hash = 0;
+  crypto_shorthash_siphash24((unsigned char *)&hash,
+                             uuid,
+                             NP_UUID_BYTES,
+                             dedup->hash_key);
+  return (uint32_t)hash & (dedup->capacity - 1);
+}
+
+static inline bool __np_dedup_is_null(const unsigned char *uuid) {
+  return memcmp(uuid, __np_dedup_null, NP_UUID_BYTES) == 0;
+}
+
+static bool __np_dedup_bucket_find(const np_dedup_t               *dedup,
+                                   const struct np_dedup_bucket_s *bucket,
+                                   const unsigned char            *uuid,
+                                   uint32_t                       *pos) {
+  if (bucket->slots == NULL) return false;
+
+  uint32_t mask = dedup->capacity - 1;
+  uint32_t i    = __np_dedup_slot(dedup, uuid);
+  // the limit ensures that there always is an empty slot to stop at
+  while (!__np_dedup_is_null(bucket->slots[i])) {
+    if (memcmp(bucket->slots[i], uuid, NP_UUID_BYTES) == 0) {
+      if (pos != NULL) *pos = i;
+      return true;
+    }
+    i = (i + 1) & mask;
+  }
+  return false;
+}
+
+static void __np_dedup_bucket_drop(struct np_dedup_bucket_s *bucket) {
+  free(bucket->slots);
+  bucket->slots      = NULL;
+  bucket->count      = 0;
+  bucket->has_null   = false;
+  bucket->max_expiry = 0.0;
+}
+
+np_dedup_t *_np_dedup_create(double ttl, uint32_t max_entries) {
+  np_dedup_t *dedup = calloc(1, sizeof(np_dedup_t));
+  if (dedup == NULL) return NULL;
+
+  dedup->limit = max_entries / NP_DEDUP_BUCKETS;
+  if (dedup->limit < 16) dedup->limit = 16;
+
+  dedup->capacity = 32;
+  while (dedup->capacity < dedup->limit + dedup->limit / 3 + 1) {
+    dedup->capacity <<= 1;
+  }
+  // a uuid inserted at the end of a bucket window has to survive until the
+  // ring wraps around to this bucket again
+  dedup->span = (ttl > 0.0) ? ttl / (NP_DEDUP_BUCKETS - 1) : 0.0;
+
+  randombytes_buf(dedup->hash_key, crypto_shorthash_KEYBYTES);
+
+  return dedup;
+}
+
+void _np_dedup_free(np_dedup_t *dedup) {
+  if (dedup == NULL) return;
+
+  for (uint8_t i = 0; i < NP_DEDUP_BUCKETS; i++) {
+    free(dedup->bucket[i].slots);
+  }
+  free(dedup);
+}
+
+bool _np_dedup_contains(np_dedup_t *dedup, const unsigned char *uuid) {
+  bool is_null = __np_dedup_is_null(uuid);
+
+  // start with the most recent bucket, duplicates are usually close in time
+  for (uint8_t n = 0; n < NP_DEDUP_BUCKETS; n++) {
+    struct np_dedup_bucket_s *bucket =
+        &dedup->bucket[(dedup->current + NP_DEDUP_BUCKETS - n) %
+                       NP_DEDUP_BUCKETS];
+    if (bucket->count == 0) continue;
+
+    if (is_null) {
+      if (bucket->has_null) return true;
+    } else if (__np_dedup_bucket_find(dedup, bucket, uuid, NULL)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool _np_dedup_check_and_add(np_dedup_t          *dedup,
+                             const unsigned char *uuid,
+                             double               expiry,
+                             double               now) {
+  if (_np_dedup_contains(dedup, uuid)) return false;
+
+  struct np_dedup_bucket_s *bucket = &dedup->bucket[dedup->current];
+  if (bucket->count > 0 &&
+      (bucket->count >= dedup->limit ||
+       (dedup->span > 0.0 && (now - bucket->opened_at) >= dedup->span))) {
+    dedup->current = (dedup->current + 1) % NP_DEDUP_BUCKETS;
+    bucket         = &dedup->bucket[dedup->current];
+    if (bucket->count > 0) {
+      // memory ceiling reached, forget uuids before their expiry
+      if (bucket->max_expiry >= now) dedup->evicted += bucket->count;
+      __np_dedup_bucket_drop(bucket);
+    }
+  }
+
+  if (bucket->count == 0) bucket->opened_at = now;
+  if (bucket->max_expiry < expiry) bucket->max_expiry = expiry;
+
+  if (__np_dedup_is_null(uuid)) {
+    bucket->has_null = true;
+    bucket->count++;
+    return true;
+  }
+
+  if (bucket->slots == NULL) {
+    bucket->slots = calloc(dedup->capacity, NP_UUID_BYTES);
+    // without memory we cannot remember, but still accept the message
+    if (bucket->slots == NULL) return true;
+  }
+
+  uint32_t mask = dedup->capacity - 1;
+  uint32_t i    = __np_dedup_slot(dedup, uuid);
+  while (!__np_dedup_is_null(bucket->slots[i])) {
+    i = (i + 1) & mask;
+  }
+  memcpy(bucket->slots[i], uuid, NP_UUID_BYTES);
+  bucket->count++;
+
+  return true;
+}
+
+bool _np_dedup_remove(np_dedup_t *dedup, const unsigned char *uuid) {
+  bool     is_null = __np_dedup_is_null(uuid);
+  uint32_t mask    = dedup->capacity - 1;
+
+  for (uint8_t n = 0; n < NP_DEDUP_BUCKETS; n++) {
+    struct np_dedup_bucket_s *bucket = &dedup->bucket[n];
+    if (bucket->count == 0) continue;
+
+    if (is_null) {
+      if (!bucket->has_null) continue;
+      bucket->has_null = false;
+      bucket->count--;
+      return true;
+    }
+
+    uint32_t i = 0;
+    if (!__np_dedup_bucket_find(dedup, bucket, uuid, &i)) continue;
+
+    // backward shift deletion keeps the probe sequences intact without
+    // tombstones
+    uint32_t j = i;
+    while (true) {
+      j = (j + 1) & mask;
+      if (__np_dedup_is_null(bucket->slots[j])) break;
+
+      uint32_t k = __np_dedup_slot(dedup, bucket->slots[j]);
+      // skip entries whose home slot lies cyclically in (i, j]
+      if ((i <= j) ? (i < k && k <= j) : (i < k || k <= j)) continue;
+
+      memcpy(bucket->slots[i], bucket->slots[j], NP_UUID_BYTES);
+      i = j;
+    }
+    memset(bucket->slots[i], 0, NP_UUID_BYTES);
+    bucket->count--;
+    return true;
+  }
+  return false;
+}
+
+uint32_t _np_dedup_expire(np_dedup_t *dedup, double now) {
+  uint32_t removed = 0;
+
+  for (uint8_t n = 0; n < NP_DEDUP_BUCKETS; n++) {
+    struct np_dedup_bucket_s *bucket = &dedup->bucket[n];
+    if (bucket->count == 0 && bucket->slots == NULL) continue;
+
+    if (bucket->max_expiry < now) {
+      removed += bucket->count;
+      __np_dedup_bucket_drop(bucket);
+    }
+  }
+  return removed;
+}
+
+uint32_t _np_dedup_size(np_dedup_t *dedup) {
+  uint32_t size = 0;
+  for (uint8_t n = 0; n < NP_DEDUP_BUCKETS; n++) {
+    size += dedup->bucket[n].count;
+  }
+  return size;
+}
+
+uint32_t _np_dedup_evicted(np_dedup_t *dedup) { return dedup->evicted; }
@@ -21,6 +21,14 @@
 
 #include "np_dhkey.h"
 
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__) &&         \
+    defined(__linux__)
+#define NP_MINHASH_TARGET_CLONES                                               \
+  __attribute__((target_clones("avx2", "default")))
+#else
+#define NP_MINHASH_TARGET_CLONES
+#endif
+
 // pushes a new string value to the minhash and the minhash signature, but uses
 // the data dependant flex scheme
 void np_minhash_push_dd_flex(np_minhash_t        *minhash,
@@ -161,11 +169,13 @@ void np_minhash_push_single(np_minhash_t        *minhash,
   if (max_h > 0) minhash->_minimums[max_idx] = max_h;
 }
 
-// pushes a new string value to the minhash and the minhash signature, but uses
-// the multi value scheme
-void np_minhash_push_multi(np_minhash_t        *minhash,
-                           const unsigned char *bytes,
-                           uint16_t             bytes_length) {
+// the multi value scheme only uses the lower 32 bits of both siphash values:
+// (v1 + i * v2) & 0xFFFFFFFF == (uint32_t)v1 + i * (uint32_t)v2
+static void __np_minhash_hash(const np_minhash_t  *minhash,
+                              const unsigned char *bytes,
+                              uint16_t             bytes_length,
+                              uint32_t            *h1,
+                              uint32_t            *h2) {
   unsigned char sip_hash[crypto_shorthash_BYTES];
   uint64_t      v1 = UINT64_MAX;
   uint64_t      v2 = UINT64_MAX;
@@ -175,23 +185,41 @@ void np_minhash_push_multi(np_minhash_t        *minhash,
   crypto_shorthash_siphash24(sip_hash, bytes, bytes_length, &minhash->seed[16]);
   memcpy(&v2, &sip_hash[0], sizeof(uint64_t));
 
-  uint16_t half = minhash->size / 2;
-
-  uint32_t min_h = UINT32_MAX;
-  uint32_t max_h = 0;
+  *h1 = (uint32_t)(v1 & 0xFFFFFFFF);
+  *h2 = (uint32_t)(v2 & 0xFFFFFFFF);
+}
 
-  for (uint16_t i = 0; i < minhash->size / 2; i++) {
-    uint32_t hash = (uint32_t)((v1 + i * v2) & 0xFFFFFFFF);
-    min_h = max_h = hash;
-    if (min_h < minhash->_minimums[i]) {
-      minhash->_minimums[i] = min_h;
-    }
-    if (max_h > minhash->_minimums[i + half]) {
-      minhash->_minimums[i + half] = max_h;
+// updates all signature slots with the hash values of count shingles. The
+// inner loop over the slots is branchless, the compiler turns it into vector
+// min/max instructions (and adds an AVX2 variant where possible)
+NP_MINHASH_TARGET_CLONES
+static void __np_minhash_update_multi(np_minhash_t   *minhash,
+                                      const uint32_t *h1,
+                                      const uint32_t *h2,
+                                      uint16_t        count) {
+  uint16_t  half = minhash->size / 2;
+  uint32_t *mins = &minhash->_minimums[0];
+  uint32_t *maxs = &minhash->_minimums[half];
+
+  for (uint16_t j = 0; j < count; j++) {
+    for (uint16_t i = 0; i < half; i++) {
+      uint32_t hash = h1[j] + (uint32_t)i * h2[j];
+      mins[i]       = (hash < mins[i]) ? hash : mins[i];
+      maxs[i]       = (hash > maxs[i]) ? hash : maxs[i];
     }
   }
 }
 
+// pushes a new string value to the minhash and the minhash signature, but uses
+// the multi value scheme
+void np_minhash_push_multi(np_minhash_t        *minhash,
+                           const unsigned char *bytes,
+                           uint16_t             bytes_length) {
+  uint32_t h1 = 0, h2 = 0;
+  __np_minhash_hash(minhash, bytes, bytes_length, &h1, &h2);
+  __np_minhash_update_multi(minhash, &h1, &h2, 1);
+}
+
 // initialize a minhash structure by allocation memory, setting size and copying
 // seed to the right place
 void np_minhash_init(np_minhash_t        *minhash,
@@ -247,6 +275,53 @@ void np_minhash_push(np_minhash_t        *minhash,
   minhash->_push_func(minhash, bytes, bytes_length);
 }
 
+// shingles of the multi value scheme are hashed first and then applied to the
+// signature in one pass, the other schemes depend on the order of the pushes
+struct __np_minhash_batch {
+  uint32_t h1[NP_MINHASH_BATCH_SIZE];
+  uint32_t h2[NP_MINHASH_BATCH_SIZE];
+  uint16_t count;
+};
+
+static void __np_minhash_batch_flush(np_minhash_t              *minhash,
+                                     struct __np_minhash_batch *batch) {
+  if (batch->count > 0)
+    __np_minhash_update_multi(minhash, batch->h1, batch->h2, batch->count);
+  batch->count = 0;
+}
+
+static void __np_minhash_batch_push(np_minhash_t              *minhash,
+                                    struct __np_minhash_batch *batch,
+                                    const unsigned char       *bytes,
+                                    uint16_t                   bytes_length) {
+  if (batch == NULL) {
+    np_minhash_push(minhash, bytes, bytes_length);
+  } else {
+    __np_minhash_hash(minhash,
+                      bytes,
+                      bytes_length,
+                      &batch->h1[batch->count],
+                      &batch->h2[batch->count]);
+    batch->count++;
+    if (batch->count == NP_MINHASH_BATCH_SIZE)
+      __np_minhash_batch_flush(minhash, batch);
+  }
+}
+
+void np_minhash_push_batch(np_minhash_t               *minhash,
+                           const unsigned char *const *bytes,
+                           const uint16_t             *bytes_length,
+                           uint16_t                    count) {
+  struct __np_minhash_batch  batch  = {.count = 0};
+  struct __np_minhash_batch *_batch = NULL;
+  if (minhash->mh_mode == MIXHASH_MULTI) _batch = &batch;
+
+  for (uint16_t i = 0; i < count; i++)
+    __np_minhash_batch_push(minhash, _batch, bytes[i], bytes_length[i]);
+
+  if (_batch != NULL) __np_minhash_batch_flush(minhash, _batch);
+}
+
 int __compare_minhash_elements(const void *left, const void *right) {
   uint32_t *lu32 = (uint32_t *)left;
   uint32_t *ru32 = (uint32_t *)right;
@@ -263,10 +338,11 @@ struct __mh_string {
   bool  freeable;
 };
 
-void np_minhash_push_tree(np_minhash_t    *minhash,
-                          const np_tree_t *tree,
-                          uint8_t          shingle_size,
-                          bool             include_keys) {
+static void __np_minhash_push_tree(np_minhash_t              *minhash,
+                                   const np_tree_t           *tree,
+                                   uint8_t                    shingle_size,
+                                   bool                       include_keys,
+                                   struct __np_minhash_batch *batch) {
   ASSERT(shingle_size != 0,
          "requested shingle size must be greater or equal than one");
 
@@ -299,7 +375,7 @@ void np_minhash_push_tree(np_minhash_t    *minhash,
           strncat(target, key_part[j].str, 512);
         }
         // fprintf(stdout, "mh add: %s\n", substring);
-        np_minhash_push(minhash, target, strnlen(target, 512));
+        __np_minhash_batch_push(minhash, batch, target, strnlen(target, 512));
 
         if (key_part[0].freeable) free(key_part[0].str);
       }
@@ -328,10 +404,11 @@ void np_minhash_push_tree(np_minhash_t    *minhash,
       unsigned char *target         = &substring[0];
 
       if (tmp->val.type == np_treeval_type_jrb_tree) {
-        np_minhash_push_tree(minhash,
-                             tmp->val.value.tree,
-                             _local_shingle_size,
-                             include_keys);
+        __np_minhash_push_tree(minhash,
+                               tmp->val.value.tree,
+                               _local_shingle_size,
+                               include_keys,
+                               batch);
       } else {
         for (uint8_t j = 0; j < _local_shingle_size; j++) {
           strncat(target, val_part[j].str, 512);
@@ -339,7 +416,10 @@ void np_minhash_push_tree(np_minhash_t    *minhash,
           // val_part[j].str, target);
         }
         // fprintf(stdout, substring, strnlen(substring, 255));
-        np_minhash_push(minhash, target, strnlen((char *)target, 512));
+        __np_minhash_batch_push(minhash,
+                                batch,
+                                target,
+                                strnlen((char *)target, 512));
       }
       if (val_part[0].freeable) free(val_part[0].str);
     }
@@ -355,6 +435,19 @@ void np_minhash_push_tree(np_minhash_t    *minhash,
   free(val_part);
 }
 
+void np_minhash_push_tree(np_minhash_t    *minhash,
+                          const np_tree_t *tree,
+                          uint8_t          shingle_size,
+                          bool             include_keys) {
+  struct __np_minhash_batch  batch  = {.count = 0};
+  struct __np_minhash_batch *_batch = NULL;
+  if (minhash->mh_mode == MIXHASH_MULTI) _batch = &batch;
+
+  __np_minhash_push_tree(minhash, tree, shingle_size, include_keys, _batch);
+
+  if (_batch != NULL) __np_minhash_batch_flush(minhash, _batch);
+}
+
 // extracts the single minimum hash value from the signature
 void np_minhash_value(const np_minhash_t *minhash, uint32_t *value) {
   *value = UINT32_MAX;
@@ -0,0 +1,338 @@
+//
+// SPDX-FileCopyrightText: 2016-2024 by pi-lar GmbH
+// SPDX-License-Identifier: OSL-3.0
+//
+#include "util/np_msgcache.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "neuropil.h"
+
+#include "util/np_tree.h"
+#include "util/np_treeval.h"
+
+#include "np_dhkey.h"
+
+#define NP_MSGCACHE_NIL UINT32_MAX
+
+struct np_msgcache_audience_s {
+  np_dhkey_t audience;
+  uint32_t   head;
+  uint32_t   tail;
+  uint32_t   count;
+};
+
+struct np_msgcache_entry_s {
+  void  *item; // NULL marks a free slot
+  double expiry;
+  size_t bytes;
+
+  uint32_t prev; // insertion order, next is reused for the free list
+  uint32_t next;
+  uint32_t aud_prev; // order within the audience
+  uint32_t aud_next;
+  uint32_t heap_pos; // position in the expiry heap
+
+  struct np_msgcache_audience_s *aud;
+};
+
+struct np_msgcache_s {
+  struct np_msgcache_entry_s *entry;
+  uint32_t                   *heap; // entry indices, min heap on expiry
+  uint32_t                    capacity;
+  uint32_t                    free_head;
+
+  uint32_t head;
+  uint32_t tail;
+  uint32_t count;
+  size_t   bytes;
+
+  np_tree_t *audiences; // np_dhkey_t -> struct np_msgcache_audience_s*
+};
+
+static void __np_msgcache_link_free(np_msgcache_t *cache,
+                                    uint32_t       from,
+                                    uint32_t       to) {
+  for (uint32_t i = to; i > from; i--) {
+    cache->entry[i - 1].item = NULL;
+    cache->entry[i - 1].next = cache->free_head;
+    cache->free_head         = i - 1;
+  }
+}
+
+static bool __np_msgcache_grow(np_msgcache_t *cache) {
+  uint32_t new_capacity = (cache->capacity == 0) ? 16 : cache->capacity * 2;
+
+  struct np_msgcache_entry_s *entry =
+      realloc(cache->entry, new_capacity * sizeof(struct np_msgcache_entry_s));
+  if (entry == NULL) return false;
+  cache->entry = entry;
+
+  uint32_t *heap = realloc(cache->heap, new_capacity * sizeof(uint32_t));
+  if (heap == NULL) return false;
+  cache->heap = heap;
+
+  __np_msgcache_link_free(cache, cache->capacity, new_capacity);
+  cache->capacity = new_capacity;
+  return true;
+}
+
+static inline void
+__np_msgcache_heap_set(np_msgcache_t *cache, uint32_t pos, uint32_t index) {
+  cache->heap[pos]             = index;
+  cache->entry[index].heap_pos = pos;
+}
+
+static void __np_msgcache_heap_up(np_msgcache_t *cache, uint32_t pos) {
+  uint32_t index  = cache->heap[pos];
+  double   expiry = cache->entry[index].expiry;
+  while (pos > 0) {
+    uint32_t parent = (pos - 1) / 2;
+    if (cache->entry[cache->heap[parent]].expiry <= expiry) break;
+    __np_msgcache_heap_set(cache, pos, cache->heap[parent]);
+    pos = parent;
+  }
+  __np_msgcache_heap_set(cache, pos, index);
+}
+
+static void __np_msgcache_heap_down(np_msgcache_t *cache, uint32_t pos) {
+  uint32_t index  = cache->heap[pos];
+  double   expiry = cache->entry[index].expiry;
+  while (true) {
+    uint32_t child = 2 * pos + 1;
+    if (child >= cache->count) break;
+    if (child + 1 < cache->count &&
+        cache->entry[cache->heap[child + 1]].expiry <
+            cache->entry[cache->heap[child]].expiry)
+      child++;
+    if (expiry <= cache->entry[cache->heap[child]].expiry) break;
+    __np_msgcache_heap_set(cache, pos, cache->heap[child]);
+    pos = child;
+  }
+  __np_msgcache_heap_set(cache, pos, index);
+}
+
+static void __np_msgcache_audience_release(np_msgcache_t                 *cache,
+                                           struct np_msgcache_audience_s *aud) {
+  if (aud->count > 0) return;
+
+  np_tree_del_dhkey(cache->audiences, aud->audience);
+  free(aud);
+}
+
+// unlinks an entry from all indices, the audience record stays in place
+static void *__np_msgcache_unlink(np_msgcache_t *cache, uint32_t index) {
+  struct np_msgcache_entry_s *e    = &cache->entry[index];
+  void                       *item = e->item;
+
+  if (e->prev != NP_MSGCACHE_NIL) cache->entry[e->prev].next = e->next;
+  else cache->head = e->next;
+  if (e->next != NP_MSGCACHE_NIL) cache->entry[e->next].prev = e->prev;
+  else cache->tail = e->prev;
+
+  struct np_msgcache_audience_s *aud = e->aud;
+  if (e->aud_prev != NP_MSGCACHE_NIL)
+    cache->entry[e->aud_prev].aud_next = e->aud_next;
+  else aud->head = e->aud_next;
+  if (e->aud_next != NP_MSGCACHE_NIL)
+    cache->entry[e->aud_next].aud_prev = e->aud_prev;
+  else aud->tail = e->aud_prev;
+  aud->count--;
+
+  // move the last heap element into the gap and restore the heap order
+  uint32_t pos  = e->heap_pos;
+  uint32_t last = cache->heap[cache->count - 1];
+  cache->count--;
+  if (pos < cache->count) {
+    __np_msgcache_heap_set(cache, pos, last);
+    __np_msgcache_heap_up(cache, pos);
+    __np_msgcache_heap_down(cache, cache->entry[last].heap_pos);
+  }
+  cache->bytes -= e->bytes;
+
+  e->item          = NULL;
+  e->aud           = NULL;
+  e->next          = cache->free_head;
+  cache->free_head = index;
+
+  return item;
+}
+
+static void *__np_msgcache_remove(np_msgcache_t *cache, uint32_t index) {
+  struct np_msgcache_audience_s *aud  = cache->entry[index].aud;
+  void                          *item = __np_msgcache_unlink(cache, index);
+  __np_msgcache_audience_release(cache, aud);
+  return item;
+}
+
+np_msgcache_t *_np_msgcache_create(uint32_t initial_size) {
+  np_msgcache_t *cache = calloc(1, sizeof(np_msgcache_t));
+  if (cache == NULL) return NULL;
+
+  cache->head      = NP_MSGCACHE_NIL;
+  cache->tail      = NP_MSGCACHE_NIL;
+  cache->free_head = NP_MSGCACHE_NIL;
+  cache->audiences = np_tree_create();
+
+  while (cache->capacity < initial_size) {
+    if (!__np_msgcache_grow(cache)) break;
+  }
+  return cache;
+}
+
+void _np_msgcache_free(np_msgcache_t *cache) {
+  if (cache == NULL) return;
+
+  np_tree_elem_t *iter = NULL;
+  RB_FOREACH (iter, np_tree_s, cache->audiences) {
+    free(iter->val.value.v);
+  }
+  np_tree_free(cache->audiences);
+  free(cache->entry);
+  free(cache->heap);
+  free(cache);
+}
+
+bool _np_msgcache_add(np_msgcache_t *cache,
+                      void          *item,
+                      np_dhkey_t     audience,
+                      double         expiry,
+                      size_t         bytes) {
+  assert(item != NULL);
+
+  if (cache->free_head == NP_MSGCACHE_NIL && !__np_msgcache_grow(cache))
+    return false;
+
+  struct np_msgcache_audience_s *aud = NULL;
+  np_tree_elem_t *aud_elem = np_tree_find_dhkey(cache->audiences, audience);
+  if (aud_elem != NULL) {
+    aud = aud_elem->val.value.v;
+  } else {
+    aud = calloc(1, sizeof(struct np_msgcache_audience_s));
+    if (aud == NULL) return false;
+    aud->audience = audience;
+    aud->head     = NP_MSGCACHE_NIL;
+    aud->tail     = NP_MSGCACHE_NIL;
+    np_tree_insert_dhkey(cache->audiences, audience, np_treeval_new_v(aud));
+  }
+
+  uint32_t                    index = cache->free_head;
+  struct np_msgcache_entry_s *e     = &cache->entry[index];
+  cache->free_head                  = e->next;
+
+  e->item   = item;
+  e->expiry = expiry;
+  e->bytes  = bytes;
+  e->aud    = aud;
+
+  e->prev = cache->tail;
+  e->next = NP_MSGCACHE_NIL;
+  if (cache->tail != NP_MSGCACHE_NIL) cache->entry[cache->tail].next = index;
+  else cache->head = index;
+  cache->tail = index;
+
+  e->aud_prev = aud->tail;
+  e->aud_next = NP_MSGCACHE_NIL;
+  if (aud->tail != NP_MSGCACHE_NIL) cache->entry[aud->tail].aud_next = index;
+  else aud->head = index;
+  aud->tail = index;
+  aud->count++;
+
+  cache->count++;
+  __np_msgcache_heap_set(cache, cache->count - 1, index);
+  __np_msgcache_heap_up(cache, cache->count - 1);
+
+  cache->bytes += bytes;
+  return true;
+}
+
+void *_np_msgcache_pop(np_msgcache_t *cache, bool newest) {
+  uint32_t index = newest ? cache->tail : cache->head;
+  if (index == NP_MSGCACHE_NIL) return NULL;
+
+  return __np_msgcache_remove(cache, index);
+}
+
+void *_np_msgcache_pop_expired(np_msgcache_t *cache, double now) {
+  if (cache->count == 0) return NULL;
+  if (cache->entry[cache->heap[0]].expiry > now) return NULL;
+
+  return __np_msgcache_remove(cache, cache->heap[0]);
+}
+
+static uint32_t __np_msgcache_drain_audience(np_msgcache_t *cache,
+                                             struct np_msgcache_audience_s *aud,
+                                             bool                newest,
+                                             np_msgcache_item_cb consume,
+                                             void               *userdata,
+                                             bool               *stop) {
+  uint32_t removed = 0;
+  while (!*stop && aud->count > 0) {
+    void *item = __np_msgcache_unlink(cache, newest ? aud->tail : aud->head);
+    removed++;
+    *stop = !consume(item, userdata);
+  }
+  return removed;
+}
+
+uint32_t _np_msgcache_drain(np_msgcache_t          *cache,
+                            const np_dhkey_t       *audience,
+                            bool                    newest,
+                            np_msgcache_audience_cb select,
+                            np_msgcache_item_cb     consume,
+                            void                   *userdata) {
+  uint32_t removed = 0;
+  bool     stop    = false;
+
+  if (audience != NULL) {
+    np_tree_elem_t *aud_elem = np_tree_find_dhkey(cache->audiences, *audience);
+    if (aud_elem == NULL) return 0;
+
+    struct np_msgcache_audience_s *aud = aud_elem->val.value.v;
+    if (select != NULL && !select(aud->audience, userdata)) return 0;
+
+    removed = __np_msgcache_drain_audience(cache,
+                                           aud,
+                                           newest,
+                                           consume,
+                                           userdata,
+                                           &stop);
+    __np_msgcache_audience_release(cache, aud);
+    return removed;
+  }
+
+  np_tree_elem_t *iter = RB_MIN(np_tree_s, cache->audiences);
+  while (iter != NULL && !stop) {
+    // fetch the successor first, the current audience may be released
+    np_tree_elem_t                *next = RB_NEXT(np_tree_s, NULL, iter);
+    struct np_msgcache_audience_s *aud  = iter->val.value.v;
+
+    if (select == NULL || select(aud->audience, userdata)) {
+      removed += __np_msgcache_drain_audience(cache,
+                                              aud,
+                                              newest,
+                                              consume,
+                                              userdata,
+                                              &stop);
+      __np_msgcache_audience_release(cache, aud);
+    }
+    iter = next;
+  }
+  return removed;
+}
+
+uint32_t _np_msgcache_size(np_msgcache_t *cache) { return cache->count; }
+
+size_t _np_msgcache_bytes(np_msgcache_t *cache) { return cache->bytes; }
+
+uint32_t _np_msgcache_audience_size(np_msgcache_t   *cache,
+                                    const np_dhkey_t audience) {
+  np_tree_elem_t *aud_elem = np_tree_find_dhkey(cache->audiences, audience);
+  if (aud_elem == NULL) return 0;
+
+  return ((struct np_msgcache_audience_s *)aud_elem->val.value.v)->count;
+}
@@ -19,6 +19,58 @@ const struct np_util_statemachine_result_s condition_not_met_result = {
 const struct np_util_statemachine_result_s no_rule_result = {
     .success = false, .error_code = NO_RULE};
 
+static uint32_t
+__np_util_statemachine_candidates(np_util_statemachine_state_t *state,
+                                  const np_util_event_t         ev) {
+  struct np_util_statemachine_dispatch_s *dispatch = state->_dispatch;
+
+  uint32_t ret = dispatch->_by_event_low[ev.type & 0x00FF] &
+                 dispatch->_by_event_high[(ev.type >> 8) & 0x00FF];
+  if (ret != 0) {
+    uint8_t data_type = dispatch->f_data_type(ev);
+    ret &= (data_type < dispatch->_data_types)
+               ? dispatch->_by_data_type[data_type]
+               : dispatch->_by_data_type[0];
+  }
+  return ret;
+}
+
+void np_util_statemachine_compile(np_util_statemachine_state_t **states,
+                                  uint8_t                        state_count,
+                                  np_util_statemachine_data_type f_data_type,
+                                  uint8_t                        data_types) {
+  for (uint8_t s = 0; s < state_count; s++) {
+    np_util_statemachine_state_t *state = states[s];
+    if (state == NULL || state->_dispatch != NULL) continue;
+    if (state->_transitions > NP_UTIL_STATEMACHINE_DISPATCH_MAX) continue;
+
+    struct np_util_statemachine_dispatch_s *dispatch =
+        calloc(1, sizeof(struct np_util_statemachine_dispatch_s));
+    dispatch->f_data_type   = f_data_type;
+    dispatch->_data_types   = data_types;
+    dispatch->_by_data_type = calloc(data_types, sizeof(uint32_t));
+
+    for (uint8_t i = 0; i < state->_transitions; i++) {
+      struct np_util_statemachine_transition_s *t =
+          &state->_transition_table[i];
+      uint32_t bit  = (1U << i);
+      uint8_t  low  = t->_event_mask & 0x00FF;
+      uint8_t  high = (t->_event_mask >> 8) & 0x00FF;
+
+      // an event type is a candidate if all required bits are set
+      for (uint16_t v = 0; v < 256; v++) {
+        if ((low & ~v) == 0) dispatch->_by_event_low[v] |= bit;
+        if ((high & ~v) == 0) dispatch->_by_event_high[v] |= bit;
+      }
+      for (uint8_t d = 0; d < data_types; d++) {
+        if (t->_data_type == 0 || t->_data_type == d)
+          dispatch->_by_data_type[d] |= bit;
+      }
+    }
+    state->_dispatch = dispatch;
+  }
+}
+
 bool np_util_statemachine_invoke_auto_transition(
     np_util_statemachine_t *machine, np_util_event_t ev) {
   bool                          ret = false;
@@ -28,10 +80,22 @@ bool np_util_statemachine_invoke_auto_transition(
   uint16_t                                 old_state  = machine->_current_state;
   struct np_util_statemachine_transition_s transition = {0};
 
+  // narrow the event down to the transitions that could match at all
+  uint32_t candidates = UINT32_MAX;
+  if (current_state->_dispatch != NULL)
+    candidates = __np_util_statemachine_candidates(current_state, ev);
+
   // fprintf(stdout, "cs: %s\n", current_state->_state_name);
   while (i < current_state->_transitions) {
 
+    if (i < NP_UTIL_STATEMACHINE_DISPATCH_MAX &&
+        (candidates & (1U << i)) == 0) {
+      i++;
+      continue;
+    }
     transition = current_state->_transition_table[i];
+    if (transition._active && transition.f_condition != NULL)
+      current_state->_transition_table[i]._evaluated++;
 
     // fprintf(stdout, " t:   %25s ->   %p / %d -> %d (c: %p / a: %p)\n",
     //         current_state->_state_name, transition,
@@ -43,6 +107,7 @@ bool np_util_statemachine_invoke_auto_transition(
       // fprintf(stdout, "cs: %d.%25s -> transition: %d\n",
       // machine->_current_state, current_state->_state_name, i);
       ret = true;
+      current_state->_transition_table[i]._hits++;
 
       // first call the action
       if (transition.f_action != NULL) transition.f_action(machine, ev);
@@ -179,6 +244,7 @@ void np_util_statemachine_add_state(np_util_statemachine_state_t      **states,
 
   states[state._state_id]->_transitions      = 0;
   states[state._state_id]->_transition_table = NULL;
+  states[state._state_id]->_dispatch         = NULL;
 
   states[state._state_id]->f_enter = state.f_enter;
   states[state._state_id]->f_exit  = state.f_exit;
@@ -216,6 +282,10 @@ void np_util_statemachine_add_transition(
   iter->_active       = trans._active;
   iter->_source_state = trans._source_state;
   iter->_target_state = trans._target_state;
+  iter->_event_mask   = trans._event_mask;
+  iter->_data_type    = trans._data_type;
+  iter->_evaluated    = 0;
+  iter->_hits         = 0;
   // memcpy(st->_transition_table+transition_offset, &trans, transition_size);
 
   st->_transitions++;
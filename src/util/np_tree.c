@@ -26,6 +26,7 @@
 
 #include "np_dhkey.h"
 #include "np_log.h"
+#include "np_settings.h"
 #include "np_util.h"
 
 RB_GENERATE(np_tree_s, np_tree_elem_s, link, _np_tree_elem_cmp);
@@ -50,10 +51,197 @@ np_tree_t *np_tree_create() {
   new_tree->size      = 0;
   new_tree->rbh_root  = NULL;
   new_tree->byte_size = 0;
+  new_tree->arena     = NULL;
 
   return new_tree;
 }
 
+/*
+        arena (bump allocator) for np_tree_t structures. The first chunk holds
+   the arena and the root tree itself, further chunks are prepended to the
+   list and grow until NP_TREE_ARENA_MAX_CHUNK_SIZE is reached.
+*/
+#define NP_TREE_ARENA_ALIGNMENT (2 * sizeof(void *))
+#define __NP_TREE_ARENA_ALIGN(x)                                               \
+  (((x) + (NP_TREE_ARENA_ALIGNMENT - 1)) & ~(NP_TREE_ARENA_ALIGNMENT - 1))
+
+struct np_tree_arena_chunk_s {
+  struct np_tree_arena_chunk_s *next;
+  size_t                        size;
+  size_t                        used;
+};
+
+struct np_tree_arena_s {
+  struct np_tree_arena_chunk_s *head;
+  np_tree_t                    *root;
+  size_t                        chunk_size;
+  size_t                        base_used;
+};
+
+static struct np_tree_arena_chunk_s *__np_tree_arena_chunk_new(size_t size) {
+  struct np_tree_arena_chunk_s *chunk = malloc(size);
+  CHECK_MALLOC(chunk);
+
+  chunk->next = NULL;
+  chunk->size = size;
+  chunk->used = __NP_TREE_ARENA_ALIGN(sizeof(struct np_tree_arena_chunk_s));
+  return chunk;
+}
+
+static void *__np_tree_arena_alloc(struct np_tree_arena_s *arena, size_t size) {
+  size = __NP_TREE_ARENA_ALIGN(size);
+
+  if (arena->head->used + size > arena->head->size) {
+    size_t chunk_size = arena->chunk_size;
+    size_t needed =
+        __NP_TREE_ARENA_ALIGN(sizeof(struct np_tree_arena_chunk_s)) + size;
+    if (needed > chunk_size) chunk_size = needed;
+
+    struct np_tree_arena_chunk_s *chunk = __np_tree_arena_chunk_new(chunk_size);
+    chunk->next                         = arena->head;
+    arena->head                         = chunk;
+
+    if (arena->chunk_size < NP_TREE_ARENA_MAX_CHUNK_SIZE)
+      arena->chunk_size = arena->chunk_size * 2;
+  }
+
+  void *ret = ((unsigned char *)arena->head) + arena->head->used;
+  arena->head->used += size;
+  return ret;
+}
+
+static void __np_tree_arena_release(struct np_tree_arena_s *arena,
+                                    bool                    keep_base) {
+  struct np_tree_arena_chunk_s *iter = arena->head;
+  while (iter != NULL) {
+    struct np_tree_arena_chunk_s *next = iter->next;
+    if (next == NULL && keep_base) {
+      // the last chunk contains the arena and the root tree
+      iter->used  = arena->base_used;
+      arena->head = iter;
+    } else {
+      free(iter);
+    }
+    iter = next;
+  }
+}
+
+static np_tree_t *__np_tree_create_arena(size_t size_hint, bool in_place) {
+  size_t base_size =
+      __NP_TREE_ARENA_ALIGN(sizeof(struct np_tree_arena_chunk_s)) +
+      __NP_TREE_ARENA_ALIGN(sizeof(struct np_tree_arena_s)) +
+      __NP_TREE_ARENA_ALIGN(sizeof(np_tree_t));
+  size_t chunk_size = size_hint + base_size;
+  if (chunk_size < NP_TREE_ARENA_CHUNK_SIZE)
+    chunk_size = NP_TREE_ARENA_CHUNK_SIZE;
+
+  struct np_tree_arena_chunk_s *chunk = __np_tree_arena_chunk_new(chunk_size);
+
+  struct np_tree_arena_s *arena =
+      (struct np_tree_arena_s *)(((unsigned char *)chunk) + chunk->used);
+  chunk->used += __NP_TREE_ARENA_ALIGN(sizeof(struct np_tree_arena_s));
+
+  arena->head       = chunk;
+  arena->chunk_size = NP_TREE_ARENA_CHUNK_SIZE;
+
+  np_tree_t *new_tree = __np_tree_arena_alloc(arena, sizeof(np_tree_t));
+  memset(&new_tree->attr, 0, sizeof(np_tree_conf_t));
+
+  new_tree->size          = 0;
+  new_tree->rbh_root      = NULL;
+  new_tree->byte_size     = 0;
+  new_tree->arena         = arena;
+  new_tree->attr.in_place = in_place;
+
+  arena->root      = new_tree;
+  arena->base_used = chunk->used;
+
+  return new_tree;
+}
+
+np_tree_t *np_tree_create_arena(size_t size_hint) {
+  return __np_tree_create_arena(size_hint, false);
+}
+
+np_tree_t *np_tree_create_view(size_t size_hint) {
+  return __np_tree_create_arena(size_hint, true);
+}
+
+np_tree_t *_np_tree_create_subtree(np_tree_t *parent) {
+  np_tree_t *new_tree = NULL;
+  if (parent->arena == NULL) {
+    new_tree                = np_tree_create();
+    new_tree->attr.in_place = false;
+  } else {
+    new_tree = __np_tree_arena_alloc(parent->arena, sizeof(np_tree_t));
+    memset(&new_tree->attr, 0, sizeof(np_tree_conf_t));
+
+    new_tree->size          = 0;
+    new_tree->rbh_root      = NULL;
+    new_tree->byte_size     = 0;
+    new_tree->arena         = parent->arena;
+    new_tree->attr.in_place = parent->attr.in_place;
+  }
+  return new_tree;
+}
+
+void *_np_tree_malloc(np_tree_t *tree, size_t size) {
+  void *ret = NULL;
+  if (tree->arena == NULL) {
+    ret = malloc(size);
+    CHECK_MALLOC(ret);
+  } else {
+    ret = __np_tree_arena_alloc(tree->arena, size);
+  }
+  return ret;
+}
+
+char *_np_tree_strndup(np_tree_t *tree, const char *s, size_t len) {
+  if (tree->arena == NULL) return strndup(s, len);
+
+  len       = strnlen(s, len);
+  char *ret = __np_tree_arena_alloc(tree->arena, len + 1);
+  memcpy(ret, s, len);
+  ret[len] = '\0';
+  return ret;
+}
+
+static np_treeval_t __np_tree_arena_copy_of_val(np_tree_t   *tree,
+                                                np_treeval_t from) {
+  np_treeval_t to = from;
+
+  switch (from.type) {
+  case np_treeval_type_char_ptr:
+    if (tree->attr.in_place == false)
+      to.value.s = _np_tree_strndup(tree, from.value.s, from.size);
+    break;
+  case np_treeval_type_bin:
+  case np_treeval_type_hash:
+  case np_treeval_type_encoded:
+    if (tree->attr.in_place == false) {
+      to.value.bin = __np_tree_arena_alloc(tree->arena, from.size);
+      memcpy(to.value.bin, from.value.bin, from.size);
+    }
+    break;
+  case np_treeval_type_cose_signed:
+  case np_treeval_type_cose_encrypted:
+  case np_treeval_type_cwt:
+  case np_treeval_type_jrb_tree:
+    // subtrees of the same arena are adopted, everything else is copied
+    if (from.value.tree->arena != tree->arena) {
+      to.value.tree                = _np_tree_create_subtree(tree);
+      to.value.tree->attr.in_place = false;
+      np_tree_copy(from.value.tree, to.value.tree);
+      to.value.tree->attr.immutable = from.value.tree->attr.immutable;
+    }
+    break;
+  default:
+    to = np_treeval_copy_of_val(from);
+    break;
+  }
+  return to;
+}
+
 int16_t _np_tree_elem_cmp(const np_tree_elem_t *j1, const np_tree_elem_t *j2) {
   assert(NULL != j1);
   assert(NULL != j2);
@@ -85,6 +273,25 @@ int16_t _np_tree_elem_cmp(const np_tree_elem_t *j1, const np_tree_elem_t *j2) {
   return (((int)jv1.type - (int)jv2.type) > 0);
 };
 
+/*
+        elements of a lazily deserialized tree still contain the encoded cbor
+   item of their subtree. It is decoded with the first lookup of the element.
+*/
+static np_tree_elem_t *__np_tree_decoded(np_tree_t      *tree,
+                                         np_tree_elem_t *elem) {
+  if (elem != NULL && elem->val.type == np_treeval_type_encoded) {
+    np_treeval_t decoded = {0};
+    if (np_serializer_read_encoded(tree, elem->val, &decoded)) {
+      tree->byte_size -= np_tree_element_get_byte_size(elem);
+      if (tree->arena == NULL && tree->attr.in_place == false)
+        free(elem->val.value.bin);
+      elem->val = decoded;
+      tree->byte_size += np_tree_element_get_byte_size(elem);
+    }
+  }
+  return elem;
+}
+
 np_tree_elem_t *
 np_tree_find_gte_str(np_tree_t *n, const char *key, uint8_t *fnd) {
   assert(n != NULL);
@@ -102,7 +309,7 @@ np_tree_find_gte_str(np_tree_t *n, const char *key, uint8_t *fnd) {
   } else {
     *fnd = 0;
   }
-  return (result);
+  return __np_tree_decoded(n, result);
 }
 
 np_tree_elem_t *np_tree_find_uuid(np_tree_t *n, void *key) {
@@ -113,7 +320,7 @@ np_tree_elem_t *np_tree_find_uuid(np_tree_t *n, void *key) {
   memcpy(search_key.value.uuid, key, NP_UUID_BYTES);
   np_tree_elem_t search_elem = {.key = search_key};
 
-  return RB_FIND(np_tree_s, n, &search_elem);
+  return __np_tree_decoded(n, RB_FIND(np_tree_s, n, &search_elem));
 }
 
 np_tree_elem_t *np_tree_find_str(np_tree_t *n, const char *key) {
@@ -127,7 +334,7 @@ np_tree_elem_t *np_tree_find_str(np_tree_t *n, const char *key) {
     np_tree_elem_t search_elem = {.key = search_key};
     ret                        = RB_FIND(np_tree_s, n, &search_elem);
   }
-  return ret;
+  return __np_tree_decoded(n, ret);
 }
 
 np_tree_elem_t *np_tree_find_gte_int(np_tree_t *n, int16_t ikey, uint8_t *fnd) {
@@ -145,19 +352,19 @@ np_tree_elem_t *np_tree_find_gte_int(np_tree_t *n, int16_t ikey, uint8_t *fnd) {
     *fnd = 0;
   }
 
-  return (result);
+  return __np_tree_decoded(n, result);
 }
 
 np_tree_elem_t *np_tree_find_int(np_tree_t *n, int16_t key) {
   np_treeval_t   search_key  = {.type = np_treeval_type_int, .value.i = key};
   np_tree_elem_t search_elem = {.key = search_key};
-  return (RB_FIND(np_tree_s, n, &search_elem));
+  return __np_tree_decoded(n, RB_FIND(np_tree_s, n, &search_elem));
 }
 
 np_tree_elem_t *np_tree_find_dhkey(np_tree_t *n, np_dhkey_t key) {
   np_treeval_t search_key = {.type = np_treeval_type_dhkey, .value.dhkey = key};
   np_tree_elem_t search_elem = {.key = search_key};
-  return (RB_FIND(np_tree_s, n, &search_elem));
+  return __np_tree_decoded(n, RB_FIND(np_tree_s, n, &search_elem));
 }
 
 np_tree_elem_t *
@@ -177,14 +384,14 @@ np_tree_find_gte_ulong(np_tree_t *n, uint32_t ulkey, uint8_t *fnd) {
     *fnd = 0;
   }
 
-  return (result);
+  return __np_tree_decoded(n, result);
 }
 
 np_tree_elem_t *np_tree_find_ulong(np_tree_t *n, uint32_t ulkey) {
   np_treeval_t   search_key  = {.type     = np_treeval_type_unsigned_long,
                                 .value.ul = ulkey};
   np_tree_elem_t search_elem = {.key = search_key};
-  return (RB_FIND(np_tree_s, n, &search_elem));
+  return __np_tree_decoded(n, RB_FIND(np_tree_s, n, &search_elem));
 }
 
 np_tree_elem_t *np_tree_find_gte_dbl(np_tree_t *n, double dkey, uint8_t *fnd) {
@@ -202,19 +409,23 @@ np_tree_elem_t *np_tree_find_gte_dbl(np_tree_t *n, double dkey, uint8_t *fnd) {
     *fnd = 0;
   }
 
-  return (result);
+  return __np_tree_decoded(n, result);
 }
 
 np_tree_elem_t *np_tree_find_dbl(np_tree_t *n, double dkey) {
   np_treeval_t   search_key = {.type = np_treeval_type_double, .value.d = dkey};
   np_tree_elem_t search_elem = {.key = search_key};
-  return (RB_FIND(np_tree_s, n, &search_elem));
+  return __np_tree_decoded(n, RB_FIND(np_tree_s, n, &search_elem));
 }
 
 void _np_tree_cleanup_treeval(np_tree_t *tree, np_treeval_t toclean) {
+  // arena memory is released together with the root tree
+  if (tree->arena != NULL) return;
+
   if (tree->attr.in_place == false) {
     if (toclean.type == np_treeval_type_char_ptr) free(toclean.value.s);
     if (toclean.type == np_treeval_type_bin) free(toclean.value.bin);
+    if (toclean.type == np_treeval_type_encoded) free(toclean.value.bin);
   }
   if (toclean.type == np_treeval_type_jrb_tree ||
       toclean.type == np_treeval_type_cwt ||
@@ -234,7 +445,7 @@ void np_tree_del_element(np_tree_t *tree, np_tree_elem_t *to_delete) {
     _np_tree_cleanup_treeval(tree, to_delete->key);
     _np_tree_cleanup_treeval(tree, to_delete->val);
 
-    free(to_delete);
+    if (tree->arena == NULL) free(to_delete);
   }
 }
 
@@ -274,6 +485,15 @@ void np_tree_del_ulong(np_tree_t *tree, const uint32_t key) {
 }
 
 void np_tree_clear(np_tree_t *n) {
+  if (n->arena != NULL && n->arena->root == n) {
+    // all elements and subtrees are part of the arena, rewind it
+    n->rbh_root  = NULL;
+    n->size      = 0;
+    n->byte_size = 0;
+    __np_tree_arena_release(n->arena, true);
+    return;
+  }
+
   np_tree_elem_t *iter = RB_MIN(np_tree_s, n);
 
   while (NULL != iter) {
@@ -284,10 +504,15 @@ void np_tree_clear(np_tree_t *n) {
 
 void np_tree_free(np_tree_t *n) {
   if (NULL != n) {
-    if (n->size > 0) {
-      np_tree_clear(n);
+    if (n->arena != NULL) {
+      // subtrees of an arena are released together with their root
+      if (n->arena->root == n) __np_tree_arena_release(n->arena, false);
+    } else {
+      if (n->size > 0) {
+        np_tree_clear(n);
+      }
+      free(n);
     }
-    free(n);
     n = NULL;
   }
 }
@@ -328,13 +553,12 @@ void np_tree_insert_str(np_tree_t *tree, const char *key, np_treeval_t val) {
 
   np_tree_elem_t *found = np_tree_find_str(tree, key);
   if (found == NULL) { // insert new value
-    found = (np_tree_elem_t *)malloc(sizeof(np_tree_elem_t));
-    CHECK_MALLOC(found);
+    found = (np_tree_elem_t *)_np_tree_malloc(tree, sizeof(np_tree_elem_t));
 
     if (tree->attr.in_place == true) {
       found->key.value.s = (char *)key;
     } else {
-      found->key.value.s = strndup(key, 255);
+      found->key.value.s = _np_tree_strndup(tree, key, 255);
     }
 
     found->key.type = np_treeval_type_char_ptr;
@@ -352,8 +576,7 @@ void np_tree_insert_int(np_tree_t *tree, int16_t ikey, np_treeval_t val) {
 
   if (found == NULL) {
     // insert new value
-    found = (np_tree_elem_t *)malloc(sizeof(np_tree_elem_t));
-    CHECK_MALLOC(found);
+    found = (np_tree_elem_t *)_np_tree_malloc(tree, sizeof(np_tree_elem_t));
 
     found->key.value.i = ikey;
     found->key.type    = np_treeval_type_int;
@@ -370,8 +593,7 @@ void np_tree_insert_dhkey(np_tree_t *tree, np_dhkey_t key, np_treeval_t val) {
 
   if (found == NULL) {
     // insert new value
-    found = (np_tree_elem_t *)malloc(sizeof(np_tree_elem_t));
-    CHECK_MALLOC(found);
+    found = (np_tree_elem_t *)_np_tree_malloc(tree, sizeof(np_tree_elem_t));
 
     found->key.value.dhkey = key;
     found->key.type        = np_treeval_type_dhkey;
@@ -388,8 +610,7 @@ void np_tree_insert_uuid(np_tree_t *tree, void *key, np_treeval_t val) {
 
   if (found == NULL) {
     // insert new value
-    found = (np_tree_elem_t *)malloc(sizeof(np_tree_elem_t));
-    CHECK_MALLOC(found);
+    found = (np_tree_elem_t *)_np_tree_malloc(tree, sizeof(np_tree_elem_t));
 
     memcpy(found->key.value.uuid, key, NP_UUID_BYTES);
     found->key.type = np_treeval_type_uuid;
@@ -406,8 +627,7 @@ void np_tree_insert_ulong(np_tree_t *tree, uint32_t ulkey, np_treeval_t val) {
 
   if (found == NULL) {
     // insert new value
-    found = (np_tree_elem_t *)malloc(sizeof(np_tree_elem_t));
-    CHECK_MALLOC(found);
+    found = (np_tree_elem_t *)_np_tree_malloc(tree, sizeof(np_tree_elem_t));
 
     found->key.value.ul = ulkey;
     found->key.type     = np_treeval_type_unsigned_long;
@@ -425,8 +645,7 @@ void np_tree_insert_dbl(np_tree_t *tree, double dkey, np_treeval_t val) {
 
   if (found == NULL) {
     // insert new value
-    found = (np_tree_elem_t *)malloc(sizeof(np_tree_elem_t));
-    CHECK_MALLOC(found);
+    found = (np_tree_elem_t *)_np_tree_malloc(tree, sizeof(np_tree_elem_t));
 
     found->key.value.d = dkey;
     found->key.type    = np_treeval_type_double;
@@ -443,7 +662,9 @@ void np_tree_set_treeval(np_tree_t      *tree,
                          np_tree_elem_t *element,
                          np_treeval_t    val) {
 
-  if (tree->attr.in_place == false) {
+  if (tree->arena != NULL) {
+    element->val = __np_tree_arena_copy_of_val(tree, val);
+  } else if (tree->attr.in_place == false) {
     element->val = np_treeval_copy_of_val(val);
   } else {
     // memmove(&element->val, &val, sizeof(np_treeval_t));
@@ -585,7 +806,12 @@ void np_tree_copy_inplace(np_tree_t *source, np_tree_t *target) {
 
 np_tree_t *np_tree_clone(np_tree_t *source) {
 
-  np_tree_t *ret = np_tree_create();
+  np_tree_t *ret = NULL;
+  if (source->arena != NULL) {
+    ret = np_tree_create_arena(source->byte_size);
+  } else {
+    ret = np_tree_create();
+  }
   memcpy(&ret->attr, &source->attr, sizeof(np_tree_conf_t));
   ret->attr.in_place  = false;
   bool old            = ret->attr.immutable;
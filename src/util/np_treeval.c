@@ -138,6 +138,13 @@ np_treeval_t np_treeval_copy_of_val(np_treeval_t from) {
     memcpy(to.value.uuid, from.value.uuid, NP_UUID_BYTES);
     to.size = NP_UUID_BYTES;
     break;
+  case np_treeval_type_encoded:
+    to.type      = np_treeval_type_encoded;
+    to.value.bin = malloc(from.size);
+    CHECK_MALLOC(to.value.bin);
+    memcpy(to.value.bin, from.value.bin, from.size);
+    to.size = from.size;
+    break;
   case np_treeval_type_hash:
     to.type      = np_treeval_type_hash;
     to.value.bin = malloc(from.size);
@@ -855,6 +862,10 @@ size_t np_treeval_get_byte_size(np_treeval_t ele) {
     byte_size += sizeof(uint8_t) /* map type */ + sizeof(uint8_t) +
                  sizeof(uint16_t) /* tag */ + ele.value.tree->byte_size;
     break;
+  case np_treeval_type_encoded:
+    // already contains the complete cbor item
+    byte_size += ele.size;
+    break;
 
 #endif // NP_USE_QCBOR
 
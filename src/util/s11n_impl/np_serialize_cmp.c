@@ -696,6 +696,19 @@ void np_serializer_read_map(np_state_t              *context,
   buffer->_error      = cmp_context.error;
 }
 
+// msgpack has no lazy mode, the complete map is decoded
+void np_serializer_read_map_lazy(np_state_t              *context,
+                                 np_deserialize_buffer_t *buffer,
+                                 np_tree_t               *tree) {
+  np_serializer_read_map(context, buffer, tree);
+}
+
+bool np_serializer_read_encoded(np_tree_t    *tree,
+                                np_treeval_t  encoded,
+                                np_treeval_t *value) {
+  return false;
+}
+
 enum np_data_return np_serializer_write_object(np_kv_buffer_t *to_write) {
   uint8_t key_len = strnlen(to_write->key, 255);
 
@@ -790,7 +803,7 @@ unsigned char *np_skip_datablock_header(np_datablock_header_t *block) {
 }
 
 enum np_data_return np_serializer_search_object(np_datablock_header_t *block,
-                                                char                  *key,
+                                                const char            *key,
                                                 np_kv_buffer_t        *kv_pair,
                                                 uint32_t data_magic_no) {
   np_serializer_read_datablock_header(block, data_magic_no);
@@ -137,10 +137,10 @@ void __np_tree_deserialize_read_type(np_state_t         *context,
     if (_item.uTags[0] ==
         (NP_CBOR_REGISTRY_ENTRIES + np_treeval_type_jrb_tree)) {
 
+      np_tree_t *subtree = NULL;
       for (int32_t i = _item.val.uCount; i > 0; i--) {
-        np_treeval_t tmp_key   = {0};
-        np_tree_t   *subtree   = np_tree_create();
-        subtree->attr.in_place = false;
+        np_treeval_t tmp_key = {0};
+        if (subtree == NULL) subtree = _np_tree_create_subtree(tree);
         __np_tree_deserialize_read_type(context,
                                         subtree, // key can't be a tree
                                         qcbor_ctx,
@@ -171,8 +171,11 @@ void __np_tree_deserialize_read_type(np_state_t         *context,
           break;
         case np_treeval_type_char_ptr:
           np_tree_insert_str(tree, tmp_key.value.s, tmp_val);
-          free(tmp_key.value.s);
-          if (tmp_val.type == np_treeval_type_char_ptr) free(tmp_val.value.s);
+          if (tree->arena == NULL) {
+            free(tmp_key.value.s);
+            if (tmp_val.type == np_treeval_type_char_ptr)
+              free(tmp_val.value.s);
+          }
           break;
         case np_treeval_type_uuid:
           np_tree_insert_uuid(tree, tmp_key.value.uuid, tmp_val);
@@ -184,7 +187,16 @@ void __np_tree_deserialize_read_type(np_state_t         *context,
           tmp_val.type = np_treeval_type_undefined;
           break;
         }
-        np_tree_free(subtree);
+        if (tree->arena == NULL) {
+          np_tree_free(subtree);
+          subtree = NULL;
+        } else if (tmp_val.type == np_treeval_type_jrb_tree ||
+                   tmp_val.type == np_treeval_type_cwt ||
+                   tmp_val.type == np_treeval_type_cose_signed ||
+                   tmp_val.type == np_treeval_type_cose_encrypted) {
+          // the subtree has been adopted by the arena tree
+          subtree = NULL;
+        }
       }
       //        QCBORDecode_ExitMap(qcbor_ctx);
       if (_item.uTags[1] == CBOR_TAG_CWT) {
@@ -234,7 +246,11 @@ void __np_tree_deserialize_read_type(np_state_t         *context,
       value->value.c = *((char *)_item.val.string.ptr);
     } else {
       value->type = np_treeval_type_char_ptr;
-      if (tree->attr.in_place == true) {
+      if (tree->arena != NULL) {
+        // add the terminating zero, even for a view
+        value->value.s =
+            _np_tree_strndup(tree, _item.val.string.ptr, _item.val.string.len);
+      } else if (tree->attr.in_place == true) {
         value->value.s = (char *)_item.val.string.ptr;
       } else {
         value->value.s = strndup(_item.val.string.ptr, _item.val.string.len);
@@ -247,7 +263,8 @@ void __np_tree_deserialize_read_type(np_state_t         *context,
     if (_item.uTags[0] == (NP_CBOR_REGISTRY_ENTRIES + np_treeval_type_hash)) {
       value->type = np_treeval_type_hash;
       value->size = _item.val.string.len;
-      if (tree->attr.in_place == true) {
+      // arena trees copy the value when it is inserted
+      if (tree->attr.in_place == true || tree->arena != NULL) {
         value->value.bin = (char *)_item.val.string.ptr;
       } else {
         value->value.bin = malloc(_item.val.string.len);
@@ -257,7 +274,7 @@ void __np_tree_deserialize_read_type(np_state_t         *context,
     } else {
       value->type = np_treeval_type_bin;
       value->size = _item.val.string.len;
-      if (tree->attr.in_place == true) {
+      if (tree->attr.in_place == true || tree->arena != NULL) {
         value->value.bin = (char *)_item.val.string.ptr;
       } else {
         value->value.bin = malloc(value->size);
@@ -475,6 +492,12 @@ void __np_tree_serialize_write_type(np_state_t         *context,
                          (UsefulBufC){.ptr = val.value.bin, .len = val.size});
     break;
 
+  case np_treeval_type_encoded:
+    // not yet decoded subtree of a lazy deserialized tree
+    QCBOREncode_AddEncoded(qcbor_ctx,
+                           (UsefulBufC){.ptr = val.value.bin, .len = val.size});
+    break;
+
   case np_treeval_type_cose_encrypted:
     QCBOREncode_AddTag(qcbor_ctx, CBOR_TAG_COSE_ENCRYPT);
     np_treeval_t tmp_encrypt = np_treeval_new_tree(val.value.tree);
@@ -598,6 +621,120 @@ void np_serializer_read_map(np_state_t              *context,
   buffer->_error      = qcbor_ctx.uLastError;
 }
 
+void np_serializer_read_map_lazy(np_state_t              *context,
+                                 np_deserialize_buffer_t *buffer,
+                                 np_tree_t               *tree) {
+  buffer->_target_tree = tree;
+
+  struct q_useful_buf_c qmp       = {.ptr = buffer->_buffer,
+                                     .len = buffer->_buffer_size};
+  QCBORDecodeContext    qcbor_ctx = {0};
+  QCBORDecode_Init(&qcbor_ctx, qmp, QCBOR_DECODE_MODE_MAP_AS_ARRAY);
+
+  QCBORItem _item = {0};
+  QCBORDecode_VGetNext(&qcbor_ctx, &_item);
+  if ((_item.uDataType != QCBOR_TYPE_MAP &&
+       _item.uDataType != QCBOR_TYPE_MAP_AS_ARRAY) ||
+      _item.uTags[0] != (NP_CBOR_REGISTRY_ENTRIES + np_treeval_type_jrb_tree)) {
+    buffer->_error = 1;
+    return;
+  }
+
+  for (int32_t i = _item.val.uCount; i > 0; i -= 2) {
+    np_treeval_t tmp_key = {0};
+    np_treeval_t tmp_val = {0};
+    __np_tree_deserialize_read_type(context, tree, &qcbor_ctx, &tmp_key, "");
+
+    QCBORItem _next = {0};
+    size_t    start = qcbor_ctx.InBuf.cursor;
+    if (QCBORDecode_PeekNext(&qcbor_ctx, &_next) != QCBOR_SUCCESS) break;
+
+    if (_next.uDataType == QCBOR_TYPE_MAP ||
+        _next.uDataType == QCBOR_TYPE_MAP_AS_ARRAY) {
+      // skip the nested map, it is decoded on first access
+      QCBORDecode_VGetNext(&qcbor_ctx, &_next);
+      uint8_t nesting_level = _next.uNestingLevel;
+      while (_next.uNextNestLevel > nesting_level &&
+             QCBORDecode_GetError(&qcbor_ctx) == QCBOR_SUCCESS) {
+        QCBORDecode_VGetNext(&qcbor_ctx, &_next);
+      }
+      tmp_val.type      = np_treeval_type_encoded;
+      tmp_val.value.bin = (unsigned char *)buffer->_buffer + start;
+      tmp_val.size      = qcbor_ctx.InBuf.cursor - start;
+    } else {
+      __np_tree_deserialize_read_type(context, tree, &qcbor_ctx, &tmp_val, "");
+    }
+
+    switch (tmp_key.type) {
+    case np_treeval_type_int:
+      np_tree_insert_int(tree, tmp_key.value.i, tmp_val);
+      break;
+    case np_treeval_type_dhkey:
+      np_tree_insert_dhkey(tree, tmp_key.value.dhkey, tmp_val);
+      break;
+    case np_treeval_type_unsigned_long:
+      np_tree_insert_ulong(tree, tmp_key.value.ul, tmp_val);
+      break;
+    case np_treeval_type_double:
+      np_tree_insert_dbl(tree, tmp_key.value.d, tmp_val);
+      break;
+    case np_treeval_type_char_ptr:
+      np_tree_insert_str(tree, tmp_key.value.s, tmp_val);
+      if (tree->arena == NULL) {
+        free(tmp_key.value.s);
+        if (tmp_val.type == np_treeval_type_char_ptr) free(tmp_val.value.s);
+      }
+      break;
+    case np_treeval_type_uuid:
+      np_tree_insert_uuid(tree, tmp_key.value.uuid, tmp_val);
+      break;
+    default:
+      log_msg(LOG_WARNING | LOG_SERIALIZATION,
+              NULL,
+              "undefined key type cannot be added to tree structure");
+      break;
+    }
+  }
+
+  QCBORError qcbor_ret = QCBORDecode_Finish(&qcbor_ctx);
+  if (qcbor_ret != QCBOR_SUCCESS && qcbor_ret != QCBOR_ERR_EXTRA_BYTES) {
+    log_debug(LOG_SERIALIZATION | LOG_WARNING,
+              NULL,
+              "lazy deserialization error: %s",
+              qcbor_err_to_str(qcbor_ret));
+    buffer->_error = 1;
+    return;
+  }
+  if (tree->attr.in_place == true) tree->attr.immutable = true;
+
+  buffer->_bytes_read = qcbor_ctx.InBuf.cursor;
+  buffer->_error      = qcbor_ctx.uLastError;
+}
+
+bool np_serializer_read_encoded(np_tree_t    *tree,
+                                np_treeval_t  encoded,
+                                np_treeval_t *value) {
+  // lookups have no context, logging is disabled for the nested decoding
+  np_state_t *context = NULL;
+
+  struct q_useful_buf_c qmp       = {.ptr = encoded.value.bin,
+                                     .len = encoded.size};
+  QCBORDecodeContext    qcbor_ctx = {0};
+  QCBORDecode_Init(&qcbor_ctx, qmp, QCBOR_DECODE_MODE_MAP_AS_ARRAY);
+
+  np_tree_t *subtree = _np_tree_create_subtree(tree);
+  __np_tree_deserialize_read_type(context, subtree, &qcbor_ctx, value, "");
+
+  QCBORError qcbor_ret = QCBORDecode_Finish(&qcbor_ctx);
+  if ((qcbor_ret != QCBOR_SUCCESS && qcbor_ret != QCBOR_ERR_EXTRA_BYTES) ||
+      qcbor_ctx.uLastError != 0 || value->value.tree != subtree) {
+    np_tree_free(subtree);
+    return false;
+  }
+  subtree->attr.immutable = tree->attr.immutable;
+  return true;
+}
+
 void np_serializer_add_map_bytesize(np_tree_t *tree, size_t *byte_size) {
   *byte_size += sizeof(uint8_t);
   if (tree->byte_size > UINT8_MAX) *byte_size += sizeof(uint16_t);
@@ -731,7 +868,7 @@ enum np_data_return np_serializer_read_object(np_kv_buffer_t *to_read) {
 }
 
 enum np_data_return np_serializer_search_object(np_datablock_header_t *block,
-                                                char                  *key,
+                                                const char            *key,
                                                 np_kv_buffer_t        *kv_pair,
                                                 uint32_t data_magic_no) {
   np_serializer_read_datablock_header(block, data_magic_no);
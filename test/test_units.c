@@ -15,7 +15,12 @@
 #include "unit/test_bloom.c"
 #include "unit/test_cupidbloom.c"
 #include "unit/test_cupidtrie.c"
+#include "unit/test_dedup.c"
+#include "unit/test_congestion.c"
 #include "unit/test_dhkey.c"
+#include "unit/test_flatindex.c"
+#include "unit/test_searchsnapshot.c"
+#include "unit/test_search.c"
 // #include "unit/test_heap.c" // TODO: fixme
 #include "unit/test_jrb_impl.c"
 #include "unit/test_jrb_serialization.c"
@@ -25,6 +30,7 @@
 // #include "unit/test_memory.c"  // TODO: fixme
 #include "unit/test_message.c"
 #include "unit/test_minhash.c"
+#include "unit/test_msgcache.c"
 #include "unit/test_network.c"
 #include "unit/test_node.c"
 #include "unit/test_route.c"
@@ -33,9 +39,11 @@
 #include "unit/test_neuropil_h.c"
 // #include "unit/test_sodium_crypt.c" // TODO: fixme on linux!
 #include "unit/test_pheromone.c"
+#include "unit/test_responsecontainer.c"
 #include "unit/test_scache.c"
 #include "unit/test_skiplist.c"
 #include "unit/test_statemachine.c"
+#include "unit/test_warmstart.c"
 
 // #include "unit/test_m_jobqueue.c" // TODO: does currently not hold any
 // meaningful test
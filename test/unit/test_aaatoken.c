@@ -199,6 +199,87 @@ Test(np_aaatoken_t,
     // np_unref_obj(np_node_t, test_node, ref_obj_creation);
   }
 }
+static uint32_t _test_verified_tokens = 0;
+
+bool _test_aaatoken_verified_cb(NP_UNUSED np_state_t     *context,
+                                NP_UNUSED np_util_event_t event) {
+  _test_verified_tokens++;
+  return true;
+}
+
+Test(np_aaatoken_t,
+     batch_verification,
+     .description = "test the batched verification stage of tokens") {
+  CTX() {
+    np_aaatoken_t *valid_token   = _np_token_factory_new_node_token(context);
+    np_aaatoken_t *expired_token = _np_token_factory_new_node_token(context);
+    cr_assert(NULL != valid_token, "expect the token to be not NULL");
+    cr_assert(NULL != expired_token, "expect the token to be not NULL");
+
+    expired_token->expires_at = expired_token->not_before - 1.;
+    _np_aaatoken_set_signature(expired_token, NULL); // self signed
+
+    np_util_event_t verify_event = {.type = (evt_internal | evt_token)};
+    _np_aaatoken_verify_submit(context,
+                               valid_token,
+                               np_aaatoken_type_node,
+                               verify_event,
+                               _test_aaatoken_verified_cb);
+    _np_aaatoken_verify_submit(context,
+                               expired_token,
+                               np_aaatoken_type_node,
+                               verify_event,
+                               _test_aaatoken_verified_cb);
+
+    // received tokens are only decoded, their signature is checked by the
+    // verification stage
+    np_tree_t *token_data = np_tree_create();
+    np_aaatoken_encode(token_data, valid_token);
+    np_aaatoken_t *received_token = NULL;
+    np_aaatoken_t *forged_token   = NULL;
+    np_new_obj(np_aaatoken_t, received_token, FUNC);
+    np_new_obj(np_aaatoken_t, forged_token, FUNC);
+    cr_assert(np_aaatoken_decode(token_data, received_token));
+    cr_assert(np_aaatoken_decode(token_data, forged_token));
+    snprintf(forged_token->subject, 255, "forged subject");
+
+    _np_aaatoken_verify_submit(context,
+                               received_token,
+                               np_aaatoken_type_node,
+                               verify_event,
+                               _test_aaatoken_verified_cb);
+    _np_aaatoken_verify_submit(context,
+                               forged_token,
+                               np_aaatoken_type_node,
+                               verify_event,
+                               _test_aaatoken_verified_cb);
+
+    ev_sleep(NP_TOKEN_VERIFY_INTERVAL_SEC * 10);
+
+    cr_expect(2 == _test_verified_tokens,
+              "expect that only the valid tokens have been passed on");
+    cr_expect(IS_VALID(valid_token->state),
+              "expect that the 1.token has been verified");
+    cr_expect(IS_INVALID(expired_token->state),
+              "expect that the 2.token has been rejected");
+    cr_expect(received_token->is_signature_verified,
+              "expect that the signature of the received token is checked");
+    cr_expect(IS_INVALID(forged_token->state),
+              "expect that the forged token has been rejected");
+
+    np_unref_obj(np_aaatoken_t, forged_token, FUNC);
+    np_unref_obj(np_aaatoken_t, received_token, FUNC);
+    np_tree_free(token_data);
+
+    np_unref_obj(np_aaatoken_t,
+                 valid_token,
+                 "_np_token_factory_new_node_token");
+    np_unref_obj(np_aaatoken_t,
+                 expired_token,
+                 "_np_token_factory_new_node_token");
+  }
+}
+
 Test(np_aaatoken_t,
      test_audience_filtering,
      .description = "test the filtering based on audience/issuer/realm field") {
@@ -294,3 +375,167 @@ Test(np_aaatoken_t,
     */
   }
 }
+
+static bool __test_handshake_verified(NP_UNUSED np_state_t     *context,
+                                      NP_UNUSED np_util_event_t event) {
+  return true;
+}
+
+Test(np_aaatoken_t,
+     test_handshake_early_rejection,
+     .description = "test the rejection of duplicate and expired handshakes") {
+  CTX() {
+    np_handshake_token_t *token =
+        _np_token_factory_new_handshake_token(context,
+                                              UDP | IPv4,
+                                              "127.0.0.1",
+                                              "3141");
+    np_util_event_t hs_event = {.type = (evt_external | evt_token)};
+    randombytes_buf(&hs_event.target_dhkey, sizeof(np_dhkey_t));
+
+    cr_expect(_np_aaatoken_verify_handshake(context,
+                                            token,
+                                            hs_event,
+                                            __test_handshake_verified),
+              "expect the first handshake to be accepted");
+    cr_expect(!_np_aaatoken_verify_handshake(context,
+                                             token,
+                                             hs_event,
+                                             __test_handshake_verified),
+              "expect the same handshake for the same alias to be rejected");
+
+    // a handshake of the same node via another alias is a new session
+    randombytes_buf(&hs_event.target_dhkey, sizeof(np_dhkey_t));
+    cr_expect(_np_aaatoken_verify_handshake(context,
+                                            token,
+                                            hs_event,
+                                            __test_handshake_verified),
+              "expect the handshake for another alias to be accepted");
+
+    np_handshake_token_t *expired_token =
+        _np_token_factory_new_handshake_token(context,
+                                              UDP | IPv4,
+                                              "127.0.0.1",
+                                              "3142");
+    expired_token->expires_at = np_time_now() - 1.0;
+    cr_expect(!_np_aaatoken_verify_handshake(context,
+                                             expired_token,
+                                             hs_event,
+                                             __test_handshake_verified),
+              "expect an expired handshake to be rejected");
+
+    uint16_t queue_depth = 0;
+    double   latency     = 0.0;
+    uint32_t dropped     = 0;
+    _np_aaatoken_handshake_statistics(context,
+                                      &queue_depth,
+                                      &latency,
+                                      &dropped);
+    cr_expect(2 == dropped, "expect two handshakes to be dropped");
+
+    np_unref_obj(np_aaatoken_t,
+                 expired_token,
+                 "_np_token_factory_new_handshake_token");
+    np_unref_obj(np_aaatoken_t, token, "_np_token_factory_new_handshake_token");
+  }
+}
+
+static volatile uint32_t       __test_handshakes_accepted = 0;
+static np_handshake_token_t *volatile __test_handshake_accepted = NULL;
+
+static bool __test_handshake_accept(NP_UNUSED np_state_t *context,
+                                    np_util_event_t       event) {
+  __test_handshake_accepted = event.user_data;
+  __test_handshakes_accepted++;
+  return true;
+}
+
+static void __test_handshake_wait(np_state_t *context, uint32_t expected) {
+  uint16_t queue_depth = 1;
+  double   latency     = 0.0;
+  uint32_t dropped     = 0;
+  double   deadline    = np_time_now() + 5.0;
+  while (np_time_now() < deadline &&
+         (queue_depth > 0 || __test_handshakes_accepted < expected)) {
+    np_time_sleep(0.01);
+    _np_aaatoken_handshake_statistics(context,
+                                      &queue_depth,
+                                      &latency,
+                                      &dropped);
+  }
+  // the last batch may still be running
+  np_time_sleep(0.1);
+}
+
+Test(np_aaatoken_t,
+     test_handshake_tampered_copy,
+     .description = "test the rejection of a tampered handshake copy") {
+  CTX() {
+    np_handshake_token_t *token =
+        _np_token_factory_new_handshake_token(context,
+                                              UDP | IPv4,
+                                              "127.0.0.1",
+                                              "3141");
+    np_tree_t *token_data = np_tree_create();
+    np_aaatoken_encode(token_data, token);
+
+    np_handshake_token_t *genuine  = NULL;
+    np_handshake_token_t *tampered = NULL;
+    np_new_obj(np_aaatoken_t, genuine, FUNC);
+    np_new_obj(np_aaatoken_t, tampered, FUNC);
+    cr_assert(np_aaatoken_decode(token_data, genuine));
+    cr_assert(np_aaatoken_decode(token_data, tampered));
+
+    // same signature and public key, but a different address
+    snprintf(tampered->subject, 255, "udp4:10.0.0.1:3141");
+
+    np_util_event_t genuine_event  = {.type = (evt_external | evt_token)};
+    np_util_event_t tampered_event = {.type = (evt_external | evt_token)};
+    randombytes_buf(&genuine_event.target_dhkey, sizeof(np_dhkey_t));
+    randombytes_buf(&tampered_event.target_dhkey, sizeof(np_dhkey_t));
+    genuine_event.user_data  = genuine;
+    tampered_event.user_data = tampered;
+
+    __test_handshakes_accepted = 0;
+    __test_handshake_accepted  = NULL;
+    cr_expect(_np_aaatoken_verify_handshake(context,
+                                            genuine,
+                                            genuine_event,
+                                            __test_handshake_accept),
+              "expect the genuine handshake to be queued");
+    cr_expect(_np_aaatoken_verify_handshake(context,
+                                            tampered,
+                                            tampered_event,
+                                            __test_handshake_accept),
+              "expect the tampered handshake to be queued");
+    __test_handshake_wait(context, 1);
+
+    cr_expect(1 == __test_handshakes_accepted,
+              "expect only one handshake to be accepted");
+    cr_expect(genuine == __test_handshake_accepted,
+              "expect the genuine handshake to be accepted");
+    cr_expect(!tampered->is_signature_verified,
+              "expect the tampered handshake to fail its signature check");
+
+    // the failed copy must not block the genuine handshake via its alias
+    np_handshake_token_t *retransmitted = NULL;
+    np_new_obj(np_aaatoken_t, retransmitted, FUNC);
+    cr_assert(np_aaatoken_decode(token_data, retransmitted));
+    tampered_event.user_data = retransmitted;
+    cr_expect(_np_aaatoken_verify_handshake(context,
+                                            retransmitted,
+                                            tampered_event,
+                                            __test_handshake_accept),
+              "expect the genuine handshake to be accepted via the alias of "
+              "the tampered copy");
+    __test_handshake_wait(context, 2);
+    cr_expect(retransmitted == __test_handshake_accepted,
+              "expect the retransmitted handshake to be accepted");
+
+    np_unref_obj(np_aaatoken_t, retransmitted, FUNC);
+    np_unref_obj(np_aaatoken_t, tampered, FUNC);
+    np_unref_obj(np_aaatoken_t, genuine, FUNC);
+    np_tree_free(token_data);
+    np_unref_obj(np_aaatoken_t, token, "_np_token_factory_new_handshake_token");
+  }
+}
@@ -0,0 +1,93 @@
+//
+// SPDX-FileCopyrightText: 2016-2024 by pi-lar GmbH
+// SPDX-License-Identifier: OSL-3.0
+//
+#include <criterion/criterion.h>
+#include <criterion/logging.h>
+#include <inttypes.h>
+
+#include "../test_macros.c"
+
+#include "util/np_congestion.h"
+
+#include "np_settings.h"
+
+TestSuite(np_congestion_t);
+
+Test(np_congestion_t,
+     _np_congestion_window,
+     .description = "test the growth and decrease of the congestion window") {
+  np_congestion_t cc;
+  _np_congestion_init(&cc, 0.0);
+  cr_expect(NP_CONGESTION_INITIAL_WINDOW == cc.cwnd,
+            "expect the initial window to be set");
+
+  _np_congestion_on_ack(&cc, 0.1);
+  cr_expect(2 * NP_CONGESTION_INITIAL_WINDOW == cc.cwnd,
+            "expect the window to double during slow start");
+  cr_expect(0.1 == cc.srtt, "expect the first sample to set the rtt");
+
+  double window = cc.cwnd;
+  _np_congestion_on_loss(&cc, 1.0);
+  cr_expect(window * NP_CONGESTION_DECREASE == cc.cwnd,
+            "expect the window to shrink after a loss");
+  cr_expect(cc.loss > 0.0, "expect the loss rate to increase");
+
+  window = cc.cwnd;
+  _np_congestion_on_loss(&cc, 1.0 + cc.srtt / 2);
+  cr_expect(window == cc.cwnd,
+            "expect only one decrease per round trip");
+
+  _np_congestion_on_ack(&cc, 0.1);
+  cr_expect(window + 1 == cc.cwnd,
+            "expect the window to grow linearly after a loss");
+
+  for (uint16_t i = 0; i < 64; i++) {
+    _np_congestion_on_loss(&cc, 2.0 + i);
+  }
+  cr_expect(NP_CONGESTION_MIN_WINDOW == cc.cwnd,
+            "expect the window to keep its minimum on a lossy link");
+}
+
+Test(np_congestion_t,
+     _np_congestion_pacing,
+     .description = "test the pacing of packages with the token bucket") {
+  np_congestion_t cc;
+  _np_congestion_init(&cc, 0.0);
+
+  cr_expect(UINT32_MAX == _np_congestion_tokens(&cc, 0.0),
+            "expect a peer without losses not to be paced");
+  _np_congestion_on_send(&cc, 1024);
+  cr_expect(0.0 == _np_congestion_delay(&cc),
+            "expect a peer without losses not to wait");
+
+  _np_congestion_on_loss(&cc, 1.0);
+  uint32_t tokens = _np_congestion_tokens(&cc, 1.0);
+  cr_expect((uint32_t)cc.cwnd == tokens,
+            "expect a full window to be available after the first loss");
+
+  double window = cc.cwnd;
+  _np_congestion_on_send(&cc, tokens);
+  cr_expect(0 == _np_congestion_tokens(&cc, 1.0),
+            "expect the bucket to be empty");
+  cr_expect(0.0 < _np_congestion_delay(&cc),
+            "expect the next package to wait for a token");
+  cr_expect(window < cc.cwnd, "expect sent packages to open the window");
+
+  double   rate     = _np_congestion_rate(&cc);
+  uint32_t expected = (uint32_t)(cc.tokens + rate * 0.01);
+  tokens            = _np_congestion_tokens(&cc, 1.01);
+  cr_expect(expected == tokens,
+            "expect %" PRIu32 " tokens after 10ms, got %" PRIu32,
+            expected,
+            tokens);
+
+  cr_expect((uint32_t)cc.cwnd == _np_congestion_tokens(&cc, 100.0),
+            "expect the bucket to hold at most one window");
+
+  for (uint16_t i = 0; i < 64 && cc.paced; i++) {
+    _np_congestion_on_ack(&cc, 0.1);
+  }
+  cr_expect(UINT32_MAX == _np_congestion_tokens(&cc, 101.0),
+            "expect the pacing to end once the losses are gone");
+}
@@ -0,0 +1,93 @@
+//
+// SPDX-FileCopyrightText: 2016-2024 by pi-lar GmbH
+// SPDX-License-Identifier: OSL-3.0
+//
+#include <criterion/criterion.h>
+#include <criterion/logging.h>
+#include <inttypes.h>
+
+#include "../test_macros.c"
+#include "sodium.h"
+
+#include "util/np_dedup.h"
+
+#include "np_settings.h"
+
+TestSuite(np_dedup_t);
+
+Test(np_dedup_t,
+     _np_dedup_check_and_add,
+     .description = "test the detection of duplicate uuids") {
+  np_dedup_t *dedup = _np_dedup_create(10.0, 1024);
+  cr_assert(NULL != dedup, "expect the dedup filter to be created");
+
+  unsigned char uuid[256][NP_UUID_BYTES];
+  for (uint16_t i = 0; i < 256; i++) {
+    randombytes_buf(uuid[i], NP_UUID_BYTES);
+    cr_expect(_np_dedup_check_and_add(dedup, uuid[i], 10.0 + i / 16, i / 16),
+              "expect uuid #%" PRIu16 " to be unique",
+              i);
+  }
+  cr_expect(256 == _np_dedup_size(dedup), "expect all uuids to be stored");
+
+  for (uint16_t i = 0; i < 256; i++) {
+    cr_expect(!_np_dedup_check_and_add(dedup, uuid[i], 30.0, 16.0),
+              "expect uuid #%" PRIu16 " to be a duplicate",
+              i);
+  }
+  cr_expect(256 == _np_dedup_size(dedup), "expect no duplicate to be stored");
+
+  unsigned char null_uuid[NP_UUID_BYTES] = {0};
+  cr_expect(_np_dedup_check_and_add(dedup, null_uuid, 30.0, 15.0));
+  cr_expect(!_np_dedup_check_and_add(dedup, null_uuid, 30.0, 15.0));
+  cr_expect(_np_dedup_remove(dedup, null_uuid));
+
+  for (uint16_t i = 0; i < 256; i += 2) {
+    cr_expect(_np_dedup_remove(dedup, uuid[i]),
+              "expect uuid #%" PRIu16 " to be removed",
+              i);
+  }
+  for (uint16_t i = 0; i < 256; i++) {
+    cr_expect((i % 2 == 0) != _np_dedup_contains(dedup, uuid[i]),
+              "expect only odd uuids to be present after removal");
+  }
+  cr_expect(0 == _np_dedup_evicted(dedup), "expect no early eviction");
+
+  _np_dedup_free(dedup);
+}
+
+Test(np_dedup_t,
+     _np_dedup_expire,
+     .description = "test the bucket wise expiry and the memory ceiling") {
+  np_dedup_t *dedup = _np_dedup_create(7.0, 1024);
+
+  unsigned char uuid[NP_UUID_BYTES];
+  // one bucket per second, every uuid lives for seven seconds
+  for (uint16_t i = 0; i < 70; i++) {
+    randombytes_buf(uuid, NP_UUID_BYTES);
+    _np_dedup_check_and_add(dedup, uuid, i / 10 + 7.0, i / 10);
+  }
+  cr_expect(70 == _np_dedup_size(dedup));
+  cr_expect(0 == _np_dedup_expire(dedup, 7.0), "expect nothing to expire");
+  cr_expect(10 == _np_dedup_expire(dedup, 7.5),
+            "expect the oldest bucket to expire at once");
+  cr_expect(60 == _np_dedup_size(dedup));
+  cr_expect(60 == _np_dedup_expire(dedup, 20.0),
+            "expect all buckets to expire");
+  cr_expect(0 == _np_dedup_size(dedup));
+
+  // exceed the ceiling within a single time window
+  uint32_t limit = 1024;
+  for (uint32_t i = 0; i < 2 * limit; i++) {
+    randombytes_buf(uuid, NP_UUID_BYTES);
+    cr_expect(_np_dedup_check_and_add(dedup, uuid, 40.0, 30.0));
+  }
+  cr_expect(_np_dedup_size(dedup) <= limit,
+            "expect the memory ceiling to be respected");
+  cr_expect(_np_dedup_evicted(dedup) >= limit,
+            "expect the early evictions to be counted");
+  cr_expect(_np_dedup_contains(dedup, uuid),
+            "expect the latest uuid to be remembered");
+
+  _np_dedup_free(dedup);
+}
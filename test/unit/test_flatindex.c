@@ -0,0 +1,188 @@
+//
+// SPDX-FileCopyrightText: 2016-2024 by pi-lar GmbH
+// SPDX-License-Identifier: OSL-3.0
+//
+#include <criterion/criterion.h>
+#include <criterion/logging.h>
+#include <inttypes.h>
+#include <stdlib.h>
+
+#include "sodium.h"
+
+#include "../test_macros.c"
+
+#include "search/np_bktree.h"
+#include "search/np_flatindex.h"
+#include "search/np_search.h"
+
+#include "np_dhkey.h"
+#include "np_time.h"
+
+TestSuite(np_flatindex_t);
+
+static uint32_t __flatindex_hits = 0;
+
+static bool _flatindex_count_map(NP_UNUSED np_map_reduce_t *mr_struct,
+                                 const void                *element) {
+  if (element != NULL) __flatindex_hits++;
+  return true;
+}
+
+static uint16_t _flatindex_distance(const np_dhkey_t *x, const np_dhkey_t *y) {
+  uint16_t ret = 0;
+  for (uint8_t k = 0; k < 8; k++) ret += __builtin_popcount(x->t[k] ^ y->t[k]);
+  return ret;
+}
+
+// every fourth entry is random, the others are close to their predecessor
+static np_searchentry_t *_flatindex_entries(uint32_t count) {
+  np_searchentry_t *entries = calloc(count, sizeof(np_searchentry_t));
+  for (uint32_t i = 0; i < count; i++) {
+    np_dhkey_t *key = &entries[i].search_index.lower_dhkey;
+    if (i % 4 == 0) {
+      randombytes_buf(key, sizeof(np_dhkey_t));
+    } else {
+      _np_dhkey_assign(key, &entries[i - 1].search_index.lower_dhkey);
+      for (uint8_t j = 0; j < 10; j++) {
+        uint8_t bit = randombytes_uniform(256);
+        key->t[bit / 32] ^= (1u << (bit % 32));
+      }
+    }
+    snprintf(entries[i].intent.subject, 255, "entry.%" PRIu32, i);
+  }
+  return entries;
+}
+
+Test(np_flatindex_t,
+     _flatindex_distance,
+     .description = "test the block wise hamming distance calculation") {
+  np_dhkey_t keys[NP_FLATINDEX_BLOCK_SIZE + 3];
+  np_dhkey_t query = {0};
+  uint16_t   distances[NP_FLATINDEX_BLOCK_SIZE + 3];
+
+  randombytes_buf(keys, sizeof(keys));
+  randombytes_buf(&query, sizeof(np_dhkey_t));
+  memset(&keys[0], 0xff, sizeof(np_dhkey_t));
+  _np_dhkey_assign(&keys[1], &query);
+
+  np_flatindex_distance(keys, NP_FLATINDEX_BLOCK_SIZE + 3, &query, distances);
+
+  for (uint16_t i = 0; i < NP_FLATINDEX_BLOCK_SIZE + 3; i++) {
+    cr_expect(distances[i] == _flatindex_distance(&keys[i], &query),
+              "expect the distance at %" PRIu16 " to match",
+              i);
+  }
+  cr_expect(0 == distances[1], "expect the same key to have no distance");
+}
+
+Test(np_flatindex_t,
+     _flatindex_query,
+     .description = "test insert, query and removal of the flat index") {
+  const uint32_t    count   = 2000;
+  np_searchentry_t *entries = _flatindex_entries(count);
+  np_dhkey_t        seed    = {0};
+
+  for (uint8_t use_bands = 0; use_bands < 2; use_bands++) {
+    np_flatindex_t index = {0};
+    np_flatindex_init(&index, seed, 40, use_bands);
+
+    for (uint32_t i = 0; i < count; i++) {
+      np_flatindex_insert(&index,
+                          entries[i].search_index.lower_dhkey,
+                          &entries[i]);
+    }
+    for (uint32_t i = 0; i < count; i += 3) {
+      np_flatindex_remove(&index,
+                          entries[i].search_index.lower_dhkey,
+                          &entries[i]);
+    }
+    cr_expect(index._count == count - (count + 2) / 3,
+              "expect the removed entries to be gone");
+
+    for (uint32_t q = 1; q < count; q += 31) {
+      if (q % 3 == 0) continue;
+
+      uint32_t expected = 0;
+      for (uint32_t i = 0; i < count; i++) {
+        if (i % 3 != 0 &&
+            _flatindex_distance(&entries[i].search_index.lower_dhkey,
+                                &entries[q].search_index.lower_dhkey) <= 40)
+          expected++;
+      }
+
+      np_map_reduce_t mr = {.map = _flatindex_count_map};
+      __flatindex_hits   = 0;
+      np_flatindex_query(&index,
+                         entries[q].search_index.lower_dhkey,
+                         &entries[q],
+                         &mr);
+      if (use_bands) {
+        // banding is approximate, but always finds the entry itself
+        cr_expect(__flatindex_hits >= 1 && __flatindex_hits <= expected,
+                  "expect to find a subset of the close entries");
+      } else {
+        cr_expect(__flatindex_hits == expected,
+                  "expect to find all %" PRIu32 " close entries",
+                  expected);
+      }
+    }
+    np_flatindex_destroy(&index);
+  }
+  free(entries);
+}
+
+Test(np_flatindex_t,
+     _flatindex_benchmark,
+     .description = "compare the flat index layouts with the bktree") {
+  const uint32_t    count   = 10000;
+  np_searchentry_t *entries = _flatindex_entries(count);
+  np_dhkey_t        seed    = {0};
+  double            elapsed[3];
+
+  np_bktree_t tree = {0};
+  np_bktree_init(&tree, seed, NP_SEARCH_QUERY_RADIUS);
+  for (uint32_t i = 0; i < count; i++) {
+    np_bktree_insert(&tree, entries[i].search_index.lower_dhkey, &entries[i]);
+  }
+  double start = _np_time_now(NULL);
+  for (uint32_t q = 0; q < count; q += 97) {
+    np_map_reduce_t mr = {.map = _flatindex_count_map};
+    mr.map_args.io     = &entries[q];
+    np_bktree_query(&tree,
+                    entries[q].search_index.lower_dhkey,
+                    &entries[q],
+                    &mr);
+  }
+  elapsed[0] = _np_time_now(NULL) - start;
+  np_bktree_destroy(&tree);
+
+  for (uint8_t use_bands = 0; use_bands < 2; use_bands++) {
+    np_flatindex_t index = {0};
+    np_flatindex_init(&index, seed, NP_SEARCH_QUERY_RADIUS, use_bands);
+    for (uint32_t i = 0; i < count; i++) {
+      np_flatindex_insert(&index,
+                          entries[i].search_index.lower_dhkey,
+                          &entries[i]);
+    }
+    start = _np_time_now(NULL);
+    for (uint32_t q = 0; q < count; q += 97) {
+      np_map_reduce_t mr = {.map = _flatindex_count_map};
+      np_flatindex_query(&index,
+                         entries[q].search_index.lower_dhkey,
+                         &entries[q],
+                         &mr);
+    }
+    elapsed[1 + use_bands] = _np_time_now(NULL) - start;
+    np_flatindex_destroy(&index);
+  }
+
+  cr_log_info("query of %" PRIu32 " entries: %.1f us (bktree) / %.1f us "
+              "(flat) / %.1f us (flat lsh)\n",
+              count,
+              elapsed[0] / (count / 97 + 1) * 1e6,
+              elapsed[1] / (count / 97 + 1) * 1e6,
+              elapsed[2] / (count / 97 + 1) * 1e6);
+  cr_expect(elapsed[2] < elapsed[1], "expect banding to narrow the scan");
+
+  free(entries);
+}
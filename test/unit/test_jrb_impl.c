@@ -372,3 +372,68 @@ Test(np_tree_t,
               "expect element to be changed");
   }
 }
+
+Test(np_tree_t,
+     tree_arena,
+     .description = "test the arena backed tree implementation") {
+  CTX() {
+    np_tree_t *test_tree_1 = np_tree_create_arena(0);
+    cr_assert(NULL != test_tree_1, "expect test_tree_1 pointer to exists");
+    cr_expect(NULL != test_tree_1->arena, "expect the tree to use an arena");
+
+    char bin_data[] = "binary\0data";
+    np_tree_insert_str(test_tree_1, "halli", np_treeval_new_s("galli"));
+    np_tree_insert_int(test_tree_1, 42, np_treeval_new_i(4711));
+    np_tree_insert_str(test_tree_1,
+                       "bin",
+                       np_treeval_new_bin(bin_data, sizeof(bin_data)));
+
+    np_tree_t *test_tree_2 = np_tree_create();
+    np_tree_insert_str(test_tree_2, "sub", np_treeval_new_s("tree"));
+    np_tree_insert_str(test_tree_1, "tree", np_treeval_new_tree(test_tree_2));
+    np_tree_free(test_tree_2);
+
+    cr_expect(4 == test_tree_1->size, "expect the size of the tree to be 4");
+    cr_expect(0 == strncmp("galli",
+                           np_tree_find_str(test_tree_1, "halli")->val.value.s,
+                           6),
+              "expect element to be the same string");
+    cr_expect(4711 == np_tree_find_int(test_tree_1, 42)->val.value.i,
+              "expect element to be the same integer");
+
+    np_tree_elem_t *bin_elem = np_tree_find_str(test_tree_1, "bin");
+    cr_assert(NULL != bin_elem, "expect element to be present");
+    cr_expect(bin_elem->val.value.bin != bin_data,
+              "expect binary value to be copied into the arena");
+    cr_expect(0 == memcmp(bin_data, bin_elem->val.value.bin, sizeof(bin_data)),
+              "expect binary value to be the same");
+
+    np_tree_elem_t *tree_elem = np_tree_find_str(test_tree_1, "tree");
+    cr_assert(NULL != tree_elem, "expect element to be present");
+    cr_expect(test_tree_1->arena == tree_elem->val.value.tree->arena,
+              "expect subtree to be part of the same arena");
+    cr_expect(NULL != np_tree_find_str(tree_elem->val.value.tree, "sub"),
+              "expect subtree element to be present");
+
+    np_tree_replace_str(test_tree_1, "halli", np_treeval_new_s("other_galli"));
+    np_tree_del_int(test_tree_1, 42);
+    cr_expect(3 == test_tree_1->size, "expect the size of the tree to be 3");
+    cr_expect(0 == strncmp("other_galli",
+                           np_tree_find_str(test_tree_1, "halli")->val.value.s,
+                           12),
+              "expect element to be changed");
+
+    np_tree_t *test_tree_3 = np_tree_clone(test_tree_1);
+    cr_expect(test_tree_3->arena != test_tree_1->arena,
+              "expect the clone to use its own arena");
+    cr_expect(3 == test_tree_3->size, "expect the size of the clone to be 3");
+
+    np_tree_clear(test_tree_1);
+    cr_expect(0 == test_tree_1->size, "expect the size of the tree to be 0");
+    np_tree_insert_str(test_tree_1, "halli", np_treeval_new_s("galli"));
+    cr_expect(1 == test_tree_1->size, "expect the size of the tree to be 1");
+
+    np_tree_free(test_tree_1);
+    np_tree_free(test_tree_3);
+  }
+}
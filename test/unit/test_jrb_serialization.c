@@ -509,6 +509,154 @@ Test(test_serialization,
   }
 }
 
+Test(test_serialization,
+     np_tree_view_deserialize,
+     .description = "test the deserialization into a tree view") {
+  CTX() {
+    char          bin_data[] = "binary\0data";
+    unsigned char buffer[1024];
+    np_tree_t    *write_tree = np_tree_create();
+    np_tree_t    *sub_tree   = np_tree_create();
+
+    np_tree_insert_str(sub_tree, "sub", np_treeval_new_s("tree"));
+    np_tree_insert_str(write_tree, "halli", np_treeval_new_s("galli"));
+    np_tree_insert_str(write_tree,
+                       "bin",
+                       np_treeval_new_bin(bin_data, sizeof(bin_data)));
+    np_tree_insert_str(write_tree, "tree", np_treeval_new_tree(sub_tree));
+
+    np_serialize_buffer_t serializer = {
+        ._tree          = write_tree,
+        ._target_buffer = buffer,
+        ._buffer_size   = sizeof(buffer),
+        ._error         = 0,
+        ._bytes_written = 0,
+    };
+    np_serializer_write_map(context, &serializer, write_tree);
+    cr_assert(serializer._error == 0, "expect no error on write");
+
+    np_tree_t              *read_tree    = np_tree_create_view(0);
+    np_deserialize_buffer_t deserializer = {
+        ._target_tree = read_tree,
+        ._buffer      = buffer,
+        ._buffer_size = serializer._bytes_written,
+        ._error       = 0,
+        ._bytes_read  = 0,
+    };
+    np_serializer_read_map(context, &deserializer, read_tree);
+    cr_assert(deserializer._error == 0, "expect no error on read");
+
+    cr_expect(3 == read_tree->size, "expect the size of the view to be 3");
+    cr_expect(read_tree->attr.immutable, "expect the view to be immutable");
+
+    np_tree_elem_t *tmp = np_tree_find_str(read_tree, "halli");
+    cr_assert(NULL != tmp, "expect element to be present");
+    cr_expect(0 == strcmp("galli", tmp->val.value.s),
+              "expect string to be zero terminated");
+
+    tmp = np_tree_find_str(read_tree, "bin");
+    cr_assert(NULL != tmp, "expect element to be present");
+    cr_expect((unsigned char *)tmp->val.value.bin >= buffer &&
+                  (unsigned char *)tmp->val.value.bin <
+                      buffer + serializer._bytes_written,
+              "expect binary value to point into the buffer");
+    cr_expect(0 == memcmp(bin_data, tmp->val.value.bin, sizeof(bin_data)),
+              "expect binary value to be the same");
+
+    tmp = np_tree_find_str(read_tree, "tree");
+    cr_assert(NULL != tmp, "expect element to be present");
+    cr_expect(read_tree->arena == tmp->val.value.tree->arena,
+              "expect subtree to be part of the same arena");
+    cr_expect(NULL != np_tree_find_str(tmp->val.value.tree, "sub"),
+              "expect subtree element to be present");
+
+    np_tree_free(read_tree);
+    np_tree_free(sub_tree);
+    np_tree_free(write_tree);
+  }
+}
+
+Test(test_serialization,
+     np_tree_lazy_deserialize,
+     .description = "test the lazy deserialization of nested trees") {
+  CTX() {
+    char          bin_data[] = "binary\0data";
+    unsigned char buffer[1024];
+    unsigned char buffer_2[1024];
+    np_tree_t    *write_tree = np_tree_create();
+    np_tree_t    *sub_tree   = np_tree_create();
+
+    np_tree_insert_str(sub_tree, "sub", np_treeval_new_s("tree"));
+    np_tree_insert_str(write_tree,
+                       NP_SERIALISATION_USERDATA,
+                       np_treeval_new_bin(bin_data, sizeof(bin_data)));
+    np_tree_insert_str(write_tree, "tree", np_treeval_new_tree(sub_tree));
+
+    np_serialize_buffer_t serializer = {
+        ._tree          = write_tree,
+        ._target_buffer = buffer,
+        ._buffer_size   = sizeof(buffer),
+        ._error         = 0,
+        ._bytes_written = 0,
+    };
+    np_serializer_write_map(context, &serializer, write_tree);
+    cr_assert(serializer._error == 0, "expect no error on write");
+
+    np_tree_t              *read_tree    = np_tree_create_view(0);
+    np_deserialize_buffer_t deserializer = {
+        ._target_tree = read_tree,
+        ._buffer      = buffer,
+        ._buffer_size = serializer._bytes_written,
+        ._error       = 0,
+        ._bytes_read  = 0,
+    };
+    np_serializer_read_map_lazy(context, &deserializer, read_tree);
+    cr_assert(deserializer._error == 0, "expect no error on read");
+    cr_expect(2 == read_tree->size, "expect the size of the view to be 2");
+
+    np_tree_elem_t *tmp = NULL;
+    RB_FOREACH (tmp, np_tree_s, read_tree) {
+      if (tmp->key.type == np_treeval_type_char_ptr &&
+          0 == strcmp("tree", tmp->key.value.s))
+        cr_expect(np_treeval_type_encoded == tmp->val.type,
+                  "expect nested tree to be still encoded");
+    }
+
+    // re-serialize the partially decoded tree
+    np_serialize_buffer_t serializer_2 = {
+        ._tree          = read_tree,
+        ._target_buffer = buffer_2,
+        ._buffer_size   = sizeof(buffer_2),
+        ._error         = 0,
+        ._bytes_written = 0,
+    };
+    np_serializer_write_map(context, &serializer_2, read_tree);
+    cr_assert(serializer_2._error == 0, "expect no error on write");
+    cr_expect(serializer._bytes_written == serializer_2._bytes_written,
+              "expect the same serialization size");
+    cr_expect(0 == memcmp(buffer, buffer_2, serializer._bytes_written),
+              "expect the same serialization");
+
+    tmp = np_tree_find_str(read_tree, NP_SERIALISATION_USERDATA);
+    cr_assert(NULL != tmp, "expect element to be present");
+    cr_expect((unsigned char *)tmp->val.value.bin >= buffer &&
+                  (unsigned char *)tmp->val.value.bin <
+                      buffer + serializer._bytes_written,
+              "expect user data to point into the buffer");
+
+    tmp = np_tree_find_str(read_tree, "tree");
+    cr_assert(NULL != tmp, "expect element to be present");
+    cr_expect(np_treeval_type_jrb_tree == tmp->val.type,
+              "expect nested tree to be decoded on access");
+    cr_expect(NULL != np_tree_find_str(tmp->val.value.tree, "sub"),
+              "expect subtree element to be present");
+
+    np_tree_free(read_tree);
+    np_tree_free(sub_tree);
+    np_tree_free(write_tree);
+  }
+}
+
 Test(test_serialization,
      np_token_serialization,
      .description = "test the serialization of a np_token") {}
@@ -4,6 +4,7 @@
 //
 #include <criterion/criterion.h>
 
+#include "np_eventqueue.h"
 #include "np_key.h"
 #include "np_keycache.h"
 #include "np_memory.h"
@@ -69,3 +70,39 @@ Test(np_key_t, _key_cmp, .description = "test compare function for np_keys")
 		cr_expect(0 > _np_key_cmp_inv(key_c, key_a), "expect keys to be not the same");
 	}
 }
+
+Test(np_key_t, _key_mailbox, .description = "test queueing of events for a busy np_key")
+{
+	CTX() {
+		np_dhkey_t dhkey = { .t = { 11, 12, 13, 14, 15, 16, 17, 18 } };
+		np_key_t*  key   = _np_keycache_create(context, dhkey);
+
+		// synchronous callers execute their event right away
+		np_util_event_t noop = { .type = evt_noop, .target_dhkey = key->dhkey };
+		_np_key_handle_event(key, noop);
+		cr_expect(false == key->mailbox.busy, "expect key to be released");
+		cr_expect(0 == key->mailbox.size, "expect mailbox to be empty");
+		cr_expect(1 == key->mailbox.popped, "expect event to be executed");
+
+		// another job owns the key, events of job chains are queued
+		key->mailbox.busy = true;
+		_np_event_runtime_start_with_job_event(context, key->dhkey, noop);
+		_np_event_runtime_start_with_job_event(context, key->dhkey, noop);
+		cr_expect(2 == key->mailbox.size, "expect events to be queued");
+
+		// synchronous callers execute the queued events before their own one
+		_np_key_handle_event(key, noop);
+		cr_expect(0 == key->mailbox.size, "expect mailbox to be drained");
+		cr_expect(4 == key->mailbox.popped, "expect events to keep their order");
+		cr_expect(true == key->mailbox.busy, "expect owner to keep the key");
+
+		// the next job owns the key and drains the mailbox
+		_np_event_runtime_start_with_job_event(context, key->dhkey, noop);
+		key->mailbox.busy = false;
+		_np_event_runtime_start_with_job_event(context, key->dhkey, noop);
+		cr_expect(false == key->mailbox.busy, "expect key to be released");
+		cr_expect(0 == key->mailbox.size, "expect mailbox to be drained");
+		cr_expect(NULL == key->mailbox.head, "expect mailbox to be drained");
+		cr_expect(6 == key->mailbox.popped, "expect all events to be executed");
+	}
+}
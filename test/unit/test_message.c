@@ -4,6 +4,7 @@
 //
 #include <assert.h>
 #include <criterion/criterion.h>
+#include <inttypes.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -11,6 +12,7 @@
 
 #include "../test_macros.c"
 #include "pthread.h"
+#include "sodium.h"
 
 #include "neuropil_log.h"
 
@@ -484,3 +486,94 @@ Test(np_message_t,
     cr_assert(elem != NULL, "expected tree element to be present");
   }
 }
+
+Test(np_message_t,
+     _message_response_uuids,
+     .description = "test single and batched acknowledgements in a body") {
+  CTX() {
+    unsigned char uuids[3 * NP_UUID_BYTES];
+    randombytes_buf(uuids, sizeof(uuids));
+
+    uint32_t       count      = 0;
+    unsigned char *read_uuids = NULL;
+
+    // a single acknowledgement keeps the old key
+    np_tree_t *body = np_tree_create();
+    _np_message_set_response_uuids(body, uuids, 1);
+    cr_expect(NULL != np_tree_find_str(body, _NP_MSG_INST_RESPONSE_UUID),
+              "expect a single uuid to use the old key");
+    read_uuids = _np_message_get_response_uuids(body, &count);
+    cr_assert(NULL != read_uuids, "expect the uuid to be readable");
+    cr_expect(1 == count, "expect a single uuid");
+    cr_expect(0 == memcmp(uuids, read_uuids, NP_UUID_BYTES),
+              "expect the uuid to be unchanged");
+    np_tree_free(body);
+
+    // a batch survives the serialization of the ack message
+    body = np_tree_create();
+    _np_message_set_response_uuids(body, uuids, 3);
+
+    np_dhkey_t               subject = {0};
+    struct np_e2e_message_s *msg_out = NULL;
+    np_new_obj(np_message_t, msg_out);
+    _np_message_create(msg_out,
+                       context->my_node_key->dhkey,
+                       context->my_node_key->dhkey,
+                       subject,
+                       body);
+    cr_assert(_np_message_serialize_chunked(context, msg_out));
+
+    struct np_e2e_message_s *msg_in = NULL;
+    np_new_obj(np_message_t, msg_in);
+    uint16_t count_of_chunks = 0;
+    _np_message_add_chunk(msg_in, msg_out->msg_chunks[0], &count_of_chunks);
+    cr_assert(_np_message_deserialize_chunks(msg_in));
+    cr_assert(_np_message_readbody(msg_in));
+
+    read_uuids = _np_message_get_response_uuids(msg_in->msg_body, &count);
+    cr_assert(NULL != read_uuids, "expect the batch to be readable");
+    cr_expect(3 == count, "expect three uuids, but got %" PRIu32, count);
+    cr_expect(0 == memcmp(uuids, read_uuids, sizeof(uuids)),
+              "expect the uuids to be unchanged");
+
+    np_unref_obj(np_message_t, msg_in, ref_obj_creation);
+    np_unref_obj(np_message_t, msg_out, ref_obj_creation);
+    np_tree_free(body);
+
+    // malformed lists are rejected
+    uint32_t malformed_sizes[] = {0, NP_UUID_BYTES - 1, NP_UUID_BYTES + 1};
+    for (uint8_t i = 0; i < 3; i++) {
+      body = np_tree_create();
+      np_tree_insert_str(body,
+                         _NP_MSG_INST_RESPONSE_UUIDS,
+                         np_treeval_new_bin(uuids, malformed_sizes[i]));
+      cr_expect(NULL == _np_message_get_response_uuids(body, &count),
+                "expect a batch of %" PRIu32 " bytes to be rejected",
+                malformed_sizes[i]);
+      cr_expect(0 == count, "expect no uuids of a malformed batch");
+      np_tree_free(body);
+
+      body = np_tree_create();
+      np_tree_insert_str(body,
+                         _NP_MSG_INST_RESPONSE_UUID,
+                         np_treeval_new_bin(uuids, malformed_sizes[i]));
+      cr_expect(NULL == _np_message_get_response_uuids(body, &count),
+                "expect a uuid of %" PRIu32 " bytes to be rejected",
+                malformed_sizes[i]);
+      np_tree_free(body);
+    }
+
+    body = np_tree_create();
+    np_tree_insert_str(body,
+                       _NP_MSG_INST_RESPONSE_UUIDS,
+                       np_treeval_new_s("not a uuid list"));
+    cr_expect(NULL == _np_message_get_response_uuids(body, &count),
+              "expect a batch of the wrong type to be rejected");
+    np_tree_free(body);
+
+    body = np_tree_create();
+    cr_expect(NULL == _np_message_get_response_uuids(body, &count),
+              "expect a body without uuids to be rejected");
+    np_tree_free(body);
+  }
+}
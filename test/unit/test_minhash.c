@@ -3,6 +3,7 @@
 // SPDX-License-Identifier: OSL-3.0
 //
 #include <criterion/criterion.h>
+#include <criterion/logging.h>
 #include <inttypes.h>
 
 #include "../test_macros.c"
@@ -14,6 +15,7 @@
 #include "util/np_treeval.h"
 
 #include "np_dhkey.h"
+#include "np_time.h"
 
 TestSuite(np_minhash_t);
 
@@ -1450,6 +1452,55 @@ Test(np_minhash_t,
   */
 }
 
+Test(np_minhash_t,
+     _minhash_push_batch,
+     .description = "test that a batch of values creates the same signature") {
+  const uint16_t count = 1000;
+  np_dhkey_t     seed =
+      _np_msgproperty_dhkey(INBOUND, "urn:np:test:minhash:v4");
+
+  unsigned char        values[count][24];
+  const unsigned char *bytes[count];
+  uint16_t             lengths[count];
+  for (uint16_t i = 0; i < count; i++) {
+    randombytes_buf(values[i], 24);
+    bytes[i]   = values[i];
+    lengths[i] = 8 + i % 16;
+  }
+
+  enum np_mixhash_mode modes[] = {MIXHASH_MULTI,
+                                  MIXHASH_SINGLE,
+                                  MIXHASH_DATADEPENDANT_FIX};
+  for (uint8_t m = 0; m < 3; m++) {
+    np_minhash_t minhash_1 = {0};
+    np_minhash_t minhash_2 = {0};
+    np_minhash_init(&minhash_1, 256, modes[m], seed);
+    np_minhash_init(&minhash_2, 256, modes[m], seed);
+
+    double start = _np_time_now(NULL);
+    for (uint16_t i = 0; i < count; i++)
+      np_minhash_push(&minhash_1, bytes[i], lengths[i]);
+    double single_time = _np_time_now(NULL) - start;
+
+    start = _np_time_now(NULL);
+    np_minhash_push_batch(&minhash_2, bytes, lengths, count);
+    double batch_time = _np_time_now(NULL) - start;
+
+    cr_log_info("minhash mode %" PRIu8 ": %.1f us (single) / %.1f us (batch)\n",
+                m,
+                single_time * 1e6,
+                batch_time * 1e6);
+
+    cr_expect(0 == memcmp(minhash_1._minimums,
+                          minhash_2._minimums,
+                          256 * sizeof(uint32_t)),
+              "expect the signatures to be equal");
+
+    np_minhash_destroy(&minhash_1);
+    np_minhash_destroy(&minhash_2);
+  }
+}
+
 /*
 @contexthttp
 httpwww
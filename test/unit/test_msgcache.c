@@ -0,0 +1,115 @@
+//
+// SPDX-FileCopyrightText: 2016-2024 by pi-lar GmbH
+// SPDX-License-Identifier: OSL-3.0
+//
+#include <criterion/criterion.h>
+#include <criterion/logging.h>
+#include <inttypes.h>
+
+#include "../test_macros.c"
+
+#include "util/np_msgcache.h"
+
+#include "np_dhkey.h"
+
+TestSuite(np_msgcache_t);
+
+static bool __test_msgcache_count(void *item, void *userdata) {
+  uint32_t *count = userdata;
+  (*count)++;
+  return true;
+}
+
+static bool __test_msgcache_even_audience(np_dhkey_t audience,
+                                          NP_UNUSED void *userdata) {
+  return (audience.t[0] % 2) == 0;
+}
+
+Test(np_msgcache_t,
+     _np_msgcache_add_pop,
+     .description = "test the insertion order and the expiry index") {
+  np_msgcache_t *cache = _np_msgcache_create(4);
+
+  uint32_t items[1000];
+  for (uint32_t i = 0; i < 1000; i++) {
+    items[i]            = i;
+    np_dhkey_t audience = {.t[0] = i % 7};
+    // expiry is a permutation of the insertion order
+    cr_expect(_np_msgcache_add(cache,
+                               &items[i],
+                               audience,
+                               (double)((i * 7919) % 1000),
+                               10));
+  }
+  cr_expect(1000 == _np_msgcache_size(cache));
+  cr_expect(10000 == _np_msgcache_bytes(cache));
+
+  cr_expect(&items[0] == _np_msgcache_pop(cache, false),
+            "expect FIFO to return the oldest item");
+  cr_expect(&items[999] == _np_msgcache_pop(cache, true),
+            "expect LIFO to return the newest item");
+
+  uint32_t *item    = NULL;
+  double    last    = -1.0;
+  uint32_t  expired = 0;
+  while (NULL != (item = _np_msgcache_pop_expired(cache, 500.0))) {
+    double expiry = (double)((*item * 7919) % 1000);
+    cr_expect(last <= expiry, "expect items to expire in order");
+    cr_expect(500.0 >= expiry, "expect only expired items");
+    last = expiry;
+    expired++;
+  }
+  cr_expect(1000 - 2 - expired == _np_msgcache_size(cache));
+  cr_expect(10 * _np_msgcache_size(cache) == _np_msgcache_bytes(cache));
+
+  _np_msgcache_free(cache);
+}
+
+Test(np_msgcache_t,
+     _np_msgcache_drain,
+     .description = "test the removal of items per audience") {
+  np_msgcache_t *cache = _np_msgcache_create(0);
+
+  uint32_t items[700];
+  for (uint32_t i = 0; i < 700; i++) {
+    items[i]            = i;
+    np_dhkey_t audience = {.t[0] = i % 7};
+    _np_msgcache_add(cache, &items[i], audience, 100.0, 1);
+  }
+
+  np_dhkey_t audience = {.t[0] = 3};
+  uint32_t   count    = 0;
+  cr_expect(100 == _np_msgcache_audience_size(cache, audience));
+  cr_expect(100 == _np_msgcache_drain(cache,
+                                      &audience,
+                                      false,
+                                      NULL,
+                                      __test_msgcache_count,
+                                      &count));
+  cr_expect(100 == count);
+  cr_expect(0 == _np_msgcache_audience_size(cache, audience));
+
+  // audiences 0, 2, 4 and 6
+  count = 0;
+  cr_expect(400 == _np_msgcache_drain(cache,
+                                      NULL,
+                                      true,
+                                      __test_msgcache_even_audience,
+                                      __test_msgcache_count,
+                                      &count));
+  cr_expect(400 == count);
+  cr_expect(200 == _np_msgcache_size(cache));
+
+  uint32_t *item = NULL;
+  uint32_t  last = 0;
+  while (NULL != (item = _np_msgcache_pop(cache, false))) {
+    cr_expect(1 == (*item % 7) || 5 == (*item % 7),
+              "expect only items of the remaining audiences");
+    cr_expect(last <= *item, "expect the insertion order to be kept");
+    last = *item;
+  }
+  cr_expect(0 == _np_msgcache_size(cache));
+  cr_expect(0 == _np_msgcache_bytes(cache));
+
+  _np_msgcache_free(cache);
+}
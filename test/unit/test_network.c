@@ -5,12 +5,18 @@
 
 #include <assert.h>
 #include <criterion/criterion.h>
+#include <fcntl.h>
 #include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "sodium.h"
 
 #include "../test_macros.c"
 
 #include "neuropil.h"
 
+#include "np_memory.h"
 #include "np_network.h"
 
 TestSuite(network_h);
@@ -308,3 +314,92 @@ Test(network_h,
   common = _np_network_count_common_tuples(ng, "invalid1", "invalid2");
   cr_expect_eq(common, 0, "Invalid IP addresses should return 0");
 }
+
+Test(network_h,
+     _np_network_stream_split_packages,
+     .description = "test packages which are split on a tcp stream") {
+  CTX() {
+    const uint16_t package_size = MSG_CHUNK_SIZE_1024 + MSG_INSTRUCTIONS_SIZE;
+
+    int fds[2];
+    cr_assert(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+
+    np_network_t *ng = NULL;
+    np_new_obj(np_network_t, ng);
+    sll_init(void_ptr, ng->out_events);
+    ng->socket_type = TCP | IPv4;
+    ng->socket      = fds[1];
+
+    unsigned char package[MSG_CHUNK_SIZE_1024 + MSG_INSTRUCTIONS_SIZE];
+    randombytes_buf(package, package_size);
+
+    // partial reads are collected until the package is complete
+    bool closed = false;
+    cr_assert(100 == write(fds[0], package, 100));
+    cr_expect(NULL == _np_network_stream_read_package(context,
+                                                      ng,
+                                                      fds[1],
+                                                      &closed),
+              "expect an incomplete package to stay in the stream buffer");
+    cr_expect(!closed, "expect the stream to be open");
+    cr_expect(100 == ng->stream_fill, "expect 100 bytes in the buffer");
+
+    cr_assert(package_size - 100 ==
+              write(fds[0], package + 100, package_size - 100));
+    void *read_package =
+        _np_network_stream_read_package(context, ng, fds[1], &closed);
+    cr_assert(NULL != read_package, "expect the package to be complete");
+    cr_expect(0 == memcmp(package, read_package, package_size),
+              "expect the package to be reassembled");
+    cr_expect(0 == ng->stream_fill, "expect the stream buffer to be empty");
+    np_unref_obj(BLOB_1024, read_package, ref_obj_creation);
+
+    // a full socket buffer interrupts the package, the next call continues
+    // at send_offset
+    unsigned char junk[512] = {0};
+    size_t        junk_size = 0;
+    ssize_t       written   = 0;
+    while ((written = write(fds[1], junk, sizeof(junk))) > 0)
+      junk_size += written;
+
+    np_dhkey_t     target    = {0};
+    unsigned char *received  = malloc(junk_size + package_size);
+    size_t         read_size = 0;
+    uint16_t       attempts  = 0;
+    while (!_np_network_send_data(context, ng, target, package)) {
+      cr_expect(ng->send_offset < package_size,
+                "expect an incomplete package to be continued");
+      ssize_t n = read(fds[0],
+                       received + read_size,
+                       MIN(256, junk_size + package_size - read_size));
+      if (n > 0) read_size += n;
+      cr_assert(++attempts < UINT16_MAX, "expect the package to be sent");
+    }
+    cr_expect(0 == ng->send_offset, "expect the package to be complete");
+
+    while (read_size < junk_size + package_size) {
+      ssize_t n = read(fds[0],
+                       received + read_size,
+                       junk_size + package_size - read_size);
+      cr_assert(n > 0, "expect the rest of the package to be readable");
+      read_size += n;
+    }
+    cr_expect(0 == memcmp(package, received + junk_size, package_size),
+              "expect the package to follow the junk without gaps");
+    free(received);
+
+    // the peer shuts down the stream
+    close(fds[0]);
+    cr_expect(NULL == _np_network_stream_read_package(context,
+                                                      ng,
+                                                      fds[1],
+                                                      &closed));
+    cr_expect(closed, "expect the closed stream to be detected");
+
+    close(fds[1]);
+    ng->socket = -1;
+    np_unref_obj(np_network_t, ng, ref_obj_creation);
+  }
+}
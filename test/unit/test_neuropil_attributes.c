@@ -15,6 +15,7 @@
 
 #include "util/np_bloom.h"
 
+#include "np_aaatoken.h"
 #include "np_attributes.h"
 
 TestSuite(neuropil_attributes);
@@ -492,4 +493,60 @@ Test(neuropil_attributes,
   cr_expect(memcmp(val_title.bin, not_matching_data2, conf.data_size) == 0,
             "attribute value is not matching expected value");
   memset(&conf, 0, sizeof(struct np_data_conf));
-}
\ No newline at end of file
+}
+Test(neuropil_attributes,
+     _check_policy_token_compliance,
+     .description = "test the compiled policy and its result cache") {
+  unsigned char matching_data[5] = "55487";
+  unsigned char other_data[6]    = "355487";
+
+  np_attribute_policy_t *policy = _np_attribute_policy_create();
+  np_aaatoken_t         *token  = calloc(1, sizeof(np_aaatoken_t));
+  np_init_datablock(token->attributes, sizeof(np_attributes_t));
+
+  cr_expect(_np_policy_check_token_compliance(NULL, token),
+            "expect a missing policy to accept every token");
+  cr_expect(_np_policy_check_token_compliance(policy, token),
+            "expect an empty policy to accept every token");
+
+  _np_policy_set_bin(policy->bloom,
+                     "test_key",
+                     matching_data,
+                     sizeof(matching_data));
+  policy->version++;
+  cr_expect(!_np_policy_check_token_compliance(policy, token),
+            "expect the changed policy to be compiled again");
+
+  struct np_data_conf conf = {.type = NP_DATA_TYPE_BIN};
+  strncpy(conf.key, "test_key", 255);
+  conf.data_size = sizeof(matching_data);
+  cr_expect(np_data_ok == np_set_data(token->attributes,
+                                      conf,
+                                      (np_data_value){.bin = matching_data}),
+            "Could not add data to attribute block");
+  token->attributes_mask_is_set = false;
+  cr_expect(_np_policy_check_token_compliance(policy, token),
+            "expect the token with the matching value to be compliant");
+  cr_expect(_np_policy_check_token_compliance(policy, token) ==
+                _np_policy_check_compliance(policy->bloom, &token->attributes),
+            "expect the same result as the bloom filter based check");
+
+  // the result of verified attributes is remembered by their signature
+  token->is_signature_attributes_verified = true;
+  randombytes_buf(token->attributes_signature, NP_SIGNATURE_BYTES);
+  cr_expect(_np_policy_check_token_compliance(policy, token),
+            "expect the token to be compliant");
+  cr_expect(1 == policy->next_result, "expect the result to be stored");
+  cr_expect(_np_policy_check_token_compliance(policy, token),
+            "expect the stored result to be used");
+  cr_expect(1 == policy->next_result, "expect no additional result");
+
+  _np_policy_set_bin(policy->bloom, "test_key", other_data, sizeof(other_data));
+  policy->version++;
+  cr_expect(!_np_policy_check_token_compliance(policy, token),
+            "expect the stored result to be outdated");
+  cr_expect(2 == policy->next_result, "expect the new result to be stored");
+
+  free(token);
+  _np_attribute_policy_free(policy);
+}
@@ -13,6 +13,8 @@
 
 #include "neuropil_data.h"
 
+#include "np_data.h"
+
 TestSuite(neuropil_data);
 
 Test(neuropil_data,
@@ -882,3 +884,89 @@ Test(neuropil_data,
                         MIN(data_size, deserialized_data_conf.data_size)),
             "Expected BIN data to be the same");
 }
+
+Test(neuropil_data,
+     _check_indexed_lookup,
+     .description = "test the key directory of a datablock") {
+  enum np_data_return tmp_ret;
+  struct np_data_conf conf = {0};
+  np_data_value       value;
+
+  size_t        datablock_size = 2000;
+  unsigned char datablock[datablock_size];
+  unsigned char datablock2[datablock_size];
+
+  np_init_datablock(datablock, datablock_size);
+  np_init_datablock(datablock2, datablock_size);
+
+  char key[255];
+  for (uint32_t i = 0; i < 20; i++) {
+    snprintf(key, 255, "key.%" PRIu32, i);
+    conf = (struct np_data_conf){.type = NP_DATA_TYPE_UNSIGNED_INT};
+    strncpy(conf.key, key, 255);
+    np_set_data(datablock, conf, (np_data_value){.unsigned_integer = i});
+  }
+
+  np_data_index_t index;
+  np_data_index_build(&index, datablock);
+  cr_assert(index.complete, "expect all keys to be indexed");
+
+  for (uint32_t i = 0; i < 20; i++) {
+    snprintf(key, 255, "key.%" PRIu32, i);
+    cr_expect(np_data_ok ==
+                  (tmp_ret = np_get_data_indexed(&index,
+                                                 datablock,
+                                                 key,
+                                                 &conf,
+                                                 &value)),
+              "expect to find %s. (ret: %" PRIu32 ")",
+              key,
+              tmp_ret);
+    cr_expect(value.unsigned_integer == i, "expect the value of %s", key);
+  }
+  cr_expect(np_key_not_found ==
+                np_get_data_indexed(&index, datablock, "key", &conf, &value),
+            "expect a missing key not to be found");
+
+  // a changed block is searched without the index
+  conf = (struct np_data_conf){.key = "key.3", .type = NP_DATA_TYPE_STR};
+  conf.data_size = 5;
+  np_set_data(datablock, conf, (np_data_value){.str = "three"});
+  cr_expect(np_data_ok == np_get_data_indexed(&index,
+                                              datablock,
+                                              "key.19",
+                                              &conf,
+                                              &value) &&
+                value.unsigned_integer == 19,
+            "expect an outdated index to be ignored");
+
+  // merging copies the new objects and keeps the unchanged ones
+  conf = (struct np_data_conf){.key = "key.3", .type = NP_DATA_TYPE_STR};
+  conf.data_size = 5;
+  np_set_data(datablock2, conf, (np_data_value){.str = "three"});
+  conf = (struct np_data_conf){.key = "key.7", .type = NP_DATA_TYPE_STR};
+  conf.data_size = 5;
+  np_set_data(datablock2, conf, (np_data_value){.str = "seven"});
+
+  cr_assert(np_data_ok == (tmp_ret = np_merge_data(datablock2, datablock)),
+            "expect merged data. (ret: %" PRIu32 ")",
+            tmp_ret);
+
+  uint32_t count = 0;
+  np_get_object_count(datablock2, &count);
+  cr_expect(20 == count, "expect 20 objects, not %" PRIu32, count);
+  for (uint32_t i = 0; i < 20; i++) {
+    snprintf(key, 255, "key.%" PRIu32, i);
+    cr_expect(np_data_ok == np_get_data(datablock2, key, &conf, &value),
+              "expect to find %s in the merged block",
+              key);
+    if (i == 3) {
+      cr_expect(0 == strncmp(value.str, "three", 5), "expect the new value");
+    } else {
+      cr_expect(conf.type == NP_DATA_TYPE_UNSIGNED_INT &&
+                    value.unsigned_integer == i,
+                "expect the value of %s",
+                key);
+    }
+  }
+}
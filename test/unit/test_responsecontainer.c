@@ -0,0 +1,74 @@
+//
+// SPDX-FileCopyrightText: 2016-2024 by pi-lar GmbH
+// SPDX-License-Identifier: OSL-3.0
+//
+#include <criterion/criterion.h>
+#include <criterion/logging.h>
+#include <inttypes.h>
+
+#include "../test_macros.c"
+#include "sodium.h"
+
+#include "np_responsecontainer.h"
+
+TestSuite(np_responsetable_t);
+
+Test(np_responsetable_t,
+     _np_responsetable_expiry,
+     .description = "test the uuid and expiry index of responsecontainers") {
+  const uint32_t          count   = 2000;
+  np_responsecontainer_t *entries = calloc(count, sizeof(*entries));
+  np_responsetable_t     *table   = _np_responsetable_create();
+  cr_assert(NULL != table, "expect the responsetable to be created");
+
+  for (uint32_t i = 0; i < count; i++) {
+    randombytes_buf(entries[i].uuid, NP_UUID_BYTES);
+    entries[i].expires_at = randombytes_uniform(10000) / 100.0;
+    cr_expect(_np_responsetable_insert(table, &entries[i]),
+              "expect entry #%" PRIu32 " to be inserted",
+              i);
+  }
+  cr_expect(!_np_responsetable_insert(table, &entries[0]),
+            "expect a duplicate uuid to be rejected");
+  cr_expect(count == _np_responsetable_size(table),
+            "expect all entries to be stored");
+
+  // acknowledge every third entry
+  for (uint32_t i = 0; i < count; i += 3) {
+    cr_expect(&entries[i] ==
+                  _np_responsetable_remove(table,
+                                           (unsigned char *)entries[i].uuid),
+              "expect entry #%" PRIu32 " to be removed",
+              i);
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    np_responsecontainer_t *found =
+        _np_responsetable_find(table, (unsigned char *)entries[i].uuid);
+    cr_expect((i % 3 == 0) ? NULL == found : &entries[i] == found,
+              "expect entry #%" PRIu32 " to be found if not acknowledged",
+              i);
+  }
+
+  uint32_t expected = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    if (i % 3 != 0 && entries[i].expires_at < 50.0) expected++;
+  }
+
+  uint32_t                expired = 0;
+  double                  last    = 0.0;
+  np_responsecontainer_t *entry   = NULL;
+  while (NULL != (entry = _np_responsetable_pop_expired(table, 50.0))) {
+    cr_expect(entry->expires_at >= last && entry->expires_at < 50.0,
+              "expect the entries to expire in order");
+    last = entry->expires_at;
+    expired++;
+  }
+  cr_expect(expected == expired,
+            "expect all %" PRIu32 " expired entries to be returned",
+            expected);
+  cr_expect(count - (count + 2) / 3 - expired == _np_responsetable_size(table),
+            "expect the other entries to remain");
+
+  _np_responsetable_free(table);
+  free(entries);
+}
@@ -0,0 +1,294 @@
+//
+// SPDX-FileCopyrightText: 2016-2024 by pi-lar GmbH
+// SPDX-License-Identifier: OSL-3.0
+//
+#include <criterion/criterion.h>
+#include <criterion/logging.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sodium.h"
+
+#include "../test_macros.c"
+
+#include "search/np_bktree.h"
+#include "search/np_search.h"
+
+#include "neuropil_data.h"
+
+#include "np_dhkey.h"
+#include "np_message.h"
+
+// not part of the search header, it is the callback of the search entry
+// subject
+bool _np_new_searchentry_cb(np_context                          *ac,
+                            const struct np_e2e_message_s *const entry_msg,
+                            np_tree_t                           *body,
+                            void                                *localdata);
+
+TestSuite(np_search_t);
+
+static np_searchentry_t *__search_entries = NULL;
+static bool             *__search_visited = NULL;
+
+static bool _search_visit_map(NP_UNUSED np_map_reduce_t *mr_struct,
+                              const void                *element) {
+  if (element != NULL)
+    __search_visited[(np_searchentry_t *)element - __search_entries] = true;
+  return true;
+}
+
+static uint16_t _search_distance(const np_dhkey_t *x, const np_dhkey_t *y) {
+  uint16_t ret = 0;
+  for (uint8_t k = 0; k < 8; k++) ret += __builtin_popcount(x->t[k] ^ y->t[k]);
+  return ret;
+}
+
+// visit the bktree with the given query radius and remember the entries
+static void _search_bktree_visit(np_bktree_t *tree,
+                                 uint32_t     query,
+                                 bool        *visited,
+                                 uint32_t     count) {
+  memset(visited, 0, count * sizeof(bool));
+  __search_visited   = visited;
+  np_map_reduce_t mr = {.map = _search_visit_map};
+  mr.map_args.io     = &__search_entries[query];
+  np_bktree_query(tree,
+                  __search_entries[query].search_index.lower_dhkey,
+                  &__search_entries[query],
+                  &mr);
+}
+
+static void _search_add_urn(np_attributes_t *attributes, uint32_t i) {
+  char urn[32];
+  snprintf(urn, 32, "urn:np:test:search:%" PRIu32, i);
+
+  struct np_data_conf conf = {.type = NP_DATA_TYPE_STR};
+  np_init_datablock(*attributes, sizeof(np_attributes_t));
+  strncpy(conf.key, "urn", 255);
+  conf.data_size = strnlen(urn, 32);
+  np_set_data(*attributes, conf, (np_data_value){.str = urn});
+}
+
+static const char *__test_search_texts[] = {
+    "Japan's trade surplus grew 5.3 percent from a year earlier to 11.46 "
+    "billion dollars in February",
+    "A severe water shortage in Beijing has prompted the city to again hike "
+    "prices, possibly by up to twenty percent",
+    "Christl Haas, the Austrian skier who won the women's downhill at the "
+    "1964 Olympics, drowned while swimming",
+    "Soccer Australia officials announced an Australian team to play "
+    "Scotland in an international friendly match",
+};
+
+Test(np_search_t,
+     _search_add_entries,
+     .description = "test adding a batch of search entries and querying them") {
+  CTX() {
+    np_search_settings_t *settings = np_default_searchsettings();
+    settings->enable_remote_peers  = false;
+    np_searchnode_init(context, settings);
+    free(settings);
+
+    const uint32_t    count = 4;
+    np_searchentry_t *entries[4];
+    char              subjects[4][255];
+
+    for (uint32_t i = 0; i < count; i++) {
+      np_attributes_t attributes = {0};
+      _search_add_urn(&attributes, i);
+
+      entries[i] = calloc(1, sizeof(np_searchentry_t));
+      cr_assert(np_create_searchentry(context,
+                                      entries[i],
+                                      __test_search_texts[i],
+                                      &attributes),
+                "expect search entry %" PRIu32 " to be created",
+                i);
+      strncpy(subjects[i], entries[i]->intent.subject, 255);
+    }
+
+    // the search node owns the entries from now on
+    np_search_add_entries(context, entries, count);
+
+    for (uint32_t i = 0; i < count; i++) {
+      np_attributes_t   attributes = {0};
+      np_searchquery_t *query      = calloc(1, sizeof(np_searchquery_t));
+      np_init_datablock(attributes, sizeof(np_attributes_t));
+      cr_assert(np_create_searchquery(context,
+                                      query,
+                                      __test_search_texts[i],
+                                      &attributes));
+      np_search_query(context, query);
+
+      bool       found      = false;
+      np_tree_t *result_set = np_tree_create();
+      cr_expect(np_search_get_resultset(context, query, result_set),
+                "expect results for the text of entry %" PRIu32,
+                i);
+      np_tree_elem_t *tmp = NULL;
+      RB_FOREACH (tmp, np_tree_s, result_set) {
+        np_searchresult_t *result = tmp->val.value.v;
+        found |= (0 == strncmp(result->result_entry->intent.subject,
+                               subjects[i],
+                               255));
+      }
+      cr_expect(found, "expect entry %" PRIu32 " to be found", i);
+      np_tree_free(result_set);
+    }
+  }
+}
+
+Test(np_search_t,
+     _search_entry_batch_malformed,
+     .description = "test the rejection of malformed search entry batches") {
+  CTX() {
+    np_search_settings_t *settings = np_default_searchsettings();
+    settings->enable_remote_peers  = false;
+    np_searchnode_init(context, settings);
+    free(settings);
+
+    unsigned char           msg_uuid[NP_UUID_BYTES] = {0};
+    struct np_e2e_message_s msg                     = {.uuid = msg_uuid};
+    np_tree_t               pipelines               = {0};
+
+    // the batch announces two entries, but the first one is missing
+    np_tree_t *entry_batch = np_tree_create();
+    np_tree_t *empty_entry = np_tree_create();
+    np_tree_insert_int(entry_batch, 1, np_treeval_new_tree(empty_entry));
+    np_tree_insert_int(entry_batch, 2, np_treeval_new_tree(empty_entry));
+    np_tree_t *body = np_tree_create();
+    np_tree_insert_str(body, "entry.batch", np_treeval_new_tree(entry_batch));
+    cr_expect(!_np_new_searchentry_cb(context, &msg, body, &pipelines),
+              "expect a batch with missing entries to be rejected");
+    np_tree_free(body);
+    np_tree_free(entry_batch);
+
+    // an entry without index and intent
+    entry_batch = np_tree_create();
+    np_tree_insert_int(entry_batch, 0, np_treeval_new_tree(empty_entry));
+    body = np_tree_create();
+    np_tree_insert_str(body, "entry.batch", np_treeval_new_tree(entry_batch));
+    cr_expect(!_np_new_searchentry_cb(context, &msg, body, &pipelines),
+              "expect a batch with an invalid entry to be rejected");
+    cr_expect(0 == pipelines.size, "expect no pipeline to be stored");
+    np_tree_free(body);
+    np_tree_free(entry_batch);
+    np_tree_free(empty_entry);
+  }
+}
+
+Test(np_search_t,
+     _search_bktree_pruning,
+     .description = "test that the query radius only prunes far entries") {
+  const uint32_t count  = 2000;
+  const uint16_t radius = 64;
+
+  // every fourth entry is random, the others are close to their predecessor
+  __search_entries = calloc(count, sizeof(np_searchentry_t));
+  for (uint32_t i = 0; i < count; i++) {
+    np_dhkey_t *key = &__search_entries[i].search_index.lower_dhkey;
+    if (i % 4 == 0) {
+      randombytes_buf(key, sizeof(np_dhkey_t));
+    } else {
+      _np_dhkey_assign(key, &__search_entries[i - 1].search_index.lower_dhkey);
+      for (uint8_t j = 0; j < 12; j++) {
+        uint8_t bit = randombytes_uniform(256);
+        key->t[bit / 32] ^= (1u << (bit % 32));
+      }
+    }
+    snprintf(__search_entries[i].intent.subject, 255, "entry.%" PRIu32, i);
+  }
+
+  np_dhkey_t  seed     = {0};
+  np_bktree_t full     = {0};
+  np_bktree_t pruned   = {0};
+  bool       *expected = calloc(count, sizeof(bool));
+  bool       *visited  = calloc(count, sizeof(bool));
+
+  // a radius of the whole key does not prune anything
+  np_bktree_init(&full, seed, 256);
+  np_bktree_init(&pruned, seed, radius);
+  for (uint32_t i = 0; i < count; i++) {
+    np_bktree_insert(&full,
+                     __search_entries[i].search_index.lower_dhkey,
+                     &__search_entries[i]);
+    np_bktree_insert(&pruned,
+                     __search_entries[i].search_index.lower_dhkey,
+                     &__search_entries[i]);
+  }
+
+  for (uint32_t q = 0; q < count; q += 37) {
+    _search_bktree_visit(&full, q, expected, count);
+    _search_bktree_visit(&pruned, q, visited, count);
+
+    cr_expect(visited[q], "expect entry %" PRIu32 " to find itself", q);
+    // compare against an exhaustive scan of the distances: every entry the
+    // unpruned tree visits within the radius is visited by the pruned tree
+    for (uint32_t i = 0; i < count; i++) {
+      uint16_t distance =
+          _search_distance(&__search_entries[i].search_index.lower_dhkey,
+                           &__search_entries[q].search_index.lower_dhkey);
+      if (expected[i] && distance <= radius) {
+        cr_expect(visited[i],
+                  "expect entry %" PRIu32 " at distance %" PRIu16
+                  " not to be pruned for query %" PRIu32,
+                  i,
+                  distance,
+                  q);
+      }
+      cr_expect(!visited[i] || expected[i],
+                "expect pruning not to add entry %" PRIu32,
+                i);
+    }
+  }
+
+  np_bktree_destroy(&full);
+  np_bktree_destroy(&pruned);
+  free(expected);
+  free(visited);
+  free(__search_entries);
+  __search_entries = NULL;
+}
+
+Test(np_search_t,
+     _search_query_top_k,
+     .description = "test that a local query keeps the best results only") {
+  CTX() {
+    np_search_settings_t *settings = np_default_searchsettings();
+    settings->enable_remote_peers  = false;
+    np_searchnode_init(context, settings);
+    free(settings);
+
+    // all entries match the query, an exhaustive search would return them all
+    const uint32_t    count   = NP_SEARCH_QUERY_TOP_K + 16;
+    np_searchentry_t *entries[NP_SEARCH_QUERY_TOP_K + 16];
+    for (uint32_t i = 0; i < count; i++) {
+      np_attributes_t attributes = {0};
+      _search_add_urn(&attributes, i);
+
+      entries[i] = calloc(1, sizeof(np_searchentry_t));
+      cr_assert(np_create_searchentry(context,
+                                      entries[i],
+                                      __test_search_texts[0],
+                                      &attributes));
+    }
+    np_search_add_entries(context, entries, count);
+
+    np_attributes_t   attributes = {0};
+    np_searchquery_t *query      = calloc(1, sizeof(np_searchquery_t));
+    np_init_datablock(attributes, sizeof(np_attributes_t));
+    cr_assert(np_create_searchquery(context,
+                                    query,
+                                    __test_search_texts[0],
+                                    &attributes));
+    np_search_query(context, query);
+
+    struct np_searchquery result_query = {.query_id = query->query_id};
+    cr_expect(NP_SEARCH_QUERY_TOP_K ==
+                  pysearch_pullresult_size(context, &result_query),
+              "expect the result set to be capped at the top %d entries",
+              NP_SEARCH_QUERY_TOP_K);
+  }
+}
@@ -0,0 +1,93 @@
+//
+// SPDX-FileCopyrightText: 2016-2024 by pi-lar GmbH
+// SPDX-License-Identifier: OSL-3.0
+//
+#include <criterion/criterion.h>
+#include <criterion/logging.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "sodium.h"
+
+#include "../test_macros.c"
+
+#include "search/np_index.h"
+#include "search/np_searchsnapshot.h"
+
+#include "np_dhkey.h"
+
+TestSuite(np_searchsnapshot_t);
+
+Test(np_searchsnapshot_t,
+     _searchsnapshot_roundtrip,
+     .description = "test writing, mapping and verifying a search snapshot") {
+  const char       *filename = "test_searchsnapshot.npsi";
+  const uint32_t    count    = 16;
+  np_dhkey_t        seeds[4];
+  np_searchentry_t *entries[16];
+
+  randombytes_buf(seeds, sizeof(seeds));
+  for (uint32_t i = 0; i < count; i++) {
+    entries[i] = calloc(1, sizeof(np_searchentry_t));
+    np_index_init(&entries[i]->search_index);
+    randombytes_buf(&entries[i]->search_index.lower_dhkey, sizeof(np_dhkey_t));
+    _np_neuropil_bloom_add(entries[i]->search_index._clk_hash,
+                           entries[i]->search_index.lower_dhkey);
+    snprintf(entries[i]->intent.subject, 255, "entry.%" PRIu32, i);
+  }
+
+  cr_assert(
+      np_ok == np_searchsnapshot_write(filename, seeds, 4, entries, count),
+      "expect the snapshot to be written");
+
+  np_searchsnapshot_t snapshot = {0};
+  cr_assert(np_ok == np_searchsnapshot_open(&snapshot, filename),
+            "expect the snapshot to be valid");
+  cr_expect(4 == snapshot.table_count, "expect the seeds to be restored");
+  cr_expect(count == snapshot.entry_count, "expect all entries to be stored");
+  cr_expect(0 == memcmp(seeds, snapshot.seeds, sizeof(seeds)),
+            "expect the seeds to be equal");
+
+  for (uint32_t i = 0; i < count; i++) {
+    np_searchentry_t *entry = np_searchsnapshot_entry(&snapshot, i);
+    cr_expect(_np_dhkey_equal(&entry->search_index.lower_dhkey,
+                              &entries[i]->search_index.lower_dhkey),
+              "expect the index of entry %" PRIu32 " to be equal",
+              i);
+    cr_expect(0 == strncmp(entry->intent.subject,
+                           entries[i]->intent.subject,
+                           255),
+              "expect the intent of entry %" PRIu32 " to be equal",
+              i);
+    cr_expect(_np_neuropil_bloom_check(entry->search_index._clk_hash,
+                                       entries[i]->search_index.lower_dhkey),
+              "expect the bloom filter of entry %" PRIu32 " to be equal",
+              i);
+
+    np_searchsnapshot_release(&snapshot, entry);
+    cr_expect(NULL == entry->search_index._clk_hash->_bitset,
+              "expect the mapped bitset to be released");
+    np_index_destroy(&entry->search_index);
+    free(entry);
+  }
+  np_searchsnapshot_close(&snapshot);
+
+  // flip a single bit of the last record
+  FILE *file = fopen(filename, "r+b");
+  fseek(file, -1, SEEK_END);
+  int last = fgetc(file);
+  fseek(file, -1, SEEK_END);
+  fputc(last ^ 0x01, file);
+  fclose(file);
+
+  cr_expect(np_operation_failed == np_searchsnapshot_open(&snapshot, filename),
+            "expect a damaged snapshot to be rejected");
+
+  for (uint32_t i = 0; i < count; i++) {
+    np_index_destroy(&entries[i]->search_index);
+    free(entries[i]);
+  }
+  unlink(filename);
+}
@@ -134,3 +134,55 @@ Test(np_util_statemachine_t, _np_util_statemachine_token, .description = "test t
         np_util_statemachine_invoke_auto_transition(&sm, ev);
     }
 };
+
+int conditions_called = 0;
+
+bool counting_condition(np_util_statemachine_t* statemachine, const np_util_event_t event) {
+    conditions_called++;
+    return true;
+}
+
+uint8_t test_data_type(const np_util_event_t event) {
+    return (event.user_data == NULL) ? 0 : 1;
+}
+
+Test(np_util_statemachine_t, np_util_statemachine_t_dispatch, .description = "test the precompiled dispatch of transitions") {
+
+    np_util_statemachine_t sm;
+
+    np_util_statemachine_state_t* states[MAX_STATES] = {0};
+    int data = 0;
+
+    NP_UTIL_STATEMACHINE_STATE(states, IDLE, "idle", _noop_state_action, _noop_state_action, _noop_state_action);
+        NP_UTIL_STATEMACHINE_TRANSITION_ON(states, IDLE, RUNNING, action, counting_condition, evt_external | evt_message, 1);
+        NP_UTIL_STATEMACHINE_TRANSITION_ON(states, IDLE, INVALID, action, counting_condition, evt_shutdown, 0);
+        NP_UTIL_STATEMACHINE_TRANSITION(states, IDLE, IDLE, action, counting_condition);
+
+    NP_UTIL_STATEMACHINE_STATE(states, RUNNING, "running", _noop_state_action, _noop_state_action, _noop_state_action);
+    NP_UTIL_STATEMACHINE_STATE(states, INVALID, "invalid", _noop_state_action, _noop_state_action, _noop_state_action);
+
+    np_util_statemachine_compile(states, MAX_STATES, test_data_type, 2);
+    cr_assert(states[IDLE]->_dispatch != NULL, "expect the state to be compiled");
+
+    NP_UTIL_STATEMACHINE_INIT(sm, NULL, IDLE, states, NULL);
+
+    // the message transition requires user data, only the last transition is a candidate
+    np_util_event_t ev = { .type=evt_external | evt_message };
+    cr_assert(np_util_statemachine_invoke_auto_transition(&sm, ev) == true, "expect a transition");
+    cr_assert(np_util_statemachine_get_state(&sm) == IDLE, "expect state IDLE");
+    cr_assert(conditions_called == 1, "expect a single condition call, not %d", conditions_called);
+    cr_assert(states[IDLE]->_transition_table[0]._evaluated == 0, "expect no condition call");
+    cr_assert(states[IDLE]->_transition_table[2]._hits == 1, "expect a hit counter of 1");
+
+    // a missing event bit excludes the message transition as well
+    ev = (struct np_util_event_s) { .type=evt_external, .user_data=&data };
+    np_util_statemachine_invoke_auto_transition(&sm, ev);
+    cr_assert(np_util_statemachine_get_state(&sm) == IDLE, "expect state IDLE");
+    cr_assert(conditions_called == 2, "expect a single condition call, not %d", conditions_called);
+
+    ev = (struct np_util_event_s) { .type=evt_external | evt_message | evt_internal, .user_data=&data };
+    np_util_statemachine_invoke_auto_transition(&sm, ev);
+    cr_assert(np_util_statemachine_get_state(&sm) == RUNNING, "expect state RUNNING");
+    cr_assert(conditions_called == 3, "expect a single condition call, not %d", conditions_called);
+    cr_assert(states[IDLE]->_transition_table[0]._hits == 1, "expect a hit counter of 1");
+}
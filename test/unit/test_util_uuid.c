@@ -3,12 +3,16 @@
 // SPDX-License-Identifier: OSL-3.0
 //
 #include <criterion/criterion.h>
+#include <pthread.h>
+
+#include "sodium.h"
 
 #include "neuropil_log.h"
 
 #include "util/np_event.h"
 
 #include "np_evloop.h"
+#include "np_legacy.h"
 #include "np_log.h"
 #include "np_util.h"
 
@@ -78,3 +82,114 @@ Test(np_uuid_t,
   }
   cr_expect(uuid_tree->size == 0, "expect the tree to have no elements");
 }
+
+#define UUID_THREADS 4
+#define UUID_PER_THREAD 500
+
+static void *__test_uuid_thread(void *arg) {
+  unsigned char *uuids = arg;
+  for (int i = 0; i < UUID_PER_THREAD; i++) {
+    unsigned char *uuid = &uuids[i * NP_UUID_BYTES];
+    np_uuid_create("this.is.a.test", i, &uuid);
+  }
+  return NULL;
+}
+
+Test(np_uuid_t,
+     _uuid_threads,
+     .description = "test the uniqueness of uuid's across threads") {
+  unsigned char uuids[UUID_THREADS * UUID_PER_THREAD * NP_UUID_BYTES];
+  pthread_t     threads[UUID_THREADS];
+
+  for (int t = 0; t < UUID_THREADS; t++) {
+    pthread_create(&threads[t],
+                   NULL,
+                   __test_uuid_thread,
+                   &uuids[t * UUID_PER_THREAD * NP_UUID_BYTES]);
+  }
+  for (int t = 0; t < UUID_THREADS; t++) {
+    pthread_join(threads[t], NULL);
+  }
+
+  for (int i = 0; i < UUID_THREADS * UUID_PER_THREAD; i++) {
+    for (int j = 0; j < i; j++) {
+      cr_expect(0 != memcmp(&uuids[i * NP_UUID_BYTES],
+                            &uuids[j * NP_UUID_BYTES],
+                            NP_UUID_BYTES),
+                "expect the uuid to be unique");
+    }
+  }
+}
+
+// the former uuid creation, hashing a formatted string with the current time
+static void __test_uuid_create_hashed(const char    *str,
+                                      uint32_t       num,
+                                      unsigned char *uuid_out) {
+  char   input[256] = {0};
+  double now        = _np_time_now(NULL);
+  snprintf(input, 255, "%64s:%010u:%16.16f", str, num, now);
+  crypto_generichash_blake2b(uuid_out,
+                             NP_UUID_BYTES,
+                             (unsigned char *)input,
+                             256,
+                             NULL,
+                             0);
+}
+
+Test(np_uuid_t,
+     _uuid_format,
+     .description = "test that the prefix and counter do not show in uuid's") {
+  const int     rounds = 1000;
+  unsigned char uuid[1000][NP_UUID_BYTES];
+  const size_t  prefix = NP_UUID_BYTES - sizeof(uint64_t);
+
+  for (int i = 0; i < rounds; i++) {
+    unsigned char *uuid_ptr = uuid[i];
+    np_uuid_create("urn:np:message:generate_message_id", i, &uuid_ptr);
+  }
+
+  for (int i = 1; i < rounds; i++) {
+    cr_expect(0 != memcmp(uuid[i - 1], uuid[i], prefix),
+              "expect consecutive uuid's not to share the thread prefix");
+
+    uint64_t last = 0, next = 0;
+    for (size_t j = prefix; j < NP_UUID_BYTES; j++) {
+      last = (last << 8) | uuid[i - 1][j];
+      next = (next << 8) | uuid[i][j];
+    }
+    cr_expect(next != last + 1,
+              "expect the counter not to be readable from the uuid");
+
+    for (int j = 0; j < i; j++) {
+      cr_expect(0 != memcmp(uuid[i], uuid[j], NP_UUID_BYTES),
+                "expect the uuid's to be unique");
+    }
+  }
+}
+
+// timing only, run with --filter to compare the creation methods
+Test(np_uuid_t,
+     _uuid_benchmark,
+     .disabled    = true,
+     .description = "compare the uuid creation with the hashed uuid's") {
+  const int      rounds    = 100000;
+  unsigned char  uuid[NP_UUID_BYTES];
+  unsigned char *uuid_ptr  = uuid;
+  char           subject[] = "urn:np:message:generate_message_id";
+
+  double start = _np_time_now(NULL);
+  for (int i = 0; i < rounds; i++) {
+    __test_uuid_create_hashed(subject, i, uuid);
+  }
+  double hashed = _np_time_now(NULL) - start;
+
+  start = _np_time_now(NULL);
+  for (int i = 0; i < rounds; i++) {
+    np_uuid_create(subject, i, &uuid_ptr);
+  }
+  double counted = _np_time_now(NULL) - start;
+
+  cr_log_info("uuid per message: %.1f ns (hashed) / %.1f ns (per thread)\n",
+              hashed / rounds * 1e9,
+              counted / rounds * 1e9);
+}
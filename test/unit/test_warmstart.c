@@ -0,0 +1,92 @@
+//
+// SPDX-FileCopyrightText: 2016-2024 by pi-lar GmbH
+// SPDX-License-Identifier: OSL-3.0
+//
+#include <criterion/criterion.h>
+#include <criterion/logging.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "../test_macros.c"
+
+#include "util/np_tree.h"
+#include "util/np_treeval.h"
+
+#include "np_aaatoken.h"
+#include "np_memory.h"
+#include "np_network.h"
+#include "np_token_factory.h"
+#include "np_warmstart.h"
+
+TestSuite(np_warmstart_t);
+
+Test(np_warmstart_t,
+     _warmstart_roundtrip,
+     .description = "test writing, reading and verifying a warm start file") {
+  CTX() {
+    const char *filename = "test_warmstart.npws";
+
+    np_handshake_token_t *token =
+        _np_token_factory_new_handshake_token(context,
+                                              UDP | IPv4,
+                                              "127.0.0.1",
+                                              "3141");
+    np_tree_t *body         = np_tree_create();
+    np_tree_t *section_data = np_tree_create();
+    np_tree_t *token_data   = np_tree_create();
+    np_aaatoken_encode(token_data, token);
+    np_tree_insert_int(section_data, 0, np_treeval_new_cwt(token_data));
+    np_tree_insert_str(body,
+                       _NP_WARMSTART_LEAFSET,
+                       np_treeval_new_tree(section_data));
+    np_tree_free(token_data);
+    np_tree_free(section_data);
+
+    cr_assert(np_ok == _np_warmstart_write_file(context, filename, body),
+              "expect the warm start file to be written");
+    np_tree_free(body);
+
+    body = np_tree_create();
+    cr_assert(np_ok == _np_warmstart_read_file(context, filename, body),
+              "expect the warm start file to be valid");
+
+    np_tree_elem_t *leafset = np_tree_find_str(body, _NP_WARMSTART_LEAFSET);
+    cr_assert(NULL != leafset, "expect the leafset section to be restored");
+    np_tree_elem_t *restored_data =
+        np_tree_find_int(leafset->val.value.tree, 0);
+    cr_assert(NULL != restored_data, "expect the node token to be restored");
+
+    np_aaatoken_t *restored =
+        np_token_factory_read_from_tree(context,
+                                        restored_data->val.value.tree);
+    cr_assert(NULL != restored, "expect the restored token to be valid");
+    cr_expect(FLAG_CMP(restored->type, np_aaatoken_type_handshake),
+              "expect the restored token to be a handshake token");
+    cr_expect(0 == strncmp(token->subject, restored->subject, 255),
+              "expect the address of the node to be equal");
+    cr_expect(0 == memcmp(token->signature,
+                          restored->signature,
+                          NP_SIGNATURE_BYTES),
+              "expect the signature to be equal");
+    np_unref_obj(np_aaatoken_t, restored, "np_token_factory_read_from_tree");
+    np_tree_free(body);
+
+    // flip a single bit of the last byte
+    FILE *file = fopen(filename, "r+b");
+    fseek(file, -1, SEEK_END);
+    int last = fgetc(file);
+    fseek(file, -1, SEEK_END);
+    fputc(last ^ 0x01, file);
+    fclose(file);
+
+    body = np_tree_create();
+    cr_expect(np_operation_failed ==
+                  _np_warmstart_read_file(context, filename, body),
+              "expect a damaged warm start file to be rejected");
+    np_tree_free(body);
+
+    np_unref_obj(np_aaatoken_t, token, "_np_token_factory_new_handshake_token");
+    unlink(filename);
+  }
+}